@@ -1,9 +1,32 @@
-// ESP32 Victron Monitor (version 1.9.7)
+// ESP32 Victron Monitor (version 2.0)
 //
 // Copyright Rob Latour, 2025
 // License: MIT
 // https://github.com/roblatour/ESP32RemoteForVictron
 //
+// version 2.0   - each value is now tracked individually; values that have not been updated recently are dimmed and re-requested from Venus
+//                 MQTT callbacks now queue any subscribe, unsubscribe or publish actions, which are then carried out from loop()
+//                 the display is now only redrawn when something shown on it has changed
+//                 payloads identical to the last one received on the same topic are no longer parsed again
+//                 numbers are now formatted without using Strings; when GENERAL_SETTINGS_ROUND_NUMBERS is false numbers are now truncated as documented
+//                 added a frame signature to the verbose debug output, and a 'screenshot' serial monitor command
+//                 periodical keep alive requests can ask Venus not to publish all topics again (see GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES); connection and mode change timings are reported
+//                 added 'record', 'stop' and 'recording' serial monitor commands to capture the MQTT traffic received, which the host build can replay (see host/traffic_replay.h)
+//                 added ingestion statistics (message rates, time spent receiving, late loop passes, heap low water mark) and a 'stats' serial monitor command
+//                 added a histogram of the time taken by each stage of loop(), with 'profile' and 'reset' serial monitor commands
+//                 added a trace recorder for MQTT, display, network and button events, with 'trace on', 'trace off' and 'trace' serial monitor commands
+//                 added a history of the main values in PSRAM: every second for an hour, about every minute for 3 days and about every 17 minutes for 48 days, and a 'history' serial monitor command
+//                 added energy totals for today and yesterday, and GENERAL_SETTINGS_ADDITIONAL_INFO option 5 to show today's solar energy
+//                 added a scrolling power chart, shown by pressing both buttons together
+//                 added a log of the main values and the battery temperature, averaged over each minute, kept in the FFat partition, and a 'log' serial monitor command
+//                 the power chart can also show the last hour, day, week or 30 days, read from the history
+//                 added a web server with the current values at /status.json and the history at /history (see GENERAL_SETTINGS_ENABLE_HTTP_SERVER)
+//                 added a gateway mode, in which one device publishes all of the values in one message for other devices to use (see GENERAL_SETTINGS_GATEWAY_MODE)
+//                 where several devices are used, one of them can be elected to send the periodical keep alive requests (see GENERAL_SETTINGS_ELECT_KEEP_ALIVE_LEADER)
+//                 the state of charge, power and voltage of each battery can be received, read with a streaming JSON filter, and sent with a 'batteries' serial monitor command
+//                 the power and state of every solar charger and VE.Bus unit can be received, and are sent with their totals with a 'devices' serial monitor command
+//                 the topics of every solar charger and VE.Bus unit are passed to their handlers by a trie of the topic filters (see topic_router.h)
+//                 added a browser of every topic Venus publishes, shown from the power chart (see GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER), and a 'topics' serial monitor command
 // version 1.9.7 - added option to show wattage coming into / going out of battery
 // version 1.9.6 - corrected problem with displaying total AC Load; ShouldTheDisplayBeOn tweaked to ensure SleepTime is correctly calculated
 // version 1.9.5 - adjusted calculation of solar watts and total grid watts when over 100kw to avoid displaying wrong results if updates not received when expected
@@ -63,7 +86,7 @@
 
 // Globals
 const String programName = "ESP32 Remote for Victron";
-const String programVersion = "(Version 1.9.7)";
+const String programVersion = "(Version 2.0)";
 const String programURL = "https://github.com/roblatour/ESP32RemoteForVictron";
 
 RTC_DATA_ATTR bool initialStartupShowSplashScreen = true;
@@ -82,6 +105,82 @@ const int dataPoints = 13;
 bool awaitingDataToBeReceived[dataPoints];
 bool awaitingInitialTransmissionOfAllDataPoints;
 
+enum dataPoint
+{
+  GridInL1DataPoint,
+  GridInL2DataPoint,
+  GridInL3DataPoint,
+  SolarDataPoint,
+  BatterySOCDataPoint,
+  BatteryPowerDataPoint,
+  BatteryTTGDataPoint,
+  ChargingStateDataPoint,
+  BatteryTemperatureDataPoint,
+  ACOutL1DataPoint,
+  ACOutL2DataPoint,
+  ACOutL3DataPoint,
+  MultiplusModeDataPoint
+};
+
+// each data point keeps track of when it was last updated so that a value which has stopped being published
+// can be shown as stale and re-requested on its own, even while the other data points continue to arrive
+struct dataPointStatus
+{
+  unsigned long generation;          // incremented each time a new value is received, zero means no value has been received yet
+  unsigned long lastUpdateReceived;  // millis() when the value was last received
+  unsigned long lastReadRequestSent; // millis() when a read request for the value was last sent
+  bool staleAtSource;                // true if the gateway a sibling gets the value from has reported it as stale
+};
+dataPointStatus dataPointStatuses[dataPoints];
+
+// a value which has not changed is only received again because Venus republishes every value following each periodical keep alive request,
+// so a value is not treated as stale until it has missed at least one of those republishes, whatever GENERAL_SETTINGS_SECONDS_BEFORE_A_VALUE_IS_SHOWN_AS_STALE is set to
+const unsigned long staleAfterMilliSeconds = ((unsigned long)GENERAL_SETTINGS_SECONDS_BEFORE_A_VALUE_IS_SHOWN_AS_STALE * 1000UL > GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL * 3UL / 2UL)
+                                                 ? (unsigned long)GENERAL_SETTINGS_SECONDS_BEFORE_A_VALUE_IS_SHOWN_AS_STALE * 1000UL
+                                                 : GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL * 3UL / 2UL;
+
+// Duplicate payload detection
+//
+// Venus republishes every value following each keep alive request whether or not it has changed (unless GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES is true),
+// so the length and hash of the last payload received on each subscribed topic is kept and an identical payload is not parsed again
+//
+// each data point is received on the topic with the same index, except that when ESS is used the charging state comes from the three Multiplus LED topics below
+// and that a sibling of a gateway receives all of them on the gateway's snapshot topic
+
+enum multiplusLEDTopic
+{
+  MultiplusBulkLEDTopic = dataPoints,
+  MultiplusAbsorptionLEDTopic,
+  MultiplusFloatLEDTopic,
+  GatewaySnapshotTopic
+};
+const int subscribedTopics = dataPoints + 4;
+
+struct topicPayloadStatus
+{
+  bool payloadReceived;
+  unsigned int lastPayloadLength;
+  uint32_t lastPayloadHash;
+  unsigned long received;   // number of payloads received
+  unsigned long duplicates; // number of payloads that were identical to the one before
+  unsigned long parsed;     // number of payloads that were parsed
+};
+topicPayloadStatus topicPayloadStatuses[subscribedTopics];
+
+// Traffic recording
+//
+// when started from the serial monitor, every payload received on a subscribed topic is recorded (until the buffer is full) with its topic
+// and the time it was received, packed as a traffic log
+
+#include "traffic_log.h" // included in the github package for this sketch
+
+const int trafficRecordingSize = 16384;
+uint8_t trafficRecording[trafficRecordingSize];
+size_t trafficRecordingLength = 0;
+trafficLogWriter trafficRecordingWriter;
+bool recordingTraffic = false;
+unsigned long trafficRecordingStartedAt = 0UL;
+
 float gridInL1Watts = 0.0;
 float gridInL2Watts = 0.0;
 float gridInL3Watts = 0.0;
@@ -92,7 +191,7 @@ float batterySOC = 0.0;
 float batteryTTG = 0.0;
 float batteryPower = 0.0;
 float batteryTemperature = 0.0;
-String chargingState = "Unknown";
+const char *chargingState = "Unknown";
 
 float ACOutL1Watts = 0.0;
 float ACOutL2Watts = 0.0;
@@ -107,6 +206,7 @@ enum multiplusMode
   Unknown
 };
 multiplusMode currentMultiplusMode = Unknown;
+const char *multiplusModeNames[] = {"charger only", "inverter only", "on", "off", "unknown"};
 
 enum multiplusFunction
 {
@@ -116,9 +216,29 @@ enum multiplusFunction
 
 int topButton, bottomButton;
 
+enum buttonPress
+{
+  NoButtonPressed,
+  TopButtonPressed,
+  BottomButtonPressed,
+  BothButtonsPressed
+};
+
 // Display
 #include <TFT_eSPI.h>             // download and use the entire TFT_eSPI https://github.com/Xinyuan-LilyGO/LilyGo-AMOLED-Series/tree/master/libdeps
 #include "rm67162.h"              // included in the github package for this sketch, but also available from https://github.com/Xinyuan-LilyGO/T-Display-S3-AMOLED/tree/main/examples/factory
+#include "number_formatting.h"    // included in the github package for this sketch
+#include "latency_histogram.h"    // included in the github package for this sketch
+#include "trace_recorder.h"       // included in the github package for this sketch
+#include "history_pyramid.h"      // included in the github package for this sketch
+#include "energy.h"               // included in the github package for this sketch
+#include "telemetry_log.h"        // included in the github package for this sketch
+#include "status_snapshot.h"      // included in the github package for this sketch
+#include "keepalive_election.h"   // included in the github package for this sketch
+#include "json_stream.h"          // included in the github package for this sketch
+#include "device_registry.h"      // included in the github package for this sketch
+#include "topic_router.h"         // included in the github package for this sketch
+#include "topic_index.h"          // included in the github package for this sketch
 #include "fonts/NotoSansBold15.h" // included in the github package for this sketch, based on https://fonts.google.com/noto/specimen/Noto+Sans
 #include "fonts/NotoSansBold24.h" // "
 #include "fonts/NotoSansBold36.h" // "
@@ -127,6 +247,286 @@ int topButton, bottomButton;
 TFT_eSPI tft = TFT_eSPI();
 TFT_eSprite sprite = TFT_eSprite(&tft);
 
+const unsigned short staleValueColour = TFT_DARKGREY;
+
+// Change driven rendering
+//
+// the text, colour and any other value which determines how each part of the main screen is drawn is cached,
+// so that the main screen is only redrawn and pushed to the display when something visible on it has changed
+
+enum displayedScreen
+{
+  OtherScreen,
+  StatusMessageScreen,
+  MainScreen,
+  ChartScreen,
+  TopicBrowserScreen
+};
+displayedScreen screenShowing = OtherScreen;
+
+enum displayWidget
+{
+  ChargerWidget,
+  InverterWidget,
+  SolarWidget,
+  GridWidget,
+  ACLoadWidget,
+  BatteryWidget,
+  AdditionalInfoWidget,
+  BatteryArrowWidget
+};
+const int displayWidgets = 8;
+
+struct displayedWidget
+{
+  char text[24];
+  unsigned short colour;
+  int value; // anything else affecting how the widget is drawn, such as the length of the battery arc
+};
+displayedWidget displayedWidgets[displayWidgets];
+
+const unsigned long forcedDisplayRefreshIntervalInMilliSeconds = (unsigned long)GENERAL_SETTINGS_SECONDS_BETWEEN_FORCED_DISPLAY_REFRESHES * 1000UL;
+unsigned long lastMainScreenRefresh = 0UL;
+
+// Display statistics
+unsigned long displayFramesRendered = 0UL;
+unsigned long displayFramesSkipped = 0UL;
+unsigned long long displayRenderingMicroSeconds = 0ULL; // total time spent drawing and pushing the frames that were rendered
+
+// Power chart
+//
+// a second screen, switched to and from by pressing both buttons together, shows a chart of solar, grid, AC load and battery power which scrolls from right to left
+// the panel's own vertical scrolling (which runs across the screen in landscape) moves the chart along, so each new sample only needs
+// a one pixel wide column to be sent to the display rather than the whole screen
+//
+// the legend on the left is in a fixed area of the panel which does not scroll; the chart has one column for each sample taken
+//
+// while the chart is shown the top button steps through longer periods (the last hour, day, week and 30 days) and the bottom button shows
+// the topic browser (see below), if it is enabled; either button returns to the main screen instead when there is nothing for it to show
+//
+// the longer periods are read from the history pyramid (see history_pyramid.h) as one column per pixel and show the range of each value as
+// well as its level; these are redrawn in full whenever a column's worth of time has passed
+
+enum chartSeries
+{
+  SolarChartSeries,
+  GridChartSeries,
+  ACLoadChartSeries,
+  BatteryChartSeries,
+  chartSeriesCount
+};
+
+const char *chartSeriesNames[chartSeriesCount] = {"Solar", "Grid", "AC Load", "Battery"};
+const historyMetric chartSeriesHistoryMetrics[chartSeriesCount] = {SolarHistory, GridHistory, ACLoadHistory, BatteryPowerHistory};
+const unsigned short chartSeriesColours[chartSeriesCount] = {TFT_YELLOW, TFT_SKYBLUE, TFT_SILVER, TFT_GREEN};
+
+const int chartLegendWidth = 96;
+const int chartWidth = TFT_WIDTH - chartLegendWidth;
+const int chartTop = 12;
+const int chartBottom = TFT_HEIGHT - 13;
+const float chartScaleStepInWatts = 500.0F;
+
+bool chartSelected = false;               // true while the user has chosen the chart rather than the main screen
+float chartSamples[chartSeriesCount][chartWidth];
+int firstChartSample = 0;
+int numberOfChartSamples = 0;
+float chartTopWatts = chartScaleStepInWatts;
+float chartBottomWatts = 0.0F;
+int chartScrollOffset = 0;                // how far the panel has scrolled the chart, in columns
+bool chartScrolling = false;              // true while the panel's scrolling is set up for the chart
+
+// Topic browser (see GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER)
+//
+// every topic Venus publishes (N/<installation id>/#) is kept in a compact index in PSRAM (see topic_index.h) and shown a page at a time;
+// once a page has been drawn only the rows whose topic or value has changed are redrawn, and only those rows are sent to the display
+
+const int topicBrowserRowHeight = 20;
+const int topicBrowserRows = TFT_HEIGHT / topicBrowserRowHeight - 1; // the first row is the heading
+
+bool topicIndexIsBeingKept = false;
+bool topicBrowserSelected = false;        // true while the user has chosen the topic browser
+int topicBrowserPage = 0;
+int topicBrowserRowTopics[topicBrowserRows];
+uint16_t topicBrowserRowUpdates[topicBrowserRows];
+int topicBrowserHeadingTopics = 0;
+unsigned long topicBrowserHeadingTopicsMissing = 0UL;
+
+const uint32_t chartPeriodsInSeconds[] = {0UL, 3600UL, 86400UL, 7UL * 86400UL, 30UL * 86400UL}; // the first is the chart of recent samples
+const char *chartPeriodNames[] = {"", "1 hour", "1 day", "1 week", "30 days"};
+const int chartPeriods = sizeof(chartPeriodsInSeconds) / sizeof(chartPeriodsInSeconds[0]);
+int chartPeriod = 0;
+unsigned long chartDrawnAtSecond = 0UL;   // the history's time when a longer period was last drawn
+
+// with the USB on the right the panel's lines run left to right, with the USB on the left they run right to left
+const bool chartLinesRunLeftToRight = !GENERAL_SETTINGS_USB_ON_THE_LEFT;
+
+// Ingestion statistics
+unsigned long payloadsReceived = 0UL;                // payloads received on all subscribed topics
+unsigned long mqttLoopCalls = 0UL;                   // calls to client.loop()
+unsigned long long mqttLoopMicroSeconds = 0ULL;      // total time spent in client.loop()
+unsigned long long mqttIngestionMicroSeconds = 0ULL; // time spent in the calls to client.loop() that delivered payloads
+unsigned long mqttLoopLongestMicroSeconds = 0UL;     // longest single call to client.loop()
+unsigned long payloadsInCurrentSecond = 0UL;
+unsigned long currentSecondStartedAt = 0UL;
+unsigned long peakPayloadsPerSecond = 0UL;
+unsigned long loopPasses = 0UL;
+unsigned long loopPassLongestMicroSeconds = 0UL;
+unsigned long lateLoopPasses = 0UL;                  // passes through loop() that took longer than lateLoopPassMilliSeconds, delaying the display and buttons
+const unsigned long lateLoopPassMilliSeconds = 100UL;
+
+// Loop profiling
+//
+// the time taken by each stage of loop() is kept in a histogram, so that occasional stalls show up in the 99th percentile and maximum even when the median is small
+
+enum loopStage
+{
+  MQTTStage,
+  DeferredActionsStage,
+  KeepAliveStage,
+  StaleDataStage,
+  HistoryStage,
+  EnergyStage,
+  TelemetryLogStage,
+  HTTPStage,
+  GatewayStage,
+  ButtonsStage,
+  DisplayStage,
+  RenderStage, // part of DisplayStage, only for frames that are drawn
+  PushStage,   // part of DisplayStage, only for frames that are drawn
+  TimeRefreshStage,
+  ReportingStage,
+  OTAStage,
+  WholeLoopStage,
+  loopStages
+};
+
+const char *loopStageNames[loopStages] = {"client.loop()", "deferred actions", "keep alive", "stale data", "history", "energy", "telemetry log", "HTTP server", "gateway", "buttons", "display", "  render", "  push", "time refresh", "reporting", "OTA", "whole loop"};
+
+latencyHistogram loopStageHistograms[loopStages];
+
+// History
+//
+// once a second, while the values shown are current, the main values are added to a history kept in PSRAM (see history_pyramid.h)
+// the history's time is the number of seconds since the sketch started
+
+bool historyIsBeingKept = false;
+unsigned long historySeconds = 0UL;
+const char *historyMetricNames[historyMetrics] = {"solar", "grid", "AC load", "battery power", "battery SOC"};
+const char *historySummaryPeriodNames[] = {"minute", "hour", "day", "30 days"};
+const unsigned long historySummaryPeriodsInSeconds[] = {60UL, 60UL * 60UL, 24UL * 60UL * 60UL, 30UL * 24UL * 60UL * 60UL};
+const int historySummaryPeriods = sizeof(historySummaryPeriodsInSeconds) / sizeof(historySummaryPeriodsInSeconds[0]);
+
+// Energy
+//
+// the power values received are added up into energy totals for today and yesterday (see energy.h)
+// the totals are kept in RTC memory, so they survive deep sleep, and are saved to flash periodically and before deep sleep, so they survive a restart
+
+#include <Preferences.h>
+
+RTC_DATA_ATTR energyTotals energy;
+
+powerIntegrator solarIntegrator, gridIntegrator, ACLoadIntegrator, batteryIntegrator;
+
+const unsigned long energyCheckpointIntervalInMilliSeconds = 15UL * 60UL * 1000UL;
+const char *energyCounterNames[energyCounters] = {"solar", "grid import", "grid export", "AC load", "battery charge", "battery discharge"};
+
+// Telemetry log
+//
+// the main values and the battery temperature, averaged over each minute, are logged to files in the FFat partition (see telemetry_log.h), so that months of history survive a restart
+// the minutes logged are held in memory and written to flash every ten minutes and before deep sleep, so that the flash is not worn by writing every minute
+
+#include <FFat.h>
+
+bool telemetryIsBeingLogged = false;
+
+const unsigned long telemetryFlushIntervalInMilliSeconds = 10UL * 60UL * 1000UL;
+const size_t telemetryLogMinimumFreeBytes = 1024UL * 1024UL; // the oldest months are deleted to keep at least this much of the partition free
+
+// HTTP server
+//
+// other systems on the network can read the current values from http://<this device>/status.json rather than asking Venus for them,
+// and the history from http://<this device>/history?seconds=86400&points=288 (the period to cover, and the number of points to cover it with)
+// the JSON is written from a snapshot of the values straight into a buffer which is sent as it is; the history is sent in chunks as it is read
+
+#include <WebServer.h>
+
+WebServer httpServer(80);
+
+const int historyExportPointsPerChunk = 32;
+const int historyExportMaximumPoints = 4096;
+
+// Gateway
+//
+// a gateway publishes a snapshot of the values (see status_snapshot.h) to its own topic, and its siblings subscribe to that one topic
+// rather than to each of Venus's, so the broker sends Venus's topics to one device rather than to each of them
+
+const bool thisDeviceIsAGateway = (GENERAL_SETTINGS_GATEWAY_MODE == 1);
+const bool thisDeviceIsAGatewaySibling = (GENERAL_SETTINGS_GATEWAY_MODE == 2);
+
+char gatewayChargingState[16] = "";       // the charging state received from the gateway, which chargingState points to on a sibling
+
+// the age of a value only shows whether it is stale while every value is received periodically whether or not it has changed: from Venus when
+// it republishes everything following each periodical keep alive request, or on a sibling from the gateway's snapshot, which is published every few seconds
+const bool staleValuesCanBeDetected = !GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES || thisDeviceIsAGatewaySibling;
+
+// Each battery (see GENERAL_SETTINGS_REPORT_EACH_BATTERY)
+//
+// Venus's system/0/Batteries holds an array with an object for each battery, which is read with a streaming JSON filter (see json_stream.h)
+// so that only the values below are kept, rather than a JsonDocument of the whole message
+
+const int maximumBatteriesReported = 8;
+
+struct batteryReport
+{
+  char name[24];
+  float SOC;
+  float power;
+  float voltage;
+};
+
+batteryReport batteriesReported[maximumBatteriesReported];
+int numberOfBatteriesReported = 0;
+
+enum batteryFilter
+{
+  BatteryNameFilter,
+  BatterySOCFilter,
+  BatteryPowerFilter,
+  BatteryVoltageFilter
+};
+const char *const batteryFilters[] = {"value/*/name", "value/*/soc", "value/*/power", "value/*/voltage"};
+
+// Every device (see GENERAL_SETTINGS_REGISTER_EVERY_DEVICE)
+//
+// every solar charger and VE.Bus unit is received through one wildcard subscription for each of the values below, however many there are,
+// and the messages received on them are passed to their handlers by the router, which also picks out the instance of the device from the topic
+
+deviceRegistry devices;
+topicRouter deviceTopicRouter;
+
+enum deviceTopicSlot
+{
+  SolarChargerPowerSlot,
+  VEBusPowerSlot,
+  SolarChargerStateSlot,
+  VEBusStateSlot
+};
+
+const char *deviceKindNames[] = {"solarcharger", "vebus"};
+const char *devicePowerTopics[] = {"Yield/Power", "Ac/Out/P"};
+
+// Keep alive election (see keepalive_election.h)
+
+const bool keepAliveLeaderIsElected = GENERAL_SETTINGS_ELECT_KEEP_ALIVE_LEADER && !thisDeviceIsAGatewaySibling;
+
+keepAliveElection keepAliveLeaderElection;
+bool keepAliveElectionStarted = false;
+
+// each device's heartbeat is retained on a topic of its own, which its MQTT will clears; as the will is given before connecting, the
+// topic cannot include the installation ID (which may not be known until later), so the heartbeat holds it instead
+#define KEEP_ALIVE_HEARTBEAT_TOPICS "ESP32RemoteForVictron/keepalive_leader/"
+const char *keepAliveHeartbeatTopic = KEEP_ALIVE_HEARTBEAT_TOPICS SECRET_SETTINGS_MQTT_ClientName;
+
 // MQTT
 #include <EspMQTTClient.h> // https://github.com/plapointe6/EspMQTTClient (v1.13.3)
 #include <string.h>
@@ -142,6 +542,37 @@ EspMQTTClient client(
 
 unsigned long lastMQTTUpdateReceived = 0UL;
 
+// Connection timings, reported when debug output is turned on
+unsigned long connectionEstablishedAt = 0UL; // when the MQTT connection was last established
+unsigned long modeChangeRequestedAt = 0UL;   // when the last mode change was sent, reset to 0 once Venus reports the new mode
+int modeChangeRequested = 0;                 // mode code sent in the last mode change
+
+// Deferred actions
+//
+// the MQTT callbacks are run by client.loop() while it is working through its list of subscriptions,
+// so rather than subscribing, unsubscribing or publishing from within a callback the callback queues what needs to be done
+// and the queued actions are then carried out from loop() once client.loop() has returned
+
+enum deferredActionType
+{
+  ContinueDiscoveryAfterInstallationID,
+  ContinueDiscoveryAfterMultiplusID,
+  ContinueDiscoveryAfterSolarChargerID,
+  SwitchChargingStateToMultiplus,
+  SetMultiplusMode
+};
+
+struct deferredAction
+{
+  deferredActionType type;
+  int value;
+};
+
+const int maximumDeferredActions = 8;
+deferredAction deferredActions[maximumDeferredActions];
+int firstDeferredAction = 0;
+int numberOfDeferredActions = 0;
+
 // JSON
 #include <ArduinoJson.h> // Ardiuno Library Manager, by Benoit Blanchon, https://arduinojson.org/?utm_source=meta&utm_medium=library.properties (v7.4.1)
 
@@ -220,1082 +651,3177 @@ void SetupTopAndBottomButtons()
 
 void RefreshDisplay()
 {
+  // the whole screen is about to be sent, so the panel must not be scrolled
+  if (chartScrolling)
+    StopChartScrolling();
+
+  TraceEvent(micros(), FramePushEvent, TraceBegin);
   lcd_PushColors(0, 0, TFT_WIDTH, TFT_HEIGHT, (uint16_t *)sprite.getPointer());
+  TraceEvent(micros(), FramePushEvent, TraceEnd);
+
+  // the caller sets this back to the main screen or to a status message as appropriate, anything else will cause the next update to redraw the screen in full
+  screenShowing = OtherScreen;
 }
 
-void ChangeMultiplusMode(multiplusFunction option)
+uint16_t SwapColourBytes(uint16_t colour)
 {
+  // the sprite, and so the display, holds each colour with its bytes swapped
+  return (colour >> 8) | (colour << 8);
+}
 
-  // if no choice is made within this timeout period then return to the previous screen without making any changes
-  int numberOfMinutesUserHasToMakeAChoiceBeforeTimeOut = 1;
-
-  SetKeepDisplayOnTimeOut(numberOfMinutesUserHasToMakeAChoiceBeforeTimeOut);
+int ChartY(float watts)
+{
+  // the row of the chart on which a value is drawn
+  float fraction = (watts - chartBottomWatts) / (chartTopWatts - chartBottomWatts);
+  int y = chartBottom - int(fraction * float(chartBottom - chartTop) + 0.5F);
+  return constrain(y, chartTop, chartBottom);
+}
 
-  // show the opening prompt
+void SetChartScale(float smallest, float largest)
+{
 
-  sprite.fillSprite(TFT_BLACK);
+  // the chart runs from zero (or, if anything went negative, from a whole number of steps below it) to a whole number of steps above the largest value
 
-  // this should not happen, but throw an error if the current Multiplus mode is unknown
+  chartTopWatts = ceilf(largest / chartScaleStepInWatts) * chartScaleStepInWatts;
+  if (chartTopWatts < chartScaleStepInWatts)
+    chartTopWatts = chartScaleStepInWatts;
 
-  if (currentMultiplusMode == Unknown)
-  {
-    sprite.setTextDatum(MC_DATUM);
-    sprite.setTextColor(TFT_RED, TFT_BLACK);
-    sprite.loadFont(NotoSansBold24);
-    sprite.drawString("Multiplus mode cannot be changed", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-    RefreshDisplay();
-    sprite.unloadFont();
-    delay(5000);
+  chartBottomWatts = floorf(smallest / chartScaleStepInWatts) * chartScaleStepInWatts;
+}
 
-    // keep the display on for one minute
-    SetKeepDisplayOnTimeOut(1);
+void ChooseChartScale()
+{
 
-    return;
-  };
+  float largest = 0.0F;
+  float smallest = 0.0F;
 
-  // show opening prompt
+  for (int series = 0; series < chartSeriesCount; series++)
+    for (int i = 0; i < numberOfChartSamples; i++)
+    {
+      float watts = chartSamples[series][(firstChartSample + i) % chartWidth];
+      if (watts > largest)
+        largest = watts;
+      if (watts < smallest)
+        smallest = watts;
+    };
 
-  sprite.loadFont(NotoSansBold36);
-  sprite.setTextDatum(MC_DATUM);
-  sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
+  SetChartScale(smallest, largest);
+}
 
-  if (option == Charger)
-  {
-    sprite.drawString("Set charger on or off?", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-    RefreshDisplay();
-  }
-  else
+bool ChartSampleFits(int sample)
+{
+  for (int series = 0; series < chartSeriesCount; series++)
   {
-    sprite.drawString("Set inverter on or off?", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-    RefreshDisplay();
+    float watts = chartSamples[series][(firstChartSample + sample) % chartWidth];
+    if ((watts > chartTopWatts) || (watts < chartBottomWatts))
+      return false;
   };
+  return true;
+}
 
-  // wait here for one second and also, if needed, for the user to release the button that they had previously pressed to get here
-  msTimer.begin(1000);
+void DrawChartColumn(int sample, uint16_t *column, int stride)
+{
 
-  // ensure whichever button was last pressed is now released
-  while (digitalRead(topButton) == 0)
-    msTimer.begin(50);
+  // draws one sample (counting from the oldest) into a column of pixels, each series as a line from the previous sample's value to this one's
+  // the pixels are stored the way the sprite stores them, with their bytes swapped, ready to be sent to the display
 
-  while (digitalRead(bottomButton) == 0)
-    msTimer.begin(50);
+  for (int y = 0; y < TFT_HEIGHT; y++)
+    column[y * stride] = TFT_BLACK;
 
-  if (IsKeepDisplayOnTimedOut())
+  column[ChartY(0.0F) * stride] = SwapColourBytes(TFT_DARKGREY);
+
+  for (int series = chartSeriesCount - 1; series >= 0; series--)
   {
 
-    if (generalDebugOutput)
-      Serial.println("Timed out waiting for the user to release the button, no change will be applied");
+    int position = (firstChartSample + sample) % chartWidth;
+    int y = ChartY(chartSamples[series][position]);
+    int previousY = y;
+    if (sample > 0)
+      previousY = ChartY(chartSamples[series][(position + chartWidth - 1) % chartWidth]);
 
-    // keep the display on for one minute
-    SetKeepDisplayOnTimeOut(1);
+    uint16_t colour = SwapColourBytes(chartSeriesColours[series]);
 
-    return;
+    for (int row = min(y, previousY); row <= max(y, previousY); row++)
+      column[row * stride] = colour;
   };
+}
 
-  // prompt for desired state
+int ChartColumnForSample(int sample)
+{
+  // the screen column in which a sample is drawn before the panel has scrolled; the newest sample is on the right, and until
+  // the chart is full the columns to the left of the oldest sample are left empty
+  return TFT_WIDTH - numberOfChartSamples + sample;
+}
 
-  int xPosition;
-  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
-  {
-    xPosition = 0;
-    sprite.setTextDatum(TL_DATUM);
-  }
-  else
+void DrawChartPeriod(uint16_t *pixels)
+{
+
+  // draws a longer period from the history pyramid, the oldest column on the left; each series is drawn as a line from the previous column's
+  // average to the range of values in this column, so it stays joined up and also shows any peaks within the column
+  // the period is read twice, first to choose the scale and then to draw it, which is quicker than keeping a copy of it
+
+  static historySample columns[chartWidth];
+
+  uint32_t toTime = historySeconds + 1;
+  uint32_t period = chartPeriodsInSeconds[chartPeriod];
+  uint32_t fromTime = (toTime > period) ? toTime - period : 0;
+
+  float largest = 0.0F;
+  float smallest = 0.0F;
+
+  for (int series = 0; series < chartSeriesCount; series++)
   {
-    xPosition = TFT_WIDTH;
-    sprite.setTextDatum(TR_DATUM);
+    ReadHistoryColumns(chartSeriesHistoryMetrics[series], fromTime, toTime, chartWidth, columns);
+    for (int i = 0; i < chartWidth; i++)
+      if (!isnan(columns[i].average))
+      {
+        if (columns[i].maximum > largest)
+          largest = columns[i].maximum;
+        if (columns[i].minimum < smallest)
+          smallest = columns[i].minimum;
+      };
   };
 
-  if (option == Charger)
-  {
-    if ((currentMultiplusMode == ChargerOnly) || (currentMultiplusMode == On))
-    {
-      sprite.drawString("ON (current mode)", xPosition, 0);
-      sprite.drawString("OFF", xPosition, TFT_HEIGHT - 30);
-    }
-    else
-    {
-      sprite.drawString("ON", xPosition, 0);
-      sprite.drawString("OFF (current mode)", xPosition, TFT_HEIGHT - 30);
-    }
-  }
-  else
+  SetChartScale(smallest, largest);
+
+  uint16_t *rowOfZero = &pixels[ChartY(0.0F) * TFT_WIDTH + chartLegendWidth];
+  for (int i = 0; i < chartWidth; i++)
+    rowOfZero[i] = SwapColourBytes(TFT_DARKGREY);
+
+  for (int series = chartSeriesCount - 1; series >= 0; series--)
   {
-    if ((currentMultiplusMode == InverterOnly) || (currentMultiplusMode == On))
-    {
-      sprite.drawString("ON (current mode)", xPosition, 0);
-      sprite.drawString("OFF", xPosition, TFT_HEIGHT - 30);
-    }
-    else
-    {
-      sprite.drawString("ON", xPosition, 0);
-      sprite.drawString("OFF (current mode)", xPosition, TFT_HEIGHT - 30);
-    };
-  };
 
-  RefreshDisplay();
+    ReadHistoryColumns(chartSeriesHistoryMetrics[series], fromTime, toTime, chartWidth, columns);
 
-  sprite.unloadFont();
+    uint16_t colour = SwapColourBytes(chartSeriesColours[series]);
 
-  // wait until a choice is made
+    for (int i = 0; i < chartWidth; i++)
+    {
 
-  while ((digitalRead(topButton) != 0) && (digitalRead(bottomButton) != 0) && !IsKeepDisplayOnTimedOut())
-    msTimer.begin(100);
+      if (isnan(columns[i].average))
+        continue;
 
-  if (IsKeepDisplayOnTimedOut())
-  {
+      int top = ChartY(columns[i].maximum);
+      int bottom = ChartY(columns[i].minimum);
 
-    if (generalDebugOutput)
-      Serial.println("Timed out waiting for the user to make a choice, no change will be applied");
+      if ((i > 0) && !isnan(columns[i - 1].average))
+      {
+        int previousY = ChartY(columns[i - 1].average);
+        top = min(top, previousY);
+        bottom = max(bottom, previousY);
+      };
 
-    SetKeepDisplayOnTimeOut(1);
-    return;
+      for (int row = top; row <= bottom; row++)
+        pixels[row * TFT_WIDTH + chartLegendWidth + i] = colour;
+    };
   };
 
-  bool userChoseOn;
+  chartDrawnAtSecond = historySeconds;
+}
 
-  if (digitalRead(topButton) == 0)
+void DrawChartScreen()
+{
+
+  // draws the legend and every sample held (or the longer period chosen) into the sprite, sends it to the display, and then sets up the panel's scrolling
+
+  sprite.fillSprite(TFT_BLACK);
+
+  uint16_t *pixels = (uint16_t *)sprite.getPointer();
+
+  if (chartPeriod > 0)
   {
-    userChoseOn = true;
-    if (generalDebugOutput)
-      Serial.println("Choice is 'ON'");
+    DrawChartPeriod(pixels);
   }
   else
   {
-    userChoseOn = false;
-    if (generalDebugOutput)
-      Serial.println("Choice is 'OFF'");
+    ChooseChartScale();
+    for (int sample = 0; sample < numberOfChartSamples; sample++)
+      DrawChartColumn(sample, &pixels[ChartColumnForSample(sample)], TFT_WIDTH);
   };
 
-  // ensure whichever button was last pressed is now released
-  while (digitalRead(topButton) == 0)
-    msTimer.begin(50);
+  sprite.loadFont(NotoSansBold15);
 
-  while (digitalRead(bottomButton) == 0)
-    msTimer.begin(50);
+  const int legendRowHeight = 30;
+  const int firstLegendRow = TFT_HEIGHT / 2 - 45;
 
-  multiplusMode desiredMultiplusMode;
-  desiredMultiplusMode = currentMultiplusMode;
+  sprite.setTextDatum(ML_DATUM);
+  for (int series = 0; series < chartSeriesCount; series++)
+  {
+    sprite.setTextColor(chartSeriesColours[series], TFT_BLACK);
+    sprite.drawString(chartSeriesNames[series], 4, firstLegendRow + series * legendRowHeight);
+  };
 
-  if (option == Charger)
+  char scaleText[16];
+  sprite.setTextDatum(MR_DATUM);
+  sprite.setTextColor(TFT_DARKGREY, TFT_BLACK);
+  FormatWatts(scaleText, sizeof(scaleText), long(chartTopWatts));
+  sprite.drawString(scaleText, chartLegendWidth - 6, chartTop);
+  FormatWatts(scaleText, sizeof(scaleText), long(chartBottomWatts));
+  sprite.drawString(scaleText, chartLegendWidth - 6, chartBottom);
+  // the zero line is only labelled where the label would not run into the name of a series, which are in the same column
+  if (chartBottomWatts < 0.0F)
   {
+    int zeroY = ChartY(0.0F);
+    bool clearOfTheNames = true;
+    for (int series = 0; series < chartSeriesCount; series++)
+      if (abs(zeroY - (firstLegendRow + series * legendRowHeight)) < sprite.fontHeight())
+        clearOfTheNames = false;
+    if (clearOfTheNames)
+      sprite.drawString("0 W", chartLegendWidth - 6, zeroY);
+  };
 
-    if (userChoseOn)
-    {
+  if (chartPeriod > 0)
+  {
+    sprite.setTextDatum(ML_DATUM);
+    sprite.setTextColor(TFT_WHITE, TFT_BLACK);
+    sprite.drawString(chartPeriodNames[chartPeriod], 4, TFT_HEIGHT / 2 + 75);
+  };
 
-      switch (currentMultiplusMode)
-      {
-      case ChargerOnly:
-        break;
-      case InverterOnly:
-        desiredMultiplusMode = On;
-        break;
-      case On:
-        break;
-      case Off:
-        desiredMultiplusMode = ChargerOnly;
-        break;
-      }
-    }
+  sprite.unloadFont();
+
+  RefreshDisplay();
+
+  // only the chart of recent samples scrolls
+  if (chartPeriod == 0)
+    StartChartScrolling();
+
+  screenShowing = ChartScreen;
+}
+
+void SendSpriteRows(int y, int height)
+{
+
+  // sends only the rows of the sprite given to the display
+
+  if (chartScrolling)
+    StopChartScrolling();
+
+  lcd_PushColors(0, y, TFT_WIDTH, height, (uint16_t *)sprite.getPointer() + y * TFT_WIDTH);
+}
+
+void DrawTopicBrowserRow(int row, int topic)
+{
+
+  int y = (row + 1) * topicBrowserRowHeight;
+
+  sprite.fillRect(0, y, TFT_WIDTH, topicBrowserRowHeight, TFT_BLACK);
+
+  if (topic < 0)
+    return;
+
+  char name[maximumTopicIndexNameLength + 1];
+  TopicIndexName(topic, name, sizeof(name));
+
+  const char *value = TopicIndexValue(topic);
+  if (value == NULL)
+    value = "-";
+
+  sprite.setTextDatum(ML_DATUM);
+  sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
+  sprite.drawString(name, 4, y + topicBrowserRowHeight / 2);
+
+  // the value is drawn over the end of a long name
+  int valueWidth = sprite.textWidth(value);
+  sprite.fillRect(TFT_WIDTH - 12 - valueWidth, y, valueWidth + 12, topicBrowserRowHeight, TFT_BLACK);
+  sprite.setTextDatum(MR_DATUM);
+  sprite.setTextColor(TFT_WHITE, TFT_BLACK);
+  sprite.drawString(value, TFT_WIDTH - 4, y + topicBrowserRowHeight / 2);
+}
+
+void DrawTopicBrowser()
+{
+
+  // the page is drawn in full when the browser is first shown or another page is selected, after that only the rows which have changed
+  // (as topics arrive, or their values are updated) are redrawn and sent to the display
+
+  static int pageDrawn = -1;
+
+  bool drawInFull = (screenShowing != TopicBrowserScreen) || (pageDrawn != topicBrowserPage);
+
+  int topics = TopicIndexTopics();
+  unsigned long topicsMissing = TopicIndexValuesTooDeep() + TopicIndexValuesNotKept();
+
+  sprite.loadFont(NotoSansBold15);
+
+  if (drawInFull)
+    sprite.fillSprite(TFT_BLACK);
+
+  if (drawInFull || (topics != topicBrowserHeadingTopics) || (topicsMissing != topicBrowserHeadingTopicsMissing))
+  {
+
+    int pages = max(1, (topics + topicBrowserRows - 1) / topicBrowserRows);
+
+    // values whose topics could not be kept are counted in the heading, so that it is clear the list is not complete
+    char heading[96]; // enough for the largest numbers each could be
+    if (topicsMissing > 0)
+      snprintf(heading, sizeof(heading), "%d topics, %lu KB, %lu values not kept", topics, (unsigned long)(TopicIndexBytesUsed() / 1024), topicsMissing);
     else
-    {
-      switch (currentMultiplusMode)
-      {
-      case ChargerOnly:
-        desiredMultiplusMode = Off;
-        break;
-      case InverterOnly:
-        break;
-      case On:
-        desiredMultiplusMode = InverterOnly;
-        break;
-      case Off:
-        break;
-      };
-    };
+      snprintf(heading, sizeof(heading), "%d topics, %lu KB", topics, (unsigned long)(TopicIndexBytesUsed() / 1024));
+
+    char pageText[16];
+    snprintf(pageText, sizeof(pageText), "%d / %d", topicBrowserPage + 1, pages);
+
+    sprite.fillRect(0, 0, TFT_WIDTH, topicBrowserRowHeight, TFT_BLACK);
+    sprite.setTextDatum(ML_DATUM);
+    sprite.setTextColor(TFT_YELLOW, TFT_BLACK);
+    sprite.drawString(heading, 4, topicBrowserRowHeight / 2);
+    sprite.setTextDatum(MR_DATUM);
+    sprite.drawString(pageText, TFT_WIDTH - 4, topicBrowserRowHeight / 2);
+
+    if (!drawInFull)
+      SendSpriteRows(0, topicBrowserRowHeight);
+
+    topicBrowserHeadingTopics = topics;
+    topicBrowserHeadingTopicsMissing = topicsMissing;
   };
 
-  if (option == Inverter)
+  for (int row = 0; row < topicBrowserRows; row++)
   {
 
-    if (userChoseOn)
-    {
+    int topic = TopicInNameOrder(topicBrowserPage * topicBrowserRows + row);
+    uint16_t updates = (topic >= 0) ? TopicIndexUpdates(topic) : 0;
 
-      switch (currentMultiplusMode)
-      {
-      case ChargerOnly:
-        desiredMultiplusMode = On;
-        break;
-      case InverterOnly:
-        break;
-      case On:
-        break;
-      case Off:
-        desiredMultiplusMode = InverterOnly;
-        break;
-      }
-    }
-    else
-    {
-      switch (currentMultiplusMode)
-      {
-      case ChargerOnly:
-        break;
-      case InverterOnly:
-        desiredMultiplusMode = Off;
-        break;
-      case On:
-        desiredMultiplusMode = ChargerOnly;
-        break;
-      case Off:
-        break;
-      };
-    };
+    if (!drawInFull && (topic == topicBrowserRowTopics[row]) && (updates == topicBrowserRowUpdates[row]))
+      continue;
+
+    DrawTopicBrowserRow(row, topic);
+
+    if (!drawInFull)
+      SendSpriteRows((row + 1) * topicBrowserRowHeight, topicBrowserRowHeight);
+
+    topicBrowserRowTopics[row] = topic;
+    topicBrowserRowUpdates[row] = updates;
   };
 
-  // apply the change if required
+  sprite.unloadFont();
 
-  if (currentMultiplusMode == desiredMultiplusMode)
-  {
+  if (drawInFull)
+    RefreshDisplay();
 
-    if (generalDebugOutput)
-      Serial.println("No change required to the multiplus mode");
+  pageDrawn = topicBrowserPage;
+  screenShowing = TopicBrowserScreen;
+}
+
+void StartChartScrolling()
+{
+
+  // the legend's lines are fixed, the chart's lines scroll; until the first new sample arrives the panel shows the frame memory as it is
+
+  if (chartLinesRunLeftToRight)
+    lcd_setScrollArea(chartLegendWidth, chartWidth, 0);
+  else
+    lcd_setScrollArea(0, chartWidth, chartLegendWidth);
+
+  chartScrollOffset = 0;
+  lcd_setScrollStart(chartLinesRunLeftToRight ? chartLegendWidth : 0);
+
+  chartScrolling = true;
+}
+
+void StopChartScrolling()
+{
+  lcd_setScrollArea(0, TFT_WIDTH, 0);
+  lcd_setScrollStart(0);
+  chartScrolling = false;
+}
+
+void ScrollInNewestChartSample()
+{
+
+  // scrolls the chart one column to the left and draws the newest sample in the column which comes into view on the right
+  // that column is the frame memory line which, until the scroll, held the oldest column shown
+
+  static uint16_t column[TFT_HEIGHT];
+
+  DrawChartColumn(numberOfChartSamples - 1, column, 1);
+
+  int memoryLine;
+
+  if (chartLinesRunLeftToRight)
+  {
+    chartScrollOffset = (chartScrollOffset + 1) % chartWidth;
+    memoryLine = chartLegendWidth + (chartScrollOffset + chartWidth - 1) % chartWidth;
+    lcd_setScrollStart(chartLegendWidth + chartScrollOffset);
   }
   else
   {
+    chartScrollOffset = (chartScrollOffset + chartWidth - 1) % chartWidth;
+    memoryLine = chartScrollOffset;
+    lcd_setScrollStart(chartScrollOffset);
+  };
 
-    String modeCodeValue;
+  // the frame memory line is written through the current rotation, in which it is a screen column
+  int screenColumn = chartLinesRunLeftToRight ? memoryLine : TFT_WIDTH - 1 - memoryLine;
 
-    switch (desiredMultiplusMode)
-    {
+  lcd_PushColors(screenColumn, 0, 1, TFT_HEIGHT, column);
+}
 
-    case ChargerOnly:
-      modeCodeValue = "1";
-      if (generalDebugOutput)
-        Serial.println("Set multiplus mode to charger only");
-      break;
-    case InverterOnly:
-      modeCodeValue = "2";
-      if (generalDebugOutput)
-        Serial.println("Set multiplus mode to inverter only");
-      break;
-    case On:
-      modeCodeValue = "3";
-      if (generalDebugOutput)
-        Serial.println("Set multiplus mode to on");
-      break;
-    case Off:
-      modeCodeValue = "4";
-      if (generalDebugOutput)
-        Serial.println("Set multiplus mode to off");
-      break;
-    };
+void RecordChartSample()
+{
 
-    // set the Multiplus's mode to Unknown while it changes over
-    // it will be reset to its current mode in the next MQTT publishing cycle
-    currentMultiplusMode = Unknown;
+  static unsigned long lastChartSample = 0UL;
+
+  if (millis() - lastChartSample < (unsigned long)GENERAL_SETTINGS_SECONDS_BETWEEN_CHART_SAMPLES * 1000UL)
+    return;
+
+  if (!theDisplayIsCurrentlyOn || !client.isMqttConnected() || awaitingInitialTransmissionOfAllDataPoints)
+    return;
 
-    // change the mode
-    client.publish("W/" + VictronInstallationID + "/vebus/" + MultiplusThreeDigitID + "/Mode", "{\"value\": " + modeCodeValue + "}");
-    delay(250);
+  lastChartSample = millis();
+
+  int position;
+  if (numberOfChartSamples < chartWidth)
+  {
+    position = (firstChartSample + numberOfChartSamples) % chartWidth;
+    numberOfChartSamples++;
+  }
+  else
+  {
+    position = firstChartSample;
+    firstChartSample = (firstChartSample + 1) % chartWidth;
   };
 
-  // keep the display on for one minute
-  SetKeepDisplayOnTimeOut(1);
-};
+  chartSamples[SolarChartSeries][position] = solarWatts;
+  chartSamples[GridChartSeries][position] = gridInL1Watts + gridInL2Watts + gridInL3Watts;
+  chartSamples[ACLoadChartSeries][position] = ACOutL1Watts + ACOutL2Watts + ACOutL3Watts;
+  chartSamples[BatteryChartSeries][position] = batteryPower;
 
-void CheckButtons()
+  if (screenShowing != ChartScreen)
+    return;
+
+  // a longer period is redrawn once a column's worth of time has passed
+  if (chartPeriod > 0)
+  {
+    if (historySeconds - chartDrawnAtSecond >= chartPeriodsInSeconds[chartPeriod] / chartWidth)
+      DrawChartScreen();
+    return;
+  };
+
+  // a sample outside the current scale needs the chart to be redrawn to a new scale
+  if (!ChartSampleFits(numberOfChartSamples - 1))
+    DrawChartScreen();
+  else
+    ScrollInNewestChartSample();
+}
+
+bool UpdateWidgetCache(displayWidget widget, const char *text, unsigned short colour, int value)
 {
 
-  if (theDisplayIsCurrentlyOn)
+  // returns true if the widget will look different from when it was last drawn
+
+  displayedWidget &cachedWidget = displayedWidgets[widget];
+
+  if ((cachedWidget.colour == colour) && (cachedWidget.value == value) && (strcmp(cachedWidget.text, text) == 0))
+    return false;
+
+  strncpy(cachedWidget.text, text, sizeof(cachedWidget.text) - 1);
+  cachedWidget.text[sizeof(cachedWidget.text) - 1] = '\0';
+  cachedWidget.colour = colour;
+  cachedWidget.value = value;
+
+  return true;
+}
+
+void ShowStatusMessage(const char *message, const uint8_t *font, unsigned short colour)
+{
+
+  // a status message is only drawn if it is not already being shown
+
+  static char statusMessageShowing[40] = "";
+
+  if ((screenShowing == StatusMessageScreen) && (strcmp(statusMessageShowing, message) == 0))
+    return;
+
+  sprite.fillSprite(TFT_BLACK);
+  sprite.loadFont(font);
+  sprite.setTextDatum(MC_DATUM);
+  sprite.setTextColor(colour, TFT_BLACK);
+  sprite.drawString(message, TFT_WIDTH / 2, TFT_HEIGHT / 2);
+  RefreshDisplay();
+  sprite.unloadFont();
+
+  strncpy(statusMessageShowing, message, sizeof(statusMessageShowing) - 1);
+  screenShowing = StatusMessageScreen;
+}
+
+void ChangeMultiplusMode(multiplusFunction option)
+{
+
+  // if no choice is made within this timeout period then return to the previous screen without making any changes
+  int numberOfMinutesUserHasToMakeAChoiceBeforeTimeOut = 1;
+
+  SetKeepDisplayOnTimeOut(numberOfMinutesUserHasToMakeAChoiceBeforeTimeOut);
+
+  // show the opening prompt
+
+  sprite.fillSprite(TFT_BLACK);
+
+  // this should not happen, but throw an error if the current Multiplus mode is unknown
+
+  if (currentMultiplusMode == Unknown)
   {
+    sprite.setTextDatum(MC_DATUM);
+    sprite.setTextColor(TFT_RED, TFT_BLACK);
+    sprite.loadFont(NotoSansBold24);
+    sprite.drawString("Multiplus mode cannot be changed", TFT_WIDTH / 2, TFT_HEIGHT / 2);
+    RefreshDisplay();
+    sprite.unloadFont();
+    delay(5000);
 
-    if (GENERAL_SETTINGS_ALLOW_CHANGING_INVERTER_AND_CHARGER_MODES)
-    {
+    // keep the display on for one minute
+    SetKeepDisplayOnTimeOut(1);
 
-      // The top button is used to turn on/off the charger
-      // The bottom button is used to turn on/off the inverter
+    return;
+  };
 
-      if (digitalRead(topButton) == 0)
-        ChangeMultiplusMode(Charger);
+  // show opening prompt
 
-      if (digitalRead(bottomButton) == 0)
-        ChangeMultiplusMode(Inverter);
-    };
+  sprite.loadFont(NotoSansBold36);
+  sprite.setTextDatum(MC_DATUM);
+  sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
+
+  if (option == Charger)
+  {
+    sprite.drawString("Set charger on or off?", TFT_WIDTH / 2, TFT_HEIGHT / 2);
+    RefreshDisplay();
   }
   else
   {
+    sprite.drawString("Set inverter on or off?", TFT_WIDTH / 2, TFT_HEIGHT / 2);
+    RefreshDisplay();
+  };
 
-    if ((digitalRead(topButton) == 0) || (digitalRead(bottomButton) == 0))
-    {
+  // wait here for one second and also, if needed, for the user to release the button that they had previously pressed to get here
+  msTimer.begin(1000);
+
+  // ensure whichever button was last pressed is now released
+  while (digitalRead(topButton) == 0)
+    msTimer.begin(50);
+
+  while (digitalRead(bottomButton) == 0)
+    msTimer.begin(50);
+
+  if (IsKeepDisplayOnTimedOut())
+  {
+
+    if (generalDebugOutput)
+      Serial.println("Timed out waiting for the user to release the button, no change will be applied");
+
+    // keep the display on for one minute
+    SetKeepDisplayOnTimeOut(1);
+
+    return;
+  };
+
+  // prompt for desired state
+
+  int xPosition;
+  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
+  {
+    xPosition = 0;
+    sprite.setTextDatum(TL_DATUM);
+  }
+  else
+  {
+    xPosition = TFT_WIDTH;
+    sprite.setTextDatum(TR_DATUM);
+  };
+
+  if (option == Charger)
+  {
+    if ((currentMultiplusMode == ChargerOnly) || (currentMultiplusMode == On))
+    {
+      sprite.drawString("ON (current mode)", xPosition, 0);
+      sprite.drawString("OFF", xPosition, TFT_HEIGHT - 30);
+    }
+    else
+    {
+      sprite.drawString("ON", xPosition, 0);
+      sprite.drawString("OFF (current mode)", xPosition, TFT_HEIGHT - 30);
+    }
+  }
+  else
+  {
+    if ((currentMultiplusMode == InverterOnly) || (currentMultiplusMode == On))
+    {
+      sprite.drawString("ON (current mode)", xPosition, 0);
+      sprite.drawString("OFF", xPosition, TFT_HEIGHT - 30);
+    }
+    else
+    {
+      sprite.drawString("ON", xPosition, 0);
+      sprite.drawString("OFF (current mode)", xPosition, TFT_HEIGHT - 30);
+    };
+  };
+
+  RefreshDisplay();
+
+  sprite.unloadFont();
+
+  // wait until a choice is made
+
+  while ((digitalRead(topButton) != 0) && (digitalRead(bottomButton) != 0) && !IsKeepDisplayOnTimedOut())
+    msTimer.begin(100);
+
+  if (IsKeepDisplayOnTimedOut())
+  {
+
+    if (generalDebugOutput)
+      Serial.println("Timed out waiting for the user to make a choice, no change will be applied");
+
+    SetKeepDisplayOnTimeOut(1);
+    return;
+  };
+
+  bool userChoseOn;
+
+  if (digitalRead(topButton) == 0)
+  {
+    userChoseOn = true;
+    if (generalDebugOutput)
+      Serial.println("Choice is 'ON'");
+  }
+  else
+  {
+    userChoseOn = false;
+    if (generalDebugOutput)
+      Serial.println("Choice is 'OFF'");
+  };
+
+  // ensure whichever button was last pressed is now released
+  while (digitalRead(topButton) == 0)
+    msTimer.begin(50);
+
+  while (digitalRead(bottomButton) == 0)
+    msTimer.begin(50);
+
+  multiplusMode desiredMultiplusMode;
+  desiredMultiplusMode = currentMultiplusMode;
+
+  if (option == Charger)
+  {
+
+    if (userChoseOn)
+    {
+
+      switch (currentMultiplusMode)
+      {
+      case ChargerOnly:
+        break;
+      case InverterOnly:
+        desiredMultiplusMode = On;
+        break;
+      case On:
+        break;
+      case Off:
+        desiredMultiplusMode = ChargerOnly;
+        break;
+      }
+    }
+    else
+    {
+      switch (currentMultiplusMode)
+      {
+      case ChargerOnly:
+        desiredMultiplusMode = Off;
+        break;
+      case InverterOnly:
+        break;
+      case On:
+        desiredMultiplusMode = InverterOnly;
+        break;
+      case Off:
+        break;
+      };
+    };
+  };
+
+  if (option == Inverter)
+  {
+
+    if (userChoseOn)
+    {
+
+      switch (currentMultiplusMode)
+      {
+      case ChargerOnly:
+        desiredMultiplusMode = On;
+        break;
+      case InverterOnly:
+        break;
+      case On:
+        break;
+      case Off:
+        desiredMultiplusMode = InverterOnly;
+        break;
+      }
+    }
+    else
+    {
+      switch (currentMultiplusMode)
+      {
+      case ChargerOnly:
+        break;
+      case InverterOnly:
+        desiredMultiplusMode = Off;
+        break;
+      case On:
+        desiredMultiplusMode = ChargerOnly;
+        break;
+      case Off:
+        break;
+      };
+    };
+  };
+
+  // apply the change if required
+
+  if (currentMultiplusMode == desiredMultiplusMode)
+  {
+
+    if (generalDebugOutput)
+      Serial.println("No change required to the multiplus mode");
+  }
+  else
+  {
+
+    int modeCodeValue = 0;
+
+    switch (desiredMultiplusMode)
+    {
+
+    case ChargerOnly:
+      modeCodeValue = 1;
+      if (generalDebugOutput)
+        Serial.println("Set multiplus mode to charger only");
+      break;
+    case InverterOnly:
+      modeCodeValue = 2;
+      if (generalDebugOutput)
+        Serial.println("Set multiplus mode to inverter only");
+      break;
+    case On:
+      modeCodeValue = 3;
+      if (generalDebugOutput)
+        Serial.println("Set multiplus mode to on");
+      break;
+    case Off:
+      modeCodeValue = 4;
+      if (generalDebugOutput)
+        Serial.println("Set multiplus mode to off");
+      break;
+    };
+
+    // set the Multiplus's mode to Unknown while it changes over
+    // it will be reset to its current mode in the next MQTT publishing cycle (even if the mode published has not changed)
+    currentMultiplusMode = Unknown;
+    ForgetLastPayload(MultiplusModeDataPoint);
+
+    // change the mode; the request is sent from loop() and replaces any earlier mode change that has not yet been sent
+    QueueDeferredAction(SetMultiplusMode, modeCodeValue);
+  };
+
+  // keep the display on for one minute
+  SetKeepDisplayOnTimeOut(1);
+};
+
+void CheckButtons()
+{
+
+  if (theDisplayIsCurrentlyOn)
+  {
+
+    // while the chart is shown both buttons together return to the main screen, the top button steps through the periods it can show (or,
+    // if the history is not being kept, returns to the main screen) and the bottom button shows the topic browser, if it is enabled, or
+    // else returns to the main screen
+    // while the topic browser is shown the top and bottom buttons show the next and previous pages, and both buttons together return to the main screen
+    // otherwise pressing both buttons together (or either button, if the Multiplus modes cannot be changed) shows the chart
+
+    if (topicBrowserSelected)
+    {
+      buttonPress press = ReadButtonPress();
+      if (press == BothButtonsPressed)
+      {
+        TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 2);
+        SelectTopicBrowser(false);
+      }
+      else if (press == TopButtonPressed)
+      {
+        TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 0);
+        SelectTopicBrowserPage(topicBrowserPage + 1);
+      }
+      else if (press == BottomButtonPressed)
+      {
+        TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 1);
+        SelectTopicBrowserPage(topicBrowserPage - 1);
+      };
+      return;
+    };
+
+    if (chartSelected)
+    {
+      buttonPress press = ReadButtonPress();
+      if (press == BothButtonsPressed)
+      {
+        TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 2);
+        SelectChart(false);
+      }
+      else if (press == TopButtonPressed)
+      {
+        TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 0);
+        if (historyIsBeingKept)
+          SelectChartPeriod((chartPeriod + 1) % chartPeriods);
+        else
+          SelectChart(false);
+      }
+      else if (press == BottomButtonPressed)
+      {
+        TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 1);
+        if (topicIndexIsBeingKept)
+          SelectTopicBrowser(true);
+        else
+          SelectChart(false);
+      };
+      return;
+    };
+
+    buttonPress press = ReadButtonPress();
+
+    if ((press == BothButtonsPressed) || ((press != NoButtonPressed) && !GENERAL_SETTINGS_ALLOW_CHANGING_INVERTER_AND_CHARGER_MODES))
+    {
+      TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 2);
+      SelectChart(true);
+      return;
+    };
+
+    // The top button is used to turn on/off the charger
+    // The bottom button is used to turn on/off the inverter
+
+    if (press == TopButtonPressed)
+    {
+      TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 0);
+      ChangeMultiplusMode(Charger);
+    }
+    else if (press == BottomButtonPressed)
+    {
+      TraceEvent(micros(), ButtonPressedEvent, TraceInstant, 1);
+      ChangeMultiplusMode(Inverter);
+    };
+  }
+  else
+  {
+
+    if ((digitalRead(topButton) == 0) || (digitalRead(bottomButton) == 0))
+    {
+
+      TraceEvent(micros(), ButtonPressedEvent, TraceInstant, (digitalRead(topButton) == 0) ? 0 : 1);
+
+      SetTheDisplayOn(true);
+
+      // ensure whichever button was last pressed is now released
+      while (digitalRead(topButton) == 0)
+        msTimer.begin(50);
+
+      while (digitalRead(bottomButton) == 0)
+        msTimer.begin(50);
+
+      SetKeepDisplayOnTimeOut(1);
+    };
+  };
+}
+
+buttonPress ReadButtonPress()
+{
+
+  // returns which button was pressed, or both if the second button goes down within a moment of the first
+  // the button that went down first is latched, so that it is returned even if it has been released again by the time the wait is over;
+  // the wait ends as soon as it is released, as the second button can then no longer be pressed together with it
+
+  const unsigned long SECOND_BUTTON_ALLOWANCE_IN_MILLIS = 150UL;
+
+  bool topButtonIsDown = (digitalRead(topButton) == 0);
+  bool bottomButtonIsDown = (digitalRead(bottomButton) == 0);
+
+  if (topButtonIsDown && bottomButtonIsDown)
+    return BothButtonsPressed;
+
+  if (!topButtonIsDown && !bottomButtonIsDown)
+    return NoButtonPressed;
+
+  buttonPress firstButtonPress = topButtonIsDown ? TopButtonPressed : BottomButtonPressed;
+  int firstButton = topButtonIsDown ? topButton : bottomButton;
+  int secondButton = topButtonIsDown ? bottomButton : topButton;
+
+  unsigned long firstButtonPressed = millis();
+
+  while ((millis() - firstButtonPressed < SECOND_BUTTON_ALLOWANCE_IN_MILLIS) && (digitalRead(firstButton) == 0))
+    if (digitalRead(secondButton) == 0)
+      return BothButtonsPressed;
+
+  return firstButtonPress;
+}
+
+void SelectChart(bool showTheChart)
+{
+
+  chartSelected = showTheChart;
+
+  // ensure both buttons are released
+  while ((digitalRead(topButton) == 0) || (digitalRead(bottomButton) == 0))
+    msTimer.begin(50);
+
+  // have the selected screen drawn in full on the next update
+  screenShowing = OtherScreen;
+
+  // keep the display on for one minute
+  SetKeepDisplayOnTimeOut(1);
+
+  if (generalDebugOutput)
+    Serial.println(showTheChart ? "Chart selected" : "Main screen selected");
+}
+
+void SelectTopicBrowser(bool showTheTopicBrowser)
+{
+
+  topicBrowserSelected = showTheTopicBrowser;
+  chartSelected = false;
+  topicBrowserPage = 0;
+
+  // ensure both buttons are released
+  while ((digitalRead(topButton) == 0) || (digitalRead(bottomButton) == 0))
+    msTimer.begin(50);
+
+  // have the selected screen drawn in full on the next update
+  screenShowing = OtherScreen;
+
+  // keep the display on for one minute
+  SetKeepDisplayOnTimeOut(1);
+
+  if (showTheTopicBrowser)
+    SubscribeToEveryTopic();
+  else
+    client.unsubscribe("N/" + VictronInstallationID + "/#");
+
+  if (generalDebugOutput)
+    Serial.println(showTheTopicBrowser ? "Topic browser selected" : "Main screen selected");
+}
+
+void SelectTopicBrowserPage(int page)
+{
+
+  int pages = max(1, (TopicIndexTopics() + topicBrowserRows - 1) / topicBrowserRows);
+
+  topicBrowserPage = (page + pages) % pages;
+
+  // ensure the button is released
+  while ((digitalRead(topButton) == 0) || (digitalRead(bottomButton) == 0))
+    msTimer.begin(50);
+
+  // keep the display on for one minute
+  SetKeepDisplayOnTimeOut(1);
+}
+
+void SelectChartPeriod(int period)
+{
+
+  chartPeriod = period;
+
+  // ensure both buttons are released
+  while ((digitalRead(topButton) == 0) || (digitalRead(bottomButton) == 0))
+    msTimer.begin(50);
+
+  // have the chart drawn in full for the period selected on the next update
+  screenShowing = OtherScreen;
+
+  // keep the display on for one minute
+  SetKeepDisplayOnTimeOut(1);
+
+  if (generalDebugOutput)
+    Serial.println("Chart period selected: " + String((chartPeriod == 0) ? "recent samples" : chartPeriodNames[chartPeriod]));
+}
+
+void printLocalTime()
+{
+
+  struct tm timeinfo;
+  if (getLocalTime(&timeinfo))
+  {
+    if (generalDebugOutput)
+      Serial.println(&timeinfo, "%A, %B %d %Y %H:%M:%S zone %Z %z ");
+  }
+  else
+  {
+    if (generalDebugOutput)
+      Serial.println("Failed to obtain time 1");
+  };
+}
+
+bool SetTime()
+{
+
+  // Configure NTP Server
+  configTime(0, 0, primaryNTPServer, secondaryNTPServer, tertiaryNTPSever);
+
+  // Set the time zone
+  if (setenv("TZ", timeZone, 1) != 0)
+  {
+    if (generalDebugOutput)
+      Serial.println("Error setting time zone");
+    return false;
+  };
+
+  tzset();
+
+  struct tm timeinfo;
+  if (!getLocalTime(&timeinfo))
+  {
+    if (generalDebugOutput)
+      Serial.println("Failed to obtain time from time server");
+    return false;
+  };
+
+  time_t t = mktime(&timeinfo);
+  if (t == -1)
+  {
+    if (generalDebugOutput)
+      Serial.println("Error converting time to time_t");
+    return false;
+  };
+
+  struct timeval now = {.tv_sec = t};
+  if (settimeofday(&now, NULL) != 0)
+  {
+    if (generalDebugOutput)
+      Serial.println("Error setting system time");
+    return false;
+  };
+
+  if (generalDebugOutput)
+  {
+    if (generalDebugOutput)
+      Serial.printf("Time set to: %s", asctime(&timeinfo));
+  };
+
+  if (generalDebugOutput)
+  {
+    // wait for console updates to complete
+    const int timerInterval = 200;
+    msTimer.begin(timerInterval);
+  };
+
+  return true;
+}
+
+void SetKeepDisplayOnTimeOut(unsigned int minutes)
+{
+  // Set the timeout after which IsKeepDisplayOnTimedOut() will become true
+  keepDisplayOnTimeOut = (unsigned long)minutes * 60UL * 1000UL;
+  ResetKeepDisplayOnStartTime();
+
+  if (generalDebugOutput)
+  {
+    Serial.print("Keep display active for this many minutes: ");
+    Serial.println(minutes);
+  };
+}
+
+void ResetKeepDisplayOnStartTime()
+{
+  // Reset the start time of the display timeout to now
+  keepDisplayOnStartTime = millis();
+}
+
+bool IsKeepDisplayOnTimedOut()
+{
+  // Returns true if the display timeout time has passed and false when not.
+  if (millis() - keepDisplayOnStartTime >= keepDisplayOnTimeOut)
+  {
+    return true;
+  }
+  return false;
+}
+
+void RefreshTimeOnceADay(bool forceTimeSet = false)
+{
+
+  const int RETRY_INTERVAL_IN_MINUTES = 20;
+  const unsigned long RETRY_INTERVAL_IN_MILLIS = RETRY_INTERVAL_IN_MINUTES * 60UL * 1000UL;
+  const unsigned long ONE_DAY_IN_MILLIS = 24UL * 60UL * 60UL * 1000UL;
+  static unsigned long lastTimeCheck = 0UL;
+  static unsigned long checkInterval = 0UL;
+
+  if (forceTimeSet || (millis() - lastTimeCheck >= checkInterval))
+  {
+    lastTimeCheck = millis();
+    if (SetTime())
+    {
+      checkInterval = ONE_DAY_IN_MILLIS;
+    }
+    else
+    {
+      checkInterval = RETRY_INTERVAL_IN_MILLIS;
+      // keep the display on until the time can be successfully set from the NTP server
+      SetKeepDisplayOnTimeOut(RETRY_INTERVAL_IN_MINUTES + 1);
+    };
+  };
+};
+
+bool ShouldTheDisplayBeOn()
+{
+
+  int timeToWake = wakeHour * 60 + wakeMinute;
+  int timeToSleep = sleepHour * 60 + sleepMinute;
+
+  static int lastMinuteChecked = -1;
+  static bool theDisplayHadBeenPreviouslyKeptOn = true;
+  static bool lastReturnValue = true;
+
+  bool returnValue = lastReturnValue;
+
+  if (turnOnDisplayAtSpecificTimesOnly)
+  {
+
+    if (timeToWake == timeToSleep)
+    {
+
+      // the display should only be set to on if the KeepDisplayOnTimeOut has not happened yet
+      returnValue = IsKeepDisplayOnTimedOut();
+    }
+    else
+    {
+
+      if (!IsKeepDisplayOnTimedOut())
+      {
+
+        theDisplayHadBeenPreviouslyKeptOn = true;
+        returnValue = true;
+      }
+      else
+      {
+
+        // Get the utc time
+        time_t utc_now = time(nullptr);
+
+        // the detailed time checking logic below is only performed:
+        //     once a minute when the seconds first reach zero
+        //     or
+        //     when the keepTheDisplayTimeOut had previously been kept on but no longer needs to be given the passing of time
+        //  otherwise
+        //     return the previously returned value
+
+        int iSecond = second(utc_now);
+
+        if ((iSecond == 0) || (theDisplayHadBeenPreviouslyKeptOn))
+        {
+
+          theDisplayHadBeenPreviouslyKeptOn = false;
+
+          // get the current local time
+          tm *timeinfo = localtime(&utc_now);
+
+          int iMinute = timeinfo->tm_min;
+
+          if (iMinute == lastMinuteChecked)
+
+            returnValue = lastReturnValue;
+
+          else
+          {
+
+            lastMinuteChecked = iMinute;
+
+            int iHour = timeinfo->tm_hour;
+
+            if (timeToSleep > timeToWake)
+            {
+
+              // as an example: wake up at 8 am and go to sleep at 10 pm
+
+              if ((iHour < wakeHour) || ((iHour == wakeHour) && (iMinute < wakeMinute)) || (iHour > sleepHour) || ((iHour == sleepHour) && (iMinute >= sleepMinute)))
+                returnValue = false;
+              else
+                returnValue = true;
+            }
+            else
+            {
+
+              // as an example: wake up at 10 pm and go to sleep at 8 am
+
+              if ((iHour < sleepHour) || ((iHour == sleepHour) && (iMinute < sleepMinute)) || (iHour > wakeHour) || ((iHour == wakeHour) && (iMinute >= wakeMinute)))
+                returnValue = true;
+              else
+                returnValue = false;
+            };
+          };
+        };
+      };
+    };
+
+    lastReturnValue = returnValue;
+  };
+
+  return returnValue;
+}
+
+void UpdateDisplay()
+{
+
+  static unsigned long lastDisplayUpdate = 0UL;
+  static bool tryToRestoreConnection = true;
+  static bool MQTTTransmissionLost = false;
+
+  // turn on or off the display as needed
+  bool theDisplayShouldBeOn = ShouldTheDisplayBeOn();
+
+  if (theDisplayIsCurrentlyOn && !theDisplayShouldBeOn)
+    SetTheDisplayOn(false);
+
+  if (!theDisplayIsCurrentlyOn && theDisplayShouldBeOn)
+    SetTheDisplayOn(true);
+
+  // only update the display when its time has come
+  if (millis() - lastDisplayUpdate < ((unsigned long)GENERAL_SETTINGS_SECONDS_BETWEEN_DISPLAY_UPDATES * 1000UL))
+    return;
+
+  // only update the display if it is on
+  if (!theDisplayShouldBeOn)
+    return;
+
+  // if the connection is not yet established, or had been lost then display an appropriate message
+
+  if (!client.isWifiConnected())
+  {
+
+    ShowStatusMessage("Awaiting Wi-Fi connection", NotoSansBold36, TFT_SKYBLUE);
+    return;
+  };
+
+  if (!client.isMqttConnected())
+  {
+
+    ShowStatusMessage("Awaiting MQTT connection", NotoSansBold36, TFT_SKYBLUE);
+    return;
+  };
+
+  // deal with the case that no data has arrived beyond the timeout period
+  // see the notes in the general_settings.h file for more information
+
+  if (millis() - lastMQTTUpdateReceived >= timeOutInMilliSeconds)
+  {
+
+    ShowStatusMessage("MQTT data updates have stopped", NotoSansBold24, TFT_RED);
+
+    if (!GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS)
+    {
+      // another system is responsible for sending the keep alive requests
+      // keep the message "MQTT data updates have stopped" on the screen for a brief period
+      // note: although the code below only delays for 1 second, the message will stay on the screen
+      // for longer than that while attempts (below) are made to reconnect
+      delay(1000);
+    };
+
+    if (tryToRestoreConnection)
+    {
+
+      // only try to restore the connection once
+      tryToRestoreConnection = false;
+
+      if (generalDebugOutput)
+        Serial.println("MQTT data updates have stopped");
+
+      ResetGlobals();
+
+      if (!GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS)
+      {
+
+        // if GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS is false it means that this program was counting on another system to send
+        // the keep alive request.  However, as this does not seem to be happening at the moment, the program will try resubscribing and sending
+        // a keep alive request itself (which is part of the mass subscribe process) to temporarily get things going again
+
+        MQTTTransmissionLost = true;
+
+        if (generalDebugOutput)
+          Serial.println("Attempting to restore MQTT data updates");
+
+        MassSubscribe();
+      };
+    };
+    return;
+  };
+
+  tryToRestoreConnection = true;
+
+  // wait until data for all data points have been received prior to showing the display
+  // while waiting display an appropriate message
+
+  if (awaitingInitialTransmissionOfAllDataPoints)
+  {
+
+    for (int i = 0; i < dataPoints; i++)
+      if (awaitingDataToBeReceived[i])
+      {
+
+        if (verboseDebugOutput)
+          Serial.println("Awaiting data on data point " + String(i));
+
+        ShowStatusMessage("Awaiting data", NotoSansBold36, TFT_SKYBLUE);
+
+        return;
+      };
+    // if we have reached this point data for all data points have been received
+    awaitingInitialTransmissionOfAllDataPoints = false;
+
+    if (generalDebugOutput)
+      Serial.println("All data received " + String(millis() - connectionEstablishedAt) + " ms after the MQTT connection was established");
+
+    if (MQTTTransmissionLost)
+    {
+      MQTTTransmissionLost = false;
+      if (generalDebugOutput)
+        Serial.println("MQTT data updates restored");
+    };
+  };
+
+  lastDisplayUpdate = millis();
+
+  if (topicBrowserSelected)
+  {
+    DrawTopicBrowser();
+    return;
+  };
+
+  // once drawn, the chart is kept up to date by RecordChartSample
+  if (chartSelected)
+  {
+    if (screenShowing != ChartScreen)
+      DrawChartScreen();
+    return;
+  };
+
+  // work out what each part of the screen should show, then only redraw the screen if something visible has changed
+
+  const char *chargerText;
+  if (currentMultiplusMode == Unknown)
+    chargerText = "Charger ?";
+  else if ((currentMultiplusMode == On) || (currentMultiplusMode == ChargerOnly))
+    chargerText = "Charger on";
+  else
+    chargerText = "Charger off";
+
+  const char *inverterText;
+  if (currentMultiplusMode == Unknown)
+    inverterText = "Inverter ?";
+  else if ((currentMultiplusMode == On) || (currentMultiplusMode == InverterOnly))
+    inverterText = "Inverter on";
+  else
+    inverterText = "Inverter off";
+  unsigned short multiplusModeColour = ColourForDataPoints(TFT_SKYBLUE, MultiplusModeDataPoint, MultiplusModeDataPoint);
+
+  // solar
+
+  solarWatts = int(solarWatts);
+
+  char solarText[16];
+  if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && (solarWatts >= 1000.0F))
+    FormatKiloWatts(solarText, sizeof(solarText), long(solarWatts), " KW");
+  else
+    FormatWatts(solarText, sizeof(solarText), long(solarWatts));
+  unsigned short solarColour = ColourForDataPoints(TFT_YELLOW, SolarDataPoint, SolarDataPoint);
+
+  // grid
+
+  float totalGridWatts = int(gridInL1Watts) + int(gridInL2Watts) + int(gridInL3Watts);
+
+  char gridText[16];
+  if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && (totalGridWatts >= 1000.0F))
+    FormatKiloWatts(gridText, sizeof(gridText), long(totalGridWatts), " KW");
+  else
+    FormatWatts(gridText, sizeof(gridText), long(totalGridWatts));
+  unsigned short gridColour = ColourForDataPoints(TFT_GOLD, GridInL1DataPoint, GridInL3DataPoint);
+
+  // AC consumption
+
+  float totalACConsumptionWatts = int(ACOutL1Watts + ACOutL2Watts + ACOutL3Watts);
+
+  char ACLoadText[16];
+  if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && (totalACConsumptionWatts >= 1000.0F))
+    FormatKiloWatts(ACLoadText, sizeof(ACLoadText), long(totalACConsumptionWatts), " KW");
+  else
+    FormatWatts(ACLoadText, sizeof(ACLoadText), long(totalACConsumptionWatts));
+  unsigned short ACLoadColour = ColourForDataPoints(TFT_SILVER, ACOutL1DataPoint, ACOutL3DataPoint);
+
+  // battery
+
+  int startAngle, endAngle;
+  unsigned short batteryColour;
+
+  startAngle = 180;
+  endAngle = int(batterySOC * 3.6 + 180) % 360;
+
+  if (batterySOC <= GENERAL_SETTINGS_SHOW_BATTERY_AS_RED)
+  {
+    batteryColour = TFT_RED;
+  }
+  else if (batterySOC <= GENERAL_SETTINGS_SHOW_BATTERY_AS_YELLOW)
+  {
+    batteryColour = TFT_YELLOW;
+  }
+  else
+  {
+    batteryColour = TFT_GREEN;
+  };
+
+  batteryColour = ColourForDataPoints(batteryColour, BatterySOCDataPoint, BatterySOCDataPoint);
+
+  // show battery percent without a decimal place
+  char batteryText[8];
+  size_t batteryTextLength = FormatFixedPoint(batteryText, sizeof(batteryText), batterySOC, 0);
+  AppendText(batteryText, sizeof(batteryText), batteryTextLength, "%");
+
+  // the additional information is dimmed independently of the battery percentage, based on the data point it is shown from
+
+  char additionalInfoText[24] = "";
+  unsigned short additionalInfoColour = batteryColour;
+
+  if ((GENERAL_SETTINGS_ADDITIONAL_INFO == 1) && (batteryTTG != 0))
+  {
+
+    // show time to go
+    FormatDaysHoursMinutes(additionalInfoText, sizeof(additionalInfoText), int(batteryTTG));
+    additionalInfoColour = ColourForDataPoints(batteryColour, BatteryTTGDataPoint, BatteryTTGDataPoint);
+  }
+  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 2)
+  {
+
+    // show charger state
+    AppendText(additionalInfoText, sizeof(additionalInfoText), 0, chargingState);
+    additionalInfoColour = ColourForDataPoints(batteryColour, ChargingStateDataPoint, ChargingStateDataPoint);
+  }
+  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 3)
+  {
+
+    // show battery temperature (with one decimal place)
+    size_t temperatureTextLength = FormatFixedPoint(additionalInfoText, sizeof(additionalInfoText), batteryTemperature, 1);
+    AppendText(additionalInfoText, sizeof(additionalInfoText), temperatureTextLength, "  ");
+    additionalInfoColour = ColourForDataPoints(batteryColour, BatteryTemperatureDataPoint, BatteryTemperatureDataPoint);
+  }
+  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 4)
+  {
+
+    // show battery power
+    if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && ((batteryPower >= 1000.0F) || (batteryPower <= -1000.0F)))
+      FormatKiloWatts(additionalInfoText, sizeof(additionalInfoText), long(batteryPower), " kW");
+    else
+      FormatWatts(additionalInfoText, sizeof(additionalInfoText), long(batteryPower));
+    additionalInfoColour = ColourForDataPoints(batteryColour, BatteryPowerDataPoint, BatteryPowerDataPoint);
+  }
+  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 5)
+  {
+
+    // show the solar energy produced today (with one decimal place)
+    size_t energyTextLength = FormatFixedPoint(additionalInfoText, sizeof(additionalInfoText), float(energy.today[SolarEnergy] / 1000.0), 1);
+    AppendText(additionalInfoText, sizeof(additionalInfoText), energyTextLength, " kWh");
+    additionalInfoColour = ColourForDataPoints(batteryColour, SolarDataPoint, SolarDataPoint);
+  };
+
+  // an upward triangle is shown if the battery is charging or a downward triangle if it is discharging
+  // however, if it is neither charging or discharging then no triangle is shown at all
+
+  int arrowDirection = 0;
+  if (batteryPower > 0.0F)
+    arrowDirection = 1;
+  else if (batteryPower < 0.0F)
+    arrowDirection = -1;
+
+  unsigned short arrowColour = ColourForDataPoints(batteryColour, BatteryPowerDataPoint, BatteryPowerDataPoint);
+
+  // compare against what is currently on the screen
+
+  bool somethingHasChanged = false;
+  somethingHasChanged |= UpdateWidgetCache(ChargerWidget, chargerText, multiplusModeColour, 0);
+  somethingHasChanged |= UpdateWidgetCache(InverterWidget, inverterText, multiplusModeColour, 0);
+  somethingHasChanged |= UpdateWidgetCache(SolarWidget, solarText, solarColour, 0);
+  somethingHasChanged |= UpdateWidgetCache(GridWidget, gridText, gridColour, 0);
+  somethingHasChanged |= UpdateWidgetCache(ACLoadWidget, ACLoadText, ACLoadColour, 0);
+  somethingHasChanged |= UpdateWidgetCache(BatteryWidget, batteryText, batteryColour, endAngle);
+  somethingHasChanged |= UpdateWidgetCache(AdditionalInfoWidget, additionalInfoText, additionalInfoColour, 0);
+  somethingHasChanged |= UpdateWidgetCache(BatteryArrowWidget, "", arrowColour, arrowDirection);
+
+  if ((screenShowing == MainScreen) && !somethingHasChanged && (millis() - lastMainScreenRefresh < forcedDisplayRefreshIntervalInMilliSeconds))
+  {
+    displayFramesSkipped++;
+    return;
+  };
+
+  unsigned long frameStartTime = micros();
+  TraceEvent(frameStartTime, FrameRenderEvent, TraceBegin);
+
+  int x, y;
+
+  // Tabula rasa
+
+  sprite.fillSprite(TFT_BLACK);
+
+  // show charger and inverter status
+
+  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
+    sprite.setTextDatum(TL_DATUM);
+  else
+    sprite.setTextDatum(TR_DATUM);
+
+  sprite.loadFont(NotoSansBold24);
+
+  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
+    x = 0;
+  else
+    x = TFT_WIDTH;
+
+  sprite.setTextColor(multiplusModeColour, TFT_BLACK);
+
+  if (GENERAL_SETTINGS_SHOW_CHARGER_MODE)
+  {
+    y = 5;
+    sprite.drawString(chargerText, x, y);
+  };
+
+  if (GENERAL_SETTINGS_SHOW_INVERTER_MODE)
+  {
+    y = TFT_HEIGHT - 30;
+    sprite.drawString(inverterText, x, y);
+  };
+
+  sprite.unloadFont();
+
+  // show solar info
+
+  sprite.loadFont(NotoSansBold24);
+  sprite.setTextColor(TFT_YELLOW, TFT_BLACK);
+
+  y = TFT_HEIGHT / 2 - 36;
+  sprite.drawString("Solar", x, y);
+
+  sprite.loadFont(NotoSansBold36);
+  sprite.setTextColor(solarColour, TFT_BLACK);
+
+  y = TFT_HEIGHT / 2 + 4;
+  sprite.drawString(solarText, x, y);
+
+  sprite.unloadFont();
+
+  // show grid info
+
+  sprite.loadFont(NotoSansBold24);
+  sprite.setTextColor(TFT_GOLD, TFT_BLACK);
+
+  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
+    sprite.setTextDatum(TR_DATUM);
+  else
+    sprite.setTextDatum(TL_DATUM);
+
+  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
+    x = TFT_WIDTH;
+  else
+    x = 0;
+
+  y = 0;
+  sprite.drawString("Grid", x, y);
+  sprite.unloadFont();
+
+  sprite.loadFont(NotoSansBold36);
+  sprite.setTextColor(gridColour, TFT_BLACK);
+
+  y = 43;
+  sprite.drawString(gridText, x, y);
+
+  sprite.unloadFont();
+
+  // show AC consumption info
+
+  sprite.loadFont(NotoSansBold24);
+  sprite.setTextColor(TFT_SILVER, TFT_BLACK);
+
+  y = TFT_HEIGHT - 73;
+  sprite.drawString("AC Load", x, y);
+
+  sprite.unloadFont();
+  sprite.loadFont(NotoSansBold36);
+  sprite.setTextColor(ACLoadColour, TFT_BLACK);
+
+  y = TFT_HEIGHT - 30;
+  sprite.drawString(ACLoadText, x, y);
+
+  sprite.unloadFont();
+
+  // show battery info
+
+  int midX, midY, outerRadius, innerRadius;
+
+  midX = TFT_WIDTH / 2;
+  midY = TFT_HEIGHT / 2;
+
+  if (midX < midY)
+    outerRadius = midX;
+  else
+    outerRadius = midY;
+
+  innerRadius = outerRadius - 8;
+
+  sprite.drawSmoothArc(midX, midY, outerRadius, innerRadius, startAngle, endAngle, batteryColour, TFT_BLACK);
+
+  sprite.loadFont(NotoSansBold72);
+  sprite.setTextDatum(MC_DATUM);
+  sprite.setTextColor(batteryColour, TFT_BLACK);
+
+  sprite.drawString(batteryText, midX, midY);
+
+  sprite.unloadFont();
+
+  sprite.loadFont(NotoSansBold24);
+  sprite.drawString("Battery", midX, midY - 60);
+
+  sprite.setTextColor(additionalInfoColour, TFT_BLACK);
+  sprite.drawString(additionalInfoText, midX, midY + 50);
+
+  if (GENERAL_SETTINGS_ADDITIONAL_INFO == 3)
+  {
+    // add the degree symbol
+    sprite.unloadFont();
+    sprite.loadFont(NotoSansBold15);
+    int degreePosx = sprite.textWidth(additionalInfoText) / 2 + 4;
+    sprite.drawString(String("o"), midX + degreePosx, midY + 43);
+  };
+
+  sprite.unloadFont();
+
+  if (arrowDirection != 0)
+  {
+
+    int16_t centerX = TFT_WIDTH / 2;
+    int16_t centerY = TFT_HEIGHT / 2 + 88;
+
+    int16_t arrowWidth = 20;
+    int16_t arrowHeight = 25;
+
+    if (arrowDirection > 0)
+    {
+
+      // Draw a upward triangle
+      sprite.fillTriangle(centerX - arrowWidth / 2, centerY + arrowHeight / 2,
+                          centerX + arrowWidth / 2, centerY + arrowHeight / 2,
+                          centerX, centerY - arrowHeight / 2, arrowColour);
+    }
+    else
+    {
+
+      // Draw a downward triangle
+      sprite.fillTriangle(centerX - arrowWidth / 2, centerY - arrowHeight / 2,
+                          centerX + arrowWidth / 2, centerY - arrowHeight / 2,
+                          centerX, centerY + arrowHeight / 2, arrowColour);
+    };
+  };
+
+  // used for testing only - display the date and time
+  //
+  // sprite.loadFont(NotoSansBold24);
+  // sprite.setTextColor(TFT_RED, TFT_BLACK);
+  //
+  // if (GENERAL_SETTINGS_USB_ON_THE_LEFT) {
+  //  sprite.setTextDatum(TL_DATUM);
+  //} else {
+  //  sprite.setTextDatum(TR_DATUM);
+  //};
+  //
+  // struct tm timeinfo;
+  // getLocalTime(&timeinfo);
+  // String currentTimeString = (String)asctime(&timeinfo) + " ";
+  //
+  // sprite.drawString(currentTimeString, 0, 50);
+  // sprite.unloadFont();
+  //
+  // end of testing block
+
+  unsigned long pushStartTime = micros();
+  RecordLatency(loopStageHistograms[RenderStage], pushStartTime - frameStartTime);
+  TraceEvent(pushStartTime, FrameRenderEvent, TraceEnd);
+
+  RefreshDisplay();
+
+  RecordLatency(loopStageHistograms[PushStage], micros() - pushStartTime);
+
+  screenShowing = MainScreen;
+  lastMainScreenRefresh = millis();
+
+  displayFramesRendered++;
+  unsigned long frameMicroSeconds = micros() - frameStartTime;
+  displayRenderingMicroSeconds += frameMicroSeconds;
+
+  // the frame signature identifies exactly what was drawn, so the effect of any change to the drawing code can be checked pixel for pixel against an earlier version
+  if (verboseDebugOutput)
+    Serial.printf("Frame rendered in %lu us, signature %08lX\n", frameMicroSeconds, (unsigned long)FrameSignature());
+}
+
+uint32_t FrameSignature()
+{
+  return HashBytes((const uint8_t *)sprite.getPointer(), (size_t)TFT_WIDTH * TFT_HEIGHT * 2);
+}
+
+void SendScreenshot()
+{
+
+  // sends what is currently shown on the display to the serial port as a binary PPM (P6) image, between a begin and an end line
+  // the image can be saved from a serial terminal capture and opened with most image viewers
+  // the sprite holds each RGB565 pixel with its bytes swapped, ready to be pushed to the display
+
+  const uint16_t *pixels = (const uint16_t *)sprite.getPointer();
+  uint8_t row[TFT_WIDTH * 3];
+
+  Serial.printf("--- screenshot begin (signature %08lX) ---\n", (unsigned long)FrameSignature());
+  Serial.printf("P6\n%d %d\n255\n", TFT_WIDTH, TFT_HEIGHT);
+
+  for (int y = 0; y < TFT_HEIGHT; y++)
+  {
+    for (int x = 0; x < TFT_WIDTH; x++)
+    {
+      uint16_t colour = SwapColourBytes(pixels[y * TFT_WIDTH + x]);
+      row[x * 3] = ((colour >> 11) & 0x1F) * 255 / 31;
+      row[x * 3 + 1] = ((colour >> 5) & 0x3F) * 255 / 63;
+      row[x * 3 + 2] = (colour & 0x1F) * 255 / 31;
+    };
+    Serial.write(row, sizeof(row));
+  };
+
+  Serial.println();
+  Serial.println("--- screenshot end ---");
+}
+
+void SendTrace()
+{
+
+  // sends the events recorded as Chrome Trace JSON, between a begin and an end line
+  // the timestamps are made relative to the oldest event recorded
+
+  size_t events = TraceEventsRecorded();
+
+  Serial.println("--- trace begin ---");
+  Serial.println("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  unsigned long long timestamp = 0ULL;
+  uint32_t previousTimestamp = (events > 0) ? TraceEventAt(0).timestamp : 0UL;
+
+  for (size_t i = 0; i < events; i++)
+  {
+
+    const traceEvent &event = TraceEventAt(i);
+
+    // adding up the time between events allows for micros() rolling over, which happens approximately every 71 minutes
+    timestamp += (uint32_t)(event.timestamp - previousTimestamp);
+    previousTimestamp = event.timestamp;
+
+    // the events are shown on three timelines: MQTT and the network, the display, and the buttons
+    int timeline;
+    switch (event.name)
+    {
+    case FrameRenderEvent:
+    case FramePushEvent:
+    case DisplayChunkEvent:
+    case DisplayOffEvent:
+      timeline = 2;
+      break;
+    case ButtonPressedEvent:
+      timeline = 3;
+      break;
+    default:
+      timeline = 1;
+      break;
+    };
+
+    Serial.printf("{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%d,%s\"args\":{\"value\":%u}}%s\n",
+                  TraceEventNameText(event.name), (char)event.phase, timestamp, timeline,
+                  (event.phase == TraceInstant) ? "\"s\":\"t\"," : "", (unsigned int)event.argument, (i + 1 < events) ? "," : "");
+  };
+
+  Serial.println("]}");
+  Serial.println("--- trace end ---");
+}
+
+void CheckSerialCommands()
+{
+
+  // commands may be typed into the serial monitor (followed by enter) when debug output is turned on:
+  //
+  //   screenshot  - send what is currently shown on the display as a PPM image
+  //   record      - start recording the MQTT traffic received (this replaces any earlier recording)
+  //   stop        - stop recording the MQTT traffic
+  //   recording   - send the recorded MQTT traffic
+  //   stats       - send the ingestion statistics as JSON
+  //   profile     - send the time taken by each stage of loop()
+  //   reset       - clear the times taken by each stage of loop()
+  //   trace on    - start recording a trace of events (this replaces any earlier trace)
+  //   trace off   - stop recording the trace
+  //   trace       - send the trace as Chrome Trace JSON, which can be viewed with chrome://tracing or https://ui.perfetto.dev
+  //   history     - send the minimum, maximum and average of each value in the history over the last minute, hour, day and 30 days
+  //   energy      - send the energy totals for today and yesterday
+  //   log         - send the log of the values, averaged over each minute, for the last 24 hours as CSV
+  //   batteries   - send the state of charge, power and voltage of each battery (if GENERAL_SETTINGS_REPORT_EACH_BATTERY is true)
+  //   devices     - send the power and state of every solar charger and VE.Bus unit, and their totals (if GENERAL_SETTINGS_REGISTER_EVERY_DEVICE is true)
+  //   topics      - send the number of topics held by the topic browser, and the bytes they use (if GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER is true)
+
+  static char command[32];
+  static int commandLength = 0;
+
+  if (!generalDebugOutput)
+    return;
+
+  while (Serial.available() > 0)
+  {
+
+    char c = (char)Serial.read();
+
+    if ((c == '\n') || (c == '\r'))
+    {
+
+      command[commandLength] = '\0';
+
+      if (strcmp(command, "screenshot") == 0)
+        SendScreenshot();
+      else if (strcmp(command, "record") == 0)
+        StartRecordingTraffic();
+      else if (strcmp(command, "stop") == 0)
+        StopRecordingTraffic();
+      else if (strcmp(command, "recording") == 0)
+        SendTrafficRecording();
+      else if (strcmp(command, "stats") == 0)
+        SendIngestionStatistics();
+      else if (strcmp(command, "profile") == 0)
+        SendLoopProfile();
+      else if (strcmp(command, "reset") == 0)
+        ResetLoopProfile();
+      else if (strcmp(command, "trace on") == 0)
+      {
+        StartTracing();
+        Serial.println("Tracing");
+      }
+      else if (strcmp(command, "trace off") == 0)
+      {
+        StopTracing();
+        Serial.println("Tracing stopped, " + String((unsigned long)TraceEventsRecorded()) + " events recorded");
+      }
+      else if (strcmp(command, "trace") == 0)
+        SendTrace();
+      else if (strcmp(command, "history") == 0)
+        SendHistorySummary();
+      else if (strcmp(command, "energy") == 0)
+        SendEnergyTotals();
+      else if (strcmp(command, "log") == 0)
+        SendTelemetryLog();
+      else if (strcmp(command, "batteries") == 0)
+        SendBatteriesReported();
+      else if (strcmp(command, "devices") == 0)
+        SendDevicesRegistered();
+      else if (strcmp(command, "topics") == 0)
+        SendTopicIndexSummary();
+      else if (commandLength > 0)
+        Serial.println("Unknown command: " + String(command));
+
+      commandLength = 0;
+    }
+    else if (commandLength < (int)sizeof(command) - 1)
+    {
+      command[commandLength++] = c;
+    };
+  };
+}
+
+void ServiceMQTT()
+{
+
+  // runs client.loop(), which delivers the payloads received to the subscription callbacks, and keeps track of how long it takes
+
+  unsigned long payloadsBefore = payloadsReceived;
+  unsigned long startTime = micros();
+
+  client.loop();
+
+  unsigned long elapsed = micros() - startTime;
+
+  mqttLoopCalls++;
+  mqttLoopMicroSeconds += elapsed;
+  if (payloadsReceived != payloadsBefore)
+    mqttIngestionMicroSeconds += elapsed;
+  if (elapsed > mqttLoopLongestMicroSeconds)
+    mqttLoopLongestMicroSeconds = elapsed;
+
+  static bool wiFiWasConnected = false;
+  static bool mqttWasConnected = false;
+
+  if (client.isWifiConnected() != wiFiWasConnected)
+  {
+    wiFiWasConnected = !wiFiWasConnected;
+    TraceEvent(micros(), WiFiConnectedEvent, TraceInstant, wiFiWasConnected);
+  };
+
+  if (client.isMqttConnected() != mqttWasConnected)
+  {
+    mqttWasConnected = !mqttWasConnected;
+    TraceEvent(micros(), MQTTConnectedEvent, TraceInstant, mqttWasConnected);
+  };
+
+  unsigned long now = millis();
+  if (now - currentSecondStartedAt >= 1000UL)
+  {
+    if (payloadsInCurrentSecond > peakPayloadsPerSecond)
+      peakPayloadsPerSecond = payloadsInCurrentSecond;
+    payloadsInCurrentSecond = 0UL;
+    currentSecondStartedAt = now;
+  };
+}
+
+unsigned long EndLoopStage(loopStage stage, unsigned long stageStartTime)
+{
+  // records the time taken by a stage of loop() and returns the time the next stage starts
+  unsigned long now = micros();
+  RecordLatency(loopStageHistograms[stage], now - stageStartTime);
+  return now;
+}
+
+void SendLoopProfile()
+{
+
+  Serial.println("Loop stage           samples    p50 us    p99 us    max us    avg us");
+
+  for (int i = 0; i < loopStages; i++)
+  {
+    const latencyHistogram &histogram = loopStageHistograms[i];
+    Serial.printf("%-18s %9lu %9lu %9lu %9lu %9lu\n", loopStageNames[i], (unsigned long)histogram.samples,
+                  (unsigned long)LatencyPercentile(histogram, 50), (unsigned long)LatencyPercentile(histogram, 99),
+                  (unsigned long)histogram.maximum, (unsigned long)AverageLatency(histogram));
+  };
+}
+
+void ResetLoopProfile()
+{
+  for (int i = 0; i < loopStages; i++)
+    ClearLatencyHistogram(loopStageHistograms[i]);
+  Serial.println("Loop profile reset");
+}
+
+void RecordLoopPass(unsigned long elapsedMicroSeconds)
+{
+  RecordLatency(loopStageHistograms[WholeLoopStage], elapsedMicroSeconds);
+  loopPasses++;
+  if (elapsedMicroSeconds > loopPassLongestMicroSeconds)
+    loopPassLongestMicroSeconds = elapsedMicroSeconds;
+  if (elapsedMicroSeconds > lateLoopPassMilliSeconds * 1000UL)
+    lateLoopPasses++;
+}
+
+void SendIngestionStatistics()
+{
+
+  // sends the ingestion statistics as a single line of JSON, so that they can be captured and compared between versions
+
+  unsigned long payloadsParsed = 0UL;
+  for (int i = 0; i < subscribedTopics; i++)
+    payloadsParsed += topicPayloadStatuses[i].parsed;
+
+  unsigned long uptimeInSeconds = millis() / 1000UL;
+
+  float averagePayloadsPerSecond = 0.0F;
+  if (uptimeInSeconds > 0)
+    averagePayloadsPerSecond = (float)payloadsReceived / (float)uptimeInSeconds;
+
+  unsigned long averageMqttLoopMicroSeconds = 0UL;
+  if (mqttLoopCalls > 0)
+    averageMqttLoopMicroSeconds = (unsigned long)(mqttLoopMicroSeconds / mqttLoopCalls);
+
+  unsigned long ingestionMicroSecondsPerPayload = 0UL;
+  if (payloadsReceived > 0)
+    ingestionMicroSecondsPerPayload = (unsigned long)(mqttIngestionMicroSeconds / payloadsReceived);
+
+  Serial.printf("{\"uptime_s\":%lu,\"payloads_received\":%lu,\"payloads_parsed\":%lu,\"average_payloads_per_s\":%.2f,\"peak_payloads_per_s\":%lu,"
+                "\"mqtt_loop_calls\":%lu,\"mqtt_loop_average_us\":%lu,\"mqtt_loop_longest_us\":%lu,\"ingestion_us_per_payload\":%lu,"
+                "\"loop_passes\":%lu,\"loop_pass_longest_us\":%lu,\"late_loop_passes\":%lu,"
+                "\"frames_rendered\":%lu,\"frames_skipped\":%lu,\"free_heap\":%lu,\"minimum_free_heap\":%lu}\n",
+                uptimeInSeconds, payloadsReceived, payloadsParsed, averagePayloadsPerSecond, peakPayloadsPerSecond,
+                mqttLoopCalls, averageMqttLoopMicroSeconds, mqttLoopLongestMicroSeconds, ingestionMicroSecondsPerPayload,
+                loopPasses, loopPassLongestMicroSeconds, lateLoopPasses,
+                displayFramesRendered, displayFramesSkipped, (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap());
+}
+
+void ReportStatistics()
+{
+
+  const unsigned long STATISTICS_REPORTING_INTERVAL_IN_MILLIS = 10UL * 60UL * 1000UL;
+  static unsigned long lastStatisticsReport = 0UL;
+
+  if (!generalDebugOutput)
+    return;
+
+  if (millis() - lastStatisticsReport < STATISTICS_REPORTING_INTERVAL_IN_MILLIS)
+    return;
+
+  lastStatisticsReport = millis();
+
+  unsigned long averageFrameMicroSeconds = 0UL;
+  if (displayFramesRendered > 0)
+    averageFrameMicroSeconds = (unsigned long)(displayRenderingMicroSeconds / displayFramesRendered);
+
+  // the rendering time saved is the measured average time of a frame for each frame skipped
+  float renderingSavedInMilliSeconds = (float)averageFrameMicroSeconds * (float)displayFramesSkipped / 1000.0F;
+
+  Serial.printf("Display frames rendered: %lu, skipped: %lu, average frame time: %lu us, rendering time saved: %.0f ms\n",
+                displayFramesRendered, displayFramesSkipped, averageFrameMicroSeconds, renderingSavedInMilliSeconds);
+
+  for (int i = 0; i < subscribedTopics; i++)
+    if (topicPayloadStatuses[i].received > 0)
+      Serial.printf("Topic %d payloads received: %lu, duplicates: %lu, parsed: %lu\n",
+                    i, topicPayloadStatuses[i].received, topicPayloadStatuses[i].duplicates, topicPayloadStatuses[i].parsed);
+
+  SendIngestionStatistics();
+
+  SendLoopProfile();
+}
+
+void ResetGlobals()
+{
+
+  if (initialStartupLoadVictronInstallationAndMultiplusIDs)
+  {
+
+    initialStartupLoadVictronInstallationAndMultiplusIDs = false;
+
+    String(SECRET_SETTING_VICTRON_INSTALLATION_ID).toCharArray(VictronInstallationIDArray, String(SECRET_SETTING_VICTRON_INSTALLATION_ID).length() + 1);
+    String(SECRET_SETTING_VICTRON_MULTIPLUS_ID).toCharArray(MultiplusThreeDigitIDArray, String(SECRET_SETTING_VICTRON_MULTIPLUS_ID).length() + 1);
+    String(SECRET_SETTING_VICTRON_SOLAR_CHARGER_ID).toCharArray(SolarChargerThreeDigitIDArray, String(SECRET_SETTING_VICTRON_SOLAR_CHARGER_ID).length() + 1);
+  };
+
+  VictronInstallationID = String(VictronInstallationIDArray);
+  MultiplusThreeDigitID = String(MultiplusThreeDigitIDArray);
+  SolarChargerThreeDigitID = String(SolarChargerThreeDigitIDArray);
+
+  awaitingInitialTransmissionOfAllDataPoints = true;
+  for (int i = 0; i < dataPoints; i++)
+  {
+    awaitingDataToBeReceived[i] = true;
+    dataPointStatuses[i].generation = 0UL;
+    dataPointStatuses[i].lastUpdateReceived = 0UL;
+    dataPointStatuses[i].lastReadRequestSent = 0UL;
+    dataPointStatuses[i].staleAtSource = false;
+  };
+
+  // the counters are kept, but as the values above have been reset the next payload received on each topic needs to be parsed
+  for (int i = 0; i < subscribedTopics; i++)
+    ForgetLastPayload(i);
+
+  gridInL1Watts = 0.0;
+  gridInL2Watts = 0.0;
+  gridInL3Watts = 0.0;
+
+  solarWatts = 0.0;
+
+  batterySOC = 0.0;
+  batteryTTG = 0.0;
+  batteryPower = 0.0;
+
+  ACOutL1Watts = 0.0;
+  ACOutL2Watts = 0.0;
+  ACOutL3Watts = 0.0;
+
+  currentMultiplusMode = Unknown;
+
+  chargingState = "";
+};
+
+void RecordDataPointUpdate(dataPoint updatedDataPoint)
+{
+  unsigned long now = millis();
+
+  awaitingDataToBeReceived[updatedDataPoint] = false;
+  dataPointStatuses[updatedDataPoint].generation++;
+  dataPointStatuses[updatedDataPoint].lastUpdateReceived = now;
+  dataPointStatuses[updatedDataPoint].staleAtSource = false;
+
+  lastMQTTUpdateReceived = now;
+
+  TraceEvent(micros(), PayloadParsedEvent, TraceEnd, updatedDataPoint);
+}
+
+uint32_t HashBytes(const uint8_t *bytes, size_t length)
+{
+  // 32 bit FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  };
+  return hash;
+}
+
+uint32_t HashPayload(const String &payload)
+{
+  return HashBytes((const uint8_t *)payload.c_str(), payload.length());
+}
+
+void CountPayloadReceived(int topic, const String &payload)
+{
+
+  topicPayloadStatuses[topic].received++;
+
+  payloadsReceived++;
+  payloadsInCurrentSecond++;
+
+  TraceEvent(micros(), PayloadReceivedEvent, TraceInstant, topic);
+
+  if (recordingTraffic)
+    RecordTraffic(topic, payload);
+}
+
+bool PayloadIsUnchanged(int topic, dataPoint topicDataPoint, const String &payload)
+{
+
+  // returns true if the payload is identical to the last one received on the topic, in which case the data point is known to still be
+  // current so only its time of last update is refreshed; its generation is left as is as the value it holds has not changed
+
+  CountPayloadReceived(topic, payload);
+
+  topicPayloadStatus &status = topicPayloadStatuses[topic];
+
+  uint32_t hash = HashPayload(payload);
+
+  if (status.payloadReceived && (status.lastPayloadLength == payload.length()) && (status.lastPayloadHash == hash))
+  {
+    status.duplicates++;
+
+    unsigned long now = millis();
+    dataPointStatuses[topicDataPoint].lastUpdateReceived = now;
+    lastMQTTUpdateReceived = now;
+
+    return true;
+  };
+
+  status.payloadReceived = true;
+  status.lastPayloadLength = payload.length();
+  status.lastPayloadHash = hash;
+  status.parsed++;
+
+  // the parse ends when the callback records the update to the data point
+  TraceEvent(micros(), PayloadParsedEvent, TraceBegin, topicDataPoint);
+
+  return false;
+}
+
+void ForgetLastPayload(int topic)
+{
+  // ensures the next payload received on the topic is parsed even if it is the same as the last one
+  topicPayloadStatuses[topic].payloadReceived = false;
+}
+
+void StartRecordingTraffic()
+{
+  trafficRecordingLength = 0;
+  BeginTrafficLogWriter(trafficRecordingWriter);
+  trafficRecordingStartedAt = millis();
+  recordingTraffic = true;
+  Serial.println("Recording MQTT traffic");
+}
+
+void StopRecordingTraffic()
+{
+  recordingTraffic = false;
+  Serial.println("MQTT traffic recording stopped, " + String((unsigned long)trafficRecordingLength) + " bytes recorded");
+}
+
+void RecordTraffic(int topic, const String &payload)
+{
+
+  String topicName = (topic == GatewaySnapshotTopic) ? GatewaySnapshotTopicName() : "N/" + VictronInstallationID + "/" + SubscribedTopicPath(topic);
+
+  if (!AppendTrafficLogMessage(trafficRecordingWriter, trafficRecording, trafficRecordingSize, trafficRecordingLength, millis() - trafficRecordingStartedAt,
+                               topicName.c_str(), topicName.length(), (const uint8_t *)payload.c_str(), payload.length()))
+    StopRecordingTraffic();
+}
+
+void SendTrafficRecording()
+{
+
+  // sends the recording to the serial port one payload per line, as milliseconds since the recording started, topic, and payload
+
+  Serial.println("--- MQTT traffic recording begin ---");
+
+  trafficLogReader reader;
+  trafficLogMessage message;
+
+  BeginTrafficLogReader(reader, trafficRecording, trafficRecordingLength);
+
+  while (ReadTrafficLogMessage(reader, message))
+  {
+    Serial.printf("%lu ", (unsigned long)message.time);
+    Serial.write((const uint8_t *)message.topic, message.topicLength);
+    Serial.print(" ");
+    Serial.write(message.payload, message.payloadLength);
+    Serial.println();
+  };
+
+  Serial.println("--- MQTT traffic recording end ---");
+}
+
+bool IsDataPointStale(int i)
+{
+  if (!staleValuesCanBeDetected)
+    return false;
+
+  // a data point which has never been received (either because it is not used or because it is still being waited on) is not considered stale
+  if (dataPointStatuses[i].generation == 0UL)
+    return false;
+
+  if (dataPointStatuses[i].staleAtSource)
+    return true;
+
+  return (millis() - dataPointStatuses[i].lastUpdateReceived >= staleAfterMilliSeconds);
+}
+
+bool AnyDataPointIsStale(dataPoint firstDataPoint, dataPoint lastDataPoint)
+{
+  for (int i = firstDataPoint; i <= lastDataPoint; i++)
+    if (IsDataPointStale(i))
+      return true;
+
+  return false;
+}
+
+unsigned short ColourForDataPoints(unsigned short colour, dataPoint firstDataPoint, dataPoint lastDataPoint)
+{
+  // returns the colour to use for a value based on the data points from which it is calculated, dimmed if any of them are stale
+  return AnyDataPointIsStale(firstDataPoint, lastDataPoint) ? staleValueColour : colour;
+}
+
+String SubscribedTopicPath(int topic)
+{
+
+  // the path, after N/<installation id>/ (or R/<installation id>/ to read it), of the topic on which the payloads for a data point
+  // or one of the Multiplus LED topics are received
+
+  String system0Path = "system/0/";
+  String ledsPath = "vebus/" + MultiplusThreeDigitID + "/Leds/";
+
+  switch (topic)
+  {
+  case GridInL1DataPoint:
+    return system0Path + "Ac/Grid/L1/Power";
+  case GridInL2DataPoint:
+    return system0Path + "Ac/Grid/L2/Power";
+  case GridInL3DataPoint:
+    return system0Path + "Ac/Grid/L3/Power";
+  case SolarDataPoint:
+    return system0Path + "Dc/Pv/Power";
+  case BatterySOCDataPoint:
+    return system0Path + "Dc/Battery/Soc";
+  case BatteryPowerDataPoint:
+    return system0Path + "Dc/Battery/Power";
+  case BatteryTTGDataPoint:
+    return system0Path + "Dc/Battery/TimeToGo";
+  case ChargingStateDataPoint:
+    return "solarcharger/" + SolarChargerThreeDigitID + "/State";
+  case BatteryTemperatureDataPoint:
+    return system0Path + "Dc/Battery/Temperature";
+  case ACOutL1DataPoint:
+    return system0Path + "Ac/Consumption/L1/Power";
+  case ACOutL2DataPoint:
+    return system0Path + "Ac/Consumption/L2/Power";
+  case ACOutL3DataPoint:
+    return system0Path + "Ac/Consumption/L3/Power";
+  case MultiplusModeDataPoint:
+    return "vebus/" + MultiplusThreeDigitID + "/Mode";
+  case MultiplusBulkLEDTopic:
+    return ledsPath + "Bulk";
+  case MultiplusAbsorptionLEDTopic:
+    return ledsPath + "Absorption";
+  case MultiplusFloatLEDTopic:
+    return ledsPath + "Float";
+  default:
+    return "";
+  };
+}
+
+void SendReadRequestForDataPoint(int i)
+{
+
+  // Venus will republish the current value of a topic when it receives a read request for it
+
+  String readTopic = "R/" + VictronInstallationID + "/";
+
+  if ((i == ChargingStateDataPoint) && ESSIsBeingUsed)
+  {
+    client.publish(readTopic + SubscribedTopicPath(MultiplusBulkLEDTopic), "");
+    client.publish(readTopic + SubscribedTopicPath(MultiplusAbsorptionLEDTopic), "");
+    client.publish(readTopic + SubscribedTopicPath(MultiplusFloatLEDTopic), "");
+  }
+  else if (i < dataPoints)
+    client.publish(readTopic + SubscribedTopicPath(i), "");
+}
+
+void RequestStaleDataPoints()
+{
+
+  // rather than resubscribing to everything when a single value stops being updated, only the values that have gone stale are requested again
+  // if all values have stopped being updated the recovery is instead handled in UpdateDisplay()
+
+  if (!staleValuesCanBeDetected || !theDisplayIsCurrentlyOn || !client.isMqttConnected() || awaitingInitialTransmissionOfAllDataPoints)
+    return;
+
+  // a sibling of a gateway is not subscribed to Venus's topics, so it has nothing to request
+  if (thisDeviceIsAGatewaySibling)
+    return;
+
+  unsigned long now = millis();
 
-      SetTheDisplayOn(true);
+  if (now - lastMQTTUpdateReceived >= timeOutInMilliSeconds)
+    return;
 
-      // ensure whichever button was last pressed is now released
-      while (digitalRead(topButton) == 0)
-        msTimer.begin(50);
+  for (int i = 0; i < dataPoints; i++)
+  {
+    if (IsDataPointStale(i) && (now - dataPointStatuses[i].lastReadRequestSent >= staleAfterMilliSeconds))
+    {
+      dataPointStatuses[i].lastReadRequestSent = now;
 
-      while (digitalRead(bottomButton) == 0)
-        msTimer.begin(50);
+      if (generalDebugOutput)
+        Serial.println("Data point " + String(i) + " is stale (generation " + String(dataPointStatuses[i].generation) + "), requesting it again");
 
-      SetKeepDisplayOnTimeOut(1);
+      SendReadRequestForDataPoint(i);
     };
   };
 }
 
-String ConvertSecondsToDayHoursMinutes(int n)
+void SetupHistory()
 {
 
-  String sDays, sHours, sMinutes;
+  // the history needs about 3 MB, which is only available if the board's PSRAM is enabled (in the Arduino IDE: Tools, PSRAM, OPI PSRAM)
 
-  int day = n / (24 * 3600);
+  if (psramFound())
+    historyIsBeingKept = BeginHistoryPyramid(ps_malloc);
 
-  if ((day) > 0)
-    sDays = String(day);
-  else
-    sDays = "";
+  if (generalDebugOutput)
+  {
+    if (historyIsBeingKept)
+      Serial.println("History is being kept in PSRAM (" + String((unsigned long)HistoryPyramidMemoryRequired()) + " bytes)");
+    else
+      Serial.println("History is not being kept as there is not enough PSRAM");
+  };
+}
 
-  n = n % (24 * 3600);
+void RecordHistory()
+{
 
-  int hour = n / 3600;
-  sHours = String(hour);
+  static unsigned long lastHistorySecond = 0UL;
 
-  n %= 3600;
+  if (!historyIsBeingKept)
+    return;
 
-  int minutes = n / 60;
-  if (minutes < 10)
-    sMinutes = "0" + String(minutes);
-  else
-    sMinutes = String(minutes);
+  unsigned long now = millis();
+  if (now - lastHistorySecond < 1000UL)
+    return;
 
-  return (sDays + " " + sHours + ":" + sMinutes);
-  // return (sDays + "D " + sHours + "H " + sMinutes + "M");
-}
+  // count every whole second that has passed, so the history's time keeps in step with millis() even if loop() has been held up
+  historySeconds += (now - lastHistorySecond) / 1000UL;
+  lastHistorySecond = now - (now - lastHistorySecond) % 1000UL;
 
-float roundFloat(float value, int decimals)
-{
-  float multiplier = pow(10, decimals);
-  return round(value * multiplier) / multiplier;
+  if (!theDisplayIsCurrentlyOn || !client.isMqttConnected() || awaitingInitialTransmissionOfAllDataPoints)
+    return;
+
+  float values[historyMetrics];
+  values[SolarHistory] = solarWatts;
+  values[GridHistory] = gridInL1Watts + gridInL2Watts + gridInL3Watts;
+  values[ACLoadHistory] = ACOutL1Watts + ACOutL2Watts + ACOutL3Watts;
+  values[BatteryPowerHistory] = batteryPower;
+  values[BatterySOCHistory] = batterySOC;
+
+  AddHistoryPyramidSample(historySeconds, values);
 }
 
-String ConvertToStringWithAFixedNumberOfDecimalPlaces(float f, int numberOfDecimalPlaces = 1)
+void SendHistorySummary()
 {
 
-  // if round = true then round to the specified number of decimal places, otherwise truncate to the specified number of decimal places
+  if (!historyIsBeingKept)
+  {
+    Serial.println("History is not being kept");
+    return;
+  };
 
-  char workingArray[20 + numberOfDecimalPlaces];
-  char formattedArray[20 + numberOfDecimalPlaces];
+  // each period is read as one column, which the pyramid answers from a level whose buckets are no wider than the period
 
-  if (GENERAL_SETTINGS_ROUND_NUMBERS)
-    f = roundFloat(f, numberOfDecimalPlaces);
+  uint32_t toTime = historySeconds + 1;
 
-  dtostrf(f, 15 + numberOfDecimalPlaces, numberOfDecimalPlaces, formattedArray);
-  sprintf(workingArray, "%s", formattedArray);
+  for (int period = 0; period < historySummaryPeriods; period++)
+  {
 
-  String returnValue = String(workingArray);
+    uint32_t seconds = min((uint32_t)historySummaryPeriodsInSeconds[period], toTime);
 
-  returnValue.trim();
+    Serial.printf("History of the last %s (from %lu s):\n", historySummaryPeriodNames[period], (unsigned long)(toTime - seconds));
 
-  return returnValue;
+    for (int metric = 0; metric < historyMetrics; metric++)
+    {
+      historySample sample;
+      ReadHistoryColumns((historyMetric)metric, toTime - seconds, toTime, 1, &sample);
+      Serial.printf("  %-14s minimum %.1f, maximum %.1f, average %.1f\n", historyMetricNames[metric], sample.minimum, sample.maximum, sample.average);
+    };
+  };
 }
 
-void printLocalTime()
+void RestoreEnergyTotals()
 {
 
-  struct tm timeinfo;
-  if (getLocalTime(&timeinfo))
-  {
-    if (generalDebugOutput)
-      Serial.println(&timeinfo, "%A, %B %d %Y %H:%M:%S zone %Z %z ");
-  }
-  else
+  // after deep sleep the totals are still in RTC memory, otherwise they are read back from flash
+
+  if (energy.validityMarker == energyTotalsValidityMarker)
+    return;
+
+  Preferences preferences;
+  bool restored = false;
+
+  if (preferences.begin("energy", true))
   {
-    if (generalDebugOutput)
-      Serial.println("Failed to obtain time 1");
+    restored = (preferences.getBytes("totals", &energy, sizeof(energy)) == sizeof(energy)) && (energy.validityMarker == energyTotalsValidityMarker);
+    preferences.end();
   };
+
+  if (!restored)
+    ClearEnergyTotals(energy, 0);
+
+  if (generalDebugOutput)
+    Serial.println(restored ? "Energy totals restored" : "Energy totals started");
 }
 
-bool SetTime()
+void SaveEnergyTotals()
 {
 
-  // Configure NTP Server
-  configTime(0, 0, primaryNTPServer, secondaryNTPServer, tertiaryNTPSever);
+  Preferences preferences;
 
-  // Set the time zone
-  if (setenv("TZ", timeZone, 1) != 0)
+  if (preferences.begin("energy", false))
   {
-    if (generalDebugOutput)
-      Serial.println("Error setting time zone");
-    return false;
+    preferences.putBytes("totals", &energy, sizeof(energy));
+    preferences.end();
   };
+}
 
-  tzset();
+void IntegrateCurrentPower(powerIntegrator &integrator, dataPoint firstDataPoint, dataPoint lastDataPoint, unsigned long now, float watts, energyCounter positiveCounter, energyCounter negativeCounter)
+{
+  if (AnyDataPointIsStale(firstDataPoint, lastDataPoint))
+    ResetPowerIntegrator(integrator);
+  else
+    IntegratePower(integrator, now, watts, energy, positiveCounter, negativeCounter);
+}
 
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo))
-  {
-    if (generalDebugOutput)
-      Serial.println("Failed to obtain time from time server");
-    return false;
-  };
+void AccumulateEnergy()
+{
 
-  time_t t = mktime(&timeinfo);
-  if (t == -1)
-  {
-    if (generalDebugOutput)
-      Serial.println("Error converting time to time_t");
-    return false;
-  };
+  static unsigned long lastEnergySample = 0UL;
+  static unsigned long lastEnergyCheckpoint = 0UL;
 
-  struct timeval now = {.tv_sec = t};
-  if (settimeofday(&now, NULL) != 0)
-  {
-    if (generalDebugOutput)
-      Serial.println("Error setting system time");
-    return false;
-  };
+  unsigned long now = millis();
+  if (now - lastEnergySample < 1000UL)
+    return;
+  lastEnergySample = now;
 
-  if (generalDebugOutput)
-  {
-    if (generalDebugOutput)
-      Serial.printf("Time set to: %s", asctime(&timeinfo));
-  };
+  // the totals are only added to once the local time is known, so that each day's totals start and end at local midnight
+  // and only while the values shown are current; anything else leaves a gap in the power curve, which is not counted
+  // a value whose data points have gone stale (see IsDataPointStale) leaves a gap in its own curve in the same way, rather than being
+  // counted at the last power received until it is updated again
 
-  if (generalDebugOutput)
+  struct tm timeinfo;
+  if (!getLocalTime(&timeinfo, 0) || !theDisplayIsCurrentlyOn || !client.isMqttConnected() || awaitingInitialTransmissionOfAllDataPoints)
   {
-    // wait for console updates to complete
-    const int timerInterval = 200;
-    msTimer.begin(timerInterval);
+    ResetPowerIntegrator(solarIntegrator);
+    ResetPowerIntegrator(gridIntegrator);
+    ResetPowerIntegrator(ACLoadIntegrator);
+    ResetPowerIntegrator(batteryIntegrator);
+    return;
   };
 
-  return true;
-}
+  SetEnergyDay(energy, DayNumber(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday));
 
-void SetKeepDisplayOnTimeOut(unsigned int minutes)
-{
-  // Set the timeout after which IsKeepDisplayOnTimedOut() will become true
-  keepDisplayOnTimeOut = (unsigned long)minutes * 60UL * 1000UL;
-  ResetKeepDisplayOnStartTime();
+  IntegrateCurrentPower(solarIntegrator, SolarDataPoint, SolarDataPoint, now, solarWatts, SolarEnergy, energyCounters);
+  IntegrateCurrentPower(gridIntegrator, GridInL1DataPoint, GridInL3DataPoint, now, gridInL1Watts + gridInL2Watts + gridInL3Watts, GridImportEnergy, GridExportEnergy);
+  IntegrateCurrentPower(ACLoadIntegrator, ACOutL1DataPoint, ACOutL3DataPoint, now, ACOutL1Watts + ACOutL2Watts + ACOutL3Watts, ACLoadEnergy, energyCounters);
+  IntegrateCurrentPower(batteryIntegrator, BatteryPowerDataPoint, BatteryPowerDataPoint, now, batteryPower, BatteryChargeEnergy, BatteryDischargeEnergy);
 
-  if (generalDebugOutput)
+  if (now - lastEnergyCheckpoint >= energyCheckpointIntervalInMilliSeconds)
   {
-    Serial.print("Keep display active for this many minutes: ");
-    Serial.println(minutes);
+    lastEnergyCheckpoint = now;
+    SaveEnergyTotals();
   };
 }
 
-void ResetKeepDisplayOnStartTime()
+void SendEnergyTotals()
 {
-  // Reset the start time of the display timeout to now
-  keepDisplayOnStartTime = millis();
+
+  Serial.println("Energy               today kWh  yesterday kWh");
+
+  for (int i = 0; i < energyCounters; i++)
+    Serial.printf("%-18s %11.3f %14.3f\n", energyCounterNames[i], energy.today[i] / 1000.0, energy.yesterday[i] / 1000.0);
 }
 
-bool IsKeepDisplayOnTimedOut()
+void SendBatteriesReported()
 {
-  // Returns true if the display timeout time has passed and false when not.
-  if (millis() - keepDisplayOnStartTime >= keepDisplayOnTimeOut)
-  {
-    return true;
-  }
-  return false;
+
+  Serial.println("Battery                    SOC %    power W  voltage V");
+
+  for (int i = 0; i < numberOfBatteriesReported; i++)
+    Serial.printf("%-24s %7.1f %10.0f %10.2f\n", batteriesReported[i].name, batteriesReported[i].SOC, batteriesReported[i].power, batteriesReported[i].voltage);
 }
 
-void RefreshTimeOnceADay(bool forceTimeSet = false)
+void KeepBatteryValue(void *, int filterIndex, const int *wildcardIndexes, const char *value, jsonStreamValueType type)
 {
 
-  const int RETRY_INTERVAL_IN_MINUTES = 20;
-  const unsigned long RETRY_INTERVAL_IN_MILLIS = RETRY_INTERVAL_IN_MINUTES * 60UL * 1000UL;
-  const unsigned long ONE_DAY_IN_MILLIS = 24UL * 60UL * 60UL * 1000UL;
-  static unsigned long lastTimeCheck = 0UL;
-  static unsigned long checkInterval = 0UL;
+  int battery = wildcardIndexes[0];
 
-  if (forceTimeSet || (millis() - lastTimeCheck >= checkInterval))
+  if ((battery >= maximumBatteriesReported) || (type == JsonStreamNull))
+    return;
+
+  if (battery >= numberOfBatteriesReported)
   {
-    lastTimeCheck = millis();
-    if (SetTime())
-    {
-      checkInterval = ONE_DAY_IN_MILLIS;
-    }
-    else
-    {
-      checkInterval = RETRY_INTERVAL_IN_MILLIS;
-      // keep the display on until the time can be successfully set from the NTP server
-      SetKeepDisplayOnTimeOut(RETRY_INTERVAL_IN_MINUTES + 1);
-    };
+    for (int i = numberOfBatteriesReported; i <= battery; i++)
+      memset(&batteriesReported[i], 0, sizeof(batteryReport));
+    numberOfBatteriesReported = battery + 1;
   };
-};
 
-bool ShouldTheDisplayBeOn()
-{
+  batteryReport &report = batteriesReported[battery];
 
-  int timeToWake = wakeHour * 60 + wakeMinute;
-  int timeToSleep = sleepHour * 60 + sleepMinute;
+  switch (filterIndex)
+  {
+  case BatteryNameFilter:
+    strncpy(report.name, value, sizeof(report.name) - 1);
+    report.name[sizeof(report.name) - 1] = '\0';
+    break;
+  case BatterySOCFilter:
+    report.SOC = strtof(value, NULL);
+    break;
+  case BatteryPowerFilter:
+    report.power = strtof(value, NULL);
+    break;
+  case BatteryVoltageFilter:
+    report.voltage = strtof(value, NULL);
+    break;
+  };
+}
 
-  static int lastMinuteChecked = -1;
-  static bool theDisplayHadBeenPreviouslyKeptOn = true;
-  static bool lastReturnValue = true;
+void SubscribeToEachBattery(String system0Topic)
+{
 
-  bool returnValue = lastReturnValue;
+  client.subscribe(system0Topic + "Batteries", [](const String &payload)
+                   {
+    jsonStreamFilter filter;
+    BeginJsonStream(filter, batteryFilters, sizeof(batteryFilters) / sizeof(batteryFilters[0]), KeepBatteryValue, NULL);
+    numberOfBatteriesReported = 0;
+    FeedJsonStream(filter, payload.c_str(), payload.length());
+    bool valid = FinishJsonStream(filter);
+    if (verboseDebugOutput)
+      Serial.println("Batteries: " + String(numberOfBatteriesReported) + (valid ? "" : " (the message was not valid JSON)")); });
 
-  if (turnOnDisplayAtSpecificTimesOnly)
-  {
+  msTimer.begin(100);
+}
 
-    if (timeToWake == timeToSleep)
-    {
+void SendDevicesRegistered()
+{
 
-      // the display should only be set to on if the KeepDisplayOnTimeOut has not happened yet
-      returnValue = IsKeepDisplayOnTimedOut();
-    }
-    else
-    {
+  Serial.println("Device            instance    power W  state");
 
-      if (!IsKeepDisplayOnTimedOut())
-      {
+  for (int i = 0; i < devices.numberOfDevices; i++)
+  {
+    registeredDevice &device = devices.devices[i];
+    Serial.printf("%-16s %9u %10ld  %s\n", deviceKindNames[device.kind], device.instance, (long)device.watts, DeviceStateName(device.state));
+  };
 
-        theDisplayHadBeenPreviouslyKeptOn = true;
-        returnValue = true;
-      }
-      else
-      {
+  for (int kind = 0; kind < deviceKinds; kind++)
+    Serial.printf("%-16s %9d %10ld  %s (least advanced)\n", "total", devices.totals[kind].devices, (long)devices.totals[kind].watts,
+                  DeviceStateName(LeastAdvancedDeviceState(devices, (deviceKind)kind)));
 
-        // Get the utc time
-        time_t utc_now = time(nullptr);
+  if (devices.devicesNotRegistered > 0)
+    Serial.println("Updates for devices beyond the first " + String(maximumRegisteredDevices) + ": " + String(devices.devicesNotRegistered));
+}
 
-        // the detailed time checking logic below is only performed:
-        //     once a minute when the seconds first reach zero
-        //     or
-        //     when the keepTheDisplayTimeOut had previously been kept on but no longer needs to be given the passing of time
-        //  otherwise
-        //     return the previously returned value
+void DeviceTopicReceived(void *, int slot, const topicRouterCaptures &captures, const void *message)
+{
 
-        int iSecond = second(utc_now);
+  // the instance of the device is the level the '+' stood for, for example 279 from N/<installation id>/solarcharger/279/State
 
-        if ((iSecond == 0) || (theDisplayHadBeenPreviouslyKeptOn))
-        {
+  const String &payload = *(const String *)message;
 
-          theDisplayHadBeenPreviouslyKeptOn = false;
+  int instance = atoi(captures.start[0]);
 
-          // get the current local time
-          tm *timeinfo = localtime(&utc_now);
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, payload);
 
-          int iMinute = timeinfo->tm_min;
+  if (error || doc["value"].isNull())
+    return;
 
-          if (iMinute == lastMinuteChecked)
+  switch (slot)
+  {
+  case SolarChargerPowerSlot:
+  case VEBusPowerSlot:
+    UpdateDevicePower(devices, (deviceKind)(slot - SolarChargerPowerSlot), instance, doc["value"].as<float>());
+    break;
+  case SolarChargerStateSlot:
+  case VEBusStateSlot:
+    UpdateDeviceState(devices, (deviceKind)(slot - SolarChargerStateSlot), instance, doc["value"].as<int>());
+    break;
+  };
 
-            returnValue = lastReturnValue;
+  doc.clear();
+}
 
-          else
-          {
+void SubscribeToEveryDevice(String commonTopic)
+{
 
-            lastMinuteChecked = iMinute;
+  ClearDeviceRegistry(devices);
+  BeginTopicRouter(deviceTopicRouter);
 
-            int iHour = timeinfo->tm_hour;
+  for (int kind = 0; kind < deviceKinds; kind++)
+  {
 
-            if (timeToSleep > timeToWake)
-            {
+    String devicesTopic = commonTopic + "/" + deviceKindNames[kind] + "/";
+    String powerTopic = devicesTopic + "+/" + devicePowerTopics[kind];
+    String stateTopic = devicesTopic + "+/State";
 
-              // as an example: wake up at 8 am and go to sleep at 10 pm
+    AddTopicRoute(deviceTopicRouter, powerTopic.c_str(), DeviceTopicReceived, NULL, SolarChargerPowerSlot + kind);
+    AddTopicRoute(deviceTopicRouter, stateTopic.c_str(), DeviceTopicReceived, NULL, SolarChargerStateSlot + kind);
 
-              if ((iHour < wakeHour) || ((iHour == wakeHour) && (iMinute < wakeMinute)) || (iHour > sleepHour) || ((iHour == sleepHour) && (iMinute >= sleepMinute)))
-                returnValue = false;
-              else
-                returnValue = true;
-            }
-            else
-            {
+    client.subscribe(powerTopic, [](const String &topic, const String &payload)
+                     { RouteTopic(deviceTopicRouter, topic.c_str(), topic.length(), &payload); });
 
-              // as an example: wake up at 10 pm and go to sleep at 8 am
+    msTimer.begin(100);
 
-              if ((iHour < sleepHour) || ((iHour == sleepHour) && (iMinute < sleepMinute)) || (iHour > wakeHour) || ((iHour == wakeHour) && (iMinute >= wakeMinute)))
-                returnValue = true;
-              else
-                returnValue = false;
-            };
-          };
-        };
-      };
-    };
+    client.subscribe(stateTopic, [](const String &topic, const String &payload)
+                     { RouteTopic(deviceTopicRouter, topic.c_str(), topic.length(), &payload); });
 
-    lastReturnValue = returnValue;
+    msTimer.begin(100);
   };
+}
 
-  return returnValue;
+void UnsubscribeFromEveryDevice(String commonTopic)
+{
+
+  for (int kind = 0; kind < deviceKinds; kind++)
+  {
+    String devicesTopic = commonTopic + "/" + deviceKindNames[kind] + "/";
+    client.unsubscribe(devicesTopic + "+/" + devicePowerTopics[kind]);
+    client.unsubscribe(devicesTopic + "+/State");
+  };
 }
 
-void UpdateDisplay()
+void SetupTopicBrowser()
 {
 
-  static unsigned long lastDisplayUpdate = 0UL;
-  static bool tryToRestoreConnection = true;
-  static bool MQTTTransmissionLost = false;
+  // the topic index needs about 280 KB, which is only available if the board's PSRAM is enabled (in the Arduino IDE: Tools, PSRAM, OPI PSRAM)
 
-  // turn on or off the display as needed
-  bool theDisplayShouldBeOn = ShouldTheDisplayBeOn();
+  if (GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER && psramFound())
+    topicIndexIsBeingKept = BeginTopicIndex(ps_malloc);
+
+  if (generalDebugOutput && GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER)
+  {
+    if (topicIndexIsBeingKept)
+      Serial.println("Topic index is being kept in PSRAM (" + String((unsigned long)TopicIndexMemoryRequired()) + " bytes)");
+    else
+      Serial.println("Topic browser is not available as there is not enough PSRAM");
+  };
+}
+
+void KeepTopicValue(void *context, int, const int *, const char *value, jsonStreamValueType)
+{
+  strncpy((char *)context, value, maximumTopicIndexValueLength);
+}
 
-  if (theDisplayIsCurrentlyOn && !theDisplayShouldBeOn)
-    SetTheDisplayOn(false);
+void SubscribeToEveryTopic()
+{
 
-  if (!theDisplayIsCurrentlyOn && theDisplayShouldBeOn)
-    SetTheDisplayOn(true);
+  // the topics are kept without the N/<installation id>/ they all start with
 
-  // only update the display when its time has come
-  if (millis() - lastDisplayUpdate < ((unsigned long)GENERAL_SETTINGS_SECONDS_BETWEEN_DISPLAY_UPDATES * 1000UL))
-    return;
+  ClearTopicIndex();
 
-  // only update the display if it is on
-  if (!theDisplayShouldBeOn)
-    return;
+  client.subscribe("N/" + VictronInstallationID + "/#", [](const String &topic, const String &payload)
+                   {
+    static const char *const valueFilter[] = {"value"};
+    // a value which is an object or an array is not kept, only shown as "..."
+    char value[maximumTopicIndexValueLength + 1] = "...";
+    jsonStreamFilter filter;
+    BeginJsonStream(filter, valueFilter, 1, KeepTopicValue, value);
+    FeedJsonStream(filter, payload.c_str(), payload.length());
+    value[maximumTopicIndexValueLength] = '\0';
+    size_t prefixLength = VictronInstallationID.length() + 3;
+    if (topic.length() > prefixLength)
+      RecordTopicValue(topic.c_str() + prefixLength, topic.length() - prefixLength, value); });
 
-  // if the connection is not yet established, or had been lost then display an appropriate message
+  msTimer.begin(100);
 
-  if (!client.isWifiConnected())
-  {
+  // no keep alive request is forced here, as that would have Venus publish all of its topics again to every client of the broker;
+  // instead the topics arrive as they change, and all of them following the next periodical keep alive request
+  // (unless GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES is true, in which case only those that change are shown)
+}
 
-    sprite.fillSprite(TFT_BLACK);
-    sprite.loadFont(NotoSansBold36);
-    sprite.setTextDatum(MC_DATUM);
-    sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
-    sprite.drawString("Awaiting Wi-Fi connection", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-    RefreshDisplay();
-    sprite.unloadFont();
-    return;
-  };
+void SendTopicIndexSummary()
+{
 
-  if (!client.isMqttConnected())
+  if (!topicIndexIsBeingKept)
   {
-
-    sprite.fillSprite(TFT_BLACK);
-    sprite.loadFont(NotoSansBold36);
-    sprite.setTextDatum(MC_DATUM);
-    sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
-    sprite.drawString("Awaiting MQTT connection", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-    RefreshDisplay();
-    sprite.unloadFont();
+    Serial.println("Topic browser is not available");
     return;
   };
 
-  // deal with the case that no data has arrived beyond the timeout period
-  // see the notes in the general_settings.h file for more information
+  Serial.println("Topics: " + String(TopicIndexTopics()) + ", bytes used: " + String((unsigned long)TopicIndexBytesUsed()) + " of " + String((unsigned long)TopicIndexMemoryRequired()));
+  Serial.println("Values not kept as their topics have more than " + String(maximumTopicIndexDepth) + " levels: " + String(TopicIndexValuesTooDeep()));
+  Serial.println("Values not kept as the index is full: " + String(TopicIndexValuesNotKept()));
 
-  if (millis() - lastMQTTUpdateReceived >= timeOutInMilliSeconds)
-  {
+  // the MQTT client drops a message too large for its buffer without passing it on, so those cannot be counted
+  Serial.println("Messages larger than " + String(MaximumMQTTPacketSize()) + " bytes (including the topic) are dropped before they reach the index");
+}
 
-    sprite.fillSprite(TFT_BLACK);
-    sprite.loadFont(NotoSansBold24);
-    sprite.setTextDatum(MC_DATUM);
-    sprite.setTextColor(TFT_RED, TFT_BLACK);
-    sprite.drawString("MQTT data updates have stopped", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-    RefreshDisplay();
+void SetupTelemetryLog()
+{
 
-    sprite.unloadFont();
+  // the FFat partition is part of the recommended partition scheme (in the Arduino IDE: Tools, Partition Scheme, 16M Flash (3MB APP/9.9MB FATFS))
+  // it is formatted the first time it is used
 
-    if (!GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS)
-    {
-      // another system is responsible for sending the keep alive requests
-      // keep the message "MQTT data updates have stopped" on the screen for a brief period
-      // note: although the code below only delays for 1 second, the message will stay on the screen
-      // for longer than that while attempts (below) are made to reconnect
-      delay(1000);
-    };
+  telemetryIsBeingLogged = FFat.begin(true) && BeginTelemetryLog("/ffat/telemetry");
 
-    if (tryToRestoreConnection)
-    {
+  if (generalDebugOutput)
+  {
+    if (telemetryIsBeingLogged)
+      Serial.println("Telemetry is being logged to FFat (" + String((unsigned long)FFat.freeBytes()) + " bytes free)");
+    else
+      Serial.println("Telemetry is not being logged as the FFat partition could not be used");
+  };
+}
 
-      // only try to restore the connection once
-      tryToRestoreConnection = false;
+void RecordTelemetry()
+{
 
-      if (generalDebugOutput)
-        Serial.println("MQTT data updates have stopped");
+  static unsigned long lastTelemetrySample = 0UL;
+  static unsigned long lastTelemetryFlush = 0UL;
 
-      ResetGlobals();
+  static uint32_t minuteBeingAveraged = 0;
+  static int64_t totals[telemetryValues];
+  static uint32_t samples = 0;
 
-      if (!GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS)
-      {
+  if (!telemetryIsBeingLogged)
+    return;
 
-        // if GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS is false it means that this program was counting on another system to send
-        // the keep alive request.  However, as this does not seem to be happening at the moment, the program will try resubscribing and sending
-        // a keep alive request itself (which is part of the mass subscribe process) to temporarily get things going again
+  unsigned long now = millis();
+  if (now - lastTelemetrySample < 1000UL)
+    return;
+  lastTelemetrySample = now;
 
-        MQTTTransmissionLost = true;
+  // as with the energy totals, the values are only sampled once the time is known and while the values shown are current
 
-        if (generalDebugOutput)
-          Serial.println("Attempting to restore MQTT data updates");
+  struct tm timeinfo;
+  if (getLocalTime(&timeinfo, 0) && theDisplayIsCurrentlyOn && client.isMqttConnected() && !awaitingInitialTransmissionOfAllDataPoints)
+  {
 
-        MassSubscribe();
-      };
+    uint32_t minute = (uint32_t)(time(nullptr) / 60);
+
+    if ((minute != minuteBeingAveraged) && (samples > 0))
+    {
+      telemetryRecord record;
+      record.minute = minuteBeingAveraged;
+      for (int i = 0; i < telemetryValues; i++)
+        record.values[i] = (int32_t)(totals[i] / (int64_t)samples);
+      AppendTelemetryRecord(record);
+      samples = 0;
     };
-    return;
-  };
 
-  tryToRestoreConnection = true;
+    if (samples == 0)
+    {
+      minuteBeingAveraged = minute;
+      for (int i = 0; i < telemetryValues; i++)
+        totals[i] = 0;
+    };
 
-  // wait until data for all data points have been received prior to showing the display
-  // while waiting display an appropriate message
+    totals[SolarTelemetry] += solarWatts;
+    totals[GridTelemetry] += gridInL1Watts + gridInL2Watts + gridInL3Watts;
+    totals[ACLoadTelemetry] += ACOutL1Watts + ACOutL2Watts + ACOutL3Watts;
+    totals[BatteryPowerTelemetry] += batteryPower;
+    totals[BatterySOCTelemetry] += (int64_t)(batterySOC * 10.0f + 0.5f);
+    totals[BatteryTemperatureTelemetry] += lroundf(batteryTemperature * 10.0f);
+    samples++;
+  };
 
-  if (awaitingInitialTransmissionOfAllDataPoints)
+  if (now - lastTelemetryFlush >= telemetryFlushIntervalInMilliSeconds)
   {
 
-    for (int i = 0; i < dataPoints; i++)
-      if (awaitingDataToBeReceived[i])
-      {
-
-        if (verboseDebugOutput)
-          Serial.println("Awaiting data on data point " + String(i));
-
-        sprite.fillSprite(TFT_BLACK);
-        sprite.loadFont(NotoSansBold36);
-        sprite.setTextDatum(MC_DATUM);
-        sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
-        sprite.drawString("Awaiting data", TFT_WIDTH / 2, TFT_HEIGHT / 2);
-        RefreshDisplay();
-        sprite.unloadFont();
+    lastTelemetryFlush = now;
 
-        return;
-      };
-    // if we have reached this point data for all data points have been received
-    awaitingInitialTransmissionOfAllDataPoints = false;
+    FlushTelemetryLog();
 
-    if (MQTTTransmissionLost)
-    {
-      MQTTTransmissionLost = false;
+    while ((FFat.freeBytes() < telemetryLogMinimumFreeBytes) && DeleteOldestTelemetryLogFile())
       if (generalDebugOutput)
-        Serial.println("MQTT data updates restored");
-    };
+        Serial.println("Oldest telemetry log file deleted to free up space");
   };
+}
 
-  lastDisplayUpdate = millis();
+void SendTelemetryRecord(const telemetryRecord &record, void *context)
+{
+  (void)context;
+  Serial.printf("%lu,%ld,%ld,%ld,%ld,%.1f,%.1f\n", (unsigned long)record.minute * 60UL, (long)record.values[SolarTelemetry], (long)record.values[GridTelemetry], (long)record.values[ACLoadTelemetry],
+                (long)record.values[BatteryPowerTelemetry], record.values[BatterySOCTelemetry] / 10.0, record.values[BatteryTemperatureTelemetry] / 10.0);
+}
 
-  int x, y;
+void SendTelemetryLog()
+{
 
-  // Tabula rasa
+  // the last 24 hours of the log, as comma separated values with the time in seconds since 1 January 1970 (UTC)
 
-  sprite.fillSprite(TFT_BLACK);
+  if (!telemetryIsBeingLogged)
+  {
+    Serial.println("Telemetry is not being logged");
+    return;
+  };
 
-  // show charger and inverter status
+  uint32_t lastMinute = (uint32_t)(time(nullptr) / 60);
 
-  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
-    sprite.setTextDatum(TL_DATUM);
-  else
-    sprite.setTextDatum(TR_DATUM);
+  Serial.println("time,solar W,grid W,AC load W,battery W,battery SOC %,battery temperature C");
+  size_t records = ReadTelemetryLog(lastMinute - 24 * 60, lastMinute, SendTelemetryRecord, NULL);
+  Serial.printf("%lu records\n", (unsigned long)records);
+}
 
-  sprite.loadFont(NotoSansBold24);
-  sprite.setTextColor(TFT_SKYBLUE, TFT_BLACK);
+void CaptureStatusSnapshot(statusSnapshot &status)
+{
 
-  String chargerStatus;
-  if (currentMultiplusMode == Unknown)
-    chargerStatus = "?";
-  else if ((currentMultiplusMode == On) || (currentMultiplusMode == ChargerOnly))
-    chargerStatus = "on";
-  else
-    chargerStatus = "off";
+  status.uptimeSeconds = millis() / 1000UL;
 
-  String inverterStatus;
-  if (currentMultiplusMode == Unknown)
-    inverterStatus = "?";
-  else if ((currentMultiplusMode == On) || (currentMultiplusMode == InverterOnly))
-    inverterStatus = "on";
-  else
-    inverterStatus = "off";
+  // until every value has been received (again), none of them is current
+  bool allValuesReceived = client.isMqttConnected() && !awaitingInitialTransmissionOfAllDataPoints;
 
-  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
-    x = 0;
-  else
-    x = TFT_WIDTH;
+  status.staleValues = 0;
+  for (int i = 0; i < dataPoints; i++)
+    if (!allValuesReceived || IsDataPointStale(i))
+      status.staleValues |= 1UL << i;
+
+  status.current = (status.staleValues == 0);
+
+  status.gridInL1Watts = gridInL1Watts;
+  status.gridInL2Watts = gridInL2Watts;
+  status.gridInL3Watts = gridInL3Watts;
+  status.solarWatts = solarWatts;
+  status.batterySOC = batterySOC;
+  status.batteryTTG = batteryTTG;
+  status.batteryPower = batteryPower;
+  status.batteryTemperature = batteryTemperature;
+  status.ACOutL1Watts = ACOutL1Watts;
+  status.ACOutL2Watts = ACOutL2Watts;
+  status.ACOutL3Watts = ACOutL3Watts;
+  status.chargingState = chargingState;
+  status.multiplusMode = multiplusModeNames[currentMultiplusMode];
+}
 
-  if (GENERAL_SETTINGS_SHOW_CHARGER_MODE)
-  {
-    y = 5;
-    sprite.drawString("Charger " + chargerStatus, x, y);
-  };
+void SendStatusJson()
+{
 
-  if (GENERAL_SETTINGS_SHOW_INVERTER_MODE)
-  {
-    y = TFT_HEIGHT - 30;
-    sprite.drawString("Inverter " + inverterStatus, x, y);
-  };
+  static char json[maximumStatusJsonLength];
 
-  sprite.unloadFont();
+  statusSnapshot status;
+  CaptureStatusSnapshot(status);
+  size_t length = FormatStatusJson(json, sizeof(json), status);
 
-  // show solar info
+  httpServer.setContentLength(length);
+  httpServer.send(200, "application/json", "");
+  httpServer.sendContent(json, length);
+}
 
-  sprite.loadFont(NotoSansBold24);
-  sprite.setTextColor(TFT_YELLOW, TFT_BLACK);
+size_t AppendHistoryExportValue(char *buffer, size_t bufferSize, size_t length, float value, int numberOfDecimalPlaces)
+{
+  length = AppendText(buffer, bufferSize, length, ",");
+  if (isnan(value))
+    return length;
+  return AppendScaledInteger(buffer, bufferSize, length, lroundf(value * ((numberOfDecimalPlaces > 0) ? 10.0F : 1.0F)), numberOfDecimalPlaces);
+}
 
-  y = TFT_HEIGHT / 2 - 36;
-  sprite.drawString("Solar", x, y);
+void SendHistoryExport()
+{
 
-  sprite.loadFont(NotoSansBold36);
-  solarWatts = int(solarWatts);
+  // comma separated values, one line per point, each giving the minimum, maximum and average of each value over its part of the period
+  // the time of each point is in seconds since 1 January 1970 (UTC) once the time is known, otherwise in seconds since the sketch started
 
-  y = TFT_HEIGHT / 2 + 4;
-  if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && (solarWatts >= 1000.0F))
+  if (!historyIsBeingKept)
   {
-    float adjustedSolarWatts = solarWatts / 1000.0F;
-    sprite.drawString(ConvertToStringWithAFixedNumberOfDecimalPlaces(adjustedSolarWatts, GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING) + " KW", x, y);
-  }
-  else
-  {
-    sprite.drawString(String(int(solarWatts)) + " W", x, y);
+    httpServer.send(503, "text/plain", "History is not being kept\n");
+    return;
   };
 
-  sprite.unloadFont();
-
-  // show grid info
-
-  sprite.loadFont(NotoSansBold24);
-  sprite.setTextColor(TFT_GOLD, TFT_BLACK);
+  uint32_t seconds = httpServer.hasArg("seconds") ? strtoul(httpServer.arg("seconds").c_str(), NULL, 10) : 86400UL;
+  int points = httpServer.hasArg("points") ? atoi(httpServer.arg("points").c_str()) : 288;
 
-  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
-    sprite.setTextDatum(TR_DATUM);
-  else
-    sprite.setTextDatum(TL_DATUM);
+  seconds = constrain(seconds, 1UL, HistoryPyramidSeconds());
+  points = constrain(points, 1, historyExportMaximumPoints);
 
-  if (GENERAL_SETTINGS_USB_ON_THE_LEFT)
-    x = TFT_WIDTH;
-  else
-    x = 0;
+  uint32_t toTime = historySeconds + 1;
+  uint32_t fromTime = (toTime > seconds) ? toTime - seconds : 0;
 
-  y = 0;
-  sprite.drawString("Grid", x, y);
-  sprite.unloadFont();
+  time_t now = time(nullptr);
+  long timeOffset = (now > 1600000000L) ? (long)(now - (time_t)toTime) : 0L;
 
-  sprite.loadFont(NotoSansBold36);
+  static historySample samples[historyMetrics][historyExportPointsPerChunk];
+  static char chunk[historyExportPointsPerChunk * 160];
 
-  float totalGridWatts = int(gridInL1Watts) + int(gridInL2Watts) + int(gridInL3Watts);
+  httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  httpServer.send(200, "text/csv", "");
 
-  y = 43;
-  if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && (totalGridWatts >= 1000.0F))
-  {
-    float adjustedTotalGridWatts = totalGridWatts / 1000.0F;
-    sprite.drawString(ConvertToStringWithAFixedNumberOfDecimalPlaces(adjustedTotalGridWatts, GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING) + " KW", x, y);
-  }
-  else
+  size_t length = AppendText(chunk, sizeof(chunk), 0, "time");
+  for (int metric = 0; metric < historyMetrics; metric++)
   {
-    totalGridWatts = int(totalGridWatts);
-    sprite.drawString(String(int(totalGridWatts)) + " W", x, y);
+    length = AppendText(chunk, sizeof(chunk), length, ",");
+    length = AppendText(chunk, sizeof(chunk), length, historyMetricNames[metric]);
+    length = AppendText(chunk, sizeof(chunk), length, " minimum,");
+    length = AppendText(chunk, sizeof(chunk), length, historyMetricNames[metric]);
+    length = AppendText(chunk, sizeof(chunk), length, " maximum,");
+    length = AppendText(chunk, sizeof(chunk), length, historyMetricNames[metric]);
+    length = AppendText(chunk, sizeof(chunk), length, " average");
   };
+  length = AppendText(chunk, sizeof(chunk), length, "\n");
+  httpServer.sendContent(chunk, length);
 
-  sprite.unloadFont();
+  for (int firstPoint = 0; firstPoint < points; firstPoint += historyExportPointsPerChunk)
+  {
 
-  // show AC consumption info
+    int pointsInChunk = min(historyExportPointsPerChunk, points - firstPoint);
 
-  sprite.loadFont(NotoSansBold24);
-  sprite.setTextColor(TFT_SILVER, TFT_BLACK);
+    uint32_t chunkFrom = fromTime + (uint32_t)((uint64_t)(toTime - fromTime) * firstPoint / points);
+    uint32_t chunkTo = fromTime + (uint32_t)((uint64_t)(toTime - fromTime) * (firstPoint + pointsInChunk) / points);
 
-  y = TFT_HEIGHT - 73;
-  sprite.drawString("AC Load", x, y);
+    for (int metric = 0; metric < historyMetrics; metric++)
+      ReadHistoryColumns((historyMetric)metric, chunkFrom, chunkTo, pointsInChunk, samples[metric]);
 
-  sprite.unloadFont();
-  sprite.loadFont(NotoSansBold36);
+    length = 0;
+    for (int point = 0; point < pointsInChunk; point++)
+    {
+      length = AppendScaledInteger(chunk, sizeof(chunk), length, (long)samples[0][point].time + timeOffset, 0);
+      for (int metric = 0; metric < historyMetrics; metric++)
+      {
+        int numberOfDecimalPlaces = (metric == BatterySOCHistory) ? 1 : 0;
+        length = AppendHistoryExportValue(chunk, sizeof(chunk), length, samples[metric][point].minimum, numberOfDecimalPlaces);
+        length = AppendHistoryExportValue(chunk, sizeof(chunk), length, samples[metric][point].maximum, numberOfDecimalPlaces);
+        length = AppendHistoryExportValue(chunk, sizeof(chunk), length, samples[metric][point].average, numberOfDecimalPlaces);
+      };
+      length = AppendText(chunk, sizeof(chunk), length, "\n");
+    };
 
-  y = TFT_HEIGHT - 30;
-  float totalACConsumptionWatts = int(ACOutL1Watts + ACOutL2Watts + ACOutL3Watts);
-  if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && (totalACConsumptionWatts >= 1000.0F))
-  {
-    totalACConsumptionWatts = totalACConsumptionWatts / 1000.0F;
-    sprite.drawString(ConvertToStringWithAFixedNumberOfDecimalPlaces(totalACConsumptionWatts, GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING) + " KW", x, y);
-  }
-  else
-  {
-    totalACConsumptionWatts = int(totalACConsumptionWatts);
-    sprite.drawString(String(int(totalACConsumptionWatts)) + " W", x, y);
+    httpServer.sendContent(chunk, length);
   };
 
-  sprite.unloadFont();
+  // an empty chunk ends the response
+  httpServer.sendContent("", 0);
+}
 
-  // show battery info
+void ServiceHTTPServer()
+{
 
-  int midX, midY, outerRadius, innerRadius, startAngle, endAngle;
-  unsigned short batteryColour;
+  static bool httpServerStarted = false;
 
-  midX = TFT_WIDTH / 2;
-  midY = TFT_HEIGHT / 2;
+  if (!GENERAL_SETTINGS_ENABLE_HTTP_SERVER)
+    return;
 
-  if (midX < midY)
-    outerRadius = midX;
-  else
-    outerRadius = midY;
+  // the server is started once the device first joins the Wi-Fi network
+  if (!httpServerStarted)
+  {
 
-  innerRadius = outerRadius - 8;
+    if (!client.isWifiConnected())
+      return;
 
-  startAngle = 180;
-  endAngle = int(batterySOC * 3.6 + 180) % 360;
+    httpServer.on("/status.json", HTTP_GET, SendStatusJson);
+    httpServer.on("/history", HTTP_GET, SendHistoryExport);
+    httpServer.begin();
+    httpServerStarted = true;
 
-  if (batterySOC <= GENERAL_SETTINGS_SHOW_BATTERY_AS_RED)
-  {
-    batteryColour = TFT_RED;
-  }
-  else if (batterySOC <= GENERAL_SETTINGS_SHOW_BATTERY_AS_YELLOW)
-  {
-    batteryColour = TFT_YELLOW;
-  }
-  else
-  {
-    batteryColour = TFT_GREEN;
+    if (generalDebugOutput)
+      Serial.println("HTTP server started at http://" + WiFi.localIP().toString() + "/status.json");
   };
 
-  sprite.drawSmoothArc(midX, midY, outerRadius, innerRadius, startAngle, endAngle, batteryColour, TFT_BLACK);
-
-  sprite.loadFont(NotoSansBold72);
-  sprite.setTextDatum(MC_DATUM);
-  sprite.setTextColor(batteryColour, TFT_BLACK);
+  httpServer.handleClient();
+}
 
-  // show battery percent without a decimal place
+String GatewaySnapshotTopicName()
+{
+  return "ESP32RemoteForVictron/" + VictronInstallationID + "/snapshot";
+}
 
-  int ibatterySOC = ConvertToStringWithAFixedNumberOfDecimalPlaces(batterySOC, 0).toInt();
-  sprite.drawString(String(ibatterySOC) + "%", midX, midY);
+void PublishGatewaySnapshot()
+{
 
-  sprite.unloadFont();
+  static unsigned long lastGatewaySnapshot = 0UL;
+  static uint32_t sequenceNumber = 0UL;
 
-  sprite.loadFont(NotoSansBold24);
-  sprite.drawString("Battery", midX, midY - 60);
+  if (!thisDeviceIsAGateway)
+    return;
 
-  if ((GENERAL_SETTINGS_ADDITIONAL_INFO == 1) && (batteryTTG != 0))
-  {
+  if (millis() - lastGatewaySnapshot < (unsigned long)GENERAL_SETTINGS_SECONDS_BETWEEN_GATEWAY_SNAPSHOTS * 1000UL)
+    return;
 
-    // show time to go
-    String TimeToGo = ConvertSecondsToDayHoursMinutes(int(batteryTTG));
-    sprite.drawString(TimeToGo, midX, midY + 50);
-  }
-  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 2)
-  {
+  // the values are only passed on while the gateway's display is on (see GENERAL_SETTINGS_GATEWAY_MODE), as only then is it subscribed to them
 
-    // show charger state
-    sprite.drawString(chargingState, midX, midY + 50);
-  }
-  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 3)
-  {
+  if (!theDisplayIsCurrentlyOn || !client.isMqttConnected() || awaitingInitialTransmissionOfAllDataPoints)
+    return;
 
-    // show battery temperature (with one decimal place)
+  lastGatewaySnapshot = millis();
 
-    String temperatureString = ConvertToStringWithAFixedNumberOfDecimalPlaces(batteryTemperature, 1) + String("  ");
+  char message[maximumStatusSnapshotMessageLength];
 
-    sprite.drawString(temperatureString, midX, midY + 50);
+  statusSnapshot status;
+  CaptureStatusSnapshot(status);
+  FormatStatusSnapshotMessage(message, sizeof(message), status, ++sequenceNumber);
 
-    // add the degree symbol
-    sprite.unloadFont();
-    sprite.loadFont(NotoSansBold15);
-    int degreePosx = sprite.textWidth(temperatureString) / 2 + 4;
-    sprite.drawString(String("o"), midX + degreePosx, midY + 43);
-  }  
-  else if (GENERAL_SETTINGS_ADDITIONAL_INFO == 4) 
-  {
+  client.publish(GatewaySnapshotTopicName(), message);
 
-    //show battery power
-    if (GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW && ((batteryPower >= 1000.0F) || (batteryPower <= -1000.0F))) {
-      sprite.drawString(ConvertToStringWithAFixedNumberOfDecimalPlaces(batteryPower / 1000.0F, GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING) + " kW", midX, midY + 50);
-    } else {
-      sprite.drawString(String(int(batteryPower)) + " W", midX, midY + 50);
-    };
-  }
+  if (verboseDebugOutput)
+    Serial.println("Gateway snapshot published: " + String(message));
+}
 
-  sprite.unloadFont();
+bool TakeValueFromGateway(dataPoint gatewayDataPoint, uint32_t staleAtGateway)
+{
 
-  // Draw an upward triangle if the battery is charging or a downward triangle if it is discharging
-  // However, if it is neither charging or discharging then do not draw any triangle at all
+  // returns true if the gateway has the value current, in which case it is recorded as updated; otherwise it is marked as stale here too
 
-  if (batteryPower > 0.0F)
+  if (staleAtGateway & (1UL << gatewayDataPoint))
   {
+    dataPointStatuses[gatewayDataPoint].staleAtSource = true;
+    return false;
+  };
 
-    // Draw a upward triangle
-    int16_t centerX = TFT_WIDTH / 2;
-    int16_t centerY = TFT_HEIGHT / 2 + 88;
+  RecordDataPointUpdate(gatewayDataPoint);
 
-    int16_t arrowWidth = 20;
-    int16_t arrowHeight = 25;
+  return true;
+}
 
-    sprite.fillTriangle(centerX - arrowWidth / 2, centerY + arrowHeight / 2,
-                        centerX + arrowWidth / 2, centerY + arrowHeight / 2,
-                        centerX, centerY - arrowHeight / 2, batteryColour);
-  }
-  else
-  {
+void SubscribeToGatewaySnapshot()
+{
 
-    if (batteryPower < 0.0F)
+  if (generalDebugOutput)
+    Serial.println("Subscribing to the gateway's snapshot");
+
+  client.subscribe(GatewaySnapshotTopicName(), [](const String &payload)
+                   {
+    // every message has a new sequence number, so none is ever a repeat of the one before
+    CountPayloadReceived(GatewaySnapshotTopic, payload);
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, payload);
+    if (error || (doc[0].as<int>() != statusSnapshotMessageVersion))
     {
+      if (generalDebugOutput)
+        Serial.println("Gateway snapshot not understood: " + payload);
+      return;
+    };
+    // the values the gateway has current are taken, the others are kept as they were and shown as stale
+    uint32_t staleAtGateway = doc[2].as<unsigned long>();
+    if (TakeValueFromGateway(GridInL1DataPoint, staleAtGateway))
+      gridInL1Watts = doc[3].as<float>();
+    if (TakeValueFromGateway(GridInL2DataPoint, staleAtGateway))
+      gridInL2Watts = doc[4].as<float>();
+    if (TakeValueFromGateway(GridInL3DataPoint, staleAtGateway))
+      gridInL3Watts = doc[5].as<float>();
+    if (TakeValueFromGateway(SolarDataPoint, staleAtGateway))
+      solarWatts = doc[6].as<float>();
+    if (TakeValueFromGateway(BatterySOCDataPoint, staleAtGateway))
+      batterySOC = doc[7].as<float>() / 10.0;
+    if (TakeValueFromGateway(BatteryTTGDataPoint, staleAtGateway))
+      batteryTTG = doc[8].as<float>();
+    if (TakeValueFromGateway(BatteryPowerDataPoint, staleAtGateway))
+      batteryPower = doc[9].as<float>();
+    if (TakeValueFromGateway(BatteryTemperatureDataPoint, staleAtGateway))
+      batteryTemperature = doc[10].as<float>() / 10.0;
+    if (TakeValueFromGateway(ACOutL1DataPoint, staleAtGateway))
+      ACOutL1Watts = doc[11].as<float>();
+    if (TakeValueFromGateway(ACOutL2DataPoint, staleAtGateway))
+      ACOutL2Watts = doc[12].as<float>();
+    if (TakeValueFromGateway(ACOutL3DataPoint, staleAtGateway))
+      ACOutL3Watts = doc[13].as<float>();
+    if (TakeValueFromGateway(ChargingStateDataPoint, staleAtGateway))
+    {
+      strncpy(gatewayChargingState, doc[14] | "", sizeof(gatewayChargingState) - 1);
+      chargingState = gatewayChargingState;
+    };
+    if (TakeValueFromGateway(MultiplusModeDataPoint, staleAtGateway))
+    {
+      const char *mode = doc[15] | "";
+      currentMultiplusMode = Unknown;
+      for (int i = 0; i < Unknown; i++)
+        if (strcmp(mode, multiplusModeNames[i]) == 0)
+          currentMultiplusMode = (multiplusMode)i;
+    };
+    // the gateway itself is still being heard from, even when none of its values is current
+    lastMQTTUpdateReceived = millis();
+    if (verboseDebugOutput)
+      Serial.println("Gateway snapshot received: " + payload);
+    doc.clear(); });
 
-      // Draw a downward triangle
-      int16_t centerX = TFT_WIDTH / 2;
-      int16_t centerY = TFT_HEIGHT / 2 + 88;
+  msTimer.begin(100);
+}
 
-      int16_t arrowWidth = 20;
-      int16_t arrowHeight = 25;
+void SubscribeToKeepAliveElection()
+{
 
-      sprite.fillTriangle(centerX - arrowWidth / 2, centerY - arrowHeight / 2,
-                          centerX + arrowWidth / 2, centerY - arrowHeight / 2,
-                          centerX, centerY + arrowHeight / 2, batteryColour);
-    };
-  };
+  if (!keepAliveLeaderIsElected)
+    return;
 
-  // used for testing only - display the date and time
-  //
-  // sprite.loadFont(NotoSansBold24);
-  // sprite.setTextColor(TFT_RED, TFT_BLACK);
-  //
-  // if (GENERAL_SETTINGS_USB_ON_THE_LEFT) {
-  //  sprite.setTextDatum(TL_DATUM);
-  //} else {
-  //  sprite.setTextDatum(TR_DATUM);
-  //};
-  //
-  // struct tm timeinfo;
-  // getLocalTime(&timeinfo);
-  // String currentTimeString = (String)asctime(&timeinfo) + " ";
-  //
-  // sprite.drawString(currentTimeString, 0, 50);
-  // sprite.unloadFont();
-  //
-  // end of testing block
+  if (generalDebugOutput)
+    Serial.println("Joining the keep alive election as " + String(keepAliveLeaderElection.ownName));
 
-  RefreshDisplay();
+  // the heartbeats are retained, so the current leader's last one is received straight away; an empty one is a heartbeat being cleared
+  client.subscribe(KEEP_ALIVE_HEARTBEAT_TOPICS "+", [](const String &topic, const String &payload)
+                   {
+                     String senderName = topic.substring(strlen(KEEP_ALIVE_HEARTBEAT_TOPICS));
+                     if (payload.length() == 0)
+                       KeepAliveLeaderLeft(keepAliveLeaderElection, senderName.c_str());
+                     else if (payload == VictronInstallationID)
+                       KeepAliveHeartbeatReceived(keepAliveLeaderElection, senderName.c_str(), millis()); });
+
+  StartKeepAliveElection(keepAliveLeaderElection, millis());
+  keepAliveElectionStarted = true;
+
+  msTimer.begin(100);
 }
 
-void ResetGlobals()
+bool ThisDeviceSendsPeriodicalKeepAlives()
 {
 
-  if (initialStartupLoadVictronInstallationAndMultiplusIDs)
-  {
+  static bool wasLeading = false;
 
-    initialStartupLoadVictronInstallationAndMultiplusIDs = false;
+  // a sibling of a gateway leaves the periodical keep alive requests to the gateway
+  if (!GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS || thisDeviceIsAGatewaySibling)
+    return false;
 
-    String(SECRET_SETTING_VICTRON_INSTALLATION_ID).toCharArray(VictronInstallationIDArray, String(SECRET_SETTING_VICTRON_INSTALLATION_ID).length() + 1);
-    String(SECRET_SETTING_VICTRON_MULTIPLUS_ID).toCharArray(MultiplusThreeDigitIDArray, String(SECRET_SETTING_VICTRON_MULTIPLUS_ID).length() + 1);
-    String(SECRET_SETTING_VICTRON_SOLAR_CHARGER_ID).toCharArray(SolarChargerThreeDigitIDArray, String(SECRET_SETTING_VICTRON_SOLAR_CHARGER_ID).length() + 1);
-  };
+  if (!keepAliveLeaderIsElected)
+    return true;
 
-  VictronInstallationID = String(VictronInstallationIDArray);
-  MultiplusThreeDigitID = String(MultiplusThreeDigitIDArray);
-  SolarChargerThreeDigitID = String(SolarChargerThreeDigitIDArray);
+  if (!keepAliveElectionStarted || !client.isMqttConnected())
+    return false;
 
-  awaitingInitialTransmissionOfAllDataPoints = true;
-  for (int i = 0; i < dataPoints; i++)
-    awaitingDataToBeReceived[i] = true;
+  unsigned long now = millis();
 
-  gridInL1Watts = 0.0;
-  gridInL2Watts = 0.0;
-  gridInL3Watts = 0.0;
+  if (KeepAliveHeartbeatIsDue(keepAliveLeaderElection, now))
+    client.publish(keepAliveHeartbeatTopic, VictronInstallationID, true);
 
-  solarWatts = 0.0;
+  bool isLeading = ThisDeviceLeadsKeepAlives(keepAliveLeaderElection, now);
 
-  batterySOC = 0.0;
-  batteryTTG = 0.0;
-  batteryPower = 0.0;
+  // having given way to another device, this one's heartbeat is cleared so that a device joining later does not take it to be leading
+  if (wasLeading && !isLeading)
+    client.publish(keepAliveHeartbeatTopic, "", true);
 
-  ACOutL1Watts = 0.0;
-  ACOutL2Watts = 0.0;
-  ACOutL3Watts = 0.0;
+  if ((isLeading != wasLeading) && generalDebugOutput)
+  {
+    if (isLeading)
+      Serial.println("This device now sends the keep alive requests");
+    else
+      Serial.println("Keep alive requests are now sent by " + String(keepAliveLeaderElection.leaderName));
+  };
 
-  currentMultiplusMode = Unknown;
+  wasLeading = isLeading;
 
-  chargingState = "";
-};
+  return isLeading;
+}
 
 void KeepMQTTAlive(bool forceKeepAliveRequestNow = false)
 {
 
   static unsigned long lastMqttUpdate = 0UL;
 
-  if ((forceKeepAliveRequestNow) || (GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS))
+  if ((forceKeepAliveRequestNow) || ThisDeviceSendsPeriodicalKeepAlives())
   {
 
     if ((forceKeepAliveRequestNow) || (millis() - lastMqttUpdate >= GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL))
@@ -1303,7 +3829,12 @@ void KeepMQTTAlive(bool forceKeepAliveRequestNow = false)
 
       lastMqttUpdate = millis();
 
-      client.publish("R/" + VictronInstallationID + "/keepalive", "");
+      // a forced keep alive request (made after subscribing) asks Venus to publish all of its topics, so that every subscribed value is received
+      // the periodical ones may instead ask Venus to publish only the values that have changed (versions of Venus that do not support keep alive options treat both the same)
+      if (forceKeepAliveRequestNow || !GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES)
+        client.publish("R/" + VictronInstallationID + "/keepalive", "");
+      else
+        client.publish("R/" + VictronInstallationID + "/keepalive", "{\"keepalive-options\": [\"suppress-republish\"]}");
 
       if (verboseDebugOutput)
         Serial.println("Keep alive request sent");
@@ -1321,7 +3852,8 @@ void SubscribeToGetChargingStateFromMultiplus()
 
   client.subscribe(ledsTopic + "/Bulk", [](const String &payload)
                    {
-    awaitingDataToBeReceived[7] = false;
+    if (PayloadIsUnchanged(MultiplusBulkLEDTopic, ChargingStateDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
@@ -1330,14 +3862,15 @@ void SubscribeToGetChargingStateFromMultiplus()
       chargingState = "Bulk";
     if (verboseDebugOutput)
       Serial.println("Multiplus Bulk LED is on");
-    lastMQTTUpdateReceived = millis();
+    RecordDataPointUpdate(ChargingStateDataPoint);
     doc.clear(); });
 
   msTimer.begin(100);
 
   client.subscribe(ledsTopic + "/Absorption", [](const String &payload)
                    {
-    awaitingDataToBeReceived[7] = false;
+    if (PayloadIsUnchanged(MultiplusAbsorptionLEDTopic, ChargingStateDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
@@ -1346,14 +3879,15 @@ void SubscribeToGetChargingStateFromMultiplus()
       chargingState = "Absorption";
     if (verboseDebugOutput)
       Serial.println("Multiplus Absorption LED is on");
-    lastMQTTUpdateReceived = millis();
+    RecordDataPointUpdate(ChargingStateDataPoint);
     doc.clear(); });
 
   msTimer.begin(100);
 
   client.subscribe(ledsTopic + "/Float", [](const String &payload)
                    {
-    awaitingDataToBeReceived[7] = false;
+    if (PayloadIsUnchanged(MultiplusFloatLEDTopic, ChargingStateDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
@@ -1362,7 +3896,7 @@ void SubscribeToGetChargingStateFromMultiplus()
       chargingState = "Float";
     if (verboseDebugOutput)
       Serial.println("Multiplus Float LED is on");
-    lastMQTTUpdateReceived = millis();
+    RecordDataPointUpdate(ChargingStateDataPoint);
     doc.clear(); });
 
   msTimer.begin(100);
@@ -1378,6 +3912,8 @@ void SubscribeToGetChargingStateFromSolarCharger()
 
   client.subscribe(solarChargerStateTopic, [](const String &payload)
                    {
+    if (PayloadIsUnchanged(ChargingStateDataPoint, ChargingStateDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
@@ -1418,18 +3954,15 @@ void SubscribeToGetChargingStateFromSolarCharger()
 
     if (ESSIsBeingUsed) {
 
-      String commonTopic = "N/" + VictronInstallationID;
-      String xsolarChargerStateTopic = commonTopic + "/solarcharger/" + SolarChargerThreeDigitID + "/State";
+      QueueDeferredAction(SwitchChargingStateToMultiplus, 0);
 
-      client.unsubscribe(xsolarChargerStateTopic);
-      SubscribeToGetChargingStateFromMultiplus();
+      lastMQTTUpdateReceived = millis();
     } else {
-      awaitingDataToBeReceived[7] = false;
       if (verboseDebugOutput)
-        Serial.println("Charging State from MPPT: " + chargingState);
+        Serial.println("Charging State from MPPT: " + String(chargingState));
+      RecordDataPointUpdate(ChargingStateDataPoint);
     };
 
-    lastMQTTUpdateReceived = millis();
     doc.clear(); });
 }
 
@@ -1439,7 +3972,7 @@ void MassSubscribe()
   // at this point we have the VictronInstallationID, MultiplusThreeDigitID and SolarChargerThreeDigitID so let's get the rest of the data
 
   if (generalDebugOutput)
-    Serial.println("Subscribing");
+    Serial.println("Subscribing (" + String(millis() - connectionEstablishedAt) + " ms after the MQTT connection was established)");
 
   String commonTopic = "N/" + VictronInstallationID;
   String system0Topic = commonTopic + "/system/0/";
@@ -1448,6 +3981,13 @@ void MassSubscribe()
   // reset global variables so we will not start displaying information until all the subscribed data has been received
   ResetGlobals();
 
+  // a sibling of a gateway gets everything from the gateway's snapshot instead
+  if (thisDeviceIsAGatewaySibling)
+  {
+    SubscribeToGatewaySnapshot();
+    return;
+  };
+
   // get the data
 
   // Grid (L1, L2, L3)
@@ -1457,21 +3997,22 @@ void MassSubscribe()
 
     client.subscribe(system0Topic + "Ac/Grid/L1/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[0] = false;
+      if (PayloadIsUnchanged(GridInL1DataPoint, GridInL1DataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       gridInL1Watts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("gridInL1Watts: " + String(gridInL1Watts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(GridInL1DataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[0] = false;
+    awaitingDataToBeReceived[GridInL1DataPoint] = false;
   };
 
   if (GENERAL_SETTINGS_GRID_IN_L2_IS_USED)
@@ -1479,21 +4020,22 @@ void MassSubscribe()
 
     client.subscribe(system0Topic + "Ac/Grid/L2/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[1] = false;
+      if (PayloadIsUnchanged(GridInL2DataPoint, GridInL2DataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       gridInL2Watts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("gridInL2Watts: " + String(gridInL2Watts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(GridInL2DataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[1] = false;
+    awaitingDataToBeReceived[GridInL2DataPoint] = false;
   };
 
   if (GENERAL_SETTINGS_GRID_IN_L3_IS_USED)
@@ -1501,21 +4043,22 @@ void MassSubscribe()
 
     client.subscribe(system0Topic + "Ac/Grid/L3/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[2] = false;
+      if (PayloadIsUnchanged(GridInL3DataPoint, GridInL3DataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       gridInL3Watts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("gridInL3Watts: " + String(gridInL3Watts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(GridInL3DataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[2] = false;
+    awaitingDataToBeReceived[GridInL3DataPoint] = false;
   };
 
   // Solar
@@ -1523,118 +4066,130 @@ void MassSubscribe()
   {
     client.subscribe(system0Topic + "Dc/Pv/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[3] = false;
+      if (PayloadIsUnchanged(SolarDataPoint, SolarDataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       solarWatts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("solarWatts: " + String(solarWatts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(SolarDataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[3] = false;
+    awaitingDataToBeReceived[SolarDataPoint] = false;
   };
 
   // Battery
 
   client.subscribe(system0Topic + "Dc/Battery/Soc", [](const String &payload)
                    {
-    awaitingDataToBeReceived[4] = false;
+    if (PayloadIsUnchanged(BatterySOCDataPoint, BatterySOCDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
     batterySOC = doc["value"].as<float>();
     if (verboseDebugOutput)
       Serial.println("batterySOC: " + String(batterySOC));
-    lastMQTTUpdateReceived = millis();
+    RecordDataPointUpdate(BatterySOCDataPoint);
     doc.clear(); });
 
   msTimer.begin(100);
 
   client.subscribe(system0Topic + "Dc/Battery/Power", [](const String &payload)
                    {
-    awaitingDataToBeReceived[5] = false;
+    if (PayloadIsUnchanged(BatteryPowerDataPoint, BatteryPowerDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
     batteryPower = doc["value"].as<float>();
     if (verboseDebugOutput)
       Serial.println("batteryPower: " + String(batteryPower));
-    lastMQTTUpdateReceived = millis();
+    RecordDataPointUpdate(BatteryPowerDataPoint);
     doc.clear(); });
 
   msTimer.begin(100);
 
+  if (GENERAL_SETTINGS_REPORT_EACH_BATTERY)
+    SubscribeToEachBattery(system0Topic);
+
+  if (GENERAL_SETTINGS_REGISTER_EVERY_DEVICE)
+    SubscribeToEveryDevice(commonTopic);
+
   switch (GENERAL_SETTINGS_ADDITIONAL_INFO)
   {
 
   case 0:
 
-    awaitingDataToBeReceived[6] = false;
-    awaitingDataToBeReceived[7] = false;
-    awaitingDataToBeReceived[8] = false;
+    awaitingDataToBeReceived[BatteryTTGDataPoint] = false;
+    awaitingDataToBeReceived[ChargingStateDataPoint] = false;
+    awaitingDataToBeReceived[BatteryTemperatureDataPoint] = false;
     break;
 
   case 1:
 
     client.subscribe(system0Topic + "Dc/Battery/TimeToGo", [](const String &payload)
                      {
-        awaitingDataToBeReceived[6] = false;
+        if (PayloadIsUnchanged(BatteryTTGDataPoint, BatteryTTGDataPoint, payload))
+          return;
         String response = String(payload);
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, response);
         batteryTTG = doc["value"].as<float>();
         if (verboseDebugOutput)
           Serial.println("batteryTTG: " + String(batteryTTG));
-        lastMQTTUpdateReceived = millis();
+        RecordDataPointUpdate(BatteryTTGDataPoint);
         doc.clear(); });
 
-    awaitingDataToBeReceived[7] = false;
-    awaitingDataToBeReceived[8] = false;
+    awaitingDataToBeReceived[ChargingStateDataPoint] = false;
+    awaitingDataToBeReceived[BatteryTemperatureDataPoint] = false;
     break;
 
   case 2:
 
-    awaitingDataToBeReceived[6] = false;
+    awaitingDataToBeReceived[BatteryTTGDataPoint] = false;
 
     if (ESSIsBeingUsed)
       SubscribeToGetChargingStateFromMultiplus();
     else
       SubscribeToGetChargingStateFromSolarCharger();
 
-    awaitingDataToBeReceived[8] = false;
+    awaitingDataToBeReceived[BatteryTemperatureDataPoint] = false;
     break;
 
   case 3:
 
-    awaitingDataToBeReceived[6] = false;
-    awaitingDataToBeReceived[7] = false;
+    awaitingDataToBeReceived[BatteryTTGDataPoint] = false;
+    awaitingDataToBeReceived[ChargingStateDataPoint] = false;
 
     client.subscribe(system0Topic + "Dc/Battery/Temperature", [](const String &payload)
                      {
-        awaitingDataToBeReceived[8] = false;
+        if (PayloadIsUnchanged(BatteryTemperatureDataPoint, BatteryTemperatureDataPoint, payload))
+          return;
         String response = String(payload);
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, response);
         batteryTemperature = doc["value"].as<float>();
         if (verboseDebugOutput)
           Serial.println("batteryTemperature: " + String(batteryTemperature));
-        lastMQTTUpdateReceived = millis();
+        RecordDataPointUpdate(BatteryTemperatureDataPoint);
         doc.clear(); });
 
     msTimer.begin(100);
     break;
 
     case 4:
+    case 5:
 
-      awaitingDataToBeReceived[6] = false;
-      awaitingDataToBeReceived[7] = false;
-      awaitingDataToBeReceived[8] = false;
+      awaitingDataToBeReceived[BatteryTTGDataPoint] = false;
+      awaitingDataToBeReceived[ChargingStateDataPoint] = false;
+      awaitingDataToBeReceived[BatteryTemperatureDataPoint] = false;
       break;
 
   default:
@@ -1649,63 +4204,66 @@ void MassSubscribe()
   {
     client.subscribe(system0Topic + "Ac/Consumption/L1/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[9] = false;
+      if (PayloadIsUnchanged(ACOutL1DataPoint, ACOutL1DataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       ACOutL1Watts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("ACOutL1Watts: " + String(ACOutL1Watts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(ACOutL1DataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[9] = false;
+    awaitingDataToBeReceived[ACOutL1DataPoint] = false;
   };
 
   if (GENERAL_SETTINGS_AC_OUT_L2_IS_USED)
   {
     client.subscribe(system0Topic + "Ac/Consumption/L2/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[10] = false;
+      if (PayloadIsUnchanged(ACOutL2DataPoint, ACOutL2DataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       ACOutL2Watts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("ACOutL2Watts: " + String(ACOutL2Watts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(ACOutL2DataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[10] = false;
+    awaitingDataToBeReceived[ACOutL2DataPoint] = false;
   };
 
   if (GENERAL_SETTINGS_AC_OUT_L3_IS_USED)
   {
     client.subscribe(system0Topic + "Ac/Consumption/L3/Power", [](const String &payload)
                      {
-      awaitingDataToBeReceived[11] = false;
+      if (PayloadIsUnchanged(ACOutL3DataPoint, ACOutL3DataPoint, payload))
+        return;
       String response = String(payload);
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, response);
       ACOutL3Watts = doc["value"].as<float>();
       if (verboseDebugOutput)
         Serial.println("ACOutL3Watts: " + String(ACOutL3Watts));
-      lastMQTTUpdateReceived = millis();
+      RecordDataPointUpdate(ACOutL3DataPoint);
       doc.clear(); });
 
     msTimer.begin(100);
   }
   else
   {
-    awaitingDataToBeReceived[11] = false;
+    awaitingDataToBeReceived[ACOutL3DataPoint] = false;
   };
 
   // Multiplus mode
@@ -1714,7 +4272,8 @@ void MassSubscribe()
 
   client.subscribe(multiplusModeTopic, [](const String &payload)
                    {
-    awaitingDataToBeReceived[12] = false;
+    if (PayloadIsUnchanged(MultiplusModeDataPoint, MultiplusModeDataPoint, payload))
+      return;
     String response = String(payload);
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, response);
@@ -1746,7 +4305,13 @@ void MassSubscribe()
           Serial.println("Unknown multiplus mode: " + String(workingMode));
         break;
     };
-    lastMQTTUpdateReceived = millis();
+    if ((modeChangeRequestedAt != 0UL) && (workingMode == modeChangeRequested))
+    {
+      if (generalDebugOutput)
+        Serial.println("Multiplus mode change confirmed " + String(millis() - modeChangeRequestedAt) + " ms after it was sent");
+      modeChangeRequestedAt = 0UL;
+    };
+    RecordDataPointUpdate(MultiplusModeDataPoint);
     doc.clear(); });
 
   msTimer.begin(100);
@@ -1760,6 +4325,19 @@ void MassUnsubscribe()
   if (generalDebugOutput)
     Serial.println("Unsubscribing");
 
+  if (topicBrowserSelected)
+  {
+    client.unsubscribe("N/" + VictronInstallationID + "/#");
+    topicBrowserSelected = false;
+  };
+
+  if (thisDeviceIsAGatewaySibling)
+  {
+    client.unsubscribe(GatewaySnapshotTopicName());
+    msTimer.begin(100);
+    return;
+  };
+
   String commonTopic = "N/" + VictronInstallationID;
   String system0Topic = commonTopic + "/system/0/";
   String multiplusModeTopic = commonTopic + "/vebus/" + MultiplusThreeDigitID + "/Mode";
@@ -1782,6 +4360,12 @@ void MassUnsubscribe()
 
   client.unsubscribe(system0Topic + "Dc/Battery/Power");
 
+  if (GENERAL_SETTINGS_REPORT_EACH_BATTERY)
+    client.unsubscribe(system0Topic + "Batteries");
+
+  if (GENERAL_SETTINGS_REGISTER_EVERY_DEVICE)
+    UnsubscribeFromEveryDevice(commonTopic);
+
   switch (GENERAL_SETTINGS_ADDITIONAL_INFO)
   {
   case 1:
@@ -1818,26 +4402,112 @@ void MassUnsubscribe()
   msTimer.begin(100);
 }
 
+bool QueueDeferredAction(deferredActionType type, int value)
+{
+
+  // an action which is already waiting to be carried out is updated rather than queued a second time,
+  // so for example repeated mode changes result in only the most recent one being sent
+
+  for (int i = 0; i < numberOfDeferredActions; i++)
+  {
+    deferredAction &queuedAction = deferredActions[(firstDeferredAction + i) % maximumDeferredActions];
+    if (queuedAction.type == type)
+    {
+      queuedAction.value = value;
+      return true;
+    };
+  };
+
+  if (numberOfDeferredActions == maximumDeferredActions)
+  {
+    if (generalDebugOutput)
+      Serial.println("Deferred action queue is full, action " + String(type) + " dropped");
+    return false;
+  };
+
+  deferredAction &newAction = deferredActions[(firstDeferredAction + numberOfDeferredActions) % maximumDeferredActions];
+  newAction.type = type;
+  newAction.value = value;
+  numberOfDeferredActions++;
+
+  return true;
+}
+
+void ProcessDeferredActions()
+{
+
+  // only the actions queued before this call are processed, anything queued while processing them will be handled on the next pass through loop()
+
+  int actionsToProcess = numberOfDeferredActions;
+
+  while (actionsToProcess-- > 0)
+  {
+
+    deferredAction action = deferredActions[firstDeferredAction];
+    firstDeferredAction = (firstDeferredAction + 1) % maximumDeferredActions;
+    numberOfDeferredActions--;
+
+    String commonTopic = "N/" + VictronInstallationID;
+
+    switch (action.type)
+    {
+    case ContinueDiscoveryAfterInstallationID:
+      client.unsubscribe("N/+/system/0/Serial");
+      DiscoverIDsAndSubscribe();
+      break;
+    case ContinueDiscoveryAfterMultiplusID:
+      client.unsubscribe(commonTopic + "/vebus/+/Mode");
+      DiscoverIDsAndSubscribe();
+      break;
+    case ContinueDiscoveryAfterSolarChargerID:
+      client.unsubscribe(commonTopic + "/solarcharger/+/Mode");
+      DiscoverIDsAndSubscribe();
+      break;
+    case SwitchChargingStateToMultiplus:
+      client.unsubscribe(commonTopic + "/solarcharger/" + SolarChargerThreeDigitID + "/State");
+      SubscribeToGetChargingStateFromMultiplus();
+      break;
+    case SetMultiplusMode:
+      client.publish("W/" + VictronInstallationID + "/vebus/" + MultiplusThreeDigitID + "/Mode", "{\"value\": " + String(action.value) + "}");
+      modeChangeRequestedAt = millis();
+      modeChangeRequested = action.value;
+      break;
+    default:
+      break;
+    };
+  };
+}
+
 void onConnectionEstablished()
 {
 
-  // note: this subroutine uses recursion to discover the VictronInstallationID, MultiplusThreeDigitID and (if needed) SolarChargerThreeDigitID
+  connectionEstablishedAt = millis();
+
+  DiscoverIDsAndSubscribe();
+}
+
+void DiscoverIDsAndSubscribe()
+{
+
+  // note: this subroutine is called again (via a deferred action queued by each discovery callback) to discover the VictronInstallationID, MultiplusThreeDigitID and (if needed) SolarChargerThreeDigitID
 
   if (VictronInstallationID == "+")
   {
 
     // Let's find the Victron Installation ID
 
-    client.subscribe("N/+/system/0/Serial", [](const String &topic, const String &payload)
+    client.subscribe("N/+/system/0/Serial", [](const String &topic, const String &)
                      {
-      client.unsubscribe("N/+/system/0/Serial");
+      // until the deferred action unsubscribes, further matches (for example from a second installation on the same broker) are ignored
+      if (VictronInstallationID != "+")
+        return;
       String mytopic = String(topic);
       VictronInstallationID = mytopic.substring(2, 14);
       VictronInstallationID.toCharArray(VictronInstallationIDArray, VictronInstallationID.length() + 1);
       if (generalDebugOutput)
         Serial.println("*** Discovered Installation ID: " + VictronInstallationID);
 
-      onConnectionEstablished();
+      QueueDeferredAction(ContinueDiscoveryAfterInstallationID, 0);
       return; });
 
     return;
@@ -1848,17 +4518,18 @@ void onConnectionEstablished()
 
     // Let's find the Multiplus three digit ID
     String commonTopic = "N/" + VictronInstallationID;
-    client.subscribe(commonTopic + "/vebus/+/Mode", [](const String &topic, const String &payload)
+    client.subscribe(commonTopic + "/vebus/+/Mode", [](const String &topic, const String &)
                      {
-      String commonTopic = "N/" + VictronInstallationID;
-      client.unsubscribe(commonTopic + "/vebus/+/Mode");
+      // the first Multiplus found is used; further matches are ignored until the deferred action unsubscribes
+      if (MultiplusThreeDigitID != "+")
+        return;
       String mytopic = String(topic);
       MultiplusThreeDigitID = mytopic.substring(21, 24);
       MultiplusThreeDigitID.toCharArray(MultiplusThreeDigitIDArray, MultiplusThreeDigitID.length() + 1);
       if (generalDebugOutput)
         Serial.println("*** Discovered Multiplus three digit ID: " + MultiplusThreeDigitID);
 
-      onConnectionEstablished();
+      QueueDeferredAction(ContinueDiscoveryAfterMultiplusID, 0);
       return; });
 
     // a keep alive request is required for Venus to publish the topic subscribed to above
@@ -1872,17 +4543,18 @@ void onConnectionEstablished()
 
     // Let's find the solarcharger three digit ID
     String commonTopic = "N/" + VictronInstallationID;
-    client.subscribe(commonTopic + "/solarcharger/+/Mode", [](const String &topic, const String &payload)
+    client.subscribe(commonTopic + "/solarcharger/+/Mode", [](const String &topic, const String &)
                      {
-      String commonTopic = "N/" + VictronInstallationID;
-      client.unsubscribe(commonTopic + "/solarcharger/+/Mode");
+      // the first solar charger found is used; further matches are ignored until the deferred action unsubscribes
+      if (SolarChargerThreeDigitID != "+")
+        return;
       String mytopic = String(topic);
       SolarChargerThreeDigitID = mytopic.substring(28, 31);
       SolarChargerThreeDigitID.toCharArray(SolarChargerThreeDigitIDArray, SolarChargerThreeDigitID.length() + 1);
       if (generalDebugOutput)
         Serial.println("*** Discovered Solar Charger three digit ID: " + SolarChargerThreeDigitID);
 
-      onConnectionEstablished();
+      QueueDeferredAction(ContinueDiscoveryAfterSolarChargerID, 0);
       return; });
 
     // a keep alive request is required for Venus to publish the topic subscribed to above
@@ -1891,12 +4563,14 @@ void onConnectionEstablished()
     return;
   };
 
-  // at this point the recursive calling is over and we have the VictronInstallationID, MultiplusThreeDigitID and (if needed) SolarChargerThreeDigitID so let's get the rest of the data
+  // at this point discovery is over and we have the VictronInstallationID, MultiplusThreeDigitID and (if needed) SolarChargerThreeDigitID so let's get the rest of the data
+
+  SubscribeToKeepAliveElection();
 
   MassSubscribe();
 }
 
-void onWiFiConnectionEstablished(WiFiEvent_t event, WiFiEventInfo_t info)
+void onWiFiConnectionEstablished(WiFiEvent_t, WiFiEventInfo_t)
 {
 
   if (generalDebugOutput)
@@ -1912,6 +4586,20 @@ void onWiFiConnectionEstablished(WiFiEvent_t event, WiFiEventInfo_t info)
   RefreshTimeOnceADay(true);
 }
 
+int MaximumMQTTPacketSize()
+{
+
+  // the MQTT client's own default is enough for each of Venus's topics the main screen uses, but not for system/0/Batteries, nor for
+  // every topic the topic browser may receive
+
+  const int defaultMaximumPacketSize = 256;
+
+  if (GENERAL_SETTINGS_REPORT_EACH_BATTERY || GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER)
+    return GENERAL_SETTINGS_MQTT_MAXIMUM_PACKET_SIZE;
+
+  return defaultMaximumPacketSize;
+}
+
 void SetupWiFiAndMQTT()
 {
 
@@ -1929,6 +4617,25 @@ void SetupWiFiAndMQTT()
 
   if (verboseDebugOutput)
     client.enableDebuggingMessages();
+
+  // the packets are received whole, so the buffer must be large enough for the largest message subscribed to
+  client.setMaxPacketSize(MaximumMQTTPacketSize());
+
+  BeginKeepAliveElection(keepAliveLeaderElection, SECRET_SETTINGS_MQTT_ClientName, GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL);
+
+  // should this device stop without leaving the election (for example if it loses power), the broker clears its heartbeat
+  if (keepAliveLeaderIsElected)
+    client.enableLastWillMessage(keepAliveHeartbeatTopic, "", true);
+}
+
+void LeaveKeepAliveElection()
+{
+
+  if (!keepAliveElectionStarted || !client.isMqttConnected())
+    return;
+
+  client.publish(keepAliveHeartbeatTopic, "", true);
+  keepAliveElectionStarted = false;
 }
 
 bool isNumeric(String str)
@@ -1955,6 +4662,12 @@ void convertSecondsToTime(int seconds, int &hours, int &minutes, int &remainingS
 void GotoDeepSleep()
 {
 
+  SaveEnergyTotals();
+
+  LeaveKeepAliveElection();
+
+  FlushTelemetryLog();
+
   // this routine is only called when it is time to send the ESP32 to sleep
   // according the logic below counts on the fact that the current time is currently within the sleep period
 
@@ -2144,6 +4857,8 @@ void SetTheDisplayOn(bool theDisplayShouldBeOn)
 
       theDisplayIsCurrentlyOn = false;
 
+      TraceEvent(micros(), DisplayOffEvent, TraceBegin);
+
       if (generalDebugOutput)
         Serial.println("Display turned off");
     };
@@ -2160,9 +4875,14 @@ void SetTheDisplayOn(bool theDisplayShouldBeOn)
       // if this is the first time the display is being turned on then
       // subscribe so that the data will be updated now that the display has been turned back on
       if (firstTimeSetup)
+      {
         firstTimeSetup = false;
+      }
       else
+      {
+        TraceEvent(micros(), DisplayOffEvent, TraceEnd);
         MassSubscribe();
+      };
 
       theDisplayIsCurrentlyOn = true;
 
@@ -2376,6 +5096,14 @@ void setup()
 
   ResetGlobals();
 
+  SetupHistory();
+
+  SetupTopicBrowser();
+
+  RestoreEnergyTotals();
+
+  SetupTelemetryLog();
+
   SetupWiFiAndMQTT();
 
   ShowOpeningWindow();
@@ -2384,15 +5112,54 @@ void setup()
 void loop()
 {
 
-  client.loop();
+  unsigned long loopPassStartTime = micros();
+  unsigned long stageStartTime = loopPassStartTime;
+
+  ServiceMQTT();
+  stageStartTime = EndLoopStage(MQTTStage, stageStartTime);
+
+  ProcessDeferredActions();
+  stageStartTime = EndLoopStage(DeferredActionsStage, stageStartTime);
 
   KeepMQTTAlive();
+  stageStartTime = EndLoopStage(KeepAliveStage, stageStartTime);
+
+  PublishGatewaySnapshot();
+  stageStartTime = EndLoopStage(GatewayStage, stageStartTime);
+
+  RequestStaleDataPoints();
+  stageStartTime = EndLoopStage(StaleDataStage, stageStartTime);
+
+  RecordHistory();
+
+  RecordChartSample();
+  stageStartTime = EndLoopStage(HistoryStage, stageStartTime);
+
+  AccumulateEnergy();
+  stageStartTime = EndLoopStage(EnergyStage, stageStartTime);
+
+  RecordTelemetry();
+  stageStartTime = EndLoopStage(TelemetryLogStage, stageStartTime);
 
   CheckButtons();
+  stageStartTime = EndLoopStage(ButtonsStage, stageStartTime);
 
   UpdateDisplay();
+  stageStartTime = EndLoopStage(DisplayStage, stageStartTime);
 
   RefreshTimeOnceADay();
+  stageStartTime = EndLoopStage(TimeRefreshStage, stageStartTime);
+
+  ReportStatistics();
+
+  CheckSerialCommands();
+  stageStartTime = EndLoopStage(ReportingStage, stageStartTime);
+
+  ServiceHTTPServer();
+  stageStartTime = EndLoopStage(HTTPStage, stageStartTime);
 
   ArduinoOTA.handle();
+  EndLoopStage(OTAStage, stageStartTime);
+
+  RecordLoopPass(micros() - loopPassStartTime);
 }
@@ -0,0 +1,150 @@
+#include "device_registry.h"
+#include <string.h>
+#include <math.h>
+
+struct deviceStateRank
+{
+  int state;
+  const char *name;
+};
+
+// Fault and Off come first as they are the states that most need to be shown when several devices differ
+static const deviceStateRank deviceStatesByRank[deviceStateRanks - 1] = {
+    {2, "Fault"},
+    {0, "Off"},
+    {1, "Low power"},
+    {245, "Starting"},
+    {3, "Bulk"},
+    {4, "Absorption"},
+    {7, "Equalize"},
+    {5, "Float"},
+    {6, "Storage"},
+    {8, "Passthru"},
+    {9, "Inverting"},
+    {10, "Power assist"},
+    {11, "Power supply"},
+    {244, "Sustain"},
+    {252, "External control"}};
+
+static const int otherStateRank = deviceStateRanks - 1;
+
+static int RankOfState(int state)
+{
+
+  for (int i = 0; i < otherStateRank; i++)
+    if (deviceStatesByRank[i].state == state)
+      return i;
+
+  return otherStateRank;
+}
+
+void ClearDeviceRegistry(deviceRegistry &registry)
+{
+
+  memset(&registry, 0, sizeof(registry));
+
+  for (int i = 0; i < deviceRegistryHashSlots; i++)
+    registry.slots[i] = -1;
+}
+
+static registeredDevice *FindOrAddDevice(deviceRegistry &registry, deviceKind kind, int instance)
+{
+
+  uint32_t key = (uint32_t)kind << 16 | (uint16_t)instance;
+  uint32_t slot = (uint32_t)(key * 2654435761U) >> 25; // the top seven bits, as there are 128 slots
+
+  while (registry.slots[slot] >= 0)
+  {
+    registeredDevice &device = registry.devices[registry.slots[slot]];
+    if ((device.kind == kind) && (device.instance == (uint16_t)instance))
+      return &device;
+    slot = (slot + 1) & (deviceRegistryHashSlots - 1);
+  };
+
+  if (registry.numberOfDevices >= maximumRegisteredDevices)
+  {
+    registry.devicesNotRegistered++;
+    return NULL;
+  };
+
+  registry.slots[slot] = (int16_t)registry.numberOfDevices;
+
+  registeredDevice &device = registry.devices[registry.numberOfDevices++];
+  device.instance = (uint16_t)instance;
+  device.kind = (uint8_t)kind;
+  device.state = -1;
+  device.powerReceived = false;
+  device.watts = 0;
+
+  registry.totals[kind].devices++;
+
+  return &device;
+}
+
+void UpdateDevicePower(deviceRegistry &registry, deviceKind kind, int instance, float watts)
+{
+
+  registeredDevice *device = FindOrAddDevice(registry, kind, instance);
+  if (device == NULL)
+    return;
+
+  deviceKindTotals &totals = registry.totals[kind];
+
+  int32_t wholeWatts = isnan(watts) ? 0 : (int32_t)lroundf(watts);
+
+  if (!device->powerReceived)
+  {
+    device->powerReceived = true;
+    totals.devicesWithPower++;
+  };
+
+  totals.watts += wholeWatts - device->watts;
+  device->watts = wholeWatts;
+}
+
+void UpdateDeviceState(deviceRegistry &registry, deviceKind kind, int instance, int state)
+{
+
+  registeredDevice *device = FindOrAddDevice(registry, kind, instance);
+  if (device == NULL)
+    return;
+
+  deviceKindTotals &totals = registry.totals[kind];
+
+  if (device->state >= 0)
+    totals.devicesInStateRank[device->stateRank]--;
+
+  device->state = (int16_t)state;
+  device->stateRank = (uint8_t)RankOfState(state);
+
+  totals.devicesInStateRank[device->stateRank]++;
+}
+
+int LeastAdvancedDeviceState(const deviceRegistry &registry, deviceKind kind)
+{
+
+  const deviceKindTotals &totals = registry.totals[kind];
+
+  for (int i = 0; i < otherStateRank; i++)
+    if (totals.devicesInStateRank[i] > 0)
+      return deviceStatesByRank[i].state;
+
+  // states other than those above have no order among themselves, so the first device found in one is taken
+  if (totals.devicesInStateRank[otherStateRank] > 0)
+    for (int i = 0; i < registry.numberOfDevices; i++)
+      if ((registry.devices[i].kind == kind) && (registry.devices[i].stateRank == otherStateRank) && (registry.devices[i].state >= 0))
+        return registry.devices[i].state;
+
+  return -1;
+}
+
+const char *DeviceStateName(int state)
+{
+
+  if (state < 0)
+    return "Unknown";
+
+  int rank = RankOfState(state);
+
+  return (rank == otherStateRank) ? "Other" : deviceStatesByRank[rank].name;
+}
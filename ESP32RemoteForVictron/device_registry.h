@@ -0,0 +1,68 @@
+#pragma once
+
+// Device registry
+//
+// keeps the power and state of every solar charger and VE.Bus unit found (through wildcard subscriptions) in a fixed table, along with
+// totals for each kind of device which are adjusted as each value arrives, so that no update has to look at any of the other devices
+//
+// devices are looked up by their instance in a small hash table, so finding one takes the same time however many there are; neither
+// adding nor updating a device allocates memory
+//
+// power is kept in whole watts so that the totals, adjusted by the difference on each update, do not drift from the sum of the devices
+//
+// this does not depend on the Arduino core
+
+#include <stdint.h>
+
+const int maximumRegisteredDevices = 48;
+const int deviceRegistryHashSlots = 128; // a power of two, well above maximumRegisteredDevices so that probes stay short
+
+enum deviceKind
+{
+  SolarChargerDevice,
+  VEBusDevice,
+  deviceKinds
+};
+
+// the charger and VE.Bus state codes, ordered from the least to the most advanced charging state (the last counts all other codes)
+const int deviceStateRanks = 16;
+
+struct registeredDevice
+{
+  uint16_t instance;
+  uint8_t kind;
+  uint8_t stateRank;
+  int16_t state; // -1 until received
+  bool powerReceived;
+  int32_t watts;
+};
+
+struct deviceKindTotals
+{
+  int devices;
+  int devicesWithPower;
+  int32_t watts;
+  uint16_t devicesInStateRank[deviceStateRanks];
+};
+
+struct deviceRegistry
+{
+  registeredDevice devices[maximumRegisteredDevices];
+  int numberOfDevices;
+  int16_t slots[deviceRegistryHashSlots]; // index into devices, or -1 if the slot is empty
+  deviceKindTotals totals[deviceKinds];
+  int devicesNotRegistered; // updates for devices beyond maximumRegisteredDevices
+};
+
+// forget all of the devices
+void ClearDeviceRegistry(deviceRegistry &registry);
+
+// these add the device if it has not been seen before
+void UpdateDevicePower(deviceRegistry &registry, deviceKind kind, int instance, float watts);
+void UpdateDeviceState(deviceRegistry &registry, deviceKind kind, int instance, int state);
+
+// the least advanced state of the devices of the kind (for example Bulk rather than Float if one charger is in each), or -1 if none is known
+int LeastAdvancedDeviceState(const deviceRegistry &registry, deviceKind kind);
+
+// the name of a solar charger or VE.Bus state code
+const char *DeviceStateName(int state);
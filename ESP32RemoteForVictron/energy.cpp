@@ -0,0 +1,99 @@
+#include "energy.h"
+
+void ClearEnergyTotals(energyTotals &totals, int32_t day)
+{
+  totals.validityMarker = energyTotalsValidityMarker;
+  totals.day = day;
+  for (int i = 0; i < energyCounters; i++)
+  {
+    totals.today[i] = 0.0;
+    totals.yesterday[i] = 0.0;
+  };
+}
+
+void SetEnergyDay(energyTotals &totals, int32_t day)
+{
+
+  if (day == totals.day)
+    return;
+
+  for (int i = 0; i < energyCounters; i++)
+  {
+    totals.yesterday[i] = (day == totals.day + 1) ? totals.today[i] : 0.0;
+    totals.today[i] = 0.0;
+  };
+
+  totals.day = day;
+}
+
+void IntegratePower(powerIntegrator &integrator, uint32_t timeInMilliSeconds, float watts, energyTotals &totals, energyCounter positiveCounter, energyCounter negativeCounter)
+{
+
+  if (integrator.havePreviousSample)
+  {
+
+    uint32_t elapsed = timeInMilliSeconds - integrator.previousTime;
+
+    if ((elapsed > 0UL) && (elapsed <= maximumIntegrationGapInMilliSeconds))
+    {
+
+      double hours = (double)elapsed / 3600000.0;
+      double startWatts = integrator.previousWatts;
+      double endWatts = watts;
+
+      double positiveWattHours = 0.0;
+      double negativeWattHours = 0.0;
+
+      if ((startWatts >= 0.0) && (endWatts >= 0.0))
+      {
+        positiveWattHours = (startWatts + endWatts) / 2.0 * hours;
+      }
+      else if ((startWatts <= 0.0) && (endWatts <= 0.0))
+      {
+        negativeWattHours = -(startWatts + endWatts) / 2.0 * hours;
+      }
+      else
+      {
+        // the power changed direction part way through the period, at the point where the straight line between the two samples crosses zero
+        double fractionBeforeCrossing = startWatts / (startWatts - endWatts);
+        double areaBeforeCrossing = startWatts / 2.0 * hours * fractionBeforeCrossing;
+        double areaAfterCrossing = endWatts / 2.0 * hours * (1.0 - fractionBeforeCrossing);
+        if (startWatts > 0.0)
+        {
+          positiveWattHours = areaBeforeCrossing;
+          negativeWattHours = -areaAfterCrossing;
+        }
+        else
+        {
+          negativeWattHours = -areaBeforeCrossing;
+          positiveWattHours = areaAfterCrossing;
+        };
+      };
+
+      if (positiveCounter < energyCounters)
+        totals.today[positiveCounter] += positiveWattHours;
+      if (negativeCounter < energyCounters)
+        totals.today[negativeCounter] += negativeWattHours;
+    };
+  };
+
+  integrator.havePreviousSample = true;
+  integrator.previousTime = timeInMilliSeconds;
+  integrator.previousWatts = watts;
+}
+
+void ResetPowerIntegrator(powerIntegrator &integrator)
+{
+  integrator.havePreviousSample = false;
+}
+
+int32_t DayNumber(int year, int month, int day)
+{
+  // days from civil, see http://howardhinnant.github.io/date_algorithms.html
+  year -= (month <= 2) ? 1 : 0;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  int32_t yearOfEra = year - era * 400;
+  int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
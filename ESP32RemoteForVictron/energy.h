@@ -0,0 +1,63 @@
+#pragma once
+
+// Energy
+//
+// turns the power values received into energy, by adding up the area under the power curve between each pair of samples (the trapezoidal rule)
+// a gap of more than maximumIntegrationGapInMilliSeconds between two samples (for example while the display is off) is left out rather than guessed at
+//
+// power which may flow either way (to and from the grid, into and out of the battery) is split into separate positive and negative totals,
+// including the part of a period on each side of a change of direction
+//
+// the totals are kept for today and yesterday; the caller says which day it is, and the totals move on when the day changes
+//
+// this does not depend on the Arduino core
+
+#include <stdint.h>
+
+enum energyCounter
+{
+  SolarEnergy,
+  GridImportEnergy,
+  GridExportEnergy,
+  ACLoadEnergy,
+  BatteryChargeEnergy,
+  BatteryDischargeEnergy,
+  energyCounters
+};
+
+const uint32_t maximumIntegrationGapInMilliSeconds = 10000UL;
+
+// the last sample of a power value
+struct powerIntegrator
+{
+  bool havePreviousSample;
+  uint32_t previousTime; // milliseconds
+  float previousWatts;
+};
+
+// the energy totals, in watt hours
+struct energyTotals
+{
+  uint32_t validityMarker; // equal to energyTotalsValidityMarker once the totals have been set up
+  int32_t day;             // as returned by DayNumber
+  double today[energyCounters];
+  double yesterday[energyCounters];
+};
+
+const uint32_t energyTotalsValidityMarker = 0x454E5247UL;
+
+// clear the totals
+void ClearEnergyTotals(energyTotals &totals, int32_t day);
+
+// move the totals on if the day has changed: after one day today's totals become yesterday's, after more than one day both start again
+void SetEnergyDay(energyTotals &totals, int32_t day);
+
+// add the energy since the previous sample to the positive counter or, for power flowing the other way, to the negative counter
+// (either counter may be energyCounters, in which case that direction is not counted)
+void IntegratePower(powerIntegrator &integrator, uint32_t timeInMilliSeconds, float watts, energyTotals &totals, energyCounter positiveCounter, energyCounter negativeCounter);
+
+// forget the last sample, so the next one starts a new period rather than being joined to it
+void ResetPowerIntegrator(powerIntegrator &integrator);
+
+// the number of days from 1 January 1970 to the date given (month 1 to 12, day 1 to 31)
+int32_t DayNumber(int year, int month, int day);
@@ -9,6 +9,18 @@
 #define GENERAL_SETTINGS_SHOW_INVERTER_MODE                            true    // set to true to show the inverter mode, otherwise set to false to hide the inverter mode
                                       
 #define GENERAL_SETTINGS_SECONDS_BETWEEN_DISPLAY_UPDATES                  1    // seconds between display updates
+#define GENERAL_SETTINGS_SECONDS_BETWEEN_FORCED_DISPLAY_REFRESHES        60    // the display is only redrawn when something shown on it changes, however it will always be redrawn at least this often
+#define GENERAL_SETTINGS_SECONDS_BETWEEN_CHART_SAMPLES                    5    // seconds between the samples shown on the power chart (shown by pressing both buttons together); the chart shows 440 samples
+#define GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER                         false    // set to true to be able to browse every topic Venus publishes (for example while commissioning an installation),
+                                                                               // shown by pressing the bottom button while the power chart is shown; the top button then shows the next page of topics,
+                                                                               // the bottom button the previous page, and both buttons together return to the main screen (this needs the board's PSRAM)
+
+#define GENERAL_SETTINGS_SECONDS_BEFORE_A_VALUE_IS_SHOWN_AS_STALE        45    // if an individual value has not been updated by Venus for this many seconds it will be shown dimmed
+                                                                               // and a read request for just that value will be sent to Venus to get it updated again
+                                                                               // note: this relies on Venus republishing every value following each periodical keep alive request, so that a value which has not
+                                                                               // changed is still received once each GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL; a value is therefore never shown
+                                                                               // as stale before one and a half intervals have passed, and values are not shown as stale at all when
+                                                                               // GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES is true (if another system sends the keep alive requests, it too must not suppress the republish)
 
 #define GENERAL_SETTINGS_IF_OVER_1000_WATTS_REPORT_KW                  true    // if value being reported is over 1000 Watts then if true report in Kilo Watts otherwise report in Watts
 
@@ -26,6 +38,7 @@
                                                                                // 2 = show Solar Charger (mppt) / Multiplus charging state: Off/Fault/Bulk/Absorption/Float/Storage/Equalize/ESS
                                                                                // 3 = show battery temperature
                                                                                // 4 = show battery power, positive number means power going into the battery, negative number means power going out of the battery
+                                                                               // 5 = show the solar energy produced today (in kWh, counted by this device while its display is on)
 
                                                                                // if any of the following are not used in your installation then you can set the associated value(s) below to false to reduce unneeded MQTT traffic:
 #define GENERAL_SETTINGS_GRID_IN_L1_IS_USED                            true    // set to true if Grid IN L1 is used in your installation, otherwise set to false
@@ -36,6 +49,15 @@
 #define GENERAL_SETTINGS_AC_OUT_L2_IS_USED                             true    // set to true if AC OUT L2 is used in your installation, otherwise set to false
 #define GENERAL_SETTINGS_AC_OUT_L3_IS_USED                             true    // set to true if AC OUT L3 is used in your installation, otherwise set to false
 
+                                                                               // the following receive more of what Venus publishes than is shown on the display, for the serial monitor commands named:
+#define GENERAL_SETTINGS_REPORT_EACH_BATTERY                          false    // set to true to also receive the state of charge, power and voltage of each battery (from Venus's system/0/Batteries),
+                                                                               // which are sent with the 'batteries' serial monitor command; set to false otherwise
+                                                                               // note: as that topic carries one message of several kilobytes, this enlarges the MQTT receive buffer to GENERAL_SETTINGS_MQTT_MAXIMUM_PACKET_SIZE
+#define GENERAL_SETTINGS_MQTT_MAXIMUM_PACKET_SIZE                      4096    // the largest MQTT message that can be received when GENERAL_SETTINGS_REPORT_EACH_BATTERY or GENERAL_SETTINGS_ENABLE_TOPIC_BROWSER is true;
+                                                                               // larger messages are dropped by the MQTT client (the 'topics' serial monitor command reports this limit)
+#define GENERAL_SETTINGS_REGISTER_EVERY_DEVICE                        false    // set to true to also receive the power and state of every solar charger and VE.Bus unit in the installation
+                                                                               // (rather than only those of the first of each found), which are sent along with their totals with the 'devices' serial monitor command
+
 #define GENERAL_SETTINGS_SHOW_SPLASH_SCREEN                            true    // set to true show the splash screen on initial startup, set to false to not show the splash screen
 
 #define GENERAL_SETTINGS_TURN_ON_DISPLAY_AT_SPECIFIC_TIMES_ONLY       false    // set to true to turn on the display between the times indentified below, set to false to leave the display always on
@@ -106,9 +128,26 @@
                                                                                // 5. regardless of if this option is set to true or false, if you see the message "Awaiting MQTT connection" appear 
                                                                                //    on your screen and stay there it likely means Venus itself is no longer transmitting MQTT data 
 #define GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL 30000    // Time between keep alive requests in ms
+#define GENERAL_SETTINGS_SUPPRESS_REPUBLISH_ON_KEEP_ALIVES            false    // set to true to have the periodical keep alive requests ask Venus to publish only the values that have changed since the last one,
+                                                                               // rather than all of them again; this cuts down on network traffic, but as a value that has not changed is then not received again,
+                                                                               // values can no longer be shown dimmed when they are stale (see GENERAL_SETTINGS_SECONDS_BEFORE_A_VALUE_IS_SHOWN_AS_STALE)
+#define GENERAL_SETTINGS_ELECT_KEEP_ALIVE_LEADER                      false    // where several of these devices are used with the same installation, set this to true on each of them to have only one of them
+                                                                               // send the periodical keep alive requests; they elect that one among themselves, and if it stops another takes over as soon as the
+                                                                               // MQTT broker finds it has gone (or, failing that, within one interval)
+                                                                               // note: each of the devices must then have its own SECRET_SETTINGS_MQTT_ClientName
+
+#define GENERAL_SETTINGS_GATEWAY_MODE                                     0    // where several of these devices are used with the same installation, one of them can pass on the values to the others:
+                                                                               // 0 = get the values from Venus
+                                                                               // 1 = get the values from Venus, and also publish them all in one compact message (the gateway)
+                                                                               // 2 = get the values from the gateway's message rather than from Venus, and leave the keep alive requests to the gateway
+                                                                               // note: the gateway only passes on the values while its own display is on, so its display should be left always on
+#define GENERAL_SETTINGS_SECONDS_BETWEEN_GATEWAY_SNAPSHOTS                2    // if GENERAL_SETTINGS_GATEWAY_MODE is 1, the gateway publishes the values this often
 
 #define GENERAL_SETTINGS_ENABLE_OVER_THE_AIR_UPDATES                   true    // set to true to enable OTA updates, set to false to disable OTA updates
 
+#define GENERAL_SETTINGS_ENABLE_HTTP_SERVER                           false    // set to true to serve the current values as JSON at http://<this device>/status.json and the history at http://<this device>/history, set to false to disable the web server
+                                                                               // note: the web server has no password, so anyone on the same network can read these
+
 #define GENERAL_SETTINGS_DEBUG_OUTPUT_LEVEL                               1    // set to: 0 for no debug output
                                                                                //         1 for general debug output
                                                                                //         2 for verbose debug output
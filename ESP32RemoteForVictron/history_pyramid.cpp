@@ -0,0 +1,173 @@
+#include "history_pyramid.h"
+#include <math.h>
+
+static const int pyramidLevels = 11;
+static const uint32_t bucketsPerLevel = 4096;
+
+// each level is a ring of buckets, bucket n of the level holding the period (time >> level) which is n modulo bucketsPerLevel
+// each bucket remembers which period it holds, so one left over from an earlier time round the ring is recognised as empty
+
+struct pyramidLevel
+{
+  uint32_t *periods;
+  uint16_t *samples;
+  float *minimums[historyMetrics];
+  float *maximums[historyMetrics];
+  float *totals[historyMetrics];
+};
+
+static pyramidLevel levels[pyramidLevels];
+
+static bool pyramidAvailable = false;
+static bool anySampleAdded = false;
+static uint32_t lastTimeAdded = 0UL;
+
+size_t HistoryPyramidMemoryRequired()
+{
+  return (size_t)pyramidLevels * bucketsPerLevel * (sizeof(uint32_t) + sizeof(uint16_t) + 3 * historyMetrics * sizeof(float));
+}
+
+uint32_t HistoryPyramidSeconds()
+{
+  return bucketsPerLevel << (pyramidLevels - 1);
+}
+
+bool BeginHistoryPyramid(void *(*allocate)(size_t size))
+{
+
+  uint8_t *memory = (uint8_t *)allocate(HistoryPyramidMemoryRequired());
+  if (memory == NULL)
+    return false;
+
+  // the floats are placed first, then the periods, then the sample counts, so that each array is aligned
+
+  for (int i = 0; i < pyramidLevels; i++)
+    for (int metric = 0; metric < historyMetrics; metric++)
+    {
+      levels[i].minimums[metric] = (float *)memory;
+      memory += bucketsPerLevel * sizeof(float);
+      levels[i].maximums[metric] = (float *)memory;
+      memory += bucketsPerLevel * sizeof(float);
+      levels[i].totals[metric] = (float *)memory;
+      memory += bucketsPerLevel * sizeof(float);
+    };
+
+  for (int i = 0; i < pyramidLevels; i++)
+  {
+    levels[i].periods = (uint32_t *)memory;
+    memory += bucketsPerLevel * sizeof(uint32_t);
+  };
+
+  for (int i = 0; i < pyramidLevels; i++)
+  {
+    levels[i].samples = (uint16_t *)memory;
+    memory += bucketsPerLevel * sizeof(uint16_t);
+    for (uint32_t bucket = 0; bucket < bucketsPerLevel; bucket++)
+      levels[i].samples[bucket] = 0;
+  };
+
+  pyramidAvailable = true;
+  return true;
+}
+
+void AddHistoryPyramidSample(uint32_t time, const float values[historyMetrics])
+{
+
+  if (!pyramidAvailable)
+    return;
+
+  if (anySampleAdded && (time <= lastTimeAdded))
+    return;
+
+  anySampleAdded = true;
+  lastTimeAdded = time;
+
+  for (int i = 0; i < pyramidLevels; i++)
+  {
+
+    pyramidLevel &level = levels[i];
+
+    uint32_t period = time >> i;
+    uint32_t bucket = period % bucketsPerLevel;
+
+    if ((level.samples[bucket] == 0) || (level.periods[bucket] != period))
+    {
+      level.periods[bucket] = period;
+      level.samples[bucket] = 0;
+      for (int metric = 0; metric < historyMetrics; metric++)
+      {
+        level.minimums[metric][bucket] = values[metric];
+        level.maximums[metric][bucket] = values[metric];
+        level.totals[metric][bucket] = 0.0F;
+      };
+    };
+
+    level.samples[bucket]++;
+    for (int metric = 0; metric < historyMetrics; metric++)
+    {
+      if (values[metric] < level.minimums[metric][bucket])
+        level.minimums[metric][bucket] = values[metric];
+      if (values[metric] > level.maximums[metric][bucket])
+        level.maximums[metric][bucket] = values[metric];
+      level.totals[metric][bucket] += values[metric];
+    };
+  };
+}
+
+uint32_t ReadHistoryColumns(historyMetric metric, uint32_t fromTime, uint32_t toTime, int columns, historySample *samples)
+{
+
+  if ((columns <= 0) || (toTime <= fromTime))
+    return 0;
+
+  // the finest level whose buckets are at least as wide as a column, or failing that whose buckets are still held for the start of the period
+
+  uint32_t period = toTime - fromTime;
+
+  int levelUsed = 0;
+  while ((levelUsed < pyramidLevels - 1) && ((((uint32_t)2 << levelUsed) * (uint32_t)columns <= period) || (lastTimeAdded - fromTime >= (bucketsPerLevel << levelUsed))))
+    levelUsed++;
+
+  const pyramidLevel &level = levels[levelUsed];
+
+  for (int column = 0; column < columns; column++)
+  {
+
+    uint32_t columnStart = fromTime + (uint32_t)((uint64_t)period * column / columns);
+    uint32_t columnEnd = fromTime + (uint32_t)((uint64_t)period * (column + 1) / columns);
+    if (columnEnd <= columnStart)
+      columnEnd = columnStart + 1;
+
+    historySample &sample = samples[column];
+    sample.time = columnStart;
+    sample.minimum = NAN;
+    sample.maximum = NAN;
+    sample.average = NAN;
+
+    if (!pyramidAvailable)
+      continue;
+
+    float total = 0.0F;
+    uint32_t count = 0;
+
+    for (uint32_t p = columnStart >> levelUsed; p <= (columnEnd - 1) >> levelUsed; p++)
+    {
+
+      uint32_t bucket = p % bucketsPerLevel;
+      if ((level.samples[bucket] == 0) || (level.periods[bucket] != p))
+        continue;
+
+      if ((count == 0) || (level.minimums[metric][bucket] < sample.minimum))
+        sample.minimum = level.minimums[metric][bucket];
+      if ((count == 0) || (level.maximums[metric][bucket] > sample.maximum))
+        sample.maximum = level.maximums[metric][bucket];
+      total += level.totals[metric][bucket];
+      count += level.samples[bucket];
+    };
+
+    if (count > 0)
+      sample.average = total / (float)count;
+  };
+
+  return (uint32_t)1 << levelUsed;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// History pyramid
+//
+// keeps the minimum, maximum and average of each metric at several levels of detail: one second a bucket, two seconds, four seconds,
+// and so on up to 1024 seconds (about 17 minutes) a bucket, with 4096 buckets at each level, so that each level covers twice the time of
+// the one below it:
+//
+//   every second for the last 68 minutes
+//   every 64 seconds (about a minute) for the last 3 days
+//   every 1024 seconds (about 17 minutes) for the last 48 days
+//
+// every sample is added to the bucket it falls in at each level as it arrives, so the pyramid is always up to date, and any period can be
+// read as a given number of columns by using the level whose buckets are no wider than a column: each column then takes only a few
+// buckets, whatever the period, so drawing a chart of an hour or of a month takes the same time
+//
+// time is given in seconds by the caller; seconds without a sample (for example while the display is off) are simply left out of the
+// statistics, and a bucket without any samples is read as having none
+//
+// the memory is allocated once by BeginHistoryPyramid using the function supplied, so that it can be placed in PSRAM;
+// this does not depend on the Arduino core
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum historyMetric
+{
+  SolarHistory,
+  GridHistory,
+  ACLoadHistory,
+  BatteryPowerHistory,
+  BatterySOCHistory,
+  historyMetrics
+};
+
+struct historySample
+{
+  uint32_t time; // seconds, at the start of the period the sample covers
+  float minimum;
+  float maximum;
+  float average;
+};
+
+// allocate the pyramid, returns false if there is not enough memory (in which case nothing is recorded)
+bool BeginHistoryPyramid(void *(*allocate)(size_t size));
+
+// the number of bytes BeginHistoryPyramid allocates
+size_t HistoryPyramidMemoryRequired();
+
+// the number of seconds the pyramid covers
+uint32_t HistoryPyramidSeconds();
+
+// add the value of each metric for the second given; seconds must not go backwards, and a second already added is ignored
+void AddHistoryPyramidSample(uint32_t time, const float values[historyMetrics]);
+
+// read the period from fromTime up to (but not including) toTime as the number of columns given, each the minimum, maximum and average of
+// the samples in its part of the period (to the nearest bucket); a column without any samples has NAN as its minimum, maximum and average
+// returns the number of seconds each bucket read covers
+uint32_t ReadHistoryColumns(historyMetric metric, uint32_t fromTime, uint32_t toTime, int columns, historySample *samples);
@@ -0,0 +1,431 @@
+#include "json_stream.h"
+#include <string.h>
+
+enum jsonStreamState
+{
+  ExpectValue,
+  ExpectValueOrArrayEnd, // just after '['
+  ExpectKeyOrObjectEnd,  // just after '{'
+  ExpectKey,
+  ExpectColon,
+  AfterValue,
+  InString,
+  InStringEscape,
+  InStringUnicodeEscape,
+  InLiteral,
+  AfterDocument
+};
+
+void BeginJsonStream(jsonStreamFilter &filter, const char *const *filters, int numberOfFilters, jsonStreamValueCallback callback, void *context)
+{
+
+  memset(&filter, 0, sizeof(filter));
+
+  filter.filters = filters;
+  filter.numberOfFilters = numberOfFilters;
+  filter.callback = callback;
+  filter.context = context;
+  filter.state = ExpectValue;
+}
+
+static bool LevelIsArray(const jsonStreamFilter &filter, int level)
+{
+  return (filter.levelIsArray >> (level - 1)) & 1UL;
+}
+
+static void AppendToToken(jsonStreamFilter &filter, char c)
+{
+  if (filter.tokenLength < maximumJsonStreamValueLength)
+    filter.token[filter.tokenLength++] = c;
+}
+
+static void AppendUnicodeCharacter(jsonStreamFilter &filter, uint32_t character)
+{
+
+  // written as UTF-8; surrogate pairs are not combined, each half being replaced by a '?'
+
+  if (character < 0x80UL)
+  {
+    AppendToToken(filter, (char)character);
+  }
+  else if (character < 0x800UL)
+  {
+    AppendToToken(filter, (char)(0xC0 | (character >> 6)));
+    AppendToToken(filter, (char)(0x80 | (character & 0x3F)));
+  }
+  else if ((character >= 0xD800UL) && (character <= 0xDFFFUL))
+  {
+    AppendToToken(filter, '?');
+  }
+  else
+  {
+    AppendToToken(filter, (char)(0xE0 | (character >> 12)));
+    AppendToToken(filter, (char)(0x80 | ((character >> 6) & 0x3F)));
+    AppendToToken(filter, (char)(0x80 | (character & 0x3F)));
+  };
+}
+
+static bool SegmentMatchesLevel(const jsonStreamFilter &filter, const char *segment, size_t segmentLength, int level)
+{
+
+  if (LevelIsArray(filter, level))
+  {
+
+    if ((segmentLength == 1) && (segment[0] == '*'))
+      return true;
+
+    if ((segmentLength == 0) || (segmentLength > 9))
+      return false;
+
+    int index = 0;
+    for (size_t i = 0; i < segmentLength; i++)
+    {
+      if ((segment[i] < '0') || (segment[i] > '9'))
+        return false;
+      index = index * 10 + (segment[i] - '0');
+    };
+
+    return index == filter.arrayIndexes[level - 1];
+  };
+
+  const char *key = filter.keys[level - 1];
+  size_t keyLength = strlen(key);
+
+  return (keyLength <= (size_t)maximumJsonStreamKeyLength) && (keyLength == segmentLength) && (memcmp(key, segment, segmentLength) == 0);
+}
+
+static void PassOnValueIfWanted(jsonStreamFilter &filter, jsonStreamValueType type)
+{
+
+  if ((filter.depth == 0) || (filter.depth > maximumJsonStreamFilterDepth) || (filter.callback == NULL))
+    return;
+
+  filter.token[filter.tokenLength] = '\0';
+
+  for (int i = 0; i < filter.numberOfFilters; i++)
+  {
+
+    const char *segment = filter.filters[i];
+    int level = 1;
+    int wildcardIndexes[maximumJsonStreamWildcards] = {};
+    int wildcards = 0;
+    bool matches = true;
+
+    while (matches)
+    {
+
+      const char *separator = strchr(segment, '/');
+      size_t segmentLength = (separator != NULL) ? (size_t)(separator - segment) : strlen(segment);
+
+      if ((level > filter.depth) || !SegmentMatchesLevel(filter, segment, segmentLength, level))
+      {
+        matches = false;
+        break;
+      };
+
+      if ((segmentLength == 1) && (segment[0] == '*') && (wildcards < maximumJsonStreamWildcards))
+        wildcardIndexes[wildcards++] = filter.arrayIndexes[level - 1];
+
+      if (separator == NULL)
+        break;
+
+      segment = separator + 1;
+      level++;
+    };
+
+    if (matches && (level == filter.depth))
+      filter.callback(filter.context, i, wildcardIndexes, filter.token, type);
+  };
+}
+
+static void EndValue(jsonStreamFilter &filter)
+{
+  filter.state = (filter.depth == 0) ? AfterDocument : AfterValue;
+}
+
+static bool OpenLevel(jsonStreamFilter &filter, bool isArray)
+{
+
+  if (filter.depth >= maximumJsonStreamDepth)
+    return false;
+
+  filter.depth++;
+
+  if (isArray)
+    filter.levelIsArray |= (1UL << (filter.depth - 1));
+  else
+    filter.levelIsArray &= ~(1UL << (filter.depth - 1));
+
+  if (filter.depth <= maximumJsonStreamFilterDepth)
+  {
+    filter.arrayIndexes[filter.depth - 1] = 0;
+    filter.keys[filter.depth - 1][0] = '\0';
+  };
+
+  filter.state = isArray ? ExpectValueOrArrayEnd : ExpectKeyOrObjectEnd;
+
+  return true;
+}
+
+static bool CloseLevel(jsonStreamFilter &filter, bool isArray)
+{
+
+  if ((filter.depth == 0) || (LevelIsArray(filter, filter.depth) != isArray))
+    return false;
+
+  filter.depth--;
+  EndValue(filter);
+
+  return true;
+}
+
+static void StartString(jsonStreamFilter &filter, bool isKey)
+{
+  filter.stringIsKey = isKey;
+  filter.tokenLength = 0;
+  filter.state = InString;
+}
+
+static void EndString(jsonStreamFilter &filter)
+{
+
+  if (filter.stringIsKey)
+  {
+
+    if (filter.depth <= maximumJsonStreamFilterDepth)
+    {
+      // keys longer than maximumJsonStreamKeyLength are kept one character longer than that, so that they match no filter
+      int length = (filter.tokenLength > maximumJsonStreamKeyLength + 1) ? maximumJsonStreamKeyLength + 1 : filter.tokenLength;
+      memcpy(filter.keys[filter.depth - 1], filter.token, length);
+      filter.keys[filter.depth - 1][length] = '\0';
+    };
+
+    filter.state = ExpectColon;
+    return;
+  };
+
+  PassOnValueIfWanted(filter, JsonStreamString);
+  EndValue(filter);
+}
+
+static bool EndLiteral(jsonStreamFilter &filter)
+{
+
+  filter.token[filter.tokenLength] = '\0';
+
+  jsonStreamValueType type;
+
+  if (strcmp(filter.token, "true") == 0)
+    type = JsonStreamTrue;
+  else if (strcmp(filter.token, "false") == 0)
+    type = JsonStreamFalse;
+  else if (strcmp(filter.token, "null") == 0)
+    type = JsonStreamNull;
+  else if ((filter.token[0] == '-') || ((filter.token[0] >= '0') && (filter.token[0] <= '9')))
+    type = JsonStreamNumber;
+  else
+    return false;
+
+  if (type == JsonStreamNumber)
+    for (int i = 0; i < filter.tokenLength; i++)
+      if (strchr("0123456789+-.eE", filter.token[i]) == NULL)
+        return false;
+
+  PassOnValueIfWanted(filter, type);
+  EndValue(filter);
+
+  return true;
+}
+
+static bool IsLiteralCharacter(char c)
+{
+  return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '-') || (c == '+') || (c == '.');
+}
+
+static int HexDigitValue(char c)
+{
+
+  if ((c >= '0') && (c <= '9'))
+    return c - '0';
+  if ((c >= 'a') && (c <= 'f'))
+    return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F'))
+    return c - 'A' + 10;
+
+  return -1;
+}
+
+static bool ReadCharacter(jsonStreamFilter &filter, char c)
+{
+
+  // returns false if the character shows the JSON is not valid
+
+  switch (filter.state)
+  {
+
+  case InString:
+    if (c == '"')
+      EndString(filter);
+    else if (c == '\\')
+      filter.state = InStringEscape;
+    else if ((unsigned char)c < 0x20)
+      return false;
+    else
+      AppendToToken(filter, c);
+    return true;
+
+  case InStringEscape:
+    filter.state = InString;
+    switch (c)
+    {
+    case '"':
+    case '\\':
+    case '/':
+      AppendToToken(filter, c);
+      break;
+    case 'b':
+      AppendToToken(filter, '\b');
+      break;
+    case 'f':
+      AppendToToken(filter, '\f');
+      break;
+    case 'n':
+      AppendToToken(filter, '\n');
+      break;
+    case 'r':
+      AppendToToken(filter, '\r');
+      break;
+    case 't':
+      AppendToToken(filter, '\t');
+      break;
+    case 'u':
+      filter.unicodeCharacter = 0UL;
+      filter.unicodeDigits = 0;
+      filter.state = InStringUnicodeEscape;
+      break;
+    default:
+      return false;
+    };
+    return true;
+
+  case InStringUnicodeEscape:
+  {
+    int digit = HexDigitValue(c);
+    if (digit < 0)
+      return false;
+    filter.unicodeCharacter = (filter.unicodeCharacter << 4) | (uint32_t)digit;
+    if (++filter.unicodeDigits == 4)
+    {
+      AppendUnicodeCharacter(filter, filter.unicodeCharacter);
+      filter.state = InString;
+    };
+    return true;
+  }
+
+  case InLiteral:
+    if (IsLiteralCharacter(c))
+    {
+      AppendToToken(filter, c);
+      return true;
+    };
+    // the character after a literal ends it, and is then read as usual below
+    if (!EndLiteral(filter))
+      return false;
+    break;
+
+  default:
+    break;
+  };
+
+  if ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r'))
+    return true;
+
+  switch (filter.state)
+  {
+
+  case ExpectValueOrArrayEnd:
+    if (c == ']')
+      return CloseLevel(filter, true);
+    // fall through
+
+  case ExpectValue:
+    if (c == '{')
+      return OpenLevel(filter, false);
+    if (c == '[')
+      return OpenLevel(filter, true);
+    if (c == '"')
+    {
+      StartString(filter, false);
+      return true;
+    };
+    if (IsLiteralCharacter(c))
+    {
+      filter.tokenLength = 0;
+      AppendToToken(filter, c);
+      filter.state = InLiteral;
+      return true;
+    };
+    return false;
+
+  case ExpectKeyOrObjectEnd:
+    if (c == '}')
+      return CloseLevel(filter, false);
+    // fall through
+
+  case ExpectKey:
+    if (c != '"')
+      return false;
+    StartString(filter, true);
+    return true;
+
+  case ExpectColon:
+    if (c != ':')
+      return false;
+    filter.state = ExpectValue;
+    return true;
+
+  case AfterValue:
+    if (c == ']')
+      return CloseLevel(filter, true);
+    if (c == '}')
+      return CloseLevel(filter, false);
+    if (c != ',')
+      return false;
+    if (LevelIsArray(filter, filter.depth))
+    {
+      if (filter.depth <= maximumJsonStreamFilterDepth)
+        filter.arrayIndexes[filter.depth - 1]++;
+      filter.state = ExpectValue;
+    }
+    else
+    {
+      filter.state = ExpectKey;
+    };
+    return true;
+
+  default:
+    // anything other than white space after the end of the document
+    return false;
+  };
+}
+
+bool FeedJsonStream(jsonStreamFilter &filter, const char *chunk, size_t length)
+{
+
+  for (size_t i = 0; (i < length) && !filter.error; i++)
+    if (!ReadCharacter(filter, chunk[i]))
+      filter.error = true;
+
+  return !filter.error;
+}
+
+bool FinishJsonStream(jsonStreamFilter &filter)
+{
+
+  // a number at the very end of the document is only known to have ended now
+
+  if (!filter.error && (filter.state == InLiteral) && !EndLiteral(filter))
+    filter.error = true;
+
+  return !filter.error && (filter.state == AfterDocument);
+}
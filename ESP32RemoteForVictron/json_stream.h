@@ -0,0 +1,67 @@
+#pragma once
+
+// Streaming JSON filter
+//
+// reads JSON a chunk at a time, keeping only the path to the value currently being read, and passes on just the values whose path
+// matches one of a list of filters; so unlike a JsonDocument the memory it needs is fixed, however large the payload (for example
+// Venus's system/0/Batteries, which holds an array with an object for each battery)
+//
+// a filter names the keys and array elements leading to a value, separated by '/', where '*' stands for any element of an array,
+// for example "value/*/soc" matches the soc of each object in the array held by value; the index of the element each '*' stood for is
+// passed on with the value
+//
+// values are passed on as text (numbers as written in the JSON, strings without their quotes and with any escapes decoded), cut short
+// if longer than maximumJsonStreamValueLength; objects and arrays themselves are not passed on, only the values within them
+//
+// this does not depend on the Arduino core
+
+#include <stddef.h>
+#include <stdint.h>
+
+const int maximumJsonStreamDepth = 32;        // deeper JSON is reported as an error
+const int maximumJsonStreamFilterDepth = 8;   // values deeper than this are never passed on
+const int maximumJsonStreamKeyLength = 23;    // a key longer than this never matches a filter
+const int maximumJsonStreamValueLength = 47;  // values longer than this are cut short
+const int maximumJsonStreamWildcards = 4;     // '*'s in a filter after this many are not given an index
+
+enum jsonStreamValueType
+{
+  JsonStreamString,
+  JsonStreamNumber,
+  JsonStreamTrue,
+  JsonStreamFalse,
+  JsonStreamNull
+};
+
+// filterIndex is the index of the filter matched, and wildcardIndexes[n] the index of the array element the n'th '*' in it stood for
+typedef void (*jsonStreamValueCallback)(void *context, int filterIndex, const int *wildcardIndexes, const char *value, jsonStreamValueType type);
+
+struct jsonStreamFilter
+{
+  const char *const *filters;
+  int numberOfFilters;
+  jsonStreamValueCallback callback;
+  void *context;
+
+  uint8_t state;
+  bool stringIsKey;
+  bool error;
+  int depth;
+  uint32_t levelIsArray; // bit n set if level n + 1 is an array
+  int arrayIndexes[maximumJsonStreamFilterDepth];
+  char keys[maximumJsonStreamFilterDepth][maximumJsonStreamKeyLength + 2]; // one more than the longest key, so longer ones can be told apart
+
+  char token[maximumJsonStreamValueLength + 1];
+  int tokenLength;
+  uint32_t unicodeCharacter;
+  int unicodeDigits;
+};
+
+// get ready to read a new document
+void BeginJsonStream(jsonStreamFilter &filter, const char *const *filters, int numberOfFilters, jsonStreamValueCallback callback, void *context);
+
+// read the next chunk of the document; returns false once the JSON has been found not to be valid, after which the rest is ignored
+bool FeedJsonStream(jsonStreamFilter &filter, const char *chunk, size_t length);
+
+// returns true if the whole of a valid document has been read
+bool FinishJsonStream(jsonStreamFilter &filter);
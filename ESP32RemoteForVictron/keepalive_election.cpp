@@ -0,0 +1,83 @@
+#include "keepalive_election.h"
+#include <string.h>
+
+static void CopyName(char *destination, const char *source)
+{
+  strncpy(destination, source, maximumKeepAliveElectionNameLength);
+  destination[maximumKeepAliveElectionNameLength] = '\0';
+}
+
+static bool NameMatches(const char *name, const char *otherName)
+{
+  return strncmp(name, otherName, maximumKeepAliveElectionNameLength) == 0;
+}
+
+void BeginKeepAliveElection(keepAliveElection &election, const char *ownName, unsigned long leaseTime)
+{
+
+  memset(&election, 0, sizeof(election));
+
+  CopyName(election.ownName, ownName);
+  election.leaseTime = leaseTime;
+}
+
+void StartKeepAliveElection(keepAliveElection &election, unsigned long now)
+{
+
+  election.leaderName[0] = '\0';
+  election.startedAt = now;
+  election.heartbeatSent = false;
+}
+
+void KeepAliveHeartbeatReceived(keepAliveElection &election, const char *senderName, unsigned long now)
+{
+
+  // this device's own heartbeats come back to it as it is subscribed to the topic they are sent to
+  if (NameMatches(senderName, election.ownName))
+    return;
+
+  // a device with a higher name claiming the lead while this one holds it gives way once it receives this one's next heartbeat
+  if (ThisDeviceLeadsKeepAlives(election, now) && (strncmp(election.ownName, senderName, maximumKeepAliveElectionNameLength) < 0))
+    return;
+
+  CopyName(election.leaderName, senderName);
+  election.lastHeartbeatReceived = now;
+}
+
+void KeepAliveLeaderLeft(keepAliveElection &election, const char *name)
+{
+
+  // only the device being followed matters; any other was not leading, or has already been given way to
+  if (NameMatches(name, election.leaderName))
+    election.leaderName[0] = '\0';
+}
+
+bool ThisDeviceLeadsKeepAlives(const keepAliveElection &election, unsigned long now)
+{
+
+  if (now - election.startedAt < election.leaseTime / 3UL)
+    return false;
+
+  if (election.leaderName[0] == '\0')
+    return true;
+
+  return (now - election.lastHeartbeatReceived >= election.leaseTime);
+}
+
+bool KeepAliveHeartbeatIsDue(keepAliveElection &election, unsigned long now)
+{
+
+  if (!ThisDeviceLeadsKeepAlives(election, now))
+  {
+    election.heartbeatSent = false;
+    return false;
+  };
+
+  if (election.heartbeatSent && (now - election.lastHeartbeatSent < election.leaseTime / 3UL))
+    return false;
+
+  election.lastHeartbeatSent = now;
+  election.heartbeatSent = true;
+
+  return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Keep alive election
+//
+// where several of these devices are used with the same installation, they elect one of themselves to send the periodical keep alive
+// requests rather than each sending its own
+//
+// the device leading the election publishes its name as a retained heartbeat at a third of the lease time, and the others follow it for
+// as long as its heartbeats keep arriving; once none has arrived for the lease time each of them claims the lead by publishing its own
+// heartbeat, and where two claim it at once the one with the lower name keeps it and the other goes back to following
+//
+// a device which stops leading (or stops altogether) clears its retained heartbeat, and where it cannot do so its MQTT will does; once the
+// leader's heartbeat is cleared the others claim the lead straight away rather than waiting for the lease time to pass
+//
+// the times are passed in (in ms, as from millis()) and the heartbeats are sent and received by the caller, so that this does not depend
+// on the Arduino core
+
+#include <stdint.h>
+
+const int maximumKeepAliveElectionNameLength = 31;
+
+struct keepAliveElection
+{
+  char ownName[maximumKeepAliveElectionNameLength + 1];
+  char leaderName[maximumKeepAliveElectionNameLength + 1]; // empty while no other device is known to lead
+
+  unsigned long leaseTime;
+  unsigned long startedAt;
+  unsigned long lastHeartbeatReceived; // from the leader named above
+  unsigned long lastHeartbeatSent;
+  bool heartbeatSent;
+};
+
+// set the election up with this device's name (which must be unique among the devices, for example its MQTT client name)
+void BeginKeepAliveElection(keepAliveElection &election, const char *ownName, unsigned long leaseTime);
+
+// start (or restart, for example after reconnecting) following the election; so that a device does not claim the lead before the
+// retained heartbeat of the current leader has had time to arrive, it does not do so until a third of the lease time has passed
+void StartKeepAliveElection(keepAliveElection &election, unsigned long now);
+
+// pass on a heartbeat received, which holds the name of the device that sent it
+void KeepAliveHeartbeatReceived(keepAliveElection &election, const char *senderName, unsigned long now);
+
+// pass on the clearing of the heartbeat of the device named, which has left the election
+void KeepAliveLeaderLeft(keepAliveElection &election, const char *name);
+
+// true if this device currently leads, and so should send the periodical keep alive requests
+bool ThisDeviceLeadsKeepAlives(const keepAliveElection &election, unsigned long now);
+
+// true if this device leads and its next heartbeat is due, in which case the heartbeat is taken to have been sent
+bool KeepAliveHeartbeatIsDue(keepAliveElection &election, unsigned long now);
@@ -0,0 +1,79 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+static int BucketForValue(uint32_t value)
+{
+
+  // values below four have a bucket each, above that each power of two is split into four equal parts
+  // for example 8 and 9 share a bucket, as do 10 and 11, 12 and 13, and 14 and 15
+
+  if (value < 4UL)
+    return (int)value;
+
+  int powerOfTwo = 31 - __builtin_clz(value);
+  int quarter = (int)((value >> (powerOfTwo - 2)) & 3UL);
+
+  return 4 + (powerOfTwo - 2) * 4 + quarter;
+}
+
+static uint32_t LargestValueInBucket(int bucket)
+{
+
+  if (bucket < 4)
+    return (uint32_t)bucket;
+
+  int powerOfTwo = (bucket - 4) / 4 + 2;
+  int quarter = (bucket - 4) % 4;
+
+  uint64_t smallestValue = (uint64_t)(4 + quarter) << (powerOfTwo - 2);
+  uint64_t largestValue = smallestValue + ((uint64_t)1 << (powerOfTwo - 2)) - 1;
+
+  return (largestValue > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (uint32_t)largestValue;
+}
+
+void ClearLatencyHistogram(latencyHistogram &histogram)
+{
+  memset(&histogram, 0, sizeof(histogram));
+}
+
+void RecordLatency(latencyHistogram &histogram, uint32_t value)
+{
+  histogram.counts[BucketForValue(value)]++;
+  histogram.samples++;
+  histogram.total += value;
+  if (value > histogram.maximum)
+    histogram.maximum = value;
+}
+
+uint32_t LatencyPercentile(const latencyHistogram &histogram, int percent)
+{
+
+  if (histogram.samples == 0UL)
+    return 0UL;
+
+  // the number of samples, rounded up, which must be at or below the value returned
+  uint64_t samplesNeeded = ((uint64_t)histogram.samples * percent + 99) / 100;
+  if (samplesNeeded == 0)
+    samplesNeeded = 1;
+
+  uint64_t samplesSoFar = 0;
+
+  for (int bucket = 0; bucket < latencyHistogramBuckets; bucket++)
+  {
+    samplesSoFar += histogram.counts[bucket];
+    if (samplesSoFar >= samplesNeeded)
+    {
+      uint32_t largestValue = LargestValueInBucket(bucket);
+      return (largestValue < histogram.maximum) ? largestValue : histogram.maximum;
+    };
+  };
+
+  return histogram.maximum;
+}
+
+uint32_t AverageLatency(const latencyHistogram &histogram)
+{
+  if (histogram.samples == 0UL)
+    return 0UL;
+  return (uint32_t)(histogram.total / histogram.samples);
+}
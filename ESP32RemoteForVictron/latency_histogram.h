@@ -0,0 +1,32 @@
+#pragma once
+
+// Latency histograms
+//
+// each histogram counts its samples in buckets which widen as the values get larger (four buckets for each power of two),
+// so timings from a microsecond up to more than an hour can be kept in a fixed amount of memory to within 25% of their value
+//
+// they do not depend on the Arduino core, so they can also be compiled and checked on a desktop computer
+
+#include <stdint.h>
+
+const int latencyHistogramBuckets = 124;
+
+struct latencyHistogram
+{
+  uint32_t counts[latencyHistogramBuckets];
+  uint32_t samples;
+  uint32_t maximum;
+  uint64_t total;
+};
+
+// remove all samples from the histogram
+void ClearLatencyHistogram(latencyHistogram &histogram);
+
+// add a sample to the histogram
+void RecordLatency(latencyHistogram &histogram, uint32_t value);
+
+// the value which percent of the samples do not exceed, taken as the top of the bucket it falls in (but never more than the largest sample)
+uint32_t LatencyPercentile(const latencyHistogram &histogram, int percent);
+
+// the average of the samples
+uint32_t AverageLatency(const latencyHistogram &histogram);
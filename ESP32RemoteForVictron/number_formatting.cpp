@@ -0,0 +1,146 @@
+#include "number_formatting.h"
+#include <stdlib.h>
+#include <math.h>
+#include "general_settings.h"
+
+static const long powersOfTen[] = {1L, 10L, 100L, 1000L, 10000L, 100000L, 1000000L};
+static const int maximumNumberOfDecimalPlaces = 6;
+
+size_t AppendText(char *buffer, size_t bufferSize, size_t length, const char *text)
+{
+  while ((*text != '\0') && (length + 1 < bufferSize))
+    buffer[length++] = *text++;
+  buffer[length] = '\0';
+  return length;
+}
+
+size_t AppendScaledInteger(char *buffer, size_t bufferSize, size_t length, long scaledValue, int numberOfDecimalPlaces, int minimumNumberOfWholeDigits)
+{
+
+  // appends scaledValue / 10^numberOfDecimalPlaces, with exactly numberOfDecimalPlaces digits after the decimal point
+  // for example a scaledValue of -1234 with two decimal places is appended as "-12.34"
+
+  char digits[24];
+  int numberOfDigits = 0;
+
+  bool negative = (scaledValue < 0);
+  unsigned long magnitude = negative ? 0UL - (unsigned long)scaledValue : (unsigned long)scaledValue;
+
+  do
+  {
+    digits[numberOfDigits++] = '0' + (magnitude % 10UL);
+    magnitude /= 10UL;
+  } while ((magnitude > 0UL) || (numberOfDigits < numberOfDecimalPlaces + minimumNumberOfWholeDigits));
+
+  if (negative && (length + 1 < bufferSize))
+    buffer[length++] = '-';
+
+  // if the buffer is too small what fits is kept, so that the text is always the start of the whole value's
+  while ((numberOfDigits > 0) && (length + 1 < bufferSize))
+  {
+    if (numberOfDigits == numberOfDecimalPlaces)
+    {
+      buffer[length++] = '.';
+      if (length + 1 >= bufferSize)
+        break;
+    };
+    buffer[length++] = digits[--numberOfDigits];
+  };
+
+  buffer[length] = '\0';
+  return length;
+}
+
+static long ScaleForDisplay(float value, int numberOfDecimalPlaces)
+{
+
+  // returns value * 10^numberOfDecimalPlaces as a whole number
+  // if GENERAL_SETTINGS_ROUND_NUMBERS is true then it is rounded (halves away from zero), otherwise it is truncated (towards zero)
+
+  // the multiplication is made as a double, in which a float times a power of ten of no more than 10^6 is exact; as a float it would
+  // itself be rounded, for example 9996.3496 (the float nearest 9996.35) times 10 would become 99963.5 and be rounded up
+  double scaledValue = (double)value * (double)powersOfTen[numberOfDecimalPlaces];
+
+  // keep well clear of the limits of a long
+  if (scaledValue > 2.0e9)
+    scaledValue = 2.0e9;
+  else if (scaledValue < -2.0e9)
+    scaledValue = -2.0e9;
+
+  if (GENERAL_SETTINGS_ROUND_NUMBERS)
+    return lround(scaledValue);
+  else
+    return (long)scaledValue;
+}
+
+size_t FormatFixedPoint(char *buffer, size_t bufferSize, float value, int numberOfDecimalPlaces)
+{
+
+  if (numberOfDecimalPlaces < 0)
+    numberOfDecimalPlaces = 0;
+  else if (numberOfDecimalPlaces > maximumNumberOfDecimalPlaces)
+    numberOfDecimalPlaces = maximumNumberOfDecimalPlaces;
+
+  long scaledValue = ScaleForDisplay(value, numberOfDecimalPlaces);
+
+  // avoid showing "-0.0"
+  if (scaledValue == 0L)
+    return AppendScaledInteger(buffer, bufferSize, 0, 0L, numberOfDecimalPlaces);
+
+  return AppendScaledInteger(buffer, bufferSize, 0, scaledValue, numberOfDecimalPlaces);
+}
+
+size_t FormatWatts(char *buffer, size_t bufferSize, long watts)
+{
+  size_t length = AppendScaledInteger(buffer, bufferSize, 0, watts, 0);
+  return AppendText(buffer, bufferSize, length, " W");
+}
+
+size_t FormatKiloWatts(char *buffer, size_t bufferSize, long watts, const char *unit)
+{
+
+  // the conversion is done from whole watts so that the rounding / truncation is exact, for example 1550 W is always 1.6 KW when rounded
+
+  int numberOfDecimalPlaces = GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING;
+  if (numberOfDecimalPlaces < 0)
+    numberOfDecimalPlaces = 0;
+  else if (numberOfDecimalPlaces > 3)
+    numberOfDecimalPlaces = 3;
+
+  long divisor = powersOfTen[3 - numberOfDecimalPlaces];
+  long scaledValue = watts / divisor;
+  long remainder = watts % divisor;
+
+  if (GENERAL_SETTINGS_ROUND_NUMBERS && (2L * labs(remainder) >= divisor))
+    scaledValue += (watts < 0L) ? -1L : 1L;
+
+  size_t length = AppendScaledInteger(buffer, bufferSize, 0, scaledValue, numberOfDecimalPlaces);
+  return AppendText(buffer, bufferSize, length, unit);
+}
+
+size_t FormatDaysHoursMinutes(char *buffer, size_t bufferSize, int n)
+{
+
+  // formatted as "days hours:minutes", with the days left blank if there are none (for example " 5:07" or "2 5:07")
+
+  int day = n / (24 * 3600);
+
+  n = n % (24 * 3600);
+
+  int hour = n / 3600;
+
+  n %= 3600;
+
+  int minutes = n / 60;
+
+  size_t length = 0;
+  buffer[0] = '\0';
+
+  if (day > 0)
+    length = AppendScaledInteger(buffer, bufferSize, length, day, 0);
+
+  length = AppendText(buffer, bufferSize, length, " ");
+  length = AppendScaledInteger(buffer, bufferSize, length, hour, 0);
+  length = AppendText(buffer, bufferSize, length, ":");
+  return AppendScaledInteger(buffer, bufferSize, length, minutes, 0, 2);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Number formatting
+//
+// these functions write into a buffer supplied by the caller and use integer arithmetic only, so that no Strings
+// (and therefore no heap allocations) are needed to format the values shown on the display
+//
+// they do not depend on the Arduino core or on the display, so they can also be compiled and checked on a desktop computer
+//
+// each function returns the length of the text in the buffer, which is always null terminated and truncated if the buffer is too small
+
+#include <stddef.h>
+
+// append text to what is already in the buffer
+size_t AppendText(char *buffer, size_t bufferSize, size_t length, const char *text);
+
+// append scaledValue / 10^numberOfDecimalPlaces, for example a scaledValue of -1234 with two decimal places is appended as "-12.34"
+size_t AppendScaledInteger(char *buffer, size_t bufferSize, size_t length, long scaledValue, int numberOfDecimalPlaces, int minimumNumberOfWholeDigits = 1);
+
+// value with a fixed number of decimal places, rounded or truncated according to GENERAL_SETTINGS_ROUND_NUMBERS
+size_t FormatFixedPoint(char *buffer, size_t bufferSize, float value, int numberOfDecimalPlaces);
+
+// whole watts, for example "250 W"
+size_t FormatWatts(char *buffer, size_t bufferSize, long watts);
+
+// watts shown as kilowatts with GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING decimal places followed by unit, for example "1.6 KW"
+size_t FormatKiloWatts(char *buffer, size_t bufferSize, long watts, const char *unit);
+
+// seconds shown as "days hours:minutes", with the days left blank if there are none (for example " 5:07" or "2 5:07")
+size_t FormatDaysHoursMinutes(char *buffer, size_t bufferSize, int n);
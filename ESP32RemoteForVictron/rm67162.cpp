@@ -2,6 +2,7 @@
 #include "SPI.h"
 #include "Arduino.h"
 #include "driver/spi_master.h"
+#include "trace_recorder.h"
 
 const static lcd_cmd_t rm67162_spi_init[] = {
     {0xFE, {0x00}, 0x01}, // PAGE
@@ -185,6 +186,24 @@ void lcd_setRotation(uint8_t r)
     lcd_send_cmd(TFT_MADCTL, &gbr, 1);
 }
 
+// Vertical scrolling runs along the panel's 536 lines, which is across the screen in landscape
+// the lines are divided into a fixed top area, a scrolling area and a fixed bottom area, which must add up to 536
+void lcd_setScrollArea(uint16_t topFixedLines, uint16_t scrollingLines, uint16_t bottomFixedLines)
+{
+    uint8_t data[6] = {
+        (uint8_t)(topFixedLines >> 8), (uint8_t)topFixedLines,
+        (uint8_t)(scrollingLines >> 8), (uint8_t)scrollingLines,
+        (uint8_t)(bottomFixedLines >> 8), (uint8_t)bottomFixedLines};
+    lcd_send_cmd(0x33, data, 6);
+}
+
+// the frame memory line shown on the first line of the scrolling area
+void lcd_setScrollStart(uint16_t line)
+{
+    uint8_t data[2] = {(uint8_t)(line >> 8), (uint8_t)line};
+    lcd_send_cmd(0x37, data, 2);
+}
+
 void lcd_address_set(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 {
     lcd_cmd_t t[3] = {
@@ -262,7 +281,9 @@ void lcd_PushColors(uint16_t x,
         t.base.length = chunk_size * 16;
 
         // spi_device_queue_trans(spi, (spi_transaction_t *)&t, portMAX_DELAY);
+        TraceEvent(micros(), DisplayChunkEvent, TraceBegin, chunk_size);
         spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
+        TraceEvent(micros(), DisplayChunkEvent, TraceEnd, chunk_size);
         len -= chunk_size;
         p += chunk_size;
     } while (len > 0);
@@ -314,7 +335,9 @@ void lcd_PushColors(uint16_t *data, uint32_t len)
         t.base.length = chunk_size * 16;
 
         // spi_device_queue_trans(spi, (spi_transaction_t *)&t, portMAX_DELAY);
+        TraceEvent(micros(), DisplayChunkEvent, TraceBegin, chunk_size);
         spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
+        TraceEvent(micros(), DisplayChunkEvent, TraceEnd, chunk_size);
         len -= chunk_size;
         p += chunk_size;
     } while (len > 0);
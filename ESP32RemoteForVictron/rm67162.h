@@ -39,6 +39,8 @@ void rm67162_init(void);
 // Set the display window size
 void lcd_address_set(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void lcd_setRotation(uint8_t r);
+void lcd_setScrollArea(uint16_t topFixedLines, uint16_t scrollingLines, uint16_t bottomFixedLines);
+void lcd_setScrollStart(uint16_t line);
 void lcd_DrawPoint(uint16_t x, uint16_t y, uint16_t color);
 void lcd_fill(uint16_t xsta,
               uint16_t ysta,
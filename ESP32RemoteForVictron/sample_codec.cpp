@@ -0,0 +1,206 @@
+#include "sample_codec.h"
+
+// each sample starts with a variable length integer, whose lowest bit says what follows:
+//
+//   0  a sample: the change in the interval (zig-zag encoded) in the other bits, then a bit mask of the values which changed,
+//      then the change in each of those values
+//   1  a run: the number of samples in the other bits, each the same as the one before and at the same interval
+//
+// a run at the end of the buffer is lengthened in place, which may need one more byte
+
+static size_t PutVarint(uint8_t *p, uint32_t value)
+{
+  size_t length = 0;
+  while (value >= 0x80UL)
+  {
+    p[length++] = (uint8_t)(value | 0x80UL);
+    value >>= 7;
+  };
+  p[length++] = (uint8_t)value;
+  return length;
+}
+
+static size_t VarintLength(uint32_t value)
+{
+  size_t length = 1;
+  while (value >= 0x80UL)
+  {
+    value >>= 7;
+    length++;
+  };
+  return length;
+}
+
+static bool GetVarint(const uint8_t *p, size_t available, size_t &position, uint32_t &value)
+{
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7)
+  {
+    if (position >= available)
+      return false;
+    uint8_t byte = p[position++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  };
+  return false;
+}
+
+static uint32_t ZigZag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t UnZigZag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1UL);
+}
+
+static void BeginState(sampleCodecState &state, int numberOfValues, uint32_t startTime)
+{
+  state.numberOfValues = (numberOfValues > sampleCodecMaximumValues) ? sampleCodecMaximumValues : numberOfValues;
+  state.time = startTime;
+  state.interval = 0;
+  for (int i = 0; i < sampleCodecMaximumValues; i++)
+    state.values[i] = 0;
+}
+
+size_t MaximumEncodedSampleSize(int numberOfValues)
+{
+  // the first integer, the bit mask, and five bytes for each value
+  return 5 + 1 + 5 * (size_t)numberOfValues;
+}
+
+int32_t QuantiseSample(float value, float resolution)
+{
+  float steps = value / resolution;
+  return (int32_t)((steps < 0.0f) ? (steps - 0.5f) : (steps + 0.5f));
+}
+
+void BeginSampleEncoder(sampleEncoder &encoder, int numberOfValues, uint32_t startTime)
+{
+  BeginState(encoder.state, numberOfValues, startTime);
+  encoder.runLength = 0;
+  encoder.runPosition = 0;
+}
+
+bool EncodeSample(sampleEncoder &encoder, uint8_t *buffer, size_t bufferSize, size_t &length, uint32_t time, const int32_t *values)
+{
+
+  sampleCodecState &state = encoder.state;
+
+  uint32_t interval = time - state.time;
+
+  uint8_t changed = 0;
+  for (int i = 0; i < state.numberOfValues; i++)
+    if (values[i] != state.values[i])
+      changed |= (uint8_t)(1 << i);
+
+  if ((interval == state.interval) && (changed == 0))
+  {
+
+    // the same as the sample before: start a run, or lengthen the one at the end of the buffer
+
+    if ((encoder.runLength > 0) && (encoder.runPosition + VarintLength((encoder.runLength << 1) | 1UL) == length))
+    {
+      uint32_t token = ((encoder.runLength + 1) << 1) | 1UL;
+      if (encoder.runPosition + VarintLength(token) > bufferSize)
+        return false;
+      length = encoder.runPosition + PutVarint(buffer + encoder.runPosition, token);
+      encoder.runLength++;
+    }
+    else
+    {
+      if (length + 1 > bufferSize)
+        return false;
+      encoder.runPosition = length;
+      encoder.runLength = 1;
+      length += PutVarint(buffer + length, (1UL << 1) | 1UL);
+    };
+
+    state.time = time;
+    return true;
+  };
+
+  uint8_t sample[5 + 1 + 5 * sampleCodecMaximumValues];
+
+  size_t sampleLength = PutVarint(sample, ZigZag((int32_t)(interval - state.interval)) << 1);
+  sample[sampleLength++] = changed;
+  for (int i = 0; i < state.numberOfValues; i++)
+    if (changed & (1 << i))
+      sampleLength += PutVarint(sample + sampleLength, ZigZag(values[i] - state.values[i]));
+
+  if (length + sampleLength > bufferSize)
+    return false;
+
+  for (size_t i = 0; i < sampleLength; i++)
+    buffer[length + i] = sample[i];
+
+  state.time = time;
+  state.interval = interval;
+  for (int i = 0; i < state.numberOfValues; i++)
+    state.values[i] = values[i];
+  length += sampleLength;
+  encoder.runLength = 0;
+
+  return true;
+}
+
+void BeginSampleDecoder(sampleDecoder &decoder, int numberOfValues, uint32_t startTime, const uint8_t *data, size_t length)
+{
+  BeginState(decoder.state, numberOfValues, startTime);
+  decoder.data = data;
+  decoder.length = length;
+  decoder.position = 0;
+  decoder.repeatsToCome = 0;
+}
+
+bool DecodeSample(sampleDecoder &decoder, uint32_t &time, int32_t *values)
+{
+
+  sampleCodecState &state = decoder.state;
+
+  if (decoder.repeatsToCome == 0)
+  {
+
+    uint32_t token;
+    if (!GetVarint(decoder.data, decoder.length, decoder.position, token))
+      return false;
+
+    if (token & 1UL)
+    {
+      decoder.repeatsToCome = token >> 1;
+      if (decoder.repeatsToCome == 0)
+        return false;
+    }
+    else
+    {
+
+      if (decoder.position >= decoder.length)
+        return false;
+      uint8_t changed = decoder.data[decoder.position++];
+
+      state.interval += (uint32_t)UnZigZag(token >> 1);
+
+      for (int i = 0; i < state.numberOfValues; i++)
+        if (changed & (1 << i))
+        {
+          uint32_t change;
+          if (!GetVarint(decoder.data, decoder.length, decoder.position, change))
+            return false;
+          state.values[i] += UnZigZag(change);
+        };
+
+      decoder.repeatsToCome = 1;
+    };
+  };
+
+  decoder.repeatsToCome--;
+
+  state.time += state.interval;
+  time = state.time;
+  for (int i = 0; i < state.numberOfValues; i++)
+    values[i] = state.values[i];
+
+  return true;
+}
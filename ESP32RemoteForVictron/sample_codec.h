@@ -0,0 +1,63 @@
+#pragma once
+
+// Sample codec
+//
+// packs a series of samples, each a time and a few whole number values, into as few bytes as possible:
+//
+//  - values are stored as whole numbers in fixed steps (for example 1 W, or 0.1 % for the state of charge); see QuantiseSample
+//  - a time is stored as the change in the time between samples (so samples taken at a steady interval cost nothing for their time)
+//  - a value is stored as its change since the sample before, zig-zag encoded (so that small falls are small numbers, as are small rises)
+//    as a variable length integer of 7 bits a byte
+//  - values which have not changed (such as solar power at night) are left out, and a run of samples which are the same as the one before
+//    at a steady interval is stored as just the length of the run
+//
+// the samples are added to the end of a buffer supplied by the caller, such as a block of the telemetry log, and read back in order
+// the encoder and decoder each start from a time given by the caller and all values zero, so a buffer can be read without anything before it
+//
+// this does not depend on the Arduino core, and is also used by the desktop tool which reads telemetry logs copied from the device
+
+#include <stdint.h>
+#include <stddef.h>
+
+const int sampleCodecMaximumValues = 7;
+
+struct sampleCodecState
+{
+  int numberOfValues;
+  uint32_t time;
+  uint32_t interval;
+  int32_t values[sampleCodecMaximumValues];
+};
+
+struct sampleEncoder
+{
+  sampleCodecState state;
+  size_t runPosition; // where the length of the run of repeated samples at the end of the buffer starts, if there is one
+  uint32_t runLength;
+};
+
+struct sampleDecoder
+{
+  sampleCodecState state;
+  const uint8_t *data;
+  size_t length;
+  size_t position;
+  uint32_t repeatsToCome;
+};
+
+// the most bytes that adding a sample can take
+size_t MaximumEncodedSampleSize(int numberOfValues);
+
+// value / resolution rounded to the nearest whole number, for example 52.34 % with a resolution of 0.1 % gives 523
+int32_t QuantiseSample(float value, float resolution);
+
+void BeginSampleEncoder(sampleEncoder &encoder, int numberOfValues, uint32_t startTime);
+
+// add a sample to the end of the buffer, updating length (which may stay the same, when a run is lengthened); returns false if the sample does not fit
+// times must not go backwards
+bool EncodeSample(sampleEncoder &encoder, uint8_t *buffer, size_t bufferSize, size_t &length, uint32_t time, const int32_t *values);
+
+void BeginSampleDecoder(sampleDecoder &decoder, int numberOfValues, uint32_t startTime, const uint8_t *data, size_t length);
+
+// read the next sample; returns false at the end of the data (or if the data is not valid)
+bool DecodeSample(sampleDecoder &decoder, uint32_t &time, int32_t *values);
@@ -0,0 +1,115 @@
+#include "status_snapshot.h"
+#include "number_formatting.h"
+#include <math.h>
+
+static size_t AppendMember(char *buffer, size_t bufferSize, size_t length, const char *name)
+{
+  length = AppendText(buffer, bufferSize, length, (length > 1) ? ",\"" : "\"");
+  length = AppendText(buffer, bufferSize, length, name);
+  return AppendText(buffer, bufferSize, length, "\":");
+}
+
+static size_t AppendNumber(char *buffer, size_t bufferSize, size_t length, const char *name, float value, int numberOfDecimalPlaces)
+{
+
+  // JSON has no way to write a value that is not a number
+  if (!isfinite(value))
+    value = 0.0F;
+
+  float scale = (numberOfDecimalPlaces > 0) ? 10.0F : 1.0F;
+
+  length = AppendMember(buffer, bufferSize, length, name);
+  return AppendScaledInteger(buffer, bufferSize, length, lroundf(value * scale), numberOfDecimalPlaces);
+}
+
+static size_t AppendString(char *buffer, size_t bufferSize, size_t length, const char *name, const char *value)
+{
+
+  // the values written are the sketch's own fixed texts, which need no escaping
+
+  length = AppendMember(buffer, bufferSize, length, name);
+  length = AppendText(buffer, bufferSize, length, "\"");
+  length = AppendText(buffer, bufferSize, length, (value != NULL) ? value : "");
+  return AppendText(buffer, bufferSize, length, "\"");
+}
+
+static size_t AppendElement(char *buffer, size_t bufferSize, size_t length, float value, int numberOfDecimalPlaces)
+{
+
+  // an element of the snapshot message, always a whole number (in tenths if it has a decimal place)
+
+  if (!isfinite(value))
+    value = 0.0F;
+
+  float scale = (numberOfDecimalPlaces > 0) ? 10.0F : 1.0F;
+
+  length = AppendText(buffer, bufferSize, length, ",");
+  return AppendScaledInteger(buffer, bufferSize, length, lroundf(value * scale), 0);
+}
+
+size_t FormatStatusJson(char *buffer, size_t bufferSize, const statusSnapshot &status)
+{
+
+  if (bufferSize == 0)
+    return 0;
+
+  size_t length = AppendText(buffer, bufferSize, 0, "{");
+
+  length = AppendMember(buffer, bufferSize, length, "uptime");
+  length = AppendScaledInteger(buffer, bufferSize, length, (long)status.uptimeSeconds, 0);
+  length = AppendMember(buffer, bufferSize, length, "current");
+  length = AppendText(buffer, bufferSize, length, status.current ? "true" : "false");
+
+  length = AppendNumber(buffer, bufferSize, length, "gridL1", status.gridInL1Watts, 0);
+  length = AppendNumber(buffer, bufferSize, length, "gridL2", status.gridInL2Watts, 0);
+  length = AppendNumber(buffer, bufferSize, length, "gridL3", status.gridInL3Watts, 0);
+  length = AppendNumber(buffer, bufferSize, length, "solar", status.solarWatts, 0);
+  length = AppendNumber(buffer, bufferSize, length, "batterySOC", status.batterySOC, 1);
+  length = AppendNumber(buffer, bufferSize, length, "batteryTTG", status.batteryTTG, 0);
+  length = AppendNumber(buffer, bufferSize, length, "batteryPower", status.batteryPower, 0);
+  length = AppendNumber(buffer, bufferSize, length, "batteryTemperature", status.batteryTemperature, 1);
+  length = AppendNumber(buffer, bufferSize, length, "ACOutL1", status.ACOutL1Watts, 0);
+  length = AppendNumber(buffer, bufferSize, length, "ACOutL2", status.ACOutL2Watts, 0);
+  length = AppendNumber(buffer, bufferSize, length, "ACOutL3", status.ACOutL3Watts, 0);
+  length = AppendString(buffer, bufferSize, length, "chargingState", status.chargingState);
+  length = AppendString(buffer, bufferSize, length, "multiplusMode", status.multiplusMode);
+
+  return AppendText(buffer, bufferSize, length, "}");
+}
+
+size_t FormatStatusSnapshotMessage(char *buffer, size_t bufferSize, const statusSnapshot &status, uint32_t sequenceNumber)
+{
+
+  // [version, sequence number, stale values (a bit for each), grid L1, grid L2, grid L3, solar, battery SOC (tenths), battery TTG, battery power,
+  //  battery temperature (tenths), AC out L1, AC out L2, AC out L3, "charging state", "multiplus mode"]
+  // the sequence number makes each message different, so that a sibling never takes one for a repeat of the one before
+
+  if (bufferSize == 0)
+    return 0;
+
+  size_t length = AppendText(buffer, bufferSize, 0, "[");
+  length = AppendScaledInteger(buffer, bufferSize, length, statusSnapshotMessageVersion, 0);
+  length = AppendText(buffer, bufferSize, length, ",");
+  length = AppendScaledInteger(buffer, bufferSize, length, (long)(sequenceNumber & 0x7FFFFFFFUL), 0);
+  length = AppendText(buffer, bufferSize, length, ",");
+  length = AppendScaledInteger(buffer, bufferSize, length, (long)(status.staleValues & 0x7FFFFFFFUL), 0);
+
+  length = AppendElement(buffer, bufferSize, length, status.gridInL1Watts, 0);
+  length = AppendElement(buffer, bufferSize, length, status.gridInL2Watts, 0);
+  length = AppendElement(buffer, bufferSize, length, status.gridInL3Watts, 0);
+  length = AppendElement(buffer, bufferSize, length, status.solarWatts, 0);
+  length = AppendElement(buffer, bufferSize, length, status.batterySOC, 1);
+  length = AppendElement(buffer, bufferSize, length, status.batteryTTG, 0);
+  length = AppendElement(buffer, bufferSize, length, status.batteryPower, 0);
+  length = AppendElement(buffer, bufferSize, length, status.batteryTemperature, 1);
+  length = AppendElement(buffer, bufferSize, length, status.ACOutL1Watts, 0);
+  length = AppendElement(buffer, bufferSize, length, status.ACOutL2Watts, 0);
+  length = AppendElement(buffer, bufferSize, length, status.ACOutL3Watts, 0);
+
+  length = AppendText(buffer, bufferSize, length, ",\"");
+  length = AppendText(buffer, bufferSize, length, (status.chargingState != NULL) ? status.chargingState : "");
+  length = AppendText(buffer, bufferSize, length, "\",\"");
+  length = AppendText(buffer, bufferSize, length, (status.multiplusMode != NULL) ? status.multiplusMode : "");
+
+  return AppendText(buffer, bufferSize, length, "\"]");
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Status snapshot
+//
+// the values shown on the display, gathered into one fixed structure so that they can be passed on to other systems (for example by
+// the HTTP server's /status.json) in one piece
+//
+// FormatStatusJson writes the snapshot as JSON straight into a buffer supplied by the caller, using integer arithmetic only, so that no
+// Strings (and therefore no heap allocations) are needed; power is given in whole watts, the state of charge and temperature to a tenth
+//
+// FormatStatusSnapshotMessage writes the same values in a more compact form, for a gateway to publish to its siblings over MQTT:
+// a JSON array with the message version first, then a sequence number, then which values are stale, then the values in a fixed order
+// (see the .cpp file), so that a sibling can show as stale exactly the values the gateway has stale
+// the state of charge and temperature are sent in tenths, so every number in the message is a whole number
+//
+// this does not depend on the Arduino core
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct statusSnapshot
+{
+  uint32_t uptimeSeconds;
+  bool current;          // true if every value has been received and none is stale
+  uint32_t staleValues;  // a bit for each value that is not current, numbered as the sketch's data points (all of them until every value has been received)
+
+  float gridInL1Watts;
+  float gridInL2Watts;
+  float gridInL3Watts;
+
+  float solarWatts;
+
+  float batterySOC;         // percent
+  float batteryTTG;         // seconds, zero if the battery is not discharging
+  float batteryPower;       // watts, positive while charging
+  float batteryTemperature; // degrees Celsius
+
+  float ACOutL1Watts;
+  float ACOutL2Watts;
+  float ACOutL3Watts;
+
+  const char *chargingState;
+  const char *multiplusMode;
+};
+
+// the largest JSON FormatStatusJson writes (including the terminating null)
+const size_t maximumStatusJsonLength = 512;
+
+const int statusSnapshotMessageVersion = 2;
+
+// the largest message FormatStatusSnapshotMessage writes (including the terminating null)
+const size_t maximumStatusSnapshotMessageLength = 192;
+
+// these return the length of the text, which is always null terminated and truncated if the buffer is too small
+size_t FormatStatusJson(char *buffer, size_t bufferSize, const statusSnapshot &status);
+size_t FormatStatusSnapshotMessage(char *buffer, size_t bufferSize, const statusSnapshot &status, uint32_t sequenceNumber);
@@ -0,0 +1,478 @@
+#include "telemetry_log.h"
+#include "sample_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// each flush appends a chunk to the file (all numbers little endian):
+//
+//    0  4 bytes  chunkMarker
+//    4  4 bytes  minute of the first record
+//    8  2 bytes  number of records
+//   10  2 bytes  number of bytes of records
+//   12           the records, packed by the sample codec (see sample_codec.h) starting from the minute of the first record
+//        4 bytes  CRC-32 of everything before it
+//
+// the chunks are packed into blocks of telemetryLogBlockSize bytes, a chunk never crossing from one block into the next, so that each
+// block starts with a chunk; what is left at the end of a block when the next chunk does not fit is never written, and whatever it holds
+// is not read, as the chunks of a block are read from its start until one is not valid
+
+static const uint32_t chunkMarker = 0x344C5456UL; // "VTL4"
+static const size_t chunkHeaderSize = 12;
+static const size_t chunkFooterSize = 4;
+static const size_t chunkRecordsCapacity = telemetryLogBlockSize - chunkHeaderSize - chunkFooterSize;
+static const int maximumLogFiles = 64;
+static const size_t maximumFileNameLength = 16;
+
+static char logDirectory[64];
+static bool logAvailable = false;
+
+// where the next chunk is written: the block of the newest file, and the bytes of it already written
+
+static char currentFileName[maximumFileNameLength] = "";
+static uint32_t currentBlockIndex = 0;
+static size_t currentBlockUsed = 0;
+
+// the records added since the last flush, which make up the next chunk
+
+static uint8_t pendingChunk[telemetryLogBlockSize];
+static uint16_t pendingRecords = 0;
+static size_t pendingLength = 0;
+static uint32_t pendingFirstMinute = 0;
+static sampleEncoder pendingEncoder;
+
+static bool anyRecordLogged = false;
+static telemetryRecord lastRecordLogged;
+
+static void Put16(uint8_t *p, uint16_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void Put32(uint8_t *p, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t Get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t CRC32(const uint8_t *data, size_t length)
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+  };
+  return ~crc;
+}
+
+static size_t ChunkSize(const uint8_t *chunk, size_t available)
+{
+
+  // the size of the chunk at the start of what is available, or 0 if there is not a whole, valid, chunk there
+
+  if ((available < chunkHeaderSize + chunkFooterSize) || (Get32(chunk) != chunkMarker))
+    return 0;
+
+  size_t length = Get16(chunk + 10);
+  if (length > available - chunkHeaderSize - chunkFooterSize)
+    return 0;
+
+  if (Get32(chunk + chunkHeaderSize + length) != CRC32(chunk, chunkHeaderSize + length))
+    return 0;
+
+  return chunkHeaderSize + length + chunkFooterSize;
+}
+
+static void ForEachRecordInChunk(const uint8_t *chunk, void (*callback)(const telemetryRecord &record, void *context), void *context)
+{
+  sampleDecoder decoder;
+  BeginSampleDecoder(decoder, telemetryValues, Get32(chunk + 4), chunk + chunkHeaderSize, Get16(chunk + 10));
+
+  telemetryRecord record;
+  while (DecodeSample(decoder, record.minute, record.values))
+    callback(record, context);
+}
+
+static void MakePath(char *path, size_t size, const char *fileName)
+{
+  snprintf(path, size, "%.63s/%.15s", logDirectory, fileName);
+}
+
+static void FileNameForMinute(uint32_t minute, char *fileName)
+{
+  time_t seconds = (time_t)minute * 60;
+  struct tm date;
+  gmtime_r(&seconds, &date);
+  snprintf(fileName, maximumFileNameLength, "%04u%02u.log", (unsigned)(date.tm_year + 1900) % 10000U, (unsigned)(date.tm_mon + 1) % 100U);
+}
+
+static bool IsLogFileName(const char *name)
+{
+  // six digits followed by .log
+  if (strlen(name) != 10 || strcmp(name + 6, ".log") != 0)
+    return false;
+  for (int i = 0; i < 6; i++)
+    if (name[i] < '0' || name[i] > '9')
+      return false;
+  return true;
+}
+
+static int CompareFileNames(const void *a, const void *b)
+{
+  return strcmp((const char *)a, (const char *)b);
+}
+
+static int ListLogFiles(char names[][maximumFileNameLength])
+{
+
+  // lists the log files in time order (which, given how they are named, is also alphabetical order)
+
+  int count = 0;
+
+  DIR *directory = opendir(logDirectory);
+  if (directory == NULL)
+    return 0;
+
+  struct dirent *entry;
+  while (((entry = readdir(directory)) != NULL) && (count < maximumLogFiles))
+    if (IsLogFileName(entry->d_name))
+      strcpy(names[count++], entry->d_name);
+
+  closedir(directory);
+
+  qsort(names, count, maximumFileNameLength, CompareFileNames);
+  return count;
+}
+
+static long FileSize(FILE *file)
+{
+  if (fseek(file, 0, SEEK_END) != 0)
+    return 0;
+  long size = ftell(file);
+  return (size > 0) ? size : 0;
+}
+
+static uint32_t BlocksInFile(long size)
+{
+  // the last block may be only partly written
+  return (uint32_t)((size + (long)telemetryLogBlockSize - 1) / (long)telemetryLogBlockSize);
+}
+
+static size_t ReadBlock(FILE *file, long size, uint32_t index, uint8_t *block, size_t length)
+{
+
+  // read up to length bytes from the start of a block, returning the number read (fewer for the last block, if it is only partly written)
+
+  long at = (long)index * (long)telemetryLogBlockSize;
+  if ((at >= size) || (fseek(file, at, SEEK_SET) != 0))
+    return 0;
+
+  if ((long)length > size - at)
+    length = (size_t)(size - at);
+
+  return fread(block, 1, length, file);
+}
+
+static void KeepLastRecord(const telemetryRecord &record, void *context)
+{
+  (void)context;
+  lastRecordLogged = record;
+  anyRecordLogged = true;
+}
+
+static size_t ReadLastRecordInBlock(const uint8_t *block, size_t length)
+{
+
+  // find the last record in a block, returning the number of bytes of it taken by valid chunks, after which the next chunk goes
+
+  size_t used = 0;
+  size_t size;
+  while ((size = ChunkSize(block + used, length - used)) > 0)
+  {
+    ForEachRecordInChunk(block + used, KeepLastRecord, NULL);
+    used += size;
+  };
+  return used;
+}
+
+bool BeginTelemetryLog(const char *directory)
+{
+
+  snprintf(logDirectory, sizeof(logDirectory), "%s", directory);
+
+  mkdir(logDirectory, 0777);
+
+  DIR *check = opendir(logDirectory);
+  if (check == NULL)
+    return false;
+  closedir(check);
+
+  logAvailable = true;
+
+  currentFileName[0] = '\0';
+  currentBlockIndex = 0;
+  currentBlockUsed = 0;
+  pendingRecords = 0;
+  pendingLength = 0;
+  anyRecordLogged = false;
+
+  // carry on after the last valid chunk of the newest file; a chunk which was only partly written when the power went off is written over
+
+  static char names[maximumLogFiles][maximumFileNameLength];
+  int files = ListLogFiles(names);
+  if (files == 0)
+    return true;
+
+  strcpy(currentFileName, names[files - 1]);
+
+  char path[96];
+  MakePath(path, sizeof(path), currentFileName);
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return true;
+
+  static uint8_t block[telemetryLogBlockSize];
+
+  long size = FileSize(file);
+  uint32_t blocks = BlocksInFile(size);
+
+  currentBlockIndex = (blocks > 0) ? blocks - 1 : 0;
+  currentBlockUsed = ReadLastRecordInBlock(block, ReadBlock(file, size, currentBlockIndex, block, telemetryLogBlockSize));
+
+  // if nothing in the last block could be read, the last record is in the block before it
+
+  if (!anyRecordLogged && (currentBlockIndex > 0))
+    ReadLastRecordInBlock(block, ReadBlock(file, size, currentBlockIndex - 1, block, telemetryLogBlockSize));
+
+  fclose(file);
+  return true;
+}
+
+bool FlushTelemetryLog()
+{
+
+  if (!logAvailable || (pendingRecords == 0))
+    return true;
+
+  Put32(pendingChunk, chunkMarker);
+  Put32(pendingChunk + 4, pendingFirstMinute);
+  Put16(pendingChunk + 8, pendingRecords);
+  Put16(pendingChunk + 10, (uint16_t)pendingLength);
+  Put32(pendingChunk + chunkHeaderSize + pendingLength, CRC32(pendingChunk, chunkHeaderSize + pendingLength));
+
+  size_t size = chunkHeaderSize + pendingLength + chunkFooterSize;
+
+  char path[96];
+  MakePath(path, sizeof(path), currentFileName);
+
+  FILE *file = fopen(path, "r+b");
+  if (file == NULL)
+    file = fopen(path, "wb");
+  if (file == NULL)
+    return false;
+
+  // only ever written after the chunks already in the file, so a write cut short by the power going off can lose only this chunk
+
+  bool written = (fseek(file, (long)currentBlockIndex * (long)telemetryLogBlockSize + (long)currentBlockUsed, SEEK_SET) == 0) &&
+                 (fwrite(pendingChunk, 1, size, file) == size);
+
+  fclose(file);
+
+  if (written)
+  {
+    currentBlockUsed += size;
+    pendingRecords = 0;
+    pendingLength = 0;
+  };
+
+  return written;
+}
+
+void AppendTelemetryRecord(const telemetryRecord &record)
+{
+
+  if (!logAvailable)
+    return;
+
+  if (anyRecordLogged && (record.minute <= lastRecordLogged.minute))
+    return;
+
+  // a new month starts a new file
+
+  char fileName[maximumFileNameLength];
+  FileNameForMinute(record.minute, fileName);
+
+  if (strcmp(fileName, currentFileName) != 0)
+  {
+
+    FlushTelemetryLog();
+    strcpy(currentFileName, fileName);
+
+    uint32_t blocks = 0;
+    char path[96];
+    MakePath(path, sizeof(path), currentFileName);
+    FILE *file = fopen(path, "rb");
+    if (file != NULL)
+    {
+      blocks = BlocksInFile(FileSize(file));
+      fclose(file);
+    };
+
+    currentBlockIndex = blocks;
+    currentBlockUsed = 0;
+  };
+
+  if (pendingRecords == 0)
+  {
+    pendingFirstMinute = record.minute;
+    BeginSampleEncoder(pendingEncoder, telemetryValues, record.minute);
+  };
+
+  size_t space = telemetryLogBlockSize - currentBlockUsed;
+  size_t capacity = (space > chunkHeaderSize + chunkFooterSize) ? space - chunkHeaderSize - chunkFooterSize : 0;
+
+  if (!EncodeSample(pendingEncoder, pendingChunk + chunkHeaderSize, capacity, pendingLength, record.minute, record.values))
+  {
+
+    // the rest of the block is full, so what there is is written and the next chunk starts the next block
+    FlushTelemetryLog();
+    currentBlockIndex++;
+    currentBlockUsed = 0;
+
+    pendingFirstMinute = record.minute;
+    BeginSampleEncoder(pendingEncoder, telemetryValues, record.minute);
+    pendingLength = 0;
+    pendingRecords = 0;
+    EncodeSample(pendingEncoder, pendingChunk + chunkHeaderSize, chunkRecordsCapacity, pendingLength, record.minute, record.values);
+  };
+
+  pendingRecords++;
+
+  lastRecordLogged = record;
+  anyRecordLogged = true;
+}
+
+bool DeleteOldestTelemetryLogFile()
+{
+
+  static char names[maximumLogFiles][maximumFileNameLength];
+  int files = ListLogFiles(names);
+
+  if ((files == 0) || (strcmp(names[0], currentFileName) == 0))
+    return false;
+
+  char path[96];
+  MakePath(path, sizeof(path), names[0]);
+  return remove(path) == 0;
+}
+
+struct telemetryReadRequest
+{
+  uint32_t fromMinute;
+  uint32_t toMinute;
+  void (*callback)(const telemetryRecord &record, void *context);
+  void *context;
+  size_t recordsFound;
+};
+
+static void PassOnRecordInRange(const telemetryRecord &record, void *context)
+{
+  telemetryReadRequest &request = *(telemetryReadRequest *)context;
+  if ((record.minute >= request.fromMinute) && (record.minute <= request.toMinute))
+  {
+    request.callback(record, request.context);
+    request.recordsFound++;
+  };
+}
+
+size_t ReadTelemetryLog(uint32_t fromMinute, uint32_t toMinute, void (*callback)(const telemetryRecord &record, void *context), void *context)
+{
+
+  if (!logAvailable)
+    return 0;
+
+  telemetryReadRequest request = {fromMinute, toMinute, callback, context, 0};
+
+  static char names[maximumLogFiles][maximumFileNameLength];
+  static uint8_t block[telemetryLogBlockSize];
+
+  bool pastTheRange = false;
+
+  int files = ListLogFiles(names);
+
+  for (int f = 0; (f < files) && !pastTheRange; f++)
+  {
+
+    char path[96];
+    MakePath(path, sizeof(path), names[f]);
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+      continue;
+
+    long size = FileSize(file);
+    uint32_t blocks = BlocksInFile(size);
+
+    // find the first block whose first chunk starts after the start of the range, reading only the first few bytes of each block looked
+    // at; the range's first records are in the block before it
+
+    uint32_t low = 0;
+    uint32_t high = blocks;
+    while (low < high)
+    {
+      uint32_t middle = (low + high) / 2;
+      if ((ReadBlock(file, size, middle, block, chunkHeaderSize) == chunkHeaderSize) && (Get32(block) == chunkMarker) && (Get32(block + 4) > fromMinute))
+        high = middle;
+      else
+        low = middle + 1;
+    };
+
+    // then read the blocks one at a time, and the chunks of each in turn, until one starts after the end of the range
+
+    for (uint32_t b = (low > 0) ? low - 1 : 0; (b < blocks) && !pastTheRange; b++)
+    {
+
+      size_t length = ReadBlock(file, size, b, block, telemetryLogBlockSize);
+      size_t at = 0;
+      size_t chunkSize;
+
+      while (((chunkSize = ChunkSize(block + at, length - at)) > 0) && !pastTheRange)
+      {
+        pastTheRange = (Get32(block + at + 4) > toMinute);
+        if (!pastTheRange)
+          ForEachRecordInChunk(block + at, PassOnRecordInRange, &request);
+        at += chunkSize;
+      };
+    };
+
+    fclose(file);
+  };
+
+  // and the records not yet written, which are the newest
+
+  if (!pastTheRange && (pendingRecords > 0) && (pendingFirstMinute <= toMinute))
+  {
+    Put32(pendingChunk + 4, pendingFirstMinute);
+    Put16(pendingChunk + 10, (uint16_t)pendingLength);
+    ForEachRecordInChunk(pendingChunk, PassOnRecordInRange, &request);
+  };
+
+  return request.recordsFound;
+}
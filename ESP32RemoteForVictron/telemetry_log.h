@@ -0,0 +1,57 @@
+#pragma once
+
+// Telemetry log
+//
+// keeps one record a minute in files on the flash file system, one file per month (for example 202610.log for October 2026),
+// so that months of history survive a restart
+//
+// records are added to a chunk held in memory, which is only written to flash when FlushTelemetryLog is called; each flush appends its
+// chunk to the file after those already written, and nothing written is ever written over, so a flush cut short by the power going off
+// can lose only the records of that flush
+//
+// each chunk holds its records packed by the sample codec (see sample_codec.h, a typical record takes around 6 bytes rather than 28),
+// and ends with a CRC so that a chunk which was only partly written is recognised and not read
+//
+// the chunks are packed into fixed size blocks, none crossing from one block into the next, so each block starts with a chunk, which
+// starts with the time of its first record; so the blocks of a file act as its own index: the block holding a given time is found by a
+// binary search which reads only the first few bytes of each block it looks at
+
+// the files are read and written with the standard C library, so this works on any file system mounted in the ESP32's virtual file system
+// (such as FFat, which is mounted at /ffat) and also on a desktop computer
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum telemetryValue
+{
+  SolarTelemetry,              // watts
+  GridTelemetry,               // watts
+  ACLoadTelemetry,             // watts
+  BatteryPowerTelemetry,       // watts
+  BatterySOCTelemetry,         // tenths of a percent
+  BatteryTemperatureTelemetry, // tenths of a degree Celsius
+  telemetryValues
+};
+
+struct telemetryRecord
+{
+  uint32_t minute; // minutes since 1 January 1970 (UTC)
+  int32_t values[telemetryValues];
+};
+
+const size_t telemetryLogBlockSize = 4096;
+
+// use the directory given for the log files, creating it if need be, and carry on after the last chunk written; returns false if the directory cannot be used
+bool BeginTelemetryLog(const char *directory);
+
+// add a record to the chunk in memory; records must be added in time order, and one for a minute already logged is ignored
+void AppendTelemetryRecord(const telemetryRecord &record);
+
+// append the chunk in memory to the file, if anything has been added to it; returns false if it could not be written
+bool FlushTelemetryLog();
+
+// delete the oldest file (but never the one being added to); returns false if there was no file which could be deleted
+bool DeleteOldestTelemetryLogFile();
+
+// call back for each record from fromMinute to toMinute inclusive, reading one block at a time (and the records not yet written); returns the number of records found
+size_t ReadTelemetryLog(uint32_t fromMinute, uint32_t toMinute, void (*callback)(const telemetryRecord &record, void *context), void *context);
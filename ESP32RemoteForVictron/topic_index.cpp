@@ -0,0 +1,389 @@
+#include "topic_index.h"
+#include <string.h>
+
+static const int childSlots = 16384;         // a power of two, twice maximumTopicIndexNodes so that probes stay short
+static const int levelSlots = 8192;          // a power of two
+static const int maximumLevels = levelSlots * 3 / 4;
+
+struct topicIndexNode
+{
+  int16_t parent; // -1 for the first level of a topic
+  int16_t value;  // index into values, or -1 if the latest value has not been kept
+  uint32_t name;  // offset into levelText of the interned name of the level, held as a length byte followed by the text
+  uint16_t updates;
+  bool isTopic; // false for a level above a topic which has not itself been received
+};
+
+struct topicIndexValue
+{
+  int16_t topic;
+  int16_t newer; // the values are linked from the most to the least recently updated
+  int16_t older;
+  char text[maximumTopicIndexValueLength + 1];
+};
+
+static topicIndexNode *nodes = NULL;
+static int16_t *children = NULL;   // the node for each parent and level name, or -1 if the slot is empty
+static uint32_t *levels = NULL;    // one more than the offset into levelText of each interned level name, or 0 if the slot is empty
+static char *levelText = NULL;
+static topicIndexValue *values = NULL;
+static int16_t *nameOrder = NULL;
+
+static int numberOfNodes = 0;
+static int numberOfLevels = 0;
+static size_t levelTextUsed = 0;
+static int numberOfTopics = 0;
+static int valuesInUse = 0;
+static int newestValue = -1;
+static int oldestValue = -1;
+static unsigned long valuesTooDeep = 0;
+static unsigned long valuesNotKept = 0;
+
+size_t TopicIndexMemoryRequired()
+{
+  return sizeof(topicIndexNode) * maximumTopicIndexNodes + sizeof(int16_t) * childSlots + sizeof(uint32_t) * levelSlots + topicIndexLevelTextBytes +
+         sizeof(topicIndexValue) * maximumTopicIndexValues + sizeof(int16_t) * maximumTopicIndexNodes;
+}
+
+bool BeginTopicIndex(void *(*allocate)(size_t size))
+{
+
+  uint8_t *memory = (uint8_t *)allocate(TopicIndexMemoryRequired());
+  if (memory == NULL)
+    return false;
+
+  nodes = (topicIndexNode *)memory;
+  memory += sizeof(topicIndexNode) * maximumTopicIndexNodes;
+  children = (int16_t *)memory;
+  memory += sizeof(int16_t) * childSlots;
+  levels = (uint32_t *)memory;
+  memory += sizeof(uint32_t) * levelSlots;
+  levelText = (char *)memory;
+  memory += topicIndexLevelTextBytes;
+  values = (topicIndexValue *)memory;
+  memory += sizeof(topicIndexValue) * maximumTopicIndexValues;
+  nameOrder = (int16_t *)memory;
+
+  ClearTopicIndex();
+
+  return true;
+}
+
+void ClearTopicIndex()
+{
+
+  if (nodes == NULL)
+    return;
+
+  memset(children, 0xFF, sizeof(int16_t) * childSlots);
+  memset(levels, 0, sizeof(uint32_t) * levelSlots);
+
+  numberOfNodes = 0;
+  numberOfLevels = 0;
+  levelTextUsed = 0;
+  numberOfTopics = 0;
+  valuesInUse = 0;
+  newestValue = -1;
+  oldestValue = -1;
+  valuesTooDeep = 0;
+  valuesNotKept = 0;
+}
+
+static uint32_t HashText(const char *text, size_t length)
+{
+
+  // FNV-1a
+
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ (uint8_t)text[i]) * 16777619UL;
+
+  return hash;
+}
+
+static int64_t InternLevel(const char *text, size_t length)
+{
+
+  // returns the offset of the level name in levelText, adding it if it is not already there, or -1 if there is no room
+
+  if (length > 255)
+    length = 255;
+
+  uint32_t slot = HashText(text, length) & (levelSlots - 1);
+
+  while (levels[slot] != 0)
+  {
+    uint32_t offset = levels[slot] - 1;
+    if (((uint8_t)levelText[offset] == length) && (memcmp(&levelText[offset + 1], text, length) == 0))
+      return offset;
+    slot = (slot + 1) & (levelSlots - 1);
+  };
+
+  if ((numberOfLevels >= maximumLevels) || (levelTextUsed + 1 + length > topicIndexLevelTextBytes))
+    return -1;
+
+  uint32_t offset = (uint32_t)levelTextUsed;
+  levelText[offset] = (char)length;
+  memcpy(&levelText[offset + 1], text, length);
+  levelTextUsed += 1 + length;
+
+  levels[slot] = offset + 1;
+  numberOfLevels++;
+
+  return offset;
+}
+
+static int FindOrAddNode(int parent, uint32_t name)
+{
+
+  // as the level names are interned, a node is found by comparing numbers only
+
+  uint32_t slot = ((uint32_t)(parent + 1) * 2654435761U ^ name * 40503U) & (childSlots - 1);
+
+  while (children[slot] >= 0)
+  {
+    const topicIndexNode &node = nodes[children[slot]];
+    if ((node.parent == parent) && (node.name == name))
+      return children[slot];
+    slot = (slot + 1) & (childSlots - 1);
+  };
+
+  if (numberOfNodes >= maximumTopicIndexNodes)
+    return -1;
+
+  topicIndexNode &node = nodes[numberOfNodes];
+  node.parent = (int16_t)parent;
+  node.value = -1;
+  node.name = name;
+  node.updates = 0;
+  node.isTopic = false;
+
+  children[slot] = (int16_t)numberOfNodes;
+
+  return numberOfNodes++;
+}
+
+size_t TopicIndexName(int topic, char *buffer, size_t bufferSize)
+{
+
+  if (bufferSize == 0)
+    return 0;
+
+  int path[maximumTopicIndexDepth];
+  int depth = 0;
+
+  for (int node = topic; (node >= 0) && (depth < maximumTopicIndexDepth); node = nodes[node].parent)
+    path[depth++] = node;
+
+  size_t length = 0;
+
+  while (depth > 0)
+  {
+
+    const char *name = &levelText[nodes[path[--depth]].name];
+    size_t nameLength = (uint8_t)name[0];
+
+    if ((length > 0) && (length < bufferSize - 1))
+      buffer[length++] = '/';
+
+    size_t room = bufferSize - 1 - length;
+    if (nameLength > room)
+      nameLength = room;
+
+    memcpy(&buffer[length], name + 1, nameLength);
+    length += nameLength;
+  };
+
+  buffer[length] = '\0';
+
+  return length;
+}
+
+static void AddToNameOrder(int topic)
+{
+
+  // new topics are rare once the first of each has been received, so a binary search and a move of the topics after it is enough
+
+  char name[maximumTopicIndexNameLength + 1];
+  char otherName[maximumTopicIndexNameLength + 1];
+
+  TopicIndexName(topic, name, sizeof(name));
+
+  int low = 0;
+  int high = numberOfTopics;
+
+  while (low < high)
+  {
+    int middle = (low + high) / 2;
+    TopicIndexName(nameOrder[middle], otherName, sizeof(otherName));
+    if (strcmp(otherName, name) < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  };
+
+  memmove(&nameOrder[low + 1], &nameOrder[low], sizeof(int16_t) * (numberOfTopics - low));
+  nameOrder[low] = (int16_t)topic;
+  numberOfTopics++;
+}
+
+static void UnlinkValue(int value)
+{
+
+  topicIndexValue &slot = values[value];
+
+  if (slot.newer >= 0)
+    values[slot.newer].older = slot.older;
+  else
+    newestValue = slot.older;
+
+  if (slot.older >= 0)
+    values[slot.older].newer = slot.newer;
+  else
+    oldestValue = slot.newer;
+}
+
+static void LinkValueAsNewest(int value)
+{
+
+  values[value].newer = -1;
+  values[value].older = (int16_t)newestValue;
+
+  if (newestValue >= 0)
+    values[newestValue].newer = (int16_t)value;
+  else
+    oldestValue = value;
+
+  newestValue = value;
+}
+
+int RecordTopicValue(const char *topic, size_t topicLength, const char *value)
+{
+
+  if (nodes == NULL)
+    return -1;
+
+  // a topic with too many levels is refused before any of its levels are added, rather than being kept under a shortened name
+  int levels = 1;
+  for (size_t i = 0; i < topicLength; i++)
+    if (topic[i] == '/')
+      levels++;
+
+  if (levels > maximumTopicIndexDepth)
+  {
+    valuesTooDeep++;
+    return -1;
+  };
+
+  int node = -1;
+  const char *level = topic;
+  const char *end = topic + topicLength;
+
+  while (true)
+  {
+
+    const char *separator = (const char *)memchr(level, '/', end - level);
+    size_t levelLength = (separator != NULL) ? (size_t)(separator - level) : (size_t)(end - level);
+
+    int64_t name = InternLevel(level, levelLength);
+    if (name >= 0)
+      node = FindOrAddNode(node, (uint32_t)name);
+
+    if ((name < 0) || (node < 0))
+    {
+      valuesNotKept++;
+      return -1;
+    };
+
+    if (separator == NULL)
+      break;
+
+    level = separator + 1;
+  };
+
+  topicIndexNode &entry = nodes[node];
+
+  if (!entry.isTopic)
+  {
+    entry.isTopic = true;
+    AddToNameOrder(node);
+  };
+
+  // the value slot used is the topic's own, a free one, or else the one updated longest ago
+  int slot = entry.value;
+
+  if (slot >= 0)
+  {
+    UnlinkValue(slot);
+  }
+  else if (valuesInUse < maximumTopicIndexValues)
+  {
+    slot = valuesInUse++;
+  }
+  else
+  {
+    slot = oldestValue;
+    UnlinkValue(slot);
+    nodes[values[slot].topic].value = -1;
+  };
+
+  LinkValueAsNewest(slot);
+
+  values[slot].topic = (int16_t)node;
+  strncpy(values[slot].text, value, maximumTopicIndexValueLength);
+  values[slot].text[maximumTopicIndexValueLength] = '\0';
+
+  entry.value = (int16_t)slot;
+  entry.updates++;
+
+  return node;
+}
+
+int TopicIndexTopics()
+{
+  return numberOfTopics;
+}
+
+size_t TopicIndexBytesUsed()
+{
+
+  if (nodes == NULL)
+    return 0;
+
+  // the hash tables are counted in full, as they are needed however few topics there are
+  return sizeof(topicIndexNode) * numberOfNodes + sizeof(int16_t) * childSlots + sizeof(uint32_t) * levelSlots + levelTextUsed +
+         sizeof(topicIndexValue) * valuesInUse + sizeof(int16_t) * numberOfTopics;
+}
+
+unsigned long TopicIndexValuesTooDeep()
+{
+  return valuesTooDeep;
+}
+
+unsigned long TopicIndexValuesNotKept()
+{
+  return valuesNotKept;
+}
+
+int TopicInNameOrder(int position)
+{
+
+  if ((position < 0) || (position >= numberOfTopics))
+    return -1;
+
+  return nameOrder[position];
+}
+
+const char *TopicIndexValue(int topic)
+{
+
+  if (nodes[topic].value < 0)
+    return NULL;
+
+  return values[nodes[topic].value].text;
+}
+
+uint16_t TopicIndexUpdates(int topic)
+{
+  return nodes[topic].updates;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Topic index
+//
+// keeps every topic received (for example on a subscription to N/<installation id>/#) in a compact form, so that the whole of Venus's
+// topic tree can be browsed on the display even where it holds thousands of topics
+//
+// each level of a topic is interned, so a name such as "Power" is only held once however many topics include it, and each topic is a
+// node holding just its parent and the interned name of its last level; a node's children are found through a hash table keyed on the
+// parent and the interned name, so finding a topic takes one lookup for each of its levels
+//
+// the latest value of only the most recently updated topics is kept: when every value slot is in use, the value of the topic that has
+// gone longest without an update is dropped to make room, and the topic itself stays in the index without a value
+//
+// the topics are also kept sorted by name, so that they can be shown a page at a time
+//
+// a topic with more than maximumTopicIndexDepth levels, or one received once the index is full, is not kept but counted, so that the
+// browser can show that topics are missing
+//
+// the memory is allocated once by BeginTopicIndex using the function supplied, so that it can be placed in PSRAM;
+// this does not depend on the Arduino core
+
+#include <stdint.h>
+#include <stddef.h>
+
+const int maximumTopicIndexNodes = 8192;          // topics, and the levels above them which are not topics themselves
+const int maximumTopicIndexValues = 1024;         // topics whose latest value is kept
+const int maximumTopicIndexValueLength = 31;      // longer values are cut short
+const int maximumTopicIndexNameLength = 127;      // longer topic names are cut short when read back
+const int maximumTopicIndexDepth = 32;            // topics with more levels are not kept
+const size_t topicIndexLevelTextBytes = 65536;    // the text of the interned level names together
+
+// allocate the index, returns false if there is not enough memory (in which case no topics are kept)
+bool BeginTopicIndex(void *(*allocate)(size_t size));
+
+// the number of bytes BeginTopicIndex allocates
+size_t TopicIndexMemoryRequired();
+
+// forget all of the topics
+void ClearTopicIndex();
+
+// record the latest value received on a topic, returns the topic's number or -1 if the topic has too many levels or the index is full
+int RecordTopicValue(const char *topic, size_t topicLength, const char *value);
+
+// the number of topics, and the bytes of the index's memory in use holding them
+int TopicIndexTopics();
+size_t TopicIndexBytesUsed();
+
+// the number of values received since the index was last cleared whose topics were not kept, as they had more than maximumTopicIndexDepth
+// levels, or as the index was full
+unsigned long TopicIndexValuesTooDeep();
+unsigned long TopicIndexValuesNotKept();
+
+// the number of the topic at the position given in the order of their names
+int TopicInNameOrder(int position);
+
+// the name of the topic, which is always null terminated and cut short if the buffer is too small; returns the length of the name
+size_t TopicIndexName(int topic, char *buffer, size_t bufferSize);
+
+// the latest value of the topic, or NULL if it has not been kept
+const char *TopicIndexValue(int topic);
+
+// a count of the values recorded on the topic (which wraps around), so that a change can be noticed
+uint16_t TopicIndexUpdates(int topic);
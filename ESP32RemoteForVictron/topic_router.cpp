@@ -0,0 +1,205 @@
+#include "topic_router.h"
+#include <string.h>
+
+void BeginTopicRouter(topicRouter &router)
+{
+
+  memset(&router, 0, sizeof(router));
+
+  // node 0 is the root, which stands for the start of the topic rather than for any level
+  router.numberOfNodes = 1;
+  router.nodes[0].route = -1;
+  router.nodes[0].firstChild = -1;
+  router.nodes[0].nextSibling = -1;
+  router.nodes[0].plusChild = -1;
+  router.nodes[0].hashChild = -1;
+}
+
+static int AddNode(topicRouter &router, const char *text, size_t textLength)
+{
+
+  if ((router.numberOfNodes >= maximumTopicRouterNodes) || (textLength > 255) || (router.textUsed + (int)textLength > maximumTopicRouterText))
+    return -1;
+
+  topicRouterNode &node = router.nodes[router.numberOfNodes];
+  node.text = (uint16_t)router.textUsed;
+  node.textLength = (uint8_t)textLength;
+  node.route = -1;
+  node.firstChild = -1;
+  node.nextSibling = -1;
+  node.plusChild = -1;
+  node.hashChild = -1;
+
+  memcpy(&router.text[router.textUsed], text, textLength);
+  router.textUsed += (int)textLength;
+
+  return router.numberOfNodes++;
+}
+
+static int FindChild(const topicRouter &router, int parent, const char *level, size_t levelLength)
+{
+
+  for (int child = router.nodes[parent].firstChild; child >= 0; child = router.nodes[child].nextSibling)
+  {
+    const topicRouterNode &node = router.nodes[child];
+    if ((node.textLength == levelLength) && (memcmp(&router.text[node.text], level, levelLength) == 0))
+      return child;
+  };
+
+  return -1;
+}
+
+bool AddTopicRoute(topicRouter &router, const char *filter, topicHandler handler, void *context, int slot)
+{
+
+  int node = 0;
+  const char *level = filter;
+
+  while (true)
+  {
+
+    const char *separator = strchr(level, '/');
+    size_t levelLength = (separator != NULL) ? (size_t)(separator - level) : strlen(level);
+
+    bool isPlus = (levelLength == 1) && (level[0] == '+');
+    bool isHash = (levelLength == 1) && (level[0] == '#');
+
+    // '#' may only be the last level, and the wildcards may not share a level with other text
+    if ((isHash && (separator != NULL)) || (!isPlus && !isHash && ((memchr(level, '+', levelLength) != NULL) || (memchr(level, '#', levelLength) != NULL))))
+      return false;
+
+    int child;
+
+    if (isPlus)
+    {
+      child = router.nodes[node].plusChild;
+      if (child < 0)
+      {
+        child = AddNode(router, "", 0);
+        if (child < 0)
+          return false;
+        router.nodes[node].plusChild = (int16_t)child;
+      };
+    }
+    else if (isHash)
+    {
+      child = router.nodes[node].hashChild;
+      if (child < 0)
+      {
+        child = AddNode(router, "", 0);
+        if (child < 0)
+          return false;
+        router.nodes[node].hashChild = (int16_t)child;
+      };
+    }
+    else
+    {
+      child = FindChild(router, node, level, levelLength);
+      if (child < 0)
+      {
+        child = AddNode(router, level, levelLength);
+        if (child < 0)
+          return false;
+        router.nodes[child].nextSibling = router.nodes[node].firstChild;
+        router.nodes[node].firstChild = (int16_t)child;
+      };
+    };
+
+    node = child;
+
+    if (separator == NULL)
+      break;
+
+    level = separator + 1;
+  };
+
+  if (router.nodes[node].route < 0)
+  {
+    if (router.numberOfRoutes >= maximumTopicRouterRoutes)
+      return false;
+    router.nodes[node].route = (int8_t)router.numberOfRoutes++;
+  };
+
+  topicRoute &route = router.routes[router.nodes[node].route];
+  route.handler = handler;
+  route.context = context;
+  route.slot = slot;
+
+  return true;
+}
+
+static int CallRoute(const topicRouter &router, int node, const topicRouterCaptures &captures, const void *message)
+{
+
+  int route = router.nodes[node].route;
+  if (route < 0)
+    return 0;
+
+  router.routes[route].handler(router.routes[route].context, router.routes[route].slot, captures, message);
+
+  return 1;
+}
+
+static int RouteFrom(const topicRouter &router, int node, const char *level, const char *end, int depth, topicRouterCaptures &captures, const void *message)
+{
+
+  // level points at the start of the next level of the topic to be matched, or is NULL once all of the levels have been matched
+
+  int handlersCalled = 0;
+
+  // '#' also matches the level above it, so a/# matches a as well as a/b
+  if (router.nodes[node].hashChild >= 0)
+    handlersCalled += CallRoute(router, router.nodes[node].hashChild, captures, message);
+
+  if (level == NULL)
+    return handlersCalled + CallRoute(router, node, captures, message);
+
+  if (depth >= maximumTopicRouterDepth)
+    return handlersCalled;
+
+  const char *separator = (const char *)memchr(level, '/', end - level);
+  size_t levelLength = (separator != NULL) ? (size_t)(separator - level) : (size_t)(end - level);
+  const char *nextLevel = (separator != NULL) ? separator + 1 : NULL;
+
+  int child = FindChild(router, node, level, levelLength);
+  if (child >= 0)
+    handlersCalled += RouteFrom(router, child, nextLevel, end, depth + 1, captures, message);
+
+  if (router.nodes[node].plusChild >= 0)
+  {
+
+    int capture = captures.count;
+    if (capture < maximumTopicRouterCaptures)
+    {
+      captures.start[capture] = level;
+      captures.length[capture] = levelLength;
+      captures.count++;
+    };
+
+    handlersCalled += RouteFrom(router, router.nodes[node].plusChild, nextLevel, end, depth + 1, captures, message);
+
+    captures.count = capture;
+  };
+
+  return handlersCalled;
+}
+
+int RouteTopic(const topicRouter &router, const char *topic, size_t topicLength, const void *message)
+{
+
+  topicRouterCaptures captures;
+  captures.count = 0;
+
+  // topics starting with '$' (those of the broker itself) are not matched by a wildcard at the first level
+  if ((topicLength > 0) && (topic[0] == '$'))
+  {
+    const char *separator = (const char *)memchr(topic, '/', topicLength);
+    size_t levelLength = (separator != NULL) ? (size_t)(separator - topic) : topicLength;
+    int node = FindChild(router, 0, topic, levelLength);
+    if (node < 0)
+      return 0;
+    return RouteFrom(router, node, (separator != NULL) ? separator + 1 : NULL, topic + topicLength, 1, captures, message);
+  };
+
+  return RouteFrom(router, 0, topic, topic + topicLength, 0, captures, message);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Topic router
+//
+// finds the handlers for an MQTT topic in a trie of the topic filters subscribed to, one node for each level of a filter, so a topic is
+// resolved in one walk down its levels however many filters there are, rather than by comparing it with each filter in turn
+//
+// filters may hold the MQTT wildcards '+' (any one level) and '#' (any number of levels, at the end of the filter); the text of each
+// level a '+' stood for is passed on to the handler, for example the instance 279 for N/<installation id>/solarcharger/+/State
+//
+// the nodes and their text are kept in fixed arrays, so neither adding a filter nor routing a topic allocates memory
+//
+// this does not depend on the Arduino core
+
+#include <stddef.h>
+#include <stdint.h>
+
+const int maximumTopicRouterNodes = 64;
+const int maximumTopicRouterRoutes = 16;
+const int maximumTopicRouterText = 512; // the text of the levels of all of the filters together
+const int maximumTopicRouterCaptures = 4;
+const int maximumTopicRouterDepth = 16; // topics with more levels than this are not routed
+
+struct topicRouterCaptures
+{
+  int count;
+  const char *start[maximumTopicRouterCaptures];
+  size_t length[maximumTopicRouterCaptures];
+};
+
+// slot is the number given with the filter, so one handler can serve several filters; message is passed on as given to RouteTopic
+typedef void (*topicHandler)(void *context, int slot, const topicRouterCaptures &captures, const void *message);
+
+struct topicRouterNode
+{
+  uint16_t text;
+  uint8_t textLength;
+  int8_t route;        // index into routes, or -1 if no filter ends here
+  int16_t firstChild;  // children with text, linked through nextSibling
+  int16_t nextSibling;
+  int16_t plusChild;   // the '+' and '#' children are kept apart, so that they need not be searched for
+  int16_t hashChild;
+};
+
+struct topicRoute
+{
+  topicHandler handler;
+  void *context;
+  int slot;
+};
+
+struct topicRouter
+{
+  topicRouterNode nodes[maximumTopicRouterNodes];
+  int numberOfNodes;
+  topicRoute routes[maximumTopicRouterRoutes];
+  int numberOfRoutes;
+  char text[maximumTopicRouterText];
+  int textUsed;
+};
+
+// remove all of the filters
+void BeginTopicRouter(topicRouter &router);
+
+// returns false if the router is full or the filter is not valid; adding a filter already added replaces its handler
+bool AddTopicRoute(topicRouter &router, const char *filter, topicHandler handler, void *context, int slot);
+
+// calls the handler of each filter matching the topic, and returns how many were called
+int RouteTopic(const topicRouter &router, const char *topic, size_t topicLength, const void *message);
@@ -0,0 +1,70 @@
+#include "trace_recorder.h"
+
+bool tracing = false;
+
+static traceEvent traceEvents[maximumTraceEvents];
+static size_t firstTraceEvent = 0;
+static size_t numberOfTraceEvents = 0;
+
+static const char *traceEventNameTexts[traceEventNames] = {
+    "payload received",
+    "payload parsed",
+    "frame render",
+    "frame push",
+    "display chunk",
+    "Wi-Fi connected",
+    "MQTT connected",
+    "display off",
+    "button pressed"};
+
+void StartTracing()
+{
+  firstTraceEvent = 0;
+  numberOfTraceEvents = 0;
+  tracing = true;
+}
+
+void StopTracing()
+{
+  tracing = false;
+}
+
+void RecordTraceEvent(uint32_t timestamp, traceEventName name, tracePhase phase, uint16_t argument)
+{
+
+  traceEvent *event;
+
+  if (numberOfTraceEvents < maximumTraceEvents)
+  {
+    event = &traceEvents[(firstTraceEvent + numberOfTraceEvents) % maximumTraceEvents];
+    numberOfTraceEvents++;
+  }
+  else
+  {
+    // the buffer is full, so the oldest event is overwritten
+    event = &traceEvents[firstTraceEvent];
+    firstTraceEvent = (firstTraceEvent + 1) % maximumTraceEvents;
+  };
+
+  event->timestamp = timestamp;
+  event->name = (uint8_t)name;
+  event->phase = (uint8_t)phase;
+  event->argument = argument;
+}
+
+size_t TraceEventsRecorded()
+{
+  return numberOfTraceEvents;
+}
+
+const traceEvent &TraceEventAt(size_t index)
+{
+  return traceEvents[(firstTraceEvent + index) % maximumTraceEvents];
+}
+
+const char *TraceEventNameText(uint8_t name)
+{
+  if (name < traceEventNames)
+    return traceEventNameTexts[name];
+  return "unknown";
+}
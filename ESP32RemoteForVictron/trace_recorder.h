@@ -0,0 +1,70 @@
+#pragma once
+
+// Trace recorder
+//
+// while tracing is turned on, events are recorded into a ring buffer (the oldest being overwritten once it is full) so that what the sketch
+// was doing in the moments before a problem can be seen on a timeline, for example by loading the Chrome Trace JSON sent by the sketch
+// into chrome://tracing or https://ui.perfetto.dev
+//
+// the timestamps (in microseconds) are supplied by the caller, so this does not depend on the Arduino core
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum traceEventName
+{
+  PayloadReceivedEvent, // argument: topic
+  PayloadParsedEvent,   // argument: data point
+  FrameRenderEvent,
+  FramePushEvent,
+  DisplayChunkEvent,    // argument: number of pixels sent
+  WiFiConnectedEvent,   // argument: 1 when connected, 0 when disconnected
+  MQTTConnectedEvent,   // argument: 1 when connected, 0 when disconnected
+  DisplayOffEvent,
+  ButtonPressedEvent,   // argument: 0 for the top button, 1 for the bottom button
+  traceEventNames
+};
+
+enum tracePhase
+{
+  TraceBegin = 'B',
+  TraceEnd = 'E',
+  TraceInstant = 'i'
+};
+
+struct traceEvent
+{
+  uint32_t timestamp;
+  uint8_t name;
+  uint8_t phase;
+  uint16_t argument;
+};
+
+const size_t maximumTraceEvents = 2048;
+
+extern bool tracing;
+
+// clear the buffer and start recording events
+void StartTracing();
+
+// stop recording events, those already recorded are kept
+void StopTracing();
+
+// record an event in the buffer, whether or not tracing is turned on
+void RecordTraceEvent(uint32_t timestamp, traceEventName name, tracePhase phase, uint16_t argument);
+
+// record an event, if tracing is turned on (this is inline so that it costs no more than a test of tracing when it is not)
+inline void TraceEvent(uint32_t timestamp, traceEventName name, tracePhase phase, uint16_t argument = 0)
+{
+  if (tracing)
+    RecordTraceEvent(timestamp, name, phase, argument);
+}
+
+// the number of events in the buffer
+size_t TraceEventsRecorded();
+
+// the events in the buffer, from the oldest (0) to the most recent
+const traceEvent &TraceEventAt(size_t index);
+
+// the name used for an event in the Chrome Trace JSON
+const char *TraceEventNameText(uint8_t name);
@@ -0,0 +1,152 @@
+#include "traffic_log.h"
+#include <string.h>
+
+static size_t PutVarint(uint8_t *p, uint32_t value)
+{
+  size_t length = 0;
+  while (value >= 0x80UL)
+  {
+    p[length++] = (uint8_t)(value | 0x80UL);
+    value >>= 7;
+  };
+  p[length++] = (uint8_t)value;
+  return length;
+}
+
+static size_t VarintLength(uint32_t value)
+{
+  size_t length = 1;
+  while (value >= 0x80UL)
+  {
+    value >>= 7;
+    length++;
+  };
+  return length;
+}
+
+static bool GetVarint(const uint8_t *p, size_t available, size_t &position, uint32_t &value)
+{
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7)
+  {
+    if (position >= available)
+      return false;
+    uint8_t byte = p[position++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  };
+  return false;
+}
+
+void BeginTrafficLogWriter(trafficLogWriter &writer)
+{
+  writer.topics.numberOfTopics = 0;
+  writer.lastTime = 0;
+}
+
+bool AppendTrafficLogMessage(trafficLogWriter &writer, uint8_t *buffer, size_t bufferSize, size_t &length, uint32_t time, const char *topic,
+                             size_t topicLength, const uint8_t *payload, size_t payloadLength)
+{
+
+  trafficLogTopics &topics = writer.topics;
+
+  // the topic's number, found by comparing its text with that of each topic seen, which is already in the buffer
+
+  int topicNumber = 0;
+  while ((topicNumber < topics.numberOfTopics) &&
+         ((topics.textLength[topicNumber] != topicLength) || (memcmp(buffer + topics.textAt[topicNumber], topic, topicLength) != 0)))
+    topicNumber++;
+
+  bool newTopic = (topicNumber == topics.numberOfTopics);
+
+  if (newTopic && ((topics.numberOfTopics == maximumTrafficLogTopics) || (topicLength > 0xFFFF)))
+    return false;
+
+  uint32_t elapsed = time - writer.lastTime;
+
+  size_t size = VarintLength(elapsed) + VarintLength((uint32_t)topicNumber) + VarintLength((uint32_t)payloadLength) + payloadLength;
+  if (newTopic)
+    size += VarintLength((uint32_t)topicLength) + topicLength;
+
+  if (length + size > bufferSize)
+    return false;
+
+  uint8_t *p = buffer + length;
+
+  p += PutVarint(p, elapsed);
+  p += PutVarint(p, (uint32_t)topicNumber);
+
+  if (newTopic)
+  {
+    p += PutVarint(p, (uint32_t)topicLength);
+    topics.textAt[topicNumber] = (uint32_t)(p - buffer);
+    topics.textLength[topicNumber] = (uint16_t)topicLength;
+    topics.numberOfTopics++;
+    memcpy(p, topic, topicLength);
+    p += topicLength;
+  };
+
+  p += PutVarint(p, (uint32_t)payloadLength);
+  memcpy(p, payload, payloadLength);
+
+  length += size;
+  writer.lastTime = time;
+
+  return true;
+}
+
+void BeginTrafficLogReader(trafficLogReader &reader, const uint8_t *data, size_t length)
+{
+  reader.topics.numberOfTopics = 0;
+  reader.time = 0;
+  reader.data = data;
+  reader.length = length;
+  reader.position = 0;
+}
+
+bool ReadTrafficLogMessage(trafficLogReader &reader, trafficLogMessage &message)
+{
+
+  trafficLogTopics &topics = reader.topics;
+
+  size_t position = reader.position;
+  uint32_t elapsed;
+  uint32_t topicNumber;
+  uint32_t payloadLength;
+
+  if (!GetVarint(reader.data, reader.length, position, elapsed) || !GetVarint(reader.data, reader.length, position, topicNumber))
+    return false;
+
+  if (topicNumber > (uint32_t)topics.numberOfTopics)
+    return false;
+
+  if (topicNumber == (uint32_t)topics.numberOfTopics)
+  {
+
+    uint32_t topicLength;
+    if ((topics.numberOfTopics == maximumTrafficLogTopics) || !GetVarint(reader.data, reader.length, position, topicLength) ||
+        (topicLength > 0xFFFF) || (topicLength > reader.length - position))
+      return false;
+
+    topics.textAt[topicNumber] = (uint32_t)position;
+    topics.textLength[topicNumber] = (uint16_t)topicLength;
+    topics.numberOfTopics++;
+    position += topicLength;
+  };
+
+  if (!GetVarint(reader.data, reader.length, position, payloadLength) || (payloadLength > reader.length - position))
+    return false;
+
+  reader.time += elapsed;
+
+  message.time = reader.time;
+  message.topic = (const char *)reader.data + topics.textAt[topicNumber];
+  message.topicLength = topics.textLength[topicNumber];
+  message.payload = reader.data + position;
+  message.payloadLength = payloadLength;
+
+  reader.position = position + payloadLength;
+
+  return true;
+}
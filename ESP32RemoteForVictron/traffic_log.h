@@ -0,0 +1,67 @@
+#pragma once
+
+// Traffic log
+//
+// packs the MQTT messages received, each a time, a topic and a payload, into a buffer supplied by the caller, and reads them back in
+// order; the sketch records into one held in memory (see its 'record' serial monitor command), and the host build replays a log to the
+// sketch (see host/traffic_replay.h)
+//
+// each message is a series of variable length integers of 7 bits a byte:
+//
+//  - the milliseconds since the message before (or since the log was started, for the first)
+//  - the topic's number, in the order the topics were first seen; a number one past the last topic seen is a new topic, whose length
+//    and text follow, so each topic's text is only stored once
+//  - the payload's length, followed by the payload
+//
+// so a message on a topic seen before, such as {"value":1582.5} on N/<installation id>/system/0/Ac/Consumption/L1/Power, takes 4 bytes
+// more than its payload rather than the 60 or so more its topic would take
+//
+// this does not depend on the Arduino core
+
+#include <stdint.h>
+#include <stddef.h>
+
+const int maximumTrafficLogTopics = 64;
+
+struct trafficLogTopics
+{
+  int numberOfTopics;
+  uint32_t textAt[maximumTrafficLogTopics]; // where each topic's text is in the buffer
+  uint16_t textLength[maximumTrafficLogTopics];
+};
+
+struct trafficLogWriter
+{
+  trafficLogTopics topics;
+  uint32_t lastTime;
+};
+
+struct trafficLogReader
+{
+  trafficLogTopics topics;
+  uint32_t time;
+  const uint8_t *data;
+  size_t length;
+  size_t position;
+};
+
+struct trafficLogMessage
+{
+  uint32_t time; // milliseconds since the log was started
+  const char *topic;
+  size_t topicLength;
+  const uint8_t *payload;
+  size_t payloadLength;
+};
+
+void BeginTrafficLogWriter(trafficLogWriter &writer);
+
+// add a message to the end of the buffer, updating length; times must not go backwards
+// returns false if the message does not fit, or if it is on a new topic when maximumTrafficLogTopics have already been seen
+bool AppendTrafficLogMessage(trafficLogWriter &writer, uint8_t *buffer, size_t bufferSize, size_t &length, uint32_t time, const char *topic,
+                             size_t topicLength, const uint8_t *payload, size_t payloadLength);
+
+void BeginTrafficLogReader(trafficLogReader &reader, const uint8_t *data, size_t length);
+
+// read the next message, whose topic and payload point into the data; returns false at the end of the data (or if the data is not valid)
+bool ReadTrafficLogMessage(trafficLogReader &reader, trafficLogMessage &message);
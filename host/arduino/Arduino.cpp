@@ -0,0 +1,313 @@
+#include "Arduino.h"
+#include "host_board.h"
+
+#undef time
+#undef settimeofday
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static uint64_t clockMicroSeconds = 0;
+
+static const int numberOfPins = 49;
+static uint64_t pinHeldLowFrom[numberOfPins];
+static uint64_t pinHeldLowUntil[numberOfPins];
+
+static std::string serialInput;
+static std::string serialOutput;
+static bool echoSerialOutput = false;
+
+static time_t wallClockWhenSet = 1782043200; // 12:00 UTC on 21 June 2026
+static bool wallClockIsSet = false;
+static int64_t wallClockOffset = 0;          // seconds to add to the virtual clock to give the wall clock
+
+static uint64_t deepSleepWakeUpAfterMicroSeconds = 0;
+
+// clock
+
+uint64_t HostMicroSeconds()
+{
+  return clockMicroSeconds;
+}
+
+void HostAdvanceTime(unsigned long milliSeconds)
+{
+  clockMicroSeconds += (uint64_t)milliSeconds * 1000ULL;
+}
+
+unsigned long micros()
+{
+  return (unsigned long)(++clockMicroSeconds);
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(++clockMicroSeconds / 1000ULL);
+}
+
+void delay(unsigned long milliSeconds)
+{
+  HostAdvanceTime(milliSeconds);
+}
+
+void delayMicroseconds(unsigned int microSeconds)
+{
+  clockMicroSeconds += microSeconds;
+}
+
+void yield()
+{
+}
+
+// pins
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  (void)pin;
+  (void)value;
+}
+
+int digitalRead(uint8_t pin)
+{
+  clockMicroSeconds++;
+  return ((pin < numberOfPins) && (clockMicroSeconds >= pinHeldLowFrom[pin]) && (clockMicroSeconds < pinHeldLowUntil[pin])) ? LOW : HIGH;
+}
+
+void HostPressButton(int pin, unsigned long milliSeconds, unsigned long fromMilliSecondsLater)
+{
+  if ((pin >= 0) && (pin < numberOfPins))
+  {
+    pinHeldLowFrom[pin] = clockMicroSeconds + (uint64_t)fromMilliSecondsLater * 1000ULL;
+    pinHeldLowUntil[pin] = pinHeldLowFrom[pin] + (uint64_t)milliSeconds * 1000ULL;
+  };
+}
+
+// serial port
+
+int HardwareSerial::available()
+{
+  return (int)serialInput.size();
+}
+
+int HardwareSerial::read()
+{
+  if (serialInput.empty())
+    return -1;
+  int c = (uint8_t)serialInput[0];
+  serialInput.erase(0, 1);
+  return c;
+}
+
+int HardwareSerial::peek()
+{
+  return serialInput.empty() ? -1 : (uint8_t)serialInput[0];
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  serialOutput.append((const char *)buffer, size);
+  if (echoSerialOutput)
+    fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+void HostSerialInput(const char *text)
+{
+  serialInput += text;
+}
+
+std::string HostTakeSerialOutput()
+{
+  std::string output;
+  output.swap(serialOutput);
+  return output;
+}
+
+void HostEchoSerialOutput(bool echo)
+{
+  echoSerialOutput = echo;
+}
+
+// printing
+
+std::string String::IntegerText(long long value, unsigned char base)
+{
+  if (value < 0)
+    return "-" + IntegerText((unsigned long long)(-(value + 1)) + 1ULL, base);
+  return IntegerText((unsigned long long)value, base);
+}
+
+std::string String::IntegerText(unsigned long long value, unsigned char base)
+{
+
+  if ((base < 2) || (base > 36))
+    base = DEC;
+
+  char digits[65];
+  int i = sizeof(digits) - 1;
+  digits[i] = '\0';
+
+  do
+  {
+    int digit = (int)(value % base);
+    digits[--i] = (char)((digit < 10) ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value > 0);
+
+  return std::string(&digits[i]);
+}
+
+std::string String::FloatText(double value, unsigned int decimalPlaces)
+{
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", (int)decimalPlaces, value);
+  return std::string(text);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size-- > 0)
+    n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const struct tm *timeInfo, const char *format)
+{
+  char text[64];
+  size_t length = strftime(text, sizeof(text), (format != NULL) ? format : "%c", timeInfo);
+  return write((const uint8_t *)text, length);
+}
+
+size_t Print::printf(const char *format, ...)
+{
+
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(NULL, 0, format, arguments);
+  va_end(arguments);
+
+  if (length <= 0)
+    return 0;
+
+  std::string text((size_t)length + 1, '\0');
+  va_start(arguments, format);
+  vsnprintf(&text[0], text.size(), format, arguments);
+  va_end(arguments);
+
+  return write((const uint8_t *)text.data(), (size_t)length);
+}
+
+String IPAddress::toString() const
+{
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+  return String(text);
+}
+
+// wall clock
+
+void HostSetWallClock(time_t secondsSince1970)
+{
+  wallClockWhenSet = secondsSince1970;
+  if (wallClockIsSet)
+    wallClockOffset = (int64_t)secondsSince1970 - (int64_t)(clockMicroSeconds / 1000000ULL);
+}
+
+void configTime(long gmtOffsetInSeconds, int daylightOffsetInSeconds, const char *server1, const char *server2, const char *server3)
+{
+
+  (void)gmtOffsetInSeconds;
+  (void)daylightOffsetInSeconds;
+  (void)server1;
+  (void)server2;
+  (void)server3;
+
+  if (!wallClockIsSet)
+  {
+    wallClockIsSet = true;
+    HostSetWallClock(wallClockWhenSet);
+  };
+}
+
+time_t HostTime(time_t *result)
+{
+  time_t now = (time_t)((int64_t)(clockMicroSeconds / 1000000ULL) + wallClockOffset);
+  if (result != NULL)
+    *result = now;
+  return now;
+}
+
+int HostSetTimeOfDay(const struct timeval *time, const struct timezone *zone)
+{
+  (void)zone;
+  wallClockIsSet = true;
+  HostSetWallClock(time->tv_sec);
+  return 0;
+}
+
+bool getLocalTime(struct tm *timeInfo, uint32_t milliSecondsToWait)
+{
+
+  if (!wallClockIsSet)
+  {
+    delay(milliSecondsToWait);
+    return false;
+  };
+
+  time_t now = HostTime(NULL);
+  localtime_r(&now, timeInfo);
+
+  return true;
+}
+
+// ESP-IDF
+
+uint32_t EspClass::getFreeHeap()
+{
+  return 256 * 1024;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+  return 192 * 1024;
+}
+
+bool psramFound()
+{
+  return true;
+}
+
+void *ps_malloc(size_t size)
+{
+  return malloc(size);
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t microSeconds)
+{
+  deepSleepWakeUpAfterMicroSeconds = microSeconds;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level)
+{
+  (void)pin;
+  (void)level;
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start()
+{
+  throw hostDeepSleep{deepSleepWakeUpAfterMicroSeconds};
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+// Arduino core for the host build
+//
+// just enough of the ESP32 Arduino core for the sketch to be compiled and run on a desktop computer, so that its behaviour and what it
+// draws can be checked by the tests in the tests folder without a T-Display S3 AMOLED
+//
+// the clock is virtual: it only moves on when delay() is called, when the host advances it (see host_board.h), or by one microsecond
+// each time the sketch reads it or a pin, so that a loop waiting on either always ends and every run is repeatable
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+#define PROGMEM
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0x0
+#define HIGH 0x1
+#define DEC 10
+#define HEX 16
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define SPI2_HOST 1
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+#define constrain(amount, low, high) ((amount) < (low) ? (low) : ((amount) > (high) ? (high) : (amount)))
+
+class String
+{
+public:
+  String() {}
+  String(const char *text) : text(text ? text : "") {}
+  String(const std::string &text) : text(text) {}
+  String(char c) : text(1, c) {}
+  String(int value, unsigned char base = DEC) : text(IntegerText((long long)value, base)) {}
+  String(unsigned int value, unsigned char base = DEC) : text(IntegerText((unsigned long long)value, base)) {}
+  String(long value, unsigned char base = DEC) : text(IntegerText((long long)value, base)) {}
+  String(unsigned long value, unsigned char base = DEC) : text(IntegerText((unsigned long long)value, base)) {}
+  String(long long value, unsigned char base = DEC) : text(IntegerText(value, base)) {}
+  String(unsigned long long value, unsigned char base = DEC) : text(IntegerText(value, base)) {}
+  String(float value, unsigned int decimalPlaces = 2) : text(FloatText(value, decimalPlaces)) {}
+  String(double value, unsigned int decimalPlaces = 2) : text(FloatText(value, decimalPlaces)) {}
+
+  unsigned int length() const { return (unsigned int)text.size(); }
+  const char *c_str() const { return text.c_str(); }
+  bool isEmpty() const { return text.empty(); }
+  bool reserve(unsigned int size)
+  {
+    text.reserve(size);
+    return true;
+  }
+
+  char charAt(unsigned int index) const { return (index < text.size()) ? text[index] : '\0'; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index) { return text[index]; }
+
+  String substring(unsigned int from) const { return (from < text.size()) ? String(text.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const
+  {
+    if (from > to)
+      std::swap(from, to);
+    if (from >= text.size())
+      return String();
+    return String(text.substr(from, std::min<size_t>(to, text.size()) - from));
+  }
+
+  int indexOf(char c, unsigned int from = 0) const { return Position(text.find(c, from)); }
+  int indexOf(const String &other, unsigned int from = 0) const { return Position(text.find(other.text, from)); }
+  int lastIndexOf(char c) const { return Position(text.rfind(c)); }
+  bool startsWith(const String &other) const { return text.compare(0, other.text.size(), other.text) == 0; }
+  bool endsWith(const String &other) const
+  {
+    return (text.size() >= other.text.size()) && (text.compare(text.size() - other.text.size(), other.text.size(), other.text) == 0);
+  }
+  bool equals(const String &other) const { return text == other.text; }
+
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return (float)atof(text.c_str()); }
+  double toDouble() const { return atof(text.c_str()); }
+
+  void trim()
+  {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last = text.find_last_not_of(" \t\r\n");
+    text = (first == std::string::npos) ? std::string() : text.substr(first, last - first + 1);
+  }
+  void toUpperCase()
+  {
+    for (char &c : text)
+      c = (char)toupper((unsigned char)c);
+  }
+  void toLowerCase()
+  {
+    for (char &c : text)
+      c = (char)tolower((unsigned char)c);
+  }
+
+  void toCharArray(char *buffer, unsigned int bufferSize, unsigned int from = 0) const { getBytes((unsigned char *)buffer, bufferSize, from); }
+  void getBytes(unsigned char *buffer, unsigned int bufferSize, unsigned int from = 0) const
+  {
+    if (bufferSize == 0)
+      return;
+    size_t length = (from < text.size()) ? std::min<size_t>(bufferSize - 1, text.size() - from) : 0;
+    memcpy(buffer, text.data() + from, length);
+    buffer[length] = '\0';
+  }
+
+  bool concat(const String &other)
+  {
+    text += other.text;
+    return true;
+  }
+  bool concat(const char *other, unsigned int length)
+  {
+    text.append(other, length);
+    return true;
+  }
+  String &operator+=(const String &other)
+  {
+    text += other.text;
+    return *this;
+  }
+  String &operator+=(const char *other)
+  {
+    text += other;
+    return *this;
+  }
+  String &operator+=(char other)
+  {
+    text += other;
+    return *this;
+  }
+
+  bool operator==(const String &other) const { return text == other.text; }
+  bool operator==(const char *other) const { return text == other; }
+  bool operator!=(const String &other) const { return text != other.text; }
+  bool operator!=(const char *other) const { return text != other; }
+  bool operator<(const String &other) const { return text < other.text; }
+
+  const std::string &str() const { return text; }
+
+private:
+  std::string text;
+
+  static int Position(size_t position) { return (position == std::string::npos) ? -1 : (int)position; }
+  static std::string IntegerText(long long value, unsigned char base);
+  static std::string IntegerText(unsigned long long value, unsigned char base);
+  static std::string FloatText(double value, unsigned int decimalPlaces);
+};
+
+inline String operator+(const String &a, const String &b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+inline String operator+(const String &a, const char *b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+inline String operator+(const char *a, const String &b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+inline String operator+(const String &a, char b)
+{
+  String result(a);
+  result += b;
+  return result;
+}
+
+class Print;
+
+class Printable
+{
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &printer) const = 0;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+
+  size_t print(const String &text) { return write((const uint8_t *)text.c_str(), text.length()); }
+  size_t print(const char *text) { return write(text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+  size_t print(long long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+  size_t print(unsigned long long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+  size_t print(double value, int decimalPlaces = 2) { return print(String(value, (unsigned int)decimalPlaces)); }
+  size_t print(const Printable &printable) { return printable.printTo(*this); }
+  size_t print(const struct tm *timeInfo, const char *format = NULL);
+
+  template <class T>
+  size_t println(const T &value)
+  {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <class T>
+  size_t println(const T &value, int option)
+  {
+    size_t n = print(value, option);
+    return n + println();
+  }
+  size_t println(const struct tm *timeInfo, const char *format = NULL)
+  {
+    size_t n = print(timeInfo, format);
+    return n + println();
+  }
+  size_t println() { return write("\r\n"); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long speed) { (void)speed; }
+  void end() {}
+  void flush() {}
+  int available();
+  int read();
+  int peek();
+  operator bool() const { return true; }
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+};
+
+extern HardwareSerial Serial;
+
+class IPAddress : public Printable
+{
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+  String toString() const;
+  size_t printTo(Print &printer) const override { return printer.print(toString()); }
+
+private:
+  uint8_t octets[4];
+};
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long milliSeconds);
+void delayMicroseconds(unsigned int microSeconds);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+// the wall clock follows the virtual clock, and is only set once configTime has been called (as the ESP32's is only set by SNTP)
+void configTime(long gmtOffsetInSeconds, int daylightOffsetInSeconds, const char *server1, const char *server2 = NULL, const char *server3 = NULL);
+bool getLocalTime(struct tm *timeInfo, uint32_t milliSecondsToWait = 5000);
+time_t HostTime(time_t *result);
+int HostSetTimeOfDay(const struct timeval *time, const struct timezone *zone);
+#define time(result) HostTime(result)
+#define settimeofday(time, zone) HostSetTimeOfDay(time, zone)
+
+#include "esp_host.h"
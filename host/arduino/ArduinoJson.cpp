@@ -0,0 +1,401 @@
+#include "ArduinoJson.h"
+#include <errno.h>
+
+static const int maximumNesting = 10; // as ArduinoJson's default
+
+JsonVariant JsonVariant::operator[](const char *key) const
+{
+
+  if (isNull() || (document->nodes[node].type != JsonDocument::ObjectNode))
+    return JsonVariant();
+
+  for (int member : document->nodes[node].children)
+    if (document->nodes[member].text == key)
+      return JsonVariant(document, document->nodes[member].children[0]);
+
+  return JsonVariant();
+}
+
+JsonVariant JsonVariant::operator[](int index) const
+{
+
+  if (isNull() || (document->nodes[node].type != JsonDocument::ArrayNode) || (index < 0) || (index >= (int)document->nodes[node].children.size()))
+    return JsonVariant();
+
+  return JsonVariant(document, document->nodes[node].children[index]);
+}
+
+bool JsonVariant::isNull() const
+{
+  return (document == NULL) || (node < 0) || (document->nodes[node].type == JsonDocument::NullNode);
+}
+
+size_t JsonVariant::size() const
+{
+  if (isNull() || ((document->nodes[node].type != JsonDocument::ArrayNode) && (document->nodes[node].type != JsonDocument::ObjectNode)))
+    return 0;
+  return document->nodes[node].children.size();
+}
+
+bool JsonVariant::IsInteger() const
+{
+  return !isNull() && (document->nodes[node].type == JsonDocument::IntegerNode);
+}
+
+bool JsonVariant::IsNumber() const
+{
+  if (isNull())
+    return false;
+  JsonDocument::nodeType type = document->nodes[node].type;
+  return (type == JsonDocument::BoolNode) || (type == JsonDocument::IntegerNode) || (type == JsonDocument::FloatNode);
+}
+
+long long JsonVariant::Integer() const
+{
+  const JsonDocument::jsonNode &value = document->nodes[node];
+  if (value.type == JsonDocument::FloatNode)
+    return (long long)value.number;
+  return value.integer;
+}
+
+double JsonVariant::Number() const
+{
+  const JsonDocument::jsonNode &value = document->nodes[node];
+  if (value.type == JsonDocument::FloatNode)
+    return value.number;
+  return (double)value.integer;
+}
+
+const char *DeserializationError::c_str() const
+{
+  static const char *names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+  return names[errorCode];
+}
+
+class JsonParser
+{
+public:
+  JsonParser(JsonDocument &document, const char *input, size_t inputLength) : document(document), next(input), end(input + inputLength) {}
+
+  DeserializationError Parse()
+  {
+
+    document.clear();
+
+    SkipSpace();
+    if (next == end)
+      return DeserializationError::EmptyInput;
+
+    DeserializationError error = ParseValue(0);
+    if (error)
+      document.clear();
+
+    // as with ArduinoJson, anything after the value is not read
+    return error;
+  }
+
+private:
+  JsonDocument &document;
+  const char *next;
+  const char *end;
+
+  int AddNode(JsonDocument::nodeType type)
+  {
+    JsonDocument::jsonNode node;
+    node.type = type;
+    node.integer = 0;
+    node.number = 0.0;
+    document.nodes.push_back(node);
+    return (int)document.nodes.size() - 1;
+  }
+
+  void SkipSpace()
+  {
+    while ((next < end) && ((*next == ' ') || (*next == '\t') || (*next == '\r') || (*next == '\n')))
+      next++;
+  }
+
+  bool Take(const char *word)
+  {
+    size_t length = strlen(word);
+    if ((size_t)(end - next) < length)
+      return false;
+    if (memcmp(next, word, length) != 0)
+      return false;
+    next += length;
+    return true;
+  }
+
+  DeserializationError ParseValue(int depth)
+  {
+
+    SkipSpace();
+    if (next == end)
+      return DeserializationError::IncompleteInput;
+
+    switch (*next)
+    {
+    case '{':
+      return ParseObject(depth);
+    case '[':
+      return ParseArray(depth);
+    case '"':
+    {
+      std::string text;
+      DeserializationError error = ParseString(text);
+      if (!error)
+        document.nodes[AddNode(JsonDocument::StringNode)].text = text;
+      return error;
+    }
+    case 't':
+    case 'f':
+    case 'n':
+    {
+      bool isTrue = Take("true");
+      if (isTrue || Take("false"))
+      {
+        document.nodes[AddNode(JsonDocument::BoolNode)].integer = isTrue ? 1 : 0;
+        return DeserializationError::Ok;
+      };
+      if (Take("null"))
+      {
+        AddNode(JsonDocument::NullNode);
+        return DeserializationError::Ok;
+      };
+      return (end - next < 5) ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+    }
+    default:
+      return ParseNumber();
+    };
+  }
+
+  DeserializationError ParseObject(int depth)
+  {
+
+    if (depth >= maximumNesting)
+      return DeserializationError::TooDeep;
+
+    int object = AddNode(JsonDocument::ObjectNode);
+    next++;
+
+    SkipSpace();
+    if ((next < end) && (*next == '}'))
+    {
+      next++;
+      return DeserializationError::Ok;
+    };
+
+    while (true)
+    {
+
+      SkipSpace();
+      if (next == end)
+        return DeserializationError::IncompleteInput;
+      if (*next != '"')
+        return DeserializationError::InvalidInput;
+
+      std::string key;
+      DeserializationError error = ParseString(key);
+      if (error)
+        return error;
+
+      SkipSpace();
+      if (next == end)
+        return DeserializationError::IncompleteInput;
+      if (*next++ != ':')
+        return DeserializationError::InvalidInput;
+
+      int member = AddNode(JsonDocument::NullNode);
+      document.nodes[member].text = key;
+
+      int value = (int)document.nodes.size();
+      error = ParseValue(depth + 1);
+      if (error)
+        return error;
+
+      document.nodes[member].children.push_back(value);
+      document.nodes[object].children.push_back(member);
+
+      SkipSpace();
+      if (next == end)
+        return DeserializationError::IncompleteInput;
+      char c = *next++;
+      if (c == '}')
+        return DeserializationError::Ok;
+      if (c != ',')
+        return DeserializationError::InvalidInput;
+    };
+  }
+
+  DeserializationError ParseArray(int depth)
+  {
+
+    if (depth >= maximumNesting)
+      return DeserializationError::TooDeep;
+
+    int array = AddNode(JsonDocument::ArrayNode);
+    next++;
+
+    SkipSpace();
+    if ((next < end) && (*next == ']'))
+    {
+      next++;
+      return DeserializationError::Ok;
+    };
+
+    while (true)
+    {
+
+      int value = (int)document.nodes.size();
+      DeserializationError error = ParseValue(depth + 1);
+      if (error)
+        return error;
+
+      document.nodes[array].children.push_back(value);
+
+      SkipSpace();
+      if (next == end)
+        return DeserializationError::IncompleteInput;
+      char c = *next++;
+      if (c == ']')
+        return DeserializationError::Ok;
+      if (c != ',')
+        return DeserializationError::InvalidInput;
+    };
+  }
+
+  static void AppendUTF8(std::string &text, unsigned long codePoint)
+  {
+    if (codePoint < 0x80)
+      text += (char)codePoint;
+    else if (codePoint < 0x800)
+    {
+      text += (char)(0xC0 | (codePoint >> 6));
+      text += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+      text += (char)(0xE0 | (codePoint >> 12));
+      text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+      text += (char)(0x80 | (codePoint & 0x3F));
+    };
+  }
+
+  DeserializationError ParseString(std::string &text)
+  {
+
+    next++;
+
+    while (true)
+    {
+
+      if (next == end)
+        return DeserializationError::IncompleteInput;
+
+      char c = *next++;
+
+      if (c == '"')
+        return DeserializationError::Ok;
+
+      if (c != '\\')
+      {
+        text += c;
+        continue;
+      };
+
+      if (next == end)
+        return DeserializationError::IncompleteInput;
+
+      c = *next++;
+
+      switch (c)
+      {
+      case 'b':
+        text += '\b';
+        break;
+      case 'f':
+        text += '\f';
+        break;
+      case 'n':
+        text += '\n';
+        break;
+      case 'r':
+        text += '\r';
+        break;
+      case 't':
+        text += '\t';
+        break;
+      case 'u':
+      {
+        if (end - next < 4)
+          return DeserializationError::IncompleteInput;
+        char digits[5] = {next[0], next[1], next[2], next[3], '\0'};
+        char *digitsEnd;
+        unsigned long codePoint = strtoul(digits, &digitsEnd, 16);
+        if (digitsEnd != digits + 4)
+          return DeserializationError::InvalidInput;
+        AppendUTF8(text, codePoint);
+        next += 4;
+        break;
+      }
+      default:
+        text += c;
+        break;
+      };
+    };
+  }
+
+  DeserializationError ParseNumber()
+  {
+
+    const char *start = next;
+    bool isFloat = false;
+
+    while ((next < end) && (strchr("+-0123456789.eE", *next) != NULL))
+    {
+      if ((*next == '.') || (*next == 'e') || (*next == 'E'))
+        isFloat = true;
+      next++;
+    };
+
+    if (next == start)
+      return DeserializationError::InvalidInput;
+
+    std::string text(start, next);
+    char *textEnd;
+
+    if (!isFloat)
+    {
+      errno = 0;
+      long long integer = strtoll(text.c_str(), &textEnd, 10);
+      if ((*textEnd == '\0') && (errno != ERANGE))
+      {
+        document.nodes[AddNode(JsonDocument::IntegerNode)].integer = integer;
+        return DeserializationError::Ok;
+      };
+    };
+
+    double number = strtod(text.c_str(), &textEnd);
+    if (*textEnd != '\0')
+      return DeserializationError::InvalidInput;
+
+    document.nodes[AddNode(JsonDocument::FloatNode)].number = number;
+    return DeserializationError::Ok;
+  }
+};
+
+DeserializationError deserializeJson(JsonDocument &document, const char *input, size_t inputLength)
+{
+  JsonParser parser(document, input, inputLength);
+  return parser.Parse();
+}
+
+DeserializationError deserializeJson(JsonDocument &document, const char *input)
+{
+  return deserializeJson(document, input, (input != NULL) ? strlen(input) : 0);
+}
+
+DeserializationError deserializeJson(JsonDocument &document, const String &input)
+{
+  return deserializeJson(document, input.c_str(), input.length());
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+// ArduinoJson for the host build
+//
+// only what the sketch uses: deserializeJson into a JsonDocument, then reading its values by key or index with as<T>(), isNull() and
+// the | operator, which follow ArduinoJson 7 (for example a string is not converted to a number, and reads as 0)
+
+#include "Arduino.h"
+#include <vector>
+
+class JsonDocument;
+
+class JsonVariant
+{
+public:
+  JsonVariant() : document(NULL), node(-1) {}
+  JsonVariant(const JsonDocument *document, int node) : document(document), node(node) {}
+
+  JsonVariant operator[](const char *key) const;
+  JsonVariant operator[](const String &key) const { return (*this)[key.c_str()]; }
+  JsonVariant operator[](int index) const;
+
+  bool isNull() const;
+  size_t size() const;
+
+  template <class T>
+  T as() const;
+
+  template <class T>
+  bool is() const;
+
+  const char *operator|(const char *defaultValue) const;
+  int operator|(int defaultValue) const;
+  float operator|(float defaultValue) const;
+
+private:
+  const JsonDocument *document;
+  int node;
+
+  bool IsInteger() const;
+  bool IsNumber() const;
+  long long Integer() const;
+  double Number() const;
+};
+
+class JsonDocument
+{
+public:
+  JsonVariant operator[](const char *key) const { return root()[key]; }
+  JsonVariant operator[](const String &key) const { return root()[key.c_str()]; }
+  JsonVariant operator[](int index) const { return root()[index]; }
+  JsonVariant root() const { return JsonVariant(this, nodes.empty() ? -1 : 0); }
+  bool isNull() const { return root().isNull(); }
+  void clear() { nodes.clear(); }
+
+private:
+  friend class JsonVariant;
+  friend class JsonParser;
+
+  enum nodeType
+  {
+    NullNode,
+    BoolNode,
+    IntegerNode,
+    FloatNode,
+    StringNode,
+    ArrayNode,
+    ObjectNode
+  };
+
+  struct jsonNode
+  {
+    nodeType type;
+    long long integer;
+    double number;
+    std::string text;                  // a string's value, or a member's key
+    std::vector<int> children;         // an array's elements, or an object's members
+  };
+
+  std::vector<jsonNode> nodes;
+};
+
+class DeserializationError
+{
+public:
+  enum Code
+  {
+    Ok,
+    EmptyInput,
+    IncompleteInput,
+    InvalidInput,
+    NoMemory,
+    TooDeep
+  };
+
+  DeserializationError(Code code = Ok) : errorCode(code) {}
+  Code code() const { return errorCode; }
+  explicit operator bool() const { return errorCode != Ok; }
+  bool operator==(Code code) const { return errorCode == code; }
+  bool operator!=(Code code) const { return errorCode != code; }
+  const char *c_str() const;
+
+private:
+  Code errorCode;
+};
+
+DeserializationError deserializeJson(JsonDocument &document, const char *input, size_t inputLength);
+DeserializationError deserializeJson(JsonDocument &document, const char *input);
+DeserializationError deserializeJson(JsonDocument &document, const String &input);
+
+template <>
+inline const char *JsonVariant::as<const char *>() const
+{
+  return (!isNull() && (document->nodes[node].type == JsonDocument::StringNode)) ? document->nodes[node].text.c_str() : NULL;
+}
+
+template <>
+inline String JsonVariant::as<String>() const
+{
+  const char *text = as<const char *>();
+  return String((text != NULL) ? text : "null");
+}
+
+template <>
+inline bool JsonVariant::as<bool>() const
+{
+  return IsNumber() ? (Number() != 0.0) : false;
+}
+
+template <>
+inline double JsonVariant::as<double>() const
+{
+  return IsNumber() ? Number() : 0.0;
+}
+
+template <>
+inline float JsonVariant::as<float>() const
+{
+  return (float)as<double>();
+}
+
+template <>
+inline long long JsonVariant::as<long long>() const
+{
+  return IsNumber() ? Integer() : 0;
+}
+
+template <>
+inline int JsonVariant::as<int>() const
+{
+  return (int)as<long long>();
+}
+
+template <>
+inline long JsonVariant::as<long>() const
+{
+  return (long)as<long long>();
+}
+
+template <>
+inline unsigned int JsonVariant::as<unsigned int>() const
+{
+  return (unsigned int)as<long long>();
+}
+
+template <>
+inline unsigned long JsonVariant::as<unsigned long>() const
+{
+  return (unsigned long)as<long long>();
+}
+
+template <>
+inline bool JsonVariant::is<const char *>() const
+{
+  return as<const char *>() != NULL;
+}
+
+template <>
+inline bool JsonVariant::is<int>() const
+{
+  return IsInteger();
+}
+
+template <>
+inline bool JsonVariant::is<float>() const
+{
+  return IsNumber() && (document->nodes[node].type != JsonDocument::BoolNode);
+}
+
+inline const char *JsonVariant::operator|(const char *defaultValue) const
+{
+  return is<const char *>() ? as<const char *>() : defaultValue;
+}
+
+inline int JsonVariant::operator|(int defaultValue) const
+{
+  return is<int>() ? as<int>() : defaultValue;
+}
+
+inline float JsonVariant::operator|(float defaultValue) const
+{
+  return is<float>() ? as<float>() : defaultValue;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// ESP32Time for the host build; the sketch includes the library but does not use it
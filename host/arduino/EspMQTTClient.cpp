@@ -0,0 +1,176 @@
+#include "EspMQTTClient.h"
+#include "WiFi.h"
+#include "host_board.h"
+#include "host_broker.h"
+
+ArduinoOTAClass ArduinoOTA;
+
+static const unsigned long reconnectionDelay = 15000UL; // as EspMQTTClient's default
+
+EspMQTTClient::EspMQTTClient(const char *wifiSsid, const char *wifiPassword, const char *mqttServerIp, const char *mqttUsername, const char *mqttPassword,
+                             const char *mqttClientName, short mqttServerPort)
+    : clientName(mqttClientName)
+{
+  (void)wifiSsid;
+  (void)wifiPassword;
+  (void)mqttServerIp;
+  (void)mqttUsername;
+  (void)mqttPassword;
+  (void)mqttServerPort;
+}
+
+void EspMQTTClient::enableDebuggingMessages(const bool enabled)
+{
+  (void)enabled;
+}
+
+void EspMQTTClient::enableOTA(const char *password, const uint16_t port)
+{
+  (void)password;
+  (void)port;
+}
+
+void EspMQTTClient::enableLastWillMessage(const char *topic, const char *message, const bool retain)
+{
+  willTopic = topic;
+  willMessage = message;
+  willRetain = retain;
+}
+
+bool EspMQTTClient::setMaxPacketSize(const uint16_t size)
+{
+  maximumPacketSize = size;
+  return true;
+}
+
+void EspMQTTClient::setOnConnectionEstablishedCallback(ConnectionEstablishedCallback callback)
+{
+  connectionEstablishedCallback = callback;
+}
+
+bool EspMQTTClient::isMqttConnected() const
+{
+  return HostBroker().IsConnected(connection);
+}
+
+void EspMQTTClient::loop()
+{
+
+  if (!wifiConnected)
+  {
+    wifiConnected = true;
+    HostWiFiConnected();
+  };
+
+  if (mqttWasConnected && !isMqttConnected())
+  {
+    mqttWasConnected = false;
+    subscriptions.clear();
+    lastConnectionAttempt = millis();
+  };
+
+  if (!isMqttConnected())
+  {
+
+    if (connectionAttempted && (millis() - lastConnectionAttempt < reconnectionDelay))
+      return;
+
+    connectionAttempted = true;
+    lastConnectionAttempt = millis();
+
+    connection = HostBroker().Connect(clientName, willTopic, willMessage, willRetain);
+    if (connection < 0)
+      return;
+
+    mqttWasConnected = true;
+
+    if (connectionEstablishedCallback)
+      connectionEstablishedCallback();
+    else
+      onConnectionEstablished();
+
+    return;
+  };
+
+  hostMessage message;
+  if (!HostBroker().Receive(connection, message))
+    return;
+
+  // the packet is the fixed header (with up to four bytes for its length), the topic's length and the topic, then the payload
+  size_t remainingLength = 2 + message.topic.size() + message.payload.size();
+  size_t packetSize = 1 + ((remainingLength < 128) ? 1 : (remainingLength < 16384) ? 2 : 3) + remainingLength;
+
+  if (packetSize > maximumPacketSize)
+  {
+    messagesDropped++;
+    return;
+  };
+
+  String topic(message.topic);
+  String payload(message.payload);
+
+  // a callback may subscribe or unsubscribe, so the subscriptions are worked through from a copy
+  std::vector<subscription> matching;
+  for (const subscription &subscribed : subscriptions)
+    if (hostBroker::TopicMatches(subscribed.topic.str(), message.topic))
+      matching.push_back(subscribed);
+
+  for (const subscription &subscribed : matching)
+  {
+    if (subscribed.callback)
+      subscribed.callback(payload);
+    else
+      subscribed.callbackWithTopic(topic, payload);
+  };
+
+  if (recordingCallbackLatencies)
+    callbackLatencies.push_back(HostMicroSeconds() - message.publishedAt);
+}
+
+std::vector<uint64_t> EspMQTTClient::hostTakeCallbackLatencies()
+{
+  std::vector<uint64_t> latencies;
+  latencies.swap(callbackLatencies);
+  return latencies;
+}
+
+bool EspMQTTClient::publish(const String &topic, const String &payload, bool retain)
+{
+  return HostBroker().Publish(connection, topic.str(), payload.str(), retain);
+}
+
+bool EspMQTTClient::Subscribe(const subscription &added)
+{
+
+  if (!HostBroker().Subscribe(connection, added.topic.str()))
+    return false;
+
+  subscriptions.push_back(added);
+
+  return true;
+}
+
+bool EspMQTTClient::subscribe(const String &topic, MessageReceivedCallback messageReceivedCallback, uint8_t qos)
+{
+  (void)qos;
+  return Subscribe(subscription{topic, messageReceivedCallback, NULL});
+}
+
+bool EspMQTTClient::subscribe(const String &topic, MessageReceivedCallbackWithTopic messageReceivedCallback, uint8_t qos)
+{
+  (void)qos;
+  return Subscribe(subscription{topic, NULL, messageReceivedCallback});
+}
+
+bool EspMQTTClient::unsubscribe(const String &topic)
+{
+
+  if (!HostBroker().Unsubscribe(connection, topic.str()))
+    return false;
+
+  for (size_t i = subscriptions.size(); i-- > 0;)
+    if (subscriptions[i].topic == topic)
+      subscriptions.erase(subscriptions.begin() + i);
+
+  return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// EspMQTTClient for the host build
+//
+// connects to the host broker (see host_board.h) on the first call of loop(), much as the real client connects once Wi-Fi is up, and
+// reconnects fifteen seconds after the connection is lost, calling onConnectionEstablished() (or the callback set) each time
+//
+// as with PubSubClient, which the real client is built on, loop() delivers at most one message each time it is called, and a message
+// that does not fit in the maximum packet size is dropped
+
+#include "Arduino.h"
+#include <vector>
+
+typedef std::function<void()> ConnectionEstablishedCallback;
+typedef std::function<void(const String &message)> MessageReceivedCallback;
+typedef std::function<void(const String &topicStr, const String &message)> MessageReceivedCallbackWithTopic;
+
+void onConnectionEstablished();
+
+class EspMQTTClient
+{
+public:
+  EspMQTTClient(const char *wifiSsid, const char *wifiPassword, const char *mqttServerIp, const char *mqttUsername, const char *mqttPassword,
+                const char *mqttClientName = "ESP8266", short mqttServerPort = 1883);
+
+  void enableDebuggingMessages(const bool enabled = true);
+  void enableOTA(const char *password = NULL, const uint16_t port = 0);
+  void enableLastWillMessage(const char *topic, const char *message, const bool retain = false);
+  bool setMaxPacketSize(const uint16_t size);
+  void setOnConnectionEstablishedCallback(ConnectionEstablishedCallback callback);
+
+  void loop();
+
+  bool isConnected() const { return isWifiConnected() && isMqttConnected(); }
+  bool isWifiConnected() const { return wifiConnected; }
+  bool isMqttConnected() const;
+
+  bool publish(const String &topic, const String &payload, bool retain = false);
+  bool subscribe(const String &topic, MessageReceivedCallback messageReceivedCallback, uint8_t qos = 0);
+  bool subscribe(const String &topic, MessageReceivedCallbackWithTopic messageReceivedCallback, uint8_t qos = 0);
+  bool unsubscribe(const String &topic);
+
+  const char *getMqttClientName() const { return clientName.c_str(); }
+
+  // the host broker's number for the current connection (or -1), and the messages dropped as they were too large
+  int hostConnection() const { return connection; }
+  unsigned long hostMessagesDropped() const { return messagesDropped; }
+
+  // while recording, the time from each message delivered being published to its callbacks returning, in microseconds of the virtual
+  // clock; taking them clears those recorded
+  void hostRecordCallbackLatencies(bool record) { recordingCallbackLatencies = record; }
+  std::vector<uint64_t> hostTakeCallbackLatencies();
+
+private:
+  struct subscription
+  {
+    String topic;
+    MessageReceivedCallback callback;
+    MessageReceivedCallbackWithTopic callbackWithTopic;
+  };
+
+  std::string clientName;
+  std::string willTopic;
+  std::string willMessage;
+  bool willRetain = false;
+  uint16_t maximumPacketSize = 256;
+  ConnectionEstablishedCallback connectionEstablishedCallback;
+
+  bool wifiConnected = false;
+  bool mqttWasConnected = false;
+  int connection = -1;
+  unsigned long lastConnectionAttempt = 0;
+  bool connectionAttempted = false;
+  unsigned long messagesDropped = 0;
+  bool recordingCallbackLatencies = false;
+  std::vector<uint64_t> callbackLatencies;
+
+  std::vector<subscription> subscriptions;
+
+  bool Subscribe(const subscription &added);
+};
+
+class ArduinoOTAClass
+{
+public:
+  void handle() {}
+};
+
+extern ArduinoOTAClass ArduinoOTA;
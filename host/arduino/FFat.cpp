@@ -0,0 +1,3 @@
+#include "FFat.h"
+
+F_Fat FFat;
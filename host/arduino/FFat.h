@@ -0,0 +1,22 @@
+#pragma once
+
+// FFat for the host build: there is no FAT partition, so begin() fails and the sketch does not keep its telemetry log
+
+#include <stddef.h>
+#include <stdint.h>
+
+class F_Fat
+{
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/ffat", uint8_t maxOpenFiles = 10, const char *partitionLabel = "ffat")
+  {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    return false;
+  }
+  size_t freeBytes() { return 0; }
+};
+
+extern F_Fat FFat;
@@ -0,0 +1,38 @@
+#pragma once
+
+// FireTimer for the host build; as with the library, begin() only starts the timer
+
+#include "Arduino.h"
+
+class FireTimer
+{
+public:
+  void begin(const unsigned long &timeout, const bool &inMicroSeconds = false)
+  {
+    this->inMicroSeconds = inMicroSeconds;
+    update(timeout);
+  }
+
+  void update(const unsigned long &timeout)
+  {
+    this->timeout = timeout;
+    start();
+  }
+
+  void start() { startedAt = inMicroSeconds ? micros() : millis(); }
+
+  bool fire(const bool &reset = true)
+  {
+    unsigned long now = inMicroSeconds ? micros() : millis();
+    if (now - startedAt < timeout)
+      return false;
+    if (reset)
+      startedAt = now;
+    return true;
+  }
+
+private:
+  unsigned long timeout = 0;
+  unsigned long startedAt = 0;
+  bool inMicroSeconds = false;
+};
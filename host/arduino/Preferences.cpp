@@ -0,0 +1,41 @@
+#include "Preferences.h"
+#include <map>
+
+static std::map<std::string, std::string> storedValues; // keyed on the name space and the key
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel)
+{
+  (void)partitionLabel;
+  this->name = name;
+  this->readOnly = readOnly;
+  opened = true;
+  return true;
+}
+
+void Preferences::end()
+{
+  opened = false;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+  if (!opened || readOnly)
+    return 0;
+  storedValues[name + "/" + key] = std::string((const char *)value, length);
+  return length;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maximumLength)
+{
+
+  if (!opened)
+    return 0;
+
+  auto stored = storedValues.find(name + "/" + key);
+  if ((stored == storedValues.end()) || (stored->second.size() > maximumLength))
+    return 0;
+
+  memcpy(buffer, stored->second.data(), stored->second.size());
+
+  return stored->second.size();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Preferences for the host build, kept in memory for as long as the host runs
+
+#include "Arduino.h"
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partitionLabel = NULL);
+  void end();
+  size_t putBytes(const char *key, const void *value, size_t length);
+  size_t getBytes(const char *key, void *buffer, size_t maximumLength);
+
+private:
+  std::string name;
+  bool readOnly = false;
+  bool opened = false;
+};
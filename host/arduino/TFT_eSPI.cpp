@@ -0,0 +1,494 @@
+#include "TFT_eSPI.h"
+
+static uint32_t ReadBigEndian32(const uint8_t *bytes)
+{
+  return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+static uint16_t DecodeUTF8(const uint8_t *&text)
+{
+
+  uint16_t c = *text++;
+
+  if ((c & 0xE0) == 0xC0)
+  {
+    if ((*text & 0xC0) != 0x80)
+      return c;
+    return ((c & 0x1F) << 6) | (*text++ & 0x3F);
+  };
+
+  if ((c & 0xF0) == 0xE0)
+  {
+    if (((text[0] & 0xC0) != 0x80) || ((text[1] & 0xC0) != 0x80))
+      return c;
+    c = ((c & 0x0F) << 12) | ((text[0] & 0x3F) << 6) | (text[1] & 0x3F);
+    text += 2;
+    return c;
+  };
+
+  return c;
+}
+
+void *TFT_eSprite::createSprite(int16_t width, int16_t height, uint8_t frames)
+{
+  (void)frames;
+  spriteWidth = width;
+  spriteHeight = height;
+  pixels.assign((size_t)width * height, 0);
+  return pixels.data();
+}
+
+void TFT_eSprite::deleteSprite()
+{
+  pixels.clear();
+  spriteWidth = 0;
+  spriteHeight = 0;
+}
+
+void TFT_eSprite::fillSprite(uint32_t colour)
+{
+  fillRect(0, 0, spriteWidth, spriteHeight, colour);
+}
+
+void TFT_eSprite::drawPixel(int32_t x, int32_t y, uint32_t colour)
+{
+  if ((x < 0) || (y < 0) || (x >= spriteWidth) || (y >= spriteHeight))
+    return;
+  uint16_t c = (uint16_t)colour;
+  pixels[(size_t)y * spriteWidth + x] = (uint16_t)((c >> 8) | (c << 8));
+}
+
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y) const
+{
+  if ((x < 0) || (y < 0) || (x >= spriteWidth) || (y >= spriteHeight))
+    return 0xFFFF;
+  uint16_t c = pixels[(size_t)y * spriteWidth + x];
+  return (uint16_t)((c >> 8) | (c << 8));
+}
+
+void TFT_eSprite::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t colour)
+{
+  fillRect(x, y, w, 1, colour);
+}
+
+void TFT_eSprite::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t colour)
+{
+  fillRect(x, y, 1, h, colour);
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t colour)
+{
+
+  if (w < 0)
+  {
+    x += w;
+    w = -w;
+  };
+
+  if (h < 0)
+  {
+    y += h;
+    h = -h;
+  };
+
+  int32_t left = std::max<int32_t>(x, 0);
+  int32_t top = std::max<int32_t>(y, 0);
+  int32_t right = std::min<int32_t>(x + w, spriteWidth);
+  int32_t bottom = std::min<int32_t>(y + h, spriteHeight);
+
+  uint16_t c = (uint16_t)colour;
+  uint16_t swapped = (uint16_t)((c >> 8) | (c << 8));
+
+  for (int32_t row = top; row < bottom; row++)
+    for (int32_t column = left; column < right; column++)
+      pixels[(size_t)row * spriteWidth + column] = swapped;
+}
+
+void TFT_eSprite::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t colour)
+{
+  drawFastHLine(x, y, w, colour);
+  drawFastHLine(x, y + h - 1, w, colour);
+  drawFastVLine(x, y + 1, h - 2, colour);
+  drawFastVLine(x + w - 1, y + 1, h - 2, colour);
+}
+
+void TFT_eSprite::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t colour)
+{
+
+  int32_t dx = abs(x1 - x0);
+  int32_t dy = -abs(y1 - y0);
+  int32_t stepX = (x0 < x1) ? 1 : -1;
+  int32_t stepY = (y0 < y1) ? 1 : -1;
+  int32_t error = dx + dy;
+
+  while (true)
+  {
+    drawPixel(x0, y0, colour);
+    if ((x0 == x1) && (y0 == y1))
+      break;
+    int32_t error2 = 2 * error;
+    if (error2 >= dy)
+    {
+      error += dy;
+      x0 += stepX;
+    };
+    if (error2 <= dx)
+    {
+      error += dx;
+      y0 += stepY;
+    };
+  };
+}
+
+void TFT_eSprite::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t colour)
+{
+
+  // as TFT_eSPI (and the Adafruit GFX library it follows): the corners are sorted by y, then the triangle is filled a line at a time
+
+  if (y0 > y1)
+  {
+    std::swap(y0, y1);
+    std::swap(x0, x1);
+  };
+
+  if (y1 > y2)
+  {
+    std::swap(y2, y1);
+    std::swap(x2, x1);
+  };
+
+  if (y0 > y1)
+  {
+    std::swap(y0, y1);
+    std::swap(x0, x1);
+  };
+
+  if (y0 == y2)
+  {
+    int32_t a = std::min(x0, std::min(x1, x2));
+    int32_t b = std::max(x0, std::max(x1, x2));
+    drawFastHLine(a, y0, b - a + 1, colour);
+    return;
+  };
+
+  int32_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0, dx12 = x2 - x1, dy12 = y2 - y1;
+  int32_t sa = 0, sb = 0;
+  int32_t last = (y1 == y2) ? y1 : y1 - 1;
+  int32_t y;
+
+  for (y = y0; y <= last; y++)
+  {
+    int32_t a = x0 + sa / dy01;
+    int32_t b = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+    if (a > b)
+      std::swap(a, b);
+    drawFastHLine(a, y, b - a + 1, colour);
+  };
+
+  sa = dx12 * (y - y1);
+  sb = dx02 * (y - y0);
+
+  for (; y <= y2; y++)
+  {
+    int32_t a = x1 + sa / dy12;
+    int32_t b = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+    if (a > b)
+      std::swap(a, b);
+    drawFastHLine(a, y, b - a + 1, colour);
+  };
+}
+
+uint16_t TFT_eSprite::alphaBlend(uint8_t alpha, uint16_t fgColour, uint16_t bgColour)
+{
+
+  // as TFT_eSPI: each component is widened to six bits (plus a half) and the blend is rounded down
+
+  uint16_t fgR = ((fgColour >> 10) & 0x3E) + 1;
+  uint16_t fgG = ((fgColour >> 4) & 0x7E) + 1;
+  uint16_t fgB = ((fgColour << 1) & 0x3E) + 1;
+
+  uint16_t bgR = ((bgColour >> 10) & 0x3E) + 1;
+  uint16_t bgG = ((bgColour >> 4) & 0x7E) + 1;
+  uint16_t bgB = ((bgColour << 1) & 0x3E) + 1;
+
+  uint16_t r = (((fgR * alpha) + (bgR * (255 - alpha))) >> 9);
+  uint16_t g = (((fgG * alpha) + (bgG * (255 - alpha))) >> 9);
+  uint16_t b = (((fgB * alpha) + (bgB * (255 - alpha))) >> 9);
+
+  return (uint16_t)((r << 11) | (g << 5) | (b << 0));
+}
+
+void TFT_eSprite::drawSmoothArc(int32_t x, int32_t y, int32_t r, int32_t ir, uint32_t startAngle, uint32_t endAngle, uint32_t fgColour, uint32_t bgColour, bool roundEnds)
+{
+
+  // each pixel within the ring is blended by how much of it lies between the two radii; the ends are cut square
+
+  (void)roundEnds;
+
+  if (startAngle == endAngle)
+    return;
+
+  bool fullCircle = (endAngle - startAngle) % 360 == 0;
+  startAngle %= 360;
+  endAngle %= 360;
+
+  for (int32_t row = y - r - 1; row <= y + r + 1; row++)
+    for (int32_t column = x - r - 1; column <= x + r + 1; column++)
+    {
+
+      float dx = (float)(column - x);
+      float dy = (float)(row - y);
+      float distance = sqrtf(dx * dx + dy * dy);
+
+      float outer = (float)r + 0.5F - distance;
+      float inner = distance - ((float)ir - 0.5F);
+      float coverage = std::min(1.0F, std::min(outer, inner));
+
+      if (coverage <= 0.0F)
+        continue;
+
+      if (!fullCircle)
+      {
+        float angle = atan2f(-dx, dy) * 180.0F / (float)M_PI;
+        if (angle < 0.0F)
+          angle += 360.0F;
+        bool inside = (startAngle < endAngle) ? ((angle >= startAngle) && (angle <= endAngle)) : ((angle >= startAngle) || (angle <= endAngle));
+        if (!inside)
+          continue;
+      };
+
+      drawPixel(column, row, alphaBlend((uint8_t)(coverage * 255.0F + 0.5F), (uint16_t)fgColour, (uint16_t)bgColour));
+    };
+}
+
+void TFT_eSprite::loadFont(const uint8_t array[])
+{
+
+  // the .vlw format: a header of six big endian 32 bit numbers, a record of seven for each glyph, then the glyphs' alpha bitmaps
+
+  unloadFont();
+
+  font = array;
+
+  uint32_t glyphCount = ReadBigEndian32(&font[0]);
+  ascent = (uint16_t)ReadBigEndian32(&font[16]);
+  descent = (uint16_t)ReadBigEndian32(&font[20]);
+  maxAscent = ascent;
+  maxDescent = descent;
+
+  const uint8_t *record = &font[24];
+  const uint8_t *bitmap = &font[24 + glyphCount * 28];
+
+  for (uint32_t i = 0; i < glyphCount; i++, record += 28)
+  {
+
+    glyph g;
+    g.unicode = (uint16_t)ReadBigEndian32(&record[0]);
+    g.height = (uint8_t)ReadBigEndian32(&record[4]);
+    g.width = (uint8_t)ReadBigEndian32(&record[8]);
+    g.xAdvance = (uint8_t)ReadBigEndian32(&record[12]);
+    g.dY = (int16_t)ReadBigEndian32(&record[16]);
+    g.dX = (int8_t)ReadBigEndian32(&record[20]);
+    g.bitmap = bitmap;
+    bitmap += g.width * g.height;
+
+    // as TFT_eSPI, the font's extent is taken from the printable ASCII characters only
+    if ((g.unicode > 0x20) && (g.unicode < 0x7F))
+    {
+      if (g.dY > (int16_t)maxAscent)
+        maxAscent = (uint16_t)g.dY;
+      if ((int16_t)g.height - g.dY > (int16_t)maxDescent)
+        maxDescent = (uint16_t)(g.height - g.dY);
+    };
+
+    glyphs.push_back(g);
+  };
+
+  spaceWidth = (uint16_t)((ascent + descent) * 2 / 7);
+}
+
+void TFT_eSprite::unloadFont()
+{
+  font = NULL;
+  glyphs.clear();
+}
+
+void TFT_eSprite::setTextColor(uint16_t fgColour, uint16_t bgColour, bool bgFill)
+{
+  (void)bgFill;
+  textColour = fgColour;
+  textBackgroundColour = bgColour;
+}
+
+int16_t TFT_eSprite::fontHeight() const
+{
+  return (font != NULL) ? (int16_t)(maxAscent + maxDescent) : 8;
+}
+
+const TFT_eSprite::glyph *TFT_eSprite::FindGlyph(uint16_t unicode) const
+{
+  for (const glyph &g : glyphs)
+    if (g.unicode == unicode)
+      return &g;
+  return NULL;
+}
+
+int16_t TFT_eSprite::textWidth(const char *text)
+{
+
+  const uint8_t *next = (const uint8_t *)text;
+
+  // without a smooth font the sketch would be using TFT_eSPI's built in font, which is six pixels wide
+  if (font == NULL)
+    return (int16_t)(strlen(text) * 6);
+
+  int16_t width = 0;
+
+  while (*next != '\0')
+  {
+
+    uint16_t unicode = DecodeUTF8(next);
+
+    // as with TFT_eSPI, a space is always the font's space width, whether or not the font has a glyph for it
+    if (unicode == ' ')
+    {
+      width += spaceWidth;
+      continue;
+    };
+
+    const glyph *g = FindGlyph(unicode);
+
+    if (g == NULL)
+    {
+      width += spaceWidth + 1;
+      continue;
+    };
+
+    if ((width == 0) && (g->dX < 0))
+      width -= g->dX;
+
+    // the last character is measured to the end of its ink, the others to where the next would start
+    if (*next != '\0')
+      width += g->xAdvance;
+    else
+      width += g->dX + g->width;
+  };
+
+  return width;
+}
+
+void TFT_eSprite::DrawGlyph(uint16_t unicode, int32_t &cursorX, int32_t cursorY)
+{
+
+  if (unicode == ' ')
+  {
+    cursorX += spaceWidth;
+    return;
+  };
+
+  const glyph *g = FindGlyph(unicode);
+
+  // as with TFT_eSPI, a character the font does not have is shown as a box
+  if (g == NULL)
+  {
+    drawRect(cursorX, cursorY + maxAscent - ascent, spaceWidth, ascent, textColour);
+    cursorX += spaceWidth + 1;
+    return;
+  };
+
+  int32_t top = cursorY + maxAscent - g->dY;
+  int32_t left = cursorX + g->dX;
+
+  for (int32_t y = 0; y < g->height; y++)
+    for (int32_t x = 0; x < g->width; x++)
+    {
+
+      uint8_t alpha = g->bitmap[y * g->width + x];
+      if (alpha == 0)
+        continue;
+
+      if (alpha == 0xFF)
+      {
+        drawPixel(left + x, top + y, textColour);
+        continue;
+      };
+
+      // with the same foreground and background colours the text is drawn over what is already there
+      uint16_t background = (textColour == textBackgroundColour) ? readPixel(left + x, top + y) : textBackgroundColour;
+      drawPixel(left + x, top + y, alphaBlend(alpha, textColour, background));
+    };
+
+  cursorX += g->xAdvance;
+}
+
+int16_t TFT_eSprite::drawString(const char *text, int32_t x, int32_t y)
+{
+
+  int16_t width = textWidth(text);
+  int16_t height = fontHeight();
+  int16_t baseline = (font != NULL) ? (int16_t)maxAscent : 7;
+
+  switch (textDatum)
+  {
+  case TC_DATUM:
+    x -= width / 2;
+    break;
+  case TR_DATUM:
+    x -= width;
+    break;
+  case ML_DATUM:
+    y -= height / 2;
+    break;
+  case MC_DATUM:
+    x -= width / 2;
+    y -= height / 2;
+    break;
+  case MR_DATUM:
+    x -= width;
+    y -= height / 2;
+    break;
+  case BL_DATUM:
+    y -= height;
+    break;
+  case BC_DATUM:
+    x -= width / 2;
+    y -= height;
+    break;
+  case BR_DATUM:
+    x -= width;
+    y -= height;
+    break;
+  case L_BASELINE:
+    y -= baseline;
+    break;
+  case C_BASELINE:
+    x -= width / 2;
+    y -= baseline;
+    break;
+  case R_BASELINE:
+    x -= width;
+    y -= baseline;
+    break;
+  };
+
+  if (font == NULL)
+  {
+    // the built in font is not drawn, only the space each character would take
+    for (const char *c = text; *c != '\0'; c++, x += 6)
+      if (*c != ' ')
+        fillRect(x + 1, y + 1, 4, 6, textColour);
+    return width;
+  };
+
+  const uint8_t *next = (const uint8_t *)text;
+  int32_t cursorX = x;
+
+  while (*next != '\0')
+    DrawGlyph(DecodeUTF8(next), cursorX, y);
+
+  return width;
+}
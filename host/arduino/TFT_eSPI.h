@@ -0,0 +1,119 @@
+#pragma once
+
+// TFT_eSPI for the host build
+//
+// a sprite which really draws, so that what the sketch shows can be checked on the host: the smooth (.vlw) fonts are read and blended
+// as TFT_eSPI does, with the same text datums, triangles are filled with TFT_eSPI's algorithm, and arcs are anti-aliased at their edges
+// (though not pixel for pixel as TFT_eSPI does)
+//
+// as with TFT_eSPI, each pixel of a 16 bit sprite is held with its bytes swapped, ready to be sent to the panel
+
+#include "Arduino.h"
+#include <vector>
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_MAROON 0x7800
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+#define TFT_ORANGE 0xFDA0
+#define TFT_GOLD 0xFEA0
+#define TFT_SILVER 0xC618
+#define TFT_SKYBLUE 0x867D
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+#define L_BASELINE 9
+#define C_BASELINE 10
+#define R_BASELINE 11
+
+class TFT_eSPI
+{
+public:
+  TFT_eSPI() {}
+};
+
+class TFT_eSprite
+{
+public:
+  TFT_eSprite(TFT_eSPI *tft) { (void)tft; }
+
+  void *createSprite(int16_t width, int16_t height, uint8_t frames = 1);
+  void deleteSprite();
+  void *getPointer() { return pixels.empty() ? NULL : pixels.data(); }
+  void setSwapBytes(bool swap) { swapBytes = swap; }
+  int16_t width() const { return spriteWidth; }
+  int16_t height() const { return spriteHeight; }
+
+  void fillSprite(uint32_t colour);
+  void drawPixel(int32_t x, int32_t y, uint32_t colour);
+  uint16_t readPixel(int32_t x, int32_t y) const;
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t colour);
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t colour);
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t colour);
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t colour);
+  void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t colour);
+  void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t colour);
+
+  // the angles are in degrees, clockwise from the bottom of the arc, as with TFT_eSPI
+  void drawSmoothArc(int32_t x, int32_t y, int32_t r, int32_t ir, uint32_t startAngle, uint32_t endAngle, uint32_t fgColour, uint32_t bgColour, bool roundEnds = false);
+
+  void loadFont(const uint8_t array[]);
+  void unloadFont();
+  void setTextDatum(uint8_t datum) { textDatum = datum; }
+  void setTextColor(uint16_t fgColour, uint16_t bgColour, bool bgFill = false);
+  int16_t textWidth(const char *text);
+  int16_t textWidth(const String &text) { return textWidth(text.c_str()); }
+  int16_t fontHeight() const;
+  int16_t drawString(const char *text, int32_t x, int32_t y);
+  int16_t drawString(const String &text, int32_t x, int32_t y) { return drawString(text.c_str(), x, y); }
+
+  static uint16_t alphaBlend(uint8_t alpha, uint16_t fgColour, uint16_t bgColour);
+
+private:
+  struct glyph
+  {
+    uint16_t unicode;
+    uint8_t height;
+    uint8_t width;
+    uint8_t xAdvance;
+    int16_t dY;
+    int8_t dX;
+    const uint8_t *bitmap;
+  };
+
+  std::vector<uint16_t> pixels;
+  int16_t spriteWidth = 0;
+  int16_t spriteHeight = 0;
+  bool swapBytes = false;
+
+  const uint8_t *font = NULL;
+  std::vector<glyph> glyphs;
+  uint16_t ascent = 0;
+  uint16_t descent = 0;
+  uint16_t maxAscent = 0;
+  uint16_t maxDescent = 0;
+  uint16_t spaceWidth = 0;
+
+  uint8_t textDatum = TL_DATUM;
+  uint16_t textColour = TFT_WHITE;
+  uint16_t textBackgroundColour = TFT_BLACK;
+
+  const glyph *FindGlyph(uint16_t unicode) const;
+  void DrawGlyph(uint16_t unicode, int32_t &cursorX, int32_t cursorY);
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+// TimeLib for the host build: only the parts of a time_t the sketch uses, which as with the library take no account of the time zone
+
+#include <time.h>
+
+inline int second(time_t t)
+{
+  return (int)(t % 60);
+}
+
+inline int minute(time_t t)
+{
+  return (int)((t / 60) % 60);
+}
+
+inline int hour(time_t t)
+{
+  return (int)((t / 3600) % 24);
+}
@@ -0,0 +1,106 @@
+#include "WebServer.h"
+#include "host_board.h"
+
+// the server the sketch starts, which the host's requests are made of
+static WebServer *startedServer = NULL;
+
+WebServer::WebServer(int port)
+{
+  (void)port;
+}
+
+void WebServer::begin()
+{
+  started = true;
+  startedServer = this;
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler)
+{
+  (void)method;
+  handlers[uri.str()] = handler;
+}
+
+bool WebServer::hasArg(const String &name) const
+{
+  return arguments.count(name.str()) > 0;
+}
+
+String WebServer::arg(const String &name) const
+{
+  auto argument = arguments.find(name.str());
+  return (argument != arguments.end()) ? String(argument->second) : String();
+}
+
+void WebServer::send(int code, const char *contentType, const String &content)
+{
+  status = code;
+  this->contentType = contentType;
+  body += content.str();
+}
+
+void WebServer::sendContent(const String &content)
+{
+  body += content.str();
+}
+
+void WebServer::sendContent(const char *content, size_t contentLength)
+{
+  body.append(content, contentLength);
+}
+
+hostHttpResponse HostHttpGet(const char *uri)
+{
+
+  hostHttpResponse response = {0, "", ""};
+
+  WebServer *server = startedServer;
+  if (server == NULL)
+    return response;
+
+  std::string path(uri);
+  std::string query;
+
+  size_t questionMark = path.find('?');
+  if (questionMark != std::string::npos)
+  {
+    query = path.substr(questionMark + 1);
+    path.erase(questionMark);
+  };
+
+  server->arguments.clear();
+
+  size_t start = 0;
+  while (start < query.size())
+  {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos)
+      end = query.size();
+    std::string argument = query.substr(start, end - start);
+    size_t equals = argument.find('=');
+    if (equals == std::string::npos)
+      server->arguments[argument] = "";
+    else
+      server->arguments[argument.substr(0, equals)] = argument.substr(equals + 1);
+    start = end + 1;
+  };
+
+  auto handler = server->handlers.find(path);
+  if (handler == server->handlers.end())
+  {
+    response.status = 404;
+    return response;
+  };
+
+  server->status = 0;
+  server->contentType.clear();
+  server->body.clear();
+
+  handler->second();
+
+  response.status = server->status;
+  response.contentType = server->contentType;
+  response.body = server->body;
+
+  return response;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// WebServer for the host build
+//
+// no socket is opened: the requests are made with HostHttpGet (see host_board.h), which calls the handler for the URI and returns what
+// it sent, with the chunks of a response of unknown length joined together
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include <map>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+enum HTTPMethod
+{
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_POST
+};
+
+class WebServer
+{
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  WebServer(int port = 80);
+
+  void begin();
+  void handleClient() {}
+  void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+
+  bool hasArg(const String &name) const;
+  String arg(const String &name) const;
+
+  void setContentLength(const size_t contentLength) { (void)contentLength; }
+  void send(int code, const char *contentType, const String &content);
+  void sendContent(const String &content);
+  void sendContent(const char *content, size_t contentLength);
+
+private:
+  friend struct hostHttpResponse HostHttpGet(const char *uri);
+
+  std::map<std::string, THandlerFunction> handlers;
+  std::map<std::string, std::string> arguments;
+  bool started = false;
+  int status = 0;
+  std::string contentType;
+  std::string body;
+};
@@ -0,0 +1,33 @@
+#include "WiFi.h"
+#include <vector>
+
+WiFiClass WiFi;
+
+struct registeredEvent
+{
+  WiFiEventFuncCb callback;
+  WiFiEvent_t event;
+};
+
+static std::vector<registeredEvent> registeredEvents;
+static bool connected = false;
+
+void WiFiClass::onEvent(WiFiEventFuncCb callback, WiFiEvent_t event)
+{
+  registeredEvents.push_back(registeredEvent{callback, event});
+}
+
+bool WiFiClass::isConnected()
+{
+  return connected;
+}
+
+void HostWiFiConnected()
+{
+
+  connected = true;
+
+  for (const registeredEvent &registered : registeredEvents)
+    if (registered.event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+      registered.callback(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+}
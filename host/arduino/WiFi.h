@@ -0,0 +1,28 @@
+#pragma once
+
+// WiFi for the host build
+//
+// the network is taken to be joined when the MQTT client first connects, at which point the events registered for are raised
+
+#include "Arduino.h"
+
+enum WiFiEvent_t
+{
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7
+};
+
+typedef int WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+
+class WiFiClass
+{
+public:
+  void onEvent(WiFiEventFuncCb callback, WiFiEvent_t event);
+  IPAddress localIP() { return IPAddress(192, 168, 1, 50); }
+  bool isConnected();
+};
+
+extern WiFiClass WiFi;
+
+// called by the host's MQTT client once it has joined the network
+void HostWiFiConnected();
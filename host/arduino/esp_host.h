@@ -0,0 +1,40 @@
+#pragma once
+
+// the parts of the ESP-IDF the sketch uses, for the host build
+//
+// PSRAM is taken to be present, and is allocated from the host's heap
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERROR_CHECK(x) (void)(x)
+
+typedef enum
+{
+  GPIO_NUM_0 = 0,
+  GPIO_NUM_21 = 21
+} gpio_num_t;
+
+class EspClass
+{
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+};
+
+extern EspClass ESP;
+
+bool psramFound();
+void *ps_malloc(size_t size);
+
+// deep sleep ends the run: the host throws hostDeepSleep, which a test can catch to check that the sketch chose to sleep
+struct hostDeepSleep
+{
+  uint64_t wakeUpAfterMicroSeconds;
+};
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t microSeconds);
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level);
+void esp_deep_sleep_start();
@@ -0,0 +1,5 @@
+#pragma once
+
+// the fonts are arrays of bytes, which on the host are read directly
+
+#include "Arduino.h"
@@ -0,0 +1,37 @@
+// running the sketch in the host build
+//
+// kept apart from the Arduino core's shims so that a test which does not link the sketch (and so has no loop()) can still use them
+
+#include "Arduino.h"
+#include "host_board.h"
+
+void loop();
+
+unsigned long HostRunSketch(unsigned long milliSeconds, bool (*stop)())
+{
+
+  // each pass of loop() is taken to last at least a millisecond, about as long as the quickest of those on the device
+
+  const uint64_t shortestPass = 1000ULL;
+
+  uint64_t end = HostMicroSeconds() + (uint64_t)milliSeconds * 1000ULL;
+  unsigned long passes = 0;
+
+  while (HostMicroSeconds() < end)
+  {
+
+    uint64_t passStartedAt = HostMicroSeconds();
+
+    loop();
+    passes++;
+
+    uint64_t passTook = HostMicroSeconds() - passStartedAt;
+    if (passTook < shortestPass)
+      delayMicroseconds((unsigned int)(shortestPass - passTook));
+
+    if ((stop != NULL) && stop())
+      break;
+  };
+
+  return passes;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Host board
+//
+// what a test (or a host tool) uses to drive the sketch in the host build: its virtual clock, its two buttons, its serial port, the
+// panel it draws on and the MQTT broker it connects to
+//
+// the sketch is still run by calling its setup() and loop(); HostRunSketch does so until the virtual clock reaches a given time
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <string>
+
+class hostBroker;
+
+// the virtual clock, in microseconds since the board was started
+uint64_t HostMicroSeconds();
+void HostAdvanceTime(unsigned long milliSeconds);
+
+// the time of day the wall clock is set to by configTime, given as seconds since 1 January 1970 (UTC) at the moment it is set;
+// if this is not called, the wall clock is set to 12:00 UTC on 21 June 2026
+void HostSetWallClock(time_t secondsSince1970);
+
+// run loop() until the virtual clock has moved on by the time given, or until stop returns true; returns the number of passes made
+unsigned long HostRunSketch(unsigned long milliSeconds, bool (*stop)() = NULL);
+
+// hold a button (GPIO 0 or GPIO 21, which are active low) down for the time given, from now or from a time later on (so that a button
+// can be pressed while the sketch waits in loop() for it)
+void HostPressButton(int pin, unsigned long milliSeconds, unsigned long fromMilliSecondsLater = 0);
+
+// text typed into the serial monitor, and everything the sketch has written to the serial port since it was last taken
+void HostSerialInput(const char *text);
+std::string HostTakeSerialOutput();
+
+// also write what the sketch writes to the serial port to standard output as it is written
+void HostEchoSerialOutput(bool echo);
+
+// what is shown on the panel, as RGB565 colours, taking its rotation and scrolling into account; the image is TFT_WIDTH x TFT_HEIGHT
+uint16_t HostPanelPixel(int x, int y);
+
+// an FNV-1a hash of what is shown on the panel, and the same as a binary PPM (P6) image
+uint32_t HostPanelSignature();
+bool HostWritePanelImage(const char *fileName);
+
+// the broker the sketch's MQTT client connects to
+hostBroker &HostBroker();
+
+// the response to an HTTP GET of the sketch's web server, or a status of 0 if it has not been started
+struct hostHttpResponse
+{
+  int status;
+  std::string contentType;
+  std::string body;
+};
+
+hostHttpResponse HostHttpGet(const char *uri);
@@ -0,0 +1,240 @@
+#include "host_broker.h"
+#include "host_board.h"
+
+hostBroker &HostBroker()
+{
+  static hostBroker broker;
+  return broker;
+}
+
+bool hostBroker::TopicMatches(const std::string &filter, const std::string &topic)
+{
+
+  if (!topic.empty() && (topic[0] == '$') && !filter.empty() && ((filter[0] == '+') || (filter[0] == '#')))
+    return false;
+
+  size_t f = 0;
+  size_t t = 0;
+
+  while (true)
+  {
+
+    size_t filterLevelEnd = filter.find('/', f);
+    if (filterLevelEnd == std::string::npos)
+      filterLevelEnd = filter.size();
+
+    std::string filterLevel = filter.substr(f, filterLevelEnd - f);
+
+    if (filterLevel == "#")
+      return true;
+
+    // the topic has run out of levels; only a remaining "/#" would match its parent
+    if (t > topic.size())
+      return false;
+
+    size_t topicLevelEnd = topic.find('/', t);
+    if (topicLevelEnd == std::string::npos)
+      topicLevelEnd = topic.size();
+
+    if ((filterLevel != "+") && (filterLevel != topic.substr(t, topicLevelEnd - t)))
+      return false;
+
+    bool filterEnds = (filterLevelEnd == filter.size());
+    bool topicEnds = (topicLevelEnd == topic.size());
+
+    if (filterEnds)
+      return topicEnds;
+
+    f = filterLevelEnd + 1;
+
+    if (topicEnds)
+      return filter.compare(f, std::string::npos, "#") == 0;
+
+    t = topicLevelEnd + 1;
+  };
+}
+
+int hostBroker::Connect(const std::string &clientName, const std::string &willTopic, const std::string &willPayload, bool willRetain)
+{
+
+  if (!accepting)
+    return -1;
+
+  // as with an MQTT broker, a client connecting with the name of one already connected takes over from it
+  for (size_t i = 0; i < connections.size(); i++)
+    if (connections[i].connected && (connections[i].clientName == clientName))
+      Close((int)i, true);
+
+  hostConnection connection;
+  connection.clientName = clientName;
+  connection.connected = true;
+  connection.willTopic = willTopic;
+  connection.willPayload = willPayload;
+  connection.willRetain = willRetain;
+
+  connections.push_back(connection);
+
+  return (int)connections.size() - 1;
+}
+
+void hostBroker::Close(int connection, bool publishWill)
+{
+
+  hostConnection &closing = connections[connection];
+
+  if (!closing.connected)
+    return;
+
+  closing.connected = false;
+  closing.filters.clear();
+  closing.queue.clear();
+
+  if (publishWill && !closing.willTopic.empty())
+    Publish(-1, closing.willTopic, closing.willPayload, closing.willRetain);
+}
+
+void hostBroker::Disconnect(int connection)
+{
+  Close(connection, false);
+}
+
+void hostBroker::DropConnection(int connection)
+{
+  Close(connection, true);
+}
+
+bool hostBroker::IsConnected(int connection) const
+{
+  return (connection >= 0) && (connection < (int)connections.size()) && connections[connection].connected;
+}
+
+const std::string &hostBroker::ClientName(int connection) const
+{
+  return connections[connection].clientName;
+}
+
+void hostBroker::SetAccepting(bool accepting)
+{
+  this->accepting = accepting;
+}
+
+bool hostBroker::Subscribe(int connection, const std::string &filter)
+{
+
+  if (!IsConnected(connection))
+    return false;
+
+  hostConnection &subscriber = connections[connection];
+  subscriber.filters.insert(filter);
+
+  for (const auto &message : retained)
+    if (TopicMatches(filter, message.first))
+      subscriber.queue.push_back(hostMessage{message.first, message.second, true, HostMicroSeconds()});
+
+  return true;
+}
+
+bool hostBroker::Unsubscribe(int connection, const std::string &filter)
+{
+
+  if (!IsConnected(connection))
+    return false;
+
+  connections[connection].filters.erase(filter);
+
+  return true;
+}
+
+bool hostBroker::IsSubscribed(int connection, const std::string &topic) const
+{
+
+  if (!IsConnected(connection))
+    return false;
+
+  for (const std::string &filter : connections[connection].filters)
+    if (TopicMatches(filter, topic))
+      return true;
+
+  return false;
+}
+
+bool hostBroker::Publish(int connection, const std::string &topic, const std::string &payload, bool retain)
+{
+
+  // a connection of -1 is the broker itself, which publishes the wills
+  if ((connection != -1) && !IsConnected(connection))
+    return false;
+
+  published++;
+  publishedOnTopic[topic]++;
+
+  if (retain)
+  {
+    if (payload.empty())
+      retained.erase(topic);
+    else
+      retained[topic] = payload;
+  };
+
+  for (hostConnection &subscriber : connections)
+  {
+
+    if (!subscriber.connected)
+      continue;
+
+    for (const std::string &filter : subscriber.filters)
+      if (TopicMatches(filter, topic))
+      {
+        subscriber.queue.push_back(hostMessage{topic, payload, false, HostMicroSeconds()});
+        break;
+      };
+  };
+
+  return true;
+}
+
+bool hostBroker::Receive(int connection, hostMessage &message)
+{
+
+  if (!IsConnected(connection) || connections[connection].queue.empty())
+    return false;
+
+  message = connections[connection].queue.front();
+  connections[connection].queue.pop_front();
+
+  return true;
+}
+
+size_t hostBroker::MessagesWaiting(int connection) const
+{
+  return IsConnected(connection) ? connections[connection].queue.size() : 0;
+}
+
+bool hostBroker::Retained(const std::string &topic, std::string &payload) const
+{
+
+  auto message = retained.find(topic);
+  if (message == retained.end())
+    return false;
+
+  payload = message->second;
+
+  return true;
+}
+
+unsigned long hostBroker::MessagesPublished() const
+{
+  return published;
+}
+
+unsigned long hostBroker::MessagesPublished(const std::string &filter) const
+{
+
+  unsigned long count = 0;
+
+  for (const auto &topic : publishedOnTopic)
+    if (TopicMatches(filter, topic.first))
+      count += topic.second;
+
+  return count;
+}
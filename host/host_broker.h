@@ -0,0 +1,90 @@
+#pragma once
+
+// Host broker
+//
+// an MQTT broker held in memory, which the sketch's MQTT client connects to in the host build, and which the tests and host tools
+// connect to as well (for example to stand in for Venus)
+//
+// it keeps the retained messages, delivers each message published to every connection with a matching subscription (once, however
+// many of its subscriptions match), and publishes a connection's will if the connection is lost rather than closed
+//
+// messages are queued for each connection until it takes them, so nothing is delivered while the sketch is not running its loop()
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+struct hostMessage
+{
+  std::string topic;
+  std::string payload;
+  bool retained;        // true if the message was sent as it was retained when the subscription was made
+  uint64_t publishedAt; // the virtual clock when it was published (or when the subscription was made, if it was retained)
+};
+
+class hostBroker
+{
+public:
+  // returns the connection's number, or -1 if the broker is not accepting connections
+  int Connect(const std::string &clientName, const std::string &willTopic = "", const std::string &willPayload = "", bool willRetain = false);
+
+  // an orderly disconnection, after which the will is not published
+  void Disconnect(int connection);
+
+  // the connection is lost, as when the network fails, so the will is published
+  void DropConnection(int connection);
+
+  bool IsConnected(int connection) const;
+  const std::string &ClientName(int connection) const;
+
+  // while not accepting, new connections are refused
+  void SetAccepting(bool accepting);
+
+  bool Subscribe(int connection, const std::string &filter);
+  bool Unsubscribe(int connection, const std::string &filter);
+
+  // true if a message published on the topic would be delivered to the connection
+  bool IsSubscribed(int connection, const std::string &topic) const;
+
+  // a retained message with an empty payload removes the message retained on the topic
+  bool Publish(int connection, const std::string &topic, const std::string &payload, bool retain = false);
+
+  // takes the oldest message queued for the connection, returns false if there is none
+  bool Receive(int connection, hostMessage &message);
+  size_t MessagesWaiting(int connection) const;
+
+  // returns false if no message is retained on the topic
+  bool Retained(const std::string &topic, std::string &payload) const;
+
+  // the messages published since the broker was started, and the number on topics matching the filter given
+  unsigned long MessagesPublished() const;
+  unsigned long MessagesPublished(const std::string &filter) const;
+
+  // as specified by MQTT: '+' matches one level, '#' (as the last level) that level's parent and any levels below it, and neither
+  // matches a first level starting with '$'
+  static bool TopicMatches(const std::string &filter, const std::string &topic);
+
+private:
+  struct hostConnection
+  {
+    std::string clientName;
+    bool connected;
+    std::string willTopic;
+    std::string willPayload;
+    bool willRetain;
+    std::set<std::string> filters;
+    std::deque<hostMessage> queue;
+  };
+
+  std::vector<hostConnection> connections;
+  std::map<std::string, std::string> retained;
+  std::map<std::string, unsigned long> publishedOnTopic;
+  unsigned long published = 0;
+  bool accepting = true;
+
+  void Close(int connection, bool publishWill);
+};
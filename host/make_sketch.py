@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+
+# Make sketch
+#
+# copies the sketch into a folder of the host build as C++ that a desktop compiler accepts, as the Arduino IDE does before it compiles
+# the sketch: the .ino becomes sketch.cpp, which includes Arduino.h and declares each of the sketch's functions before the first of them
+#
+# settings may be given to replace those in general_settings.h (or secret_settings.h), so that one build can check the sketch with
+# several of them; the copy of each unit is compiled rather than the original so that it sees the same settings as the sketch
+#
+#   make_sketch.py <sketch folder> <output folder> [NAME=VALUE ...]
+
+import os
+import re
+import shutil
+import sys
+
+keywords = {'if', 'while', 'for', 'switch', 'return', 'else', 'case', 'do', 'sizeof'}
+
+function = re.compile(r'^((?:[A-Za-z_][\w:<>]*\s+)*[A-Za-z_][\w:<>]*(?:\s*[\*&])?)\s+([\*&]?)([A-Za-z_]\w*)\s*\((.*)\)\s*\{?\s*$')
+
+
+def WithoutDefaultArguments(parameters):
+    result = []
+    depth = 0
+    skipping = False
+    for c in parameters:
+        if c in '(<[':
+            depth += 1
+        if c in ')>]':
+            depth -= 1
+        if c == '=' and depth == 0:
+            skipping = True
+            continue
+        if c == ',' and depth == 0:
+            skipping = False
+        if not skipping:
+            result.append(c)
+    return ''.join(result).strip()
+
+
+def Prototypes(lines):
+
+    # a function definition starts at the beginning of a line, and its body's brace ends that line or starts the next
+
+    prototypes = []
+    first = None
+
+    for i, line in enumerate(lines):
+        match = function.match(line)
+        if not match or match.group(3) in keywords or match.group(1).split()[0] in keywords:
+            continue
+        opensBody = line.rstrip().endswith('{') or (i + 1 < len(lines) and lines[i + 1].strip().startswith('{'))
+        if not opensBody or (i > 0 and 'template' in lines[i - 1]):
+            continue
+        prototypes.append('%s %s%s(%s);' % (match.group(1), match.group(2), match.group(3), WithoutDefaultArguments(match.group(4))))
+        if first is None:
+            first = i
+
+    return prototypes, first
+
+
+def ReplaceSettings(folder, settings):
+
+    remaining = dict(settings)
+
+    for name in ('general_settings.h', 'secret_settings.h'):
+        path = os.path.join(folder, name)
+        text = open(path, encoding='latin-1').read()
+        for setting, value in settings.items():
+            pattern = re.compile(r'^(#define\s+' + re.escape(setting) + r'\s+)(".*?"|\S+)', re.MULTILINE)
+            text, replaced = pattern.subn(lambda match: match.group(1) + value, text)
+            if replaced:
+                remaining.pop(setting, None)
+        open(path, 'w', encoding='latin-1').write(text)
+
+    if remaining:
+        sys.exit('make_sketch.py: no such setting: ' + ', '.join(sorted(remaining)))
+
+
+def WriteIfChanged(path, content):
+
+    # so that the files of a sketch which has not changed are not compiled again
+
+    if os.path.exists(path) and open(path, 'rb').read() == content:
+        return
+    open(path, 'wb').write(content)
+
+
+def Main(arguments):
+
+    if len(arguments) < 2:
+        sys.exit('usage: make_sketch.py <sketch folder> <output folder> [NAME=VALUE ...]')
+
+    source, output = arguments[0], arguments[1]
+    settings = dict(argument.split('=', 1) for argument in arguments[2:])
+
+    staging = output + '.staging'
+    shutil.rmtree(staging, ignore_errors=True)
+    shutil.copytree(source, staging, ignore=shutil.ignore_patterns('*.ino', 'rm67162.cpp'))
+
+    ReplaceSettings(staging, settings)
+
+    ino = os.path.join(source, os.path.basename(os.path.normpath(source)) + '.ino')
+    lines = open(ino, encoding='latin-1').read().split('\n')
+    prototypes, first = Prototypes(lines)
+
+    sketch = ['#include "Arduino.h"', '#line 1 "%s"' % os.path.abspath(ino)] + lines[:first]
+    sketch += prototypes + ['#line %d "%s"' % (first + 1, os.path.abspath(ino))] + lines[first:]
+
+    os.makedirs(output, exist_ok=True)
+    WriteIfChanged(os.path.join(output, 'sketch.cpp'), '\n'.join(sketch).encode('latin-1'))
+
+    for folder, _, files in os.walk(staging):
+        relative = os.path.relpath(folder, staging)
+        os.makedirs(os.path.join(output, relative), exist_ok=True)
+        for name in files:
+            WriteIfChanged(os.path.join(output, relative, name), open(os.path.join(folder, name), 'rb').read())
+
+    shutil.rmtree(staging)
+
+
+if __name__ == '__main__':
+    Main(sys.argv[1:])
@@ -0,0 +1,116 @@
+// the RM67162 AMOLED panel, for the host build
+//
+// the panel's frame memory is 536 lines of 240 pixels; in landscape each line is a column of the screen, so the panel's vertical
+// scrolling (which moves its lines) runs across the screen, as the sketch's chart relies on
+//
+// only the landscape rotations the sketch uses are modelled: 1, in which screen column x is written to line x and shown on the panel's
+// line x, and 3, in which the screen is turned through 180 degrees
+
+#include "rm67162.h"
+#include "host_board.h"
+#include <stdio.h>
+#include <string.h>
+
+static const int panelLines = TFT_WIDTH;
+static const int panelLineLength = TFT_HEIGHT;
+
+static uint16_t frameMemory[panelLines][panelLineLength]; // as sent, with the bytes of each colour swapped
+static uint8_t rotation = 1;
+
+static uint16_t topFixedLines = 0;
+static uint16_t scrollingLines = panelLines;
+static uint16_t scrollStart = 0;
+
+static void ScreenToPanel(int x, int y, int &line, int &position)
+{
+  line = (rotation == 3) ? panelLines - 1 - x : x;
+  position = (rotation == 3) ? panelLineLength - 1 - y : y;
+}
+
+void rm67162_init(void)
+{
+  memset(frameMemory, 0, sizeof(frameMemory));
+}
+
+void lcd_setRotation(uint8_t r)
+{
+  rotation = r;
+}
+
+void lcd_setScrollArea(uint16_t topFixed, uint16_t scrolling, uint16_t bottomFixed)
+{
+  // as with the panel, the areas only take effect if they add up to its number of lines
+  if (topFixed + scrolling + bottomFixed != panelLines)
+    return;
+  topFixedLines = topFixed;
+  scrollingLines = scrolling;
+}
+
+void lcd_setScrollStart(uint16_t line)
+{
+  scrollStart = line;
+}
+
+void lcd_PushColors(uint16_t x, uint16_t y, uint16_t width, uint16_t high, uint16_t *data)
+{
+  for (int row = 0; row < high; row++)
+    for (int column = 0; column < width; column++)
+    {
+      int line, position;
+      ScreenToPanel(x + column, y + row, line, position);
+      if ((line >= 0) && (line < panelLines) && (position >= 0) && (position < panelLineLength))
+        frameMemory[line][position] = data[row * width + column];
+    };
+}
+
+uint16_t HostPanelPixel(int x, int y)
+{
+
+  int shownLine, position;
+  ScreenToPanel(x, y, shownLine, position);
+
+  // the panel's line shown in the scrolling area is taken from the frame memory starting at the scroll start
+  int line = shownLine;
+  if ((shownLine >= topFixedLines) && (shownLine < topFixedLines + scrollingLines) && (scrollStart >= topFixedLines) &&
+      (scrollStart < topFixedLines + scrollingLines))
+    line = topFixedLines + (shownLine - topFixedLines + scrollStart - topFixedLines) % scrollingLines;
+
+  uint16_t colour = frameMemory[line][position];
+  return (uint16_t)((colour >> 8) | (colour << 8));
+}
+
+uint32_t HostPanelSignature()
+{
+
+  uint32_t hash = 2166136261UL;
+
+  for (int y = 0; y < TFT_HEIGHT; y++)
+    for (int x = 0; x < TFT_WIDTH; x++)
+    {
+      uint16_t colour = HostPanelPixel(x, y);
+      hash = (hash ^ (colour & 0xFF)) * 16777619UL;
+      hash = (hash ^ (colour >> 8)) * 16777619UL;
+    };
+
+  return hash;
+}
+
+bool HostWritePanelImage(const char *fileName)
+{
+
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL)
+    return false;
+
+  fprintf(file, "P6\n%d %d\n255\n", TFT_WIDTH, TFT_HEIGHT);
+
+  for (int y = 0; y < TFT_HEIGHT; y++)
+    for (int x = 0; x < TFT_WIDTH; x++)
+    {
+      uint16_t colour = HostPanelPixel(x, y);
+      uint8_t rgb[3] = {(uint8_t)(((colour >> 11) & 0x1F) * 255 / 31), (uint8_t)(((colour >> 5) & 0x3F) * 255 / 63), (uint8_t)((colour & 0x1F) * 255 / 31)};
+      fwrite(rgb, 1, sizeof(rgb), file);
+    };
+
+  return fclose(file) == 0;
+}
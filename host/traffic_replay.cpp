@@ -0,0 +1,214 @@
+#include "traffic_replay.h"
+#include "traffic_log.h"
+#include "venus_emulator.h"
+#include "host_board.h"
+#include "host_broker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+
+static const char *recordingBegins = "--- MQTT traffic recording begin ---";
+static const char *recordingEnds = "--- MQTT traffic recording end ---";
+
+static bool ReadFile(const char *fileName, std::string &contents)
+{
+
+  FILE *file = fopen(fileName, "rb");
+  if (file == NULL)
+    return false;
+
+  char buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    contents.append(buffer, read);
+
+  fclose(file);
+  return true;
+}
+
+static bool ParseSerialRecording(const std::string &text, size_t begins, std::vector<trafficMessage> &messages)
+{
+
+  size_t position = text.find('\n', begins);
+
+  while (position != std::string::npos)
+  {
+
+    position++;
+
+    size_t lineEnd = text.find('\n', position);
+    if (lineEnd == std::string::npos)
+      lineEnd = text.size();
+
+    std::string line = text.substr(position, lineEnd - position);
+    if (!line.empty() && (line.back() == '\r'))
+      line.pop_back();
+
+    if (line == recordingEnds)
+      return true;
+
+    size_t topicStart = line.find(' ');
+    size_t payloadStart = (topicStart == std::string::npos) ? std::string::npos : line.find(' ', topicStart + 1);
+    if (payloadStart == std::string::npos)
+      return false;
+
+    trafficMessage message;
+    message.time = (uint32_t)strtoul(line.c_str(), NULL, 10);
+    message.topic = line.substr(topicStart + 1, payloadStart - topicStart - 1);
+    message.payload = line.substr(payloadStart + 1);
+    messages.push_back(message);
+
+    position = (lineEnd < text.size()) ? lineEnd : std::string::npos;
+  };
+
+  // the end of the recording was not found
+  return false;
+}
+
+static bool ParseTrafficLog(const std::string &data, std::vector<trafficMessage> &messages)
+{
+
+  trafficLogReader reader;
+  trafficLogMessage message;
+
+  BeginTrafficLogReader(reader, (const uint8_t *)data.data(), data.size());
+
+  while (ReadTrafficLogMessage(reader, message))
+    messages.push_back(trafficMessage{message.time, std::string(message.topic, message.topicLength),
+                                      std::string((const char *)message.payload, message.payloadLength)});
+
+  return reader.position == data.size();
+}
+
+bool LoadTrafficRecording(const char *fileName, std::vector<trafficMessage> &messages)
+{
+
+  std::string contents;
+  if (!ReadFile(fileName, contents))
+    return false;
+
+  messages.clear();
+
+  size_t begins = contents.find(recordingBegins);
+  if (begins != std::string::npos)
+    return ParseSerialRecording(contents, begins, messages);
+
+  return ParseTrafficLog(contents, messages);
+}
+
+bool SaveTrafficLog(const char *fileName, const std::vector<trafficMessage> &messages)
+{
+
+  // the log is packed into a buffer large enough for the messages with each topic written out in full, which it can only be smaller than
+
+  size_t bufferSize = 0;
+  for (const auto &message : messages)
+    bufferSize += 20 + message.topic.size() + message.payload.size();
+
+  std::vector<uint8_t> buffer(bufferSize);
+  size_t length = 0;
+
+  trafficLogWriter writer;
+  BeginTrafficLogWriter(writer);
+
+  for (const auto &message : messages)
+    if (!AppendTrafficLogMessage(writer, buffer.data(), buffer.size(), length, message.time, message.topic.c_str(), message.topic.size(),
+                                 (const uint8_t *)message.payload.data(), message.payload.size()))
+      return false;
+
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL)
+    return false;
+
+  bool written = (fwrite(buffer.data(), 1, length, file) == length);
+  return (fclose(file) == 0) && written;
+}
+
+// the installation ID and the path after it, for a topic published by Venus (N/<installation id>/<path>)
+static bool SplitVenusTopic(const std::string &topic, std::string &installationID, std::string &path)
+{
+
+  if (topic.compare(0, 2, "N/") != 0)
+    return false;
+
+  size_t pathStart = topic.find('/', 2);
+  if ((pathStart == std::string::npos) || (pathStart + 1 >= topic.size()))
+    return false;
+
+  installationID = topic.substr(2, pathStart - 2);
+  path = topic.substr(pathStart + 1);
+  return true;
+}
+
+std::string TrafficInstallationID(const std::vector<trafficMessage> &messages)
+{
+
+  std::string installationID;
+  std::string path;
+
+  for (const auto &message : messages)
+    if (SplitVenusTopic(message.topic, installationID, path))
+      return installationID;
+
+  return "";
+}
+
+void SetInitialValues(venusEmulator &venus, const std::vector<trafficMessage> &messages)
+{
+
+  std::set<std::string> pathsSeen;
+  std::string installationID;
+  std::string path;
+
+  for (const auto &message : messages)
+    if (SplitVenusTopic(message.topic, installationID, path) && pathsSeen.insert(path).second)
+      venus.SetValue(path, message.payload);
+
+  // the sketch finds a solar charger by its Mode topic, which it no longer subscribes to once it has been found, so which is not in a
+  // recording; each solar charger in the recording is given one (on)
+
+  std::string payload;
+  for (const auto &seen : pathsSeen)
+    if (hostBroker::TopicMatches("solarcharger/+/#", seen))
+    {
+      std::string modePath = seen.substr(0, seen.find('/', strlen("solarcharger/"))) + "/Mode";
+      if (!venus.Value(modePath, payload))
+        venus.SetValue(modePath, "{\"value\":1}");
+    };
+}
+
+unsigned long ReplayTraffic(venusEmulator &venus, const std::vector<trafficMessage> &messages, unsigned long speed)
+{
+
+  // Venus takes its turn every 10 ms (of the replay's time), between passes of the sketch's loop()
+
+  const uint64_t step = 10000ULL;
+
+  uint64_t startedAt = HostMicroSeconds();
+  unsigned long handedOver = 0;
+
+  std::string installationID;
+  std::string path;
+
+  for (const auto &message : messages)
+  {
+
+    uint64_t dueAt = startedAt + (uint64_t)message.time * 1000ULL / (speed > 0 ? speed : 1);
+
+    while (HostMicroSeconds() + 1000ULL <= dueAt)
+    {
+      uint64_t toRun = dueAt - HostMicroSeconds();
+      HostRunSketch((unsigned long)((toRun < step ? toRun : step) / 1000ULL));
+      venus.Step();
+    };
+
+    if (SplitVenusTopic(message.topic, installationID, path))
+    {
+      venus.SetValue(path, message.payload);
+      handedOver++;
+    };
+  };
+
+  return handedOver;
+}
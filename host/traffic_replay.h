@@ -0,0 +1,44 @@
+#pragma once
+
+// Traffic replay
+//
+// replays MQTT traffic recorded from Venus to the sketch in the host build, at the speed it was recorded or faster, so that a day of
+// solar and grid activity can be put through the sketch's ingestion, rendering and memory use in a few seconds
+//
+// a recording is read either from what the sketch sends to the serial monitor for its 'recording' command (one "<ms> <topic> <payload>"
+// line for each message, between the lines marking its beginning and end) or from a traffic log file (see traffic_log.h), and can be
+// saved as the latter
+//
+// the messages are published by the Venus emulator (see venus_emulator.h), which is first given the first payload of each topic in the
+// recording, so that the sketch finds the installation and subscribes as it would with Venus; ReplayTraffic then hands the emulator
+// each message at the time it was received, divided by the speed, while running the sketch, so that the sketch receives them as it
+// would from Venus (including only while it keeps Venus alive)
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class venusEmulator;
+
+struct trafficMessage
+{
+  uint32_t time; // milliseconds since the recording was started
+  std::string topic;
+  std::string payload;
+};
+
+// returns false if the file cannot be read, or holds neither a recording sent to the serial monitor nor a valid traffic log
+bool LoadTrafficRecording(const char *fileName, std::vector<trafficMessage> &messages);
+
+bool SaveTrafficLog(const char *fileName, const std::vector<trafficMessage> &messages);
+
+// the installation ID the messages were published for, or an empty string if none was
+std::string TrafficInstallationID(const std::vector<trafficMessage> &messages);
+
+// give the emulator the first payload of each topic (and a Mode for each solar charger, by which the sketch finds it), before the sketch
+// is started
+void SetInitialValues(venusEmulator &venus, const std::vector<trafficMessage> &messages);
+
+// run the sketch while handing the messages to the emulator, starting now; returns the number of messages handed over (those not
+// published by Venus, such as a gateway's snapshot, are left out)
+unsigned long ReplayTraffic(venusEmulator &venus, const std::vector<trafficMessage> &messages, unsigned long speed);
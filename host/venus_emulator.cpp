@@ -0,0 +1,215 @@
+#include "venus_emulator.h"
+#include "host_board.h"
+#include "host_broker.h"
+#include "ArduinoJson.h"
+#include <stdio.h>
+
+static unsigned long Now()
+{
+  return (unsigned long)(HostMicroSeconds() / 1000ULL);
+}
+
+bool venusEmulator::Start(hostBroker &broker, const std::string &installationID)
+{
+
+  this->broker = &broker;
+  this->installationID = installationID;
+
+  connection = broker.Connect("venus");
+  if (connection < 0)
+    return false;
+
+  broker.Subscribe(connection, "R/" + installationID + "/#");
+  broker.Subscribe(connection, "W/" + installationID + "/#");
+
+  values["system/0/Serial"] = "{\"value\":\"" + installationID + "\"}";
+  broker.Publish(connection, "N/" + installationID + "/system/0/Serial", values["system/0/Serial"], true);
+
+  return true;
+}
+
+void venusEmulator::Stop()
+{
+
+  if (broker != NULL)
+    broker->Disconnect(connection);
+
+  connection = -1;
+  requests.clear();
+  keepAliveReceived = false;
+}
+
+void venusEmulator::SetValue(const std::string &path, const std::string &payload)
+{
+
+  values[path] = payload;
+
+  if (!KeepAliveHasExpired())
+    PublishValue(path, payload);
+}
+
+bool venusEmulator::Value(const std::string &path, std::string &payload) const
+{
+
+  auto value = values.find(path);
+  if (value == values.end())
+    return false;
+
+  payload = PublishedPayload(path, value->second);
+  return true;
+}
+
+void venusEmulator::SetEssControlsSolarChargers(bool controlled)
+{
+
+  essControlsSolarChargers = controlled;
+
+  if (!KeepAliveHasExpired())
+    PublishValues("solarcharger/+/State");
+}
+
+void venusEmulator::SetResponseTime(unsigned long milliSeconds)
+{
+  responseTime = milliSeconds;
+}
+
+bool venusEmulator::KeepAliveHasExpired() const
+{
+  return !keepAliveReceived || (Now() - keepAliveReceivedAt >= keepAliveTime);
+}
+
+void venusEmulator::Step()
+{
+
+  if ((broker == NULL) || !broker->IsConnected(connection))
+    return;
+
+  unsigned long now = Now();
+
+  hostMessage message;
+  while (broker->Receive(connection, message))
+    requests.push_back(request{now + responseTime, message.topic, message.payload});
+
+  while (!requests.empty() && ((long)(now - requests.front().answerAt) >= 0))
+  {
+    request received = requests.front();
+    requests.pop_front();
+    Answer(received);
+  };
+}
+
+void venusEmulator::Answer(const request &received)
+{
+
+  // the topic is R/<id>/<path> or W/<id>/<path>
+  size_t pathStart = 2 + installationID.size() + 1;
+  if (received.topic.size() <= pathStart)
+    return;
+
+  std::string path = received.topic.substr(pathStart);
+
+  if (received.topic[0] == 'R')
+  {
+    if (path == "keepalive")
+      AnswerKeepAlive(received.payload);
+    else
+      PublishValues(path);
+    return;
+  };
+
+  // a write to a path which does not exist is ignored, as there is no device to take it
+  if (values.find(path) == values.end())
+    return;
+
+  JsonDocument doc;
+  if (deserializeJson(doc, received.payload) || doc["value"].isNull())
+    return;
+
+  char payload[96];
+  if (doc["value"].is<int>())
+    snprintf(payload, sizeof(payload), "{\"value\":%lld}", doc["value"].as<long long>());
+  else if (doc["value"].is<float>())
+    snprintf(payload, sizeof(payload), "{\"value\":%.9g}", doc["value"].as<double>());
+  else if (doc["value"].is<const char *>())
+    snprintf(payload, sizeof(payload), "{\"value\":\"%s\"}", doc["value"].as<const char *>());
+  else
+    return;
+
+  SetValue(path, payload);
+}
+
+void venusEmulator::AnswerKeepAlive(const std::string &payload)
+{
+
+  keepAlivesReceived++;
+
+  bool hadExpired = KeepAliveHasExpired();
+
+  keepAliveReceived = true;
+  keepAliveReceivedAt = Now();
+
+  bool suppressRepublish = false;
+  std::string echo;
+
+  JsonDocument doc;
+  if (!payload.empty() && !deserializeJson(doc, payload))
+  {
+
+    // a topic selective keep alive: a list of the paths to publish
+    if (doc[0].is<const char *>())
+    {
+      for (size_t i = 0; i < doc.root().size(); i++)
+        PublishValues(doc[(int)i].as<const char *>());
+      return;
+    };
+
+    JsonVariant options = doc["keepalive-options"];
+    for (size_t i = 0; i < options.size(); i++)
+    {
+      if (options[(int)i].is<const char *>() && (std::string(options[(int)i].as<const char *>()) == "suppress-republish"))
+        suppressRepublish = true;
+      else if (options[(int)i]["full-publish-completed-echo"].is<const char *>())
+        echo = options[(int)i]["full-publish-completed-echo"].as<const char *>();
+    };
+  };
+
+  if (suppressRepublish && !hadExpired)
+    return;
+
+  PublishValues("#");
+
+  char completed[128];
+  if (echo.empty())
+    snprintf(completed, sizeof(completed), "{\"value\":%lld}", (long long)time(NULL));
+  else
+    snprintf(completed, sizeof(completed), "{\"full-publish-completed-echo\":\"%s\",\"value\":%lld}", echo.c_str(), (long long)time(NULL));
+
+  broker->Publish(connection, "N/" + installationID + "/full_publish_completed", completed);
+  fullPublishesCompleted++;
+}
+
+void venusEmulator::PublishValues(const std::string &filter)
+{
+  for (const auto &value : values)
+    if (hostBroker::TopicMatches(filter, value.first))
+      PublishValue(value.first, value.second);
+}
+
+void venusEmulator::PublishValue(const std::string &path, const std::string &payload)
+{
+
+  if ((broker == NULL) || !broker->IsConnected(connection))
+    return;
+
+  broker->Publish(connection, "N/" + installationID + "/" + path, PublishedPayload(path, payload));
+  valuesPublished++;
+}
+
+std::string venusEmulator::PublishedPayload(const std::string &path, const std::string &payload) const
+{
+
+  if (essControlsSolarChargers && hostBroker::TopicMatches("solarcharger/+/State", path))
+    return "{\"value\":252}";
+
+  return payload;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Venus emulator
+//
+// stands in for the MQTT interface of Venus OS (dbus-flashmq) on the host broker, so that the sketch (or a host tool) can be run
+// against an installation whose values, timing and answers are the same each time
+//
+// it follows Venus's topic conventions, taking the installation ID (the portal ID) and a value's path on D-Bus, such as
+// system/0/Dc/Battery/Soc, whose value is published as {"value": ...}:
+//
+//   N/<id>/<path>               published by Venus; only N/<id>/system/0/Serial is published (and retained) before a keep alive is
+//                               received, so that a client can find the installation ID by subscribing to N/+/system/0/Serial
+//   R/<id>/keepalive            a keep alive request, after which the values are published as they change for the next 60 s; one with
+//                               an empty payload (or {"keepalive-options": [...]} without "suppress-republish") also publishes every
+//                               value, followed by N/<id>/full_publish_completed, while "suppress-republish" leaves that out unless
+//                               the keep alive had expired; one whose payload is a JSON array of paths (which may hold + and #)
+//                               publishes only the values on those paths
+//   R/<id>/<path>               a read request, which publishes the value on the path (or on those matching it)
+//   W/<id>/<path>               a write request, such as W/<id>/vebus/276/Mode with {"value": 2}, which sets the value and, as Venus
+//                               does once the device has taken it, publishes it on N/<id>/<path> while the keep alive has not expired
+//
+// the emulator is stepped by its user, as the sketch is, between passes of the sketch's loop(); requests are answered once the response
+// time has passed (none by default), as measured by the virtual clock
+
+#include <stddef.h>
+#include <deque>
+#include <map>
+#include <string>
+
+class hostBroker;
+
+class venusEmulator
+{
+public:
+  // how long a keep alive request keeps the values being published, as with Venus
+  static const unsigned long keepAliveTime = 60000UL;
+
+  // connects to the broker as Venus, and publishes N/<id>/system/0/Serial
+  bool Start(hostBroker &broker, const std::string &installationID);
+  void Stop();
+
+  // a value, given as the payload Venus publishes for it, such as {"value": 76.5}; it is published straight away if the keep alive has
+  // not expired
+  void SetValue(const std::string &path, const std::string &payload);
+  bool Value(const std::string &path, std::string &payload) const;
+
+  // with ESS controlling the solar chargers, Venus gives their state as 252 (external control) rather than their charging state
+  void SetEssControlsSolarChargers(bool controlled);
+
+  // how long after a request is received it is answered
+  void SetResponseTime(unsigned long milliSeconds);
+
+  // takes the requests received and answers those due
+  void Step();
+
+  bool KeepAliveHasExpired() const;
+
+  unsigned long KeepAlivesReceived() const { return keepAlivesReceived; }
+  unsigned long FullPublishesCompleted() const { return fullPublishesCompleted; }
+  unsigned long ValuesPublished() const { return valuesPublished; }
+
+private:
+  struct request
+  {
+    unsigned long answerAt;
+    std::string topic;
+    std::string payload;
+  };
+
+  hostBroker *broker = NULL;
+  int connection = -1;
+  std::string installationID;
+
+  std::map<std::string, std::string> values;
+  std::deque<request> requests;
+
+  unsigned long responseTime = 0UL;
+  bool essControlsSolarChargers = false;
+
+  bool keepAliveReceived = false;
+  unsigned long keepAliveReceivedAt = 0UL;
+
+  unsigned long keepAlivesReceived = 0UL;
+  unsigned long fullPublishesCompleted = 0UL;
+  unsigned long valuesPublished = 0UL;
+
+  void Answer(const request &received);
+  void AnswerKeepAlive(const std::string &payload);
+  void PublishValues(const std::string &filter);
+  void PublishValue(const std::string &path, const std::string &payload);
+  std::string PublishedPayload(const std::string &path, const std::string &payload) const;
+};
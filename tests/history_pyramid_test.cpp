@@ -0,0 +1,79 @@
+// History pyramid test
+//
+// checks that the history pyramid keeps every second for the last hour, about every minute for the last day and about every quarter of
+// an hour for the last 31 days, with the minimum, maximum and average of each column those of the samples added for its part of the period
+
+#include "host_test.h"
+#include "history_pyramid.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const uint32_t day = 24UL * 60UL * 60UL;
+
+static float Value(uint32_t time)
+{
+  // a value for each second which repeats every minute, so that every minute and longer has the same minimum and maximum
+  return (float)(time % 60);
+}
+
+static bool EveryColumnHasSamples(const historySample *columns, int numberOfColumns, float minimum, float maximum)
+{
+  for (int column = 0; column < numberOfColumns; column++)
+    if (isnan(columns[column].average) || (columns[column].minimum != minimum) || (columns[column].maximum != maximum))
+      return false;
+  return true;
+}
+
+int main()
+{
+
+  CHECK(BeginHistoryPyramid(malloc));
+
+  // 31 days of samples, one a second
+
+  const uint32_t firstTime = 1000;
+  const uint32_t lastTime = firstTime + 31 * day - 1;
+
+  float values[historyMetrics];
+  for (uint32_t time = firstTime; time <= lastTime; time++)
+  {
+    for (int metric = 0; metric < historyMetrics; metric++)
+      values[metric] = Value(time);
+    AddHistoryPyramidSample(time, values);
+  };
+
+  uint32_t toTime = lastTime + 1;
+
+  // the last hour, a column a second, from single second buckets
+
+  static historySample columns[3600];
+
+  CHECK(ReadHistoryColumns(SolarHistory, toTime - 3600, toTime, 3600, columns) == 1);
+  bool eachSecondIsKept = true;
+  for (int column = 0; column < 3600; column++)
+    if ((columns[column].time != toTime - 3600 + (uint32_t)column) || (columns[column].average != Value(columns[column].time)))
+      eachSecondIsKept = false;
+  CHECK(eachSecondIsKept);
+
+  // the last day, a column a minute, from buckets of less than a minute
+
+  CHECK(ReadHistoryColumns(GridHistory, toTime - day, toTime, 1440, columns) <= 60);
+  CHECK(EveryColumnHasSamples(columns, 1440, 0.0F, 59.0F));
+
+  // the last 31 days, a column a quarter of an hour, from buckets of about a quarter of an hour
+
+  CHECK(ReadHistoryColumns(BatterySOCHistory, toTime - 31 * day, toTime, 31 * 96, columns) <= 1024);
+  CHECK(EveryColumnHasSamples(columns, 31 * 96, 0.0F, 59.0F));
+
+  // and the whole period as one column
+
+  CHECK(ReadHistoryColumns(ACLoadHistory, toTime - 31 * day, toTime, 1, columns) <= 1024);
+  CHECK((columns[0].minimum == 0.0F) && (columns[0].maximum == 59.0F) && (fabsf(columns[0].average - 29.5F) < 0.1F));
+
+  if (failures != 0)
+    return 1;
+
+  printf("History pyramid test passed (%lu bytes)\n", (unsigned long)HistoryPyramidMemoryRequired());
+
+  return 0;
+}
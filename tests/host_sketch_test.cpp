@@ -0,0 +1,77 @@
+// Host sketch test
+//
+// runs the sketch in the host build against a broker standing in for Venus, and checks that it finds the installation, subscribes,
+// keeps Venus publishing, draws something on the panel, keeps a history of the values received and switches to and from the chart
+
+#include "host_test.h"
+#include "pins_config.h"
+
+int main()
+{
+
+  hostBroker &broker = HostBroker();
+
+  PublishVenusTopics(broker);
+
+  setup();
+  HostRunSketch(20000);
+
+  std::string output = HostTakeSerialOutput();
+
+  CHECK(output.find(std::string("*** Discovered Installation ID: ") + installationID) != std::string::npos);
+  CHECK(output.find("*** Discovered Multiplus three digit ID: 276") != std::string::npos);
+
+  CHECK(output.find("All data received") != std::string::npos);
+
+  // the keep alive request made once subscribed, and so before any of the periodical ones
+  CHECK(broker.MessagesPublished(std::string("R/") + installationID + "/keepalive") >= 1);
+
+  // something other than a blank panel
+  uint16_t corner = HostPanelPixel(0, 0);
+  int differentPixels = 0;
+  for (int y = 0; y < TFT_HEIGHT; y++)
+    for (int x = 0; x < TFT_WIDTH; x++)
+      if (HostPanelPixel(x, y) != corner)
+        differentPixels++;
+
+  CHECK(differentPixels > 1000);
+
+  // the values received, which have not changed, in the history
+
+  HostRunSketch(60000);
+  HostTakeSerialOutput();
+  HostSerialInput("history\n");
+  HostRunSketch(10);
+
+  std::string history = HostTakeSerialOutput();
+  CHECK(history.find("History of the last minute") != std::string::npos);
+  CHECK(history.find("solar          minimum 2380.0, maximum 2380.0, average 2380.0") != std::string::npos);
+
+  // both buttons together show the chart, the top button then steps to the next period, and both together return to the main screen
+
+  HostPressButton(PIN_BUTTON_1, 200);
+  HostPressButton(PIN_BUTTON_2, 200);
+  HostRunSketch(1000);
+  HostPressButton(PIN_BUTTON_1, 200);
+  HostRunSketch(1000);
+  HostPressButton(PIN_BUTTON_1, 200);
+  HostPressButton(PIN_BUTTON_2, 200);
+  HostRunSketch(1000);
+
+  std::string buttons = HostTakeSerialOutput();
+  size_t chartSelectedAt = buttons.find("Chart selected");
+  size_t periodSelectedAt = buttons.find("Chart period selected: 1 hour");
+  size_t mainScreenSelectedAt = buttons.find("Main screen selected");
+  CHECK((chartSelectedAt != std::string::npos) && (periodSelectedAt != std::string::npos) && (mainScreenSelectedAt != std::string::npos));
+  CHECK((chartSelectedAt < periodSelectedAt) && (periodSelectedAt < mainScreenSelectedAt));
+
+  if (failures != 0)
+  {
+    printf("%s\n", (output + history + buttons).c_str());
+    return 1;
+  };
+
+  printf("host sketch test passed\n");
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// what the tests of the sketch in the host build share: a CHECK that counts the checks failed, and the topics Venus publishes for a
+// small installation with one Multiplus and one solar charger; PublishVenusTopics publishes them retained, so that the sketch receives
+// them whenever it subscribes, while the Venus emulator (see venus_emulator.h) publishes them as Venus does
+
+#include "Arduino.h"
+#include "host_board.h"
+#include "host_broker.h"
+#include <stdio.h>
+#include <string>
+
+void setup();
+
+static int failures = 0;
+
+#define CHECK(condition)                                                     \
+  do                                                                         \
+  {                                                                          \
+    if (!(condition))                                                        \
+    {                                                                        \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                            \
+    };                                                                       \
+  } while (false)
+
+static const char *installationID = "c0619ab1d2e3";
+
+static int venusConnection = -1;
+
+// a value published by Venus, given by its topic after N/<installation id>
+static inline void PublishVenusValue(const char *topic, const char *payload)
+{
+  HostBroker().Publish(venusConnection, std::string("N/") + installationID + topic, payload, true);
+}
+
+// the topics, after N/<installation id>, and their payloads
+static const char *venusTopics[][2] = {{"/system/0/Serial", "{\"value\":\"c0619ab1d2e3\"}"},
+                                       {"/vebus/276/Mode", "{\"value\":3}"},
+                                       {"/solarcharger/279/Mode", "{\"value\":1}"},
+                                       {"/solarcharger/279/State", "{\"value\":3}"},
+                                       {"/system/0/Ac/Grid/L1/Power", "{\"value\":412.5}"},
+                                       {"/system/0/Ac/Grid/L2/Power", "{\"value\":0}"},
+                                       {"/system/0/Ac/Grid/L3/Power", "{\"value\":0}"},
+                                       {"/system/0/Dc/Pv/Power", "{\"value\":2380}"},
+                                       {"/system/0/Dc/Battery/Soc", "{\"value\":76.5}"},
+                                       {"/system/0/Dc/Battery/Power", "{\"value\":1210}"},
+                                       {"/system/0/Dc/Battery/TimeToGo", "{\"value\":null}"},
+                                       {"/system/0/Dc/Battery/Temperature", "{\"value\":21.4}"},
+                                       {"/system/0/Ac/Consumption/L1/Power", "{\"value\":1582.5}"},
+                                       {"/system/0/Ac/Consumption/L2/Power", "{\"value\":0}"},
+                                       {"/system/0/Ac/Consumption/L3/Power", "{\"value\":0}"}};
+
+static inline void PublishVenusTopics(hostBroker &broker)
+{
+
+  venusConnection = broker.Connect("venus");
+
+  for (const auto &topic : venusTopics)
+    PublishVenusValue(topic[0], topic[1]);
+}
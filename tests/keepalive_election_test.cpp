@@ -0,0 +1,213 @@
+// Keep alive election test
+//
+// runs the sketch with GENERAL_SETTINGS_ELECT_KEEP_ALIVE_LEADER set alongside other devices in the election, which follow the same
+// protocol using the keep alive election unit, and checks that exactly one of them leads as devices join, claim the lead, leave it
+// and drop off the network
+
+#include "host_test.h"
+#include "keepalive_election.h"
+#include "EspMQTTClient.h"
+#include "general_settings.h"
+#include "secret_settings.h"
+#include <string.h>
+
+extern EspMQTTClient client;
+
+static const char *heartbeatTopics = "ESP32RemoteForVictron/keepalive_leader/";
+static const char *sketchName = SECRET_SETTINGS_MQTT_ClientName;
+
+static const unsigned long leaseTime = GENERAL_SETTINGS_SEND_PERIODICAL_KEEP_ALIVE_REQUESTS_INTERVAL;
+
+// another device in the election
+
+class peer
+{
+public:
+  explicit peer(const char *name) : name(name)
+  {
+    BeginKeepAliveElection(election, name, leaseTime);
+  }
+
+  void Join()
+  {
+    connection = HostBroker().Connect(name, HeartbeatTopic(), "", true);
+    HostBroker().Subscribe(connection, std::string(heartbeatTopics) + "+");
+    StartKeepAliveElection(election, millis());
+    wasLeading = false;
+  }
+
+  // claim the lead regardless of the election, as a device does which has not yet received the leader's heartbeat
+  void Claim()
+  {
+    HostBroker().Publish(connection, HeartbeatTopic(), installationID, true);
+  }
+
+  void Leave()
+  {
+    HostBroker().Publish(connection, HeartbeatTopic(), "", true);
+    HostBroker().Disconnect(connection);
+  }
+
+  void Step()
+  {
+
+    if (!HostBroker().IsConnected(connection))
+      return;
+
+    unsigned long now = millis();
+
+    hostMessage message;
+    while (HostBroker().Receive(connection, message))
+    {
+      std::string senderName = message.topic.substr(strlen(heartbeatTopics));
+      if (message.payload.empty())
+        KeepAliveLeaderLeft(election, senderName.c_str());
+      else if (message.payload == installationID)
+        KeepAliveHeartbeatReceived(election, senderName.c_str(), now);
+    };
+
+    if (KeepAliveHeartbeatIsDue(election, now))
+      Claim();
+
+    bool isLeading = ThisDeviceLeadsKeepAlives(election, now);
+    if (wasLeading && !isLeading)
+      HostBroker().Publish(connection, HeartbeatTopic(), "", true);
+    wasLeading = isLeading;
+  }
+
+  bool Leads() const
+  {
+    return HostBroker().IsConnected(connection) && ThisDeviceLeadsKeepAlives(election, millis());
+  }
+
+  int connection = -1;
+
+private:
+  std::string name;
+  keepAliveElection election;
+  bool wasLeading = false;
+
+  std::string HeartbeatTopic() const
+  {
+    return heartbeatTopics + name;
+  }
+};
+
+static peer firstPeer("A-remote"); // sorts before the sketch's name, so wins when both claim the lead
+static peer lastPeer("Z-remote");  // sorts after it
+
+static bool sketchStarted = false;
+
+static void Run(unsigned long milliSeconds)
+{
+
+  // the peers take their turn every 100 ms, between passes of the sketch's loop() once it has been started
+
+  for (unsigned long ran = 0; ran < milliSeconds; ran += 100)
+  {
+    if (sketchStarted)
+      HostRunSketch(100);
+    else
+      HostAdvanceTime(100);
+    firstPeer.Step();
+    lastPeer.Step();
+  };
+}
+
+static bool HeartbeatIsRetained(const char *name)
+{
+  std::string payload;
+  return HostBroker().Retained(std::string(heartbeatTopics) + name, payload) && (payload == installationID);
+}
+
+static unsigned long KeepAlivesSentBySketch()
+{
+  // the peers do not send keep alive requests themselves, so those there are have been sent by the sketch
+  return HostBroker().MessagesPublished(std::string("R/") + installationID + "/keepalive");
+}
+
+static bool SketchLeads()
+{
+  return HeartbeatIsRetained(sketchName) && !firstPeer.Leads() && !lastPeer.Leads();
+}
+
+int main()
+{
+
+  hostBroker &broker = HostBroker();
+
+  PublishVenusTopics(broker);
+
+  // a device already leading when the sketch starts is followed, so the sketch sends no periodical keep alive requests
+
+  firstPeer.Join();
+  Run(leaseTime);
+  CHECK(firstPeer.Leads());
+
+  setup();
+  sketchStarted = true;
+  Run(3 * leaseTime);
+
+  CHECK(firstPeer.Leads());
+  CHECK(!HeartbeatIsRetained(sketchName));
+
+  unsigned long keepAlivesSent = KeepAlivesSentBySketch();
+  Run(3 * leaseTime);
+  CHECK(KeepAlivesSentBySketch() == keepAlivesSent);
+
+  // once the leader drops off the network its will clears its heartbeat, and the sketch takes over straight away rather than after
+  // the lease time
+
+  broker.DropConnection(firstPeer.connection);
+  CHECK(!HeartbeatIsRetained("A-remote"));
+
+  Run(1000);
+  CHECK(SketchLeads());
+
+  Run(3 * leaseTime);
+  CHECK(KeepAlivesSentBySketch() >= keepAlivesSent + 2);
+
+  // a device joining later follows the sketch
+
+  lastPeer.Join();
+  Run(3 * leaseTime);
+  CHECK(SketchLeads());
+
+  // where another device claims the lead as well, the one with the lower name keeps it; the sketch gives way and clears its heartbeat,
+  // so that a device joining later does not take it to be leading
+
+  firstPeer.Join();
+  firstPeer.Claim();
+  Run(leaseTime);
+
+  CHECK(firstPeer.Leads());
+  CHECK(!lastPeer.Leads());
+  CHECK(HeartbeatIsRetained("A-remote"));
+  CHECK(!HeartbeatIsRetained(sketchName));
+
+  // the leader leaving the election clears its heartbeat; the sketch, with the lower name of the two left, takes over
+
+  firstPeer.Leave();
+
+  Run(1000);
+  CHECK(SketchLeads());
+
+  // and once the sketch drops off the network its will clears its heartbeat, so the device left takes over
+
+  broker.DropConnection(client.hostConnection());
+  CHECK(!HeartbeatIsRetained(sketchName));
+
+  firstPeer.Step();
+  lastPeer.Step();
+  CHECK(lastPeer.Leads());
+
+  if (failures != 0)
+  {
+    printf("%s\n", HostTakeSerialOutput().c_str());
+    return 1;
+  };
+
+  printf("keep alive election test passed\n");
+
+  return 0;
+}
@@ -0,0 +1,261 @@
+// Number formatting test
+//
+// checks the number formatting unit against snprintf, for every input over the ranges the sketch uses it for, with the unit built with
+// the settings of the sketch it is linked with (GENERAL_SETTINGS_ROUND_NUMBERS and GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING)
+//
+//   number_formatting_test              the check
+//   number_formatting_test exhaustive   the check, with FormatFixedPoint given every float of less than 100000 (this takes hours)
+//   number_formatting_test benchmark    how long each function takes, and snprintf for the same text
+
+#include "number_formatting.h"
+#include "general_settings.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+static const long powersOfTen[] = {1L, 10L, 100L, 1000L, 10000L, 100000L, 1000000L};
+
+static unsigned long checks = 0;
+static unsigned long failures = 0;
+
+static void Check(const char *function, const char *input, const char *expected, const char *text, size_t length)
+{
+
+  checks++;
+
+  if ((strcmp(expected, text) == 0) && (length == strlen(text)))
+    return;
+
+  // the first few are enough to see what is wrong
+  if (failures++ < 20)
+    printf("%s(%s) gave \"%s\" (length %lu), snprintf gave \"%s\"\n", function, input, text, (unsigned long)length, expected);
+}
+
+static void WithoutNegativeZero(char *text)
+{
+
+  // the sketch shows a value which is zero once rounded or truncated as "0.0", where snprintf shows "-0.0"
+  if ((text[0] == '-') && (strspn(text + 1, "0.") == strlen(text + 1)))
+    memmove(text, text + 1, strlen(text));
+}
+
+static void ExpectedScaledValue(char *expected, size_t expectedSize, double exactScaledValue, int numberOfDecimalPlaces)
+{
+
+  // snprintf rounds halves to even and has no way to truncate, so for those the sketch's rounding (halves away from zero) or
+  // truncation is made first, after which the value is a whole number of the last decimal place shown and snprintf shows it exactly
+
+  double scaledValue = GENERAL_SETTINGS_ROUND_NUMBERS ? round(exactScaledValue) : trunc(exactScaledValue);
+
+  snprintf(expected, expectedSize, "%.*f", numberOfDecimalPlaces, scaledValue / (double)powersOfTen[numberOfDecimalPlaces]);
+  WithoutNegativeZero(expected);
+}
+
+static void CheckFixedPoint(float value, int numberOfDecimalPlaces)
+{
+
+  char expected[64];
+  char text[64];
+  char input[64];
+
+  // a float times a power of ten of no more than 10^6 is exact as a double
+  double exactScaledValue = (double)value * (double)powersOfTen[numberOfDecimalPlaces];
+
+  if (GENERAL_SETTINGS_ROUND_NUMBERS && (fabs(exactScaledValue - trunc(exactScaledValue)) != 0.5))
+  {
+    snprintf(expected, sizeof(expected), "%.*f", numberOfDecimalPlaces, (double)value);
+    WithoutNegativeZero(expected);
+  }
+  else
+    ExpectedScaledValue(expected, sizeof(expected), exactScaledValue, numberOfDecimalPlaces);
+
+  size_t length = FormatFixedPoint(text, sizeof(text), value, numberOfDecimalPlaces);
+
+  if (strcmp(expected, text) != 0)
+    snprintf(input, sizeof(input), "%.9g, %d", (double)value, numberOfDecimalPlaces);
+
+  Check("FormatFixedPoint", input, expected, text, length);
+}
+
+static void CheckWatts(long watts)
+{
+
+  char expected[64];
+  char text[64];
+  char input[32];
+
+  snprintf(expected, sizeof(expected), "%ld W", watts);
+  size_t length = FormatWatts(text, sizeof(text), watts);
+
+  snprintf(input, sizeof(input), "%ld", watts);
+  Check("FormatWatts", input, expected, text, length);
+}
+
+static void CheckKiloWatts(long watts)
+{
+
+  char expected[64];
+  char text[64];
+  char input[32];
+
+  const int numberOfDecimalPlaces = GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING;
+  long divisor = powersOfTen[3 - numberOfDecimalPlaces];
+
+  if (GENERAL_SETTINGS_ROUND_NUMBERS && (2L * labs(watts % divisor) != divisor))
+  {
+    snprintf(expected, sizeof(expected), "%.*f", numberOfDecimalPlaces, (double)watts / 1000.0);
+    WithoutNegativeZero(expected);
+  }
+  else
+    ExpectedScaledValue(expected, sizeof(expected), (double)watts / (double)divisor, numberOfDecimalPlaces);
+
+  strcat(expected, " KW");
+
+  size_t length = FormatKiloWatts(text, sizeof(text), watts, " KW");
+
+  snprintf(input, sizeof(input), "%ld", watts);
+  Check("FormatKiloWatts", input, expected, text, length);
+}
+
+static void CheckDaysHoursMinutes(int seconds)
+{
+
+  char expected[64];
+  char text[64];
+  char input[32];
+
+  int days = seconds / (24 * 3600);
+  int hours = seconds % (24 * 3600) / 3600;
+  int minutes = seconds % 3600 / 60;
+
+  if (days > 0)
+    snprintf(expected, sizeof(expected), "%d %d:%02d", days, hours, minutes);
+  else
+    snprintf(expected, sizeof(expected), " %d:%02d", hours, minutes);
+
+  size_t length = FormatDaysHoursMinutes(text, sizeof(text), seconds);
+
+  snprintf(input, sizeof(input), "%d", seconds);
+  Check("FormatDaysHoursMinutes", input, expected, text, length);
+}
+
+static void CheckTruncation()
+{
+
+  // the text is cut short to fit the buffer, and is still null terminated
+
+  char text[6];
+  char input[] = "1234.5678, 4";
+
+  size_t length = FormatFixedPoint(text, sizeof(text), 1234.5678F, 4);
+  Check("FormatFixedPoint", input, "1234.", text, length);
+
+  length = FormatWatts(text, 4, 123456L);
+  Check("FormatWatts", "123456", "123", text, length);
+}
+
+static void CheckFixedPointOverTheSketchsRanges()
+{
+
+  // every value with up to two decimal places from -10000 to 10000, which takes in the state of charge, the battery temperature and
+  // today's energy as Venus publishes them
+
+  for (long hundredths = -1000000L; hundredths <= 1000000L; hundredths++)
+  {
+    float value = (float)hundredths / 100.0F;
+    CheckFixedPoint(value, 0);
+    CheckFixedPoint(value, 1);
+  };
+
+  // and every float from 64 to 128, so every pattern of the bits after the binary point, to take in those between
+
+  for (float value = 64.0F; value < 128.0F; value = nextafterf(value, 256.0F))
+    CheckFixedPoint(value, 1);
+}
+
+static void CheckFixedPointExhaustively()
+{
+
+  for (float value = 0.0F; value < 100000.0F; value = nextafterf(value, 200000.0F))
+    for (int numberOfDecimalPlaces = 0; numberOfDecimalPlaces <= 3; numberOfDecimalPlaces++)
+    {
+      CheckFixedPoint(value, numberOfDecimalPlaces);
+      CheckFixedPoint(-value, numberOfDecimalPlaces);
+    };
+}
+
+static void Benchmark()
+{
+
+  const int calls = 10000000;
+
+  char text[64];
+  unsigned long characters = 0;
+
+  auto Time = [&](const char *name, void (*format)(char *, size_t, int))
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+      format(text, sizeof(text), i);
+    auto end = std::chrono::steady_clock::now();
+    characters += strlen(text);
+    printf("%-40s %6.1f ns a call\n", name, std::chrono::duration<double, std::nano>(end - start).count() / calls);
+  };
+
+  // values like those the sketch shows, such as a state of charge of 76.3 or a load of 1582 W
+
+  Time("FormatFixedPoint, 1 decimal place", [](char *buffer, size_t size, int i)
+       { FormatFixedPoint(buffer, size, (float)(i % 100000) / 1000.0F, 1); });
+  Time("snprintf \"%.1f\"", [](char *buffer, size_t size, int i)
+       { snprintf(buffer, size, "%.1f", (double)((float)(i % 100000) / 1000.0F)); });
+  Time("FormatWatts", [](char *buffer, size_t size, int i)
+       { FormatWatts(buffer, size, i % 20000 - 10000); });
+  Time("snprintf \"%ld W\"", [](char *buffer, size_t size, int i)
+       { snprintf(buffer, size, "%ld W", (long)(i % 20000 - 10000)); });
+  Time("FormatKiloWatts", [](char *buffer, size_t size, int i)
+       { FormatKiloWatts(buffer, size, i % 20000 - 10000, " KW"); });
+  Time("snprintf \"%.1f KW\"", [](char *buffer, size_t size, int i)
+       { snprintf(buffer, size, "%.1f KW", (i % 20000 - 10000) / 1000.0); });
+  Time("FormatDaysHoursMinutes", [](char *buffer, size_t size, int i)
+       { FormatDaysHoursMinutes(buffer, size, i); });
+
+  // so that the calls are not optimised away
+  if (characters == 0)
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+
+  if ((argc > 1) && (strcmp(argv[1], "benchmark") == 0))
+  {
+    Benchmark();
+    return 0;
+  };
+
+  bool exhaustive = (argc > 1) && (strcmp(argv[1], "exhaustive") == 0);
+
+  CheckTruncation();
+
+  for (long watts = -2000000L; watts <= 2000000L; watts++)
+  {
+    CheckWatts(watts);
+    CheckKiloWatts(watts);
+  };
+
+  // up to 30 days, more than the battery's time to go is likely to be
+  for (int seconds = 0; seconds <= 30 * 24 * 3600; seconds++)
+    CheckDaysHoursMinutes(seconds);
+
+  if (exhaustive)
+    CheckFixedPointExhaustively();
+  else
+    CheckFixedPointOverTheSketchsRanges();
+
+  printf("%lu checks, %lu failed (rounding %s, %d decimal places for KW)\n", checks, failures, GENERAL_SETTINGS_ROUND_NUMBERS ? "on" : "off",
+         GENERAL_SETTINGS_NUMBER_DECIMAL_PLACES_FOR_KW_REPORTING);
+
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include "png_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static void PutBigEndian(std::vector<uint8_t> &bytes, uint32_t value)
+{
+  for (int shift = 24; shift >= 0; shift -= 8)
+    bytes.push_back((uint8_t)(value >> shift));
+}
+
+static uint32_t GetBigEndian(const uint8_t *bytes)
+{
+  return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+static void PutChunk(FILE *file, const char *type, const std::vector<uint8_t> &data)
+{
+
+  std::vector<uint8_t> chunk;
+  PutBigEndian(chunk, (uint32_t)data.size());
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+
+  // the CRC covers the type and the data, but not the length
+  PutBigEndian(chunk, (uint32_t)crc32(0L, chunk.data() + 4, (uInt)(chunk.size() - 4)));
+
+  fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+bool WritePngImage(const char *fileName, int width, int height, const std::vector<uint8_t> &rgb)
+{
+
+  // each row is preceded by its filter type; 1 (each byte less the one of the pixel to its left) packs the panel's flat areas well
+
+  const size_t rowLength = (size_t)width * 3;
+
+  std::vector<uint8_t> rows;
+  rows.reserve((rowLength + 1) * height);
+
+  for (int y = 0; y < height; y++)
+  {
+    const uint8_t *row = &rgb[y * rowLength];
+    rows.push_back(1);
+    for (size_t i = 0; i < rowLength; i++)
+      rows.push_back((uint8_t)(row[i] - ((i >= 3) ? row[i - 3] : 0)));
+  };
+
+  uLongf compressedLength = compressBound((uLong)rows.size());
+  std::vector<uint8_t> compressed(compressedLength);
+  if (compress2(compressed.data(), &compressedLength, rows.data(), (uLong)rows.size(), Z_BEST_COMPRESSION) != Z_OK)
+    return false;
+  compressed.resize(compressedLength);
+
+  std::vector<uint8_t> header;
+  PutBigEndian(header, (uint32_t)width);
+  PutBigEndian(header, (uint32_t)height);
+  header.push_back(8); // bits for each colour
+  header.push_back(2); // RGB
+  header.push_back(0); // deflate
+  header.push_back(0); // adaptive filtering
+  header.push_back(0); // not interlaced
+
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL)
+    return false;
+
+  fwrite(pngSignature, 1, sizeof(pngSignature), file);
+  PutChunk(file, "IHDR", header);
+  PutChunk(file, "IDAT", compressed);
+  PutChunk(file, "IEND", std::vector<uint8_t>());
+
+  return fclose(file) == 0;
+}
+
+static uint8_t Paeth(int left, int above, int aboveLeft)
+{
+
+  int estimate = left + above - aboveLeft;
+  int leftDistance = abs(estimate - left);
+  int aboveDistance = abs(estimate - above);
+  int aboveLeftDistance = abs(estimate - aboveLeft);
+
+  if ((leftDistance <= aboveDistance) && (leftDistance <= aboveLeftDistance))
+    return (uint8_t)left;
+  if (aboveDistance <= aboveLeftDistance)
+    return (uint8_t)above;
+  return (uint8_t)aboveLeft;
+}
+
+bool ReadPngImage(const char *fileName, int &width, int &height, std::vector<uint8_t> &rgb)
+{
+
+  FILE *file = fopen(fileName, "rb");
+  if (file == NULL)
+    return false;
+
+  std::vector<uint8_t> bytes;
+  uint8_t buffer[65536];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    bytes.insert(bytes.end(), buffer, buffer + read);
+  fclose(file);
+
+  if ((bytes.size() < sizeof(pngSignature)) || (memcmp(bytes.data(), pngSignature, sizeof(pngSignature)) != 0))
+    return false;
+
+  std::vector<uint8_t> compressed;
+  bool headerRead = false;
+
+  for (size_t at = sizeof(pngSignature); at + 12 <= bytes.size();)
+  {
+
+    uint32_t length = GetBigEndian(&bytes[at]);
+    if (at + 12 + length > bytes.size())
+      return false;
+
+    const char *type = (const char *)&bytes[at + 4];
+    const uint8_t *data = &bytes[at + 8];
+
+    if (memcmp(type, "IHDR", 4) == 0)
+    {
+      width = (int)GetBigEndian(data);
+      height = (int)GetBigEndian(data + 4);
+      // only 8 bit RGB, not interlaced
+      if ((length < 13) || (data[8] != 8) || (data[9] != 2) || (data[12] != 0))
+        return false;
+      headerRead = true;
+    }
+    else if (memcmp(type, "IDAT", 4) == 0)
+      compressed.insert(compressed.end(), data, data + length);
+    else if (memcmp(type, "IEND", 4) == 0)
+      break;
+
+    at += 12 + length;
+  };
+
+  if (!headerRead)
+    return false;
+
+  const size_t rowLength = (size_t)width * 3;
+
+  std::vector<uint8_t> rows((rowLength + 1) * height);
+  uLongf rowsLength = (uLongf)rows.size();
+  if ((uncompress(rows.data(), &rowsLength, compressed.data(), (uLong)compressed.size()) != Z_OK) || (rowsLength != rows.size()))
+    return false;
+
+  rgb.assign(rowLength * height, 0);
+
+  for (int y = 0; y < height; y++)
+  {
+
+    uint8_t filter = rows[y * (rowLength + 1)];
+    const uint8_t *filtered = &rows[y * (rowLength + 1) + 1];
+    uint8_t *row = &rgb[y * rowLength];
+    const uint8_t *rowAbove = (y > 0) ? &rgb[(y - 1) * rowLength] : NULL;
+
+    for (size_t i = 0; i < rowLength; i++)
+    {
+
+      int left = (i >= 3) ? row[i - 3] : 0;
+      int above = (rowAbove != NULL) ? rowAbove[i] : 0;
+      int aboveLeft = ((rowAbove != NULL) && (i >= 3)) ? rowAbove[i - 3] : 0;
+
+      switch (filter)
+      {
+      case 0:
+        row[i] = filtered[i];
+        break;
+      case 1:
+        row[i] = (uint8_t)(filtered[i] + left);
+        break;
+      case 2:
+        row[i] = (uint8_t)(filtered[i] + above);
+        break;
+      case 3:
+        row[i] = (uint8_t)(filtered[i] + (left + above) / 2);
+        break;
+      case 4:
+        row[i] = (uint8_t)(filtered[i] + Paeth(left, above, aboveLeft));
+        break;
+      default:
+        return false;
+      };
+    };
+  };
+
+  return true;
+}
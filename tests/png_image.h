@@ -0,0 +1,12 @@
+#pragma once
+
+// PNG images
+//
+// reads and writes the 8 bit RGB images the rendering test compares the panel with, using zlib; only those are read (any of the PNG
+// filters may have been used, so that an image saved again by an image editor can still be read, but not interlacing)
+
+#include <stdint.h>
+#include <vector>
+
+bool WritePngImage(const char *fileName, int width, int height, const std::vector<uint8_t> &rgb);
+bool ReadPngImage(const char *fileName, int &width, int &height, std::vector<uint8_t> &rgb);
@@ -0,0 +1,167 @@
+// Rendering test
+//
+// runs the sketch in the host build through its screens with the same values each time, and compares what is shown on the panel with
+// the golden images in tests/golden, pixel by pixel; as the images are drawn by the host build's TFT_eSPI (which follows the library's
+// smooth fonts and anti-aliasing closely, but not to the pixel) they check the sketch's rendering against itself rather than the device
+//
+//   rendering_test <golden folder> <sketch name> <output folder>          the check; the images which differ are written to the output
+//                                                                          folder, as <sketch name>-<screen>.png
+//   rendering_test <golden folder> <sketch name> <output folder> update   write the golden images, once those in the output folder
+//                                                                          have been looked at and found right
+
+#include "host_test.h"
+#include "png_image.h"
+#include "pins_config.h"
+#include <string.h>
+#include <vector>
+
+static const char *goldenFolder;
+static const char *sketchName;
+static const char *outputFolder;
+static bool updating = false;
+
+static std::vector<uint8_t> PanelImage()
+{
+
+  std::vector<uint8_t> rgb;
+  rgb.reserve(TFT_WIDTH * TFT_HEIGHT * 3);
+
+  for (int y = 0; y < TFT_HEIGHT; y++)
+    for (int x = 0; x < TFT_WIDTH; x++)
+    {
+      uint16_t colour = HostPanelPixel(x, y);
+      rgb.push_back((uint8_t)(((colour >> 11) & 0x1F) * 255 / 31));
+      rgb.push_back((uint8_t)(((colour >> 5) & 0x3F) * 255 / 63));
+      rgb.push_back((uint8_t)((colour & 0x1F) * 255 / 31));
+    };
+
+  return rgb;
+}
+
+static void CheckScreen(const char *screen)
+{
+
+  std::string fileName = std::string(sketchName) + "-" + screen + ".png";
+  std::string goldenFileName = std::string(goldenFolder) + "/" + fileName;
+
+  std::vector<uint8_t> shown = PanelImage();
+
+  if (updating)
+  {
+    CHECK(WritePngImage(goldenFileName.c_str(), TFT_WIDTH, TFT_HEIGHT, shown));
+    return;
+  };
+
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> golden;
+
+  bool read = ReadPngImage(goldenFileName.c_str(), width, height, golden);
+
+  int pixelsDifferent = 0;
+  if (read && (width == TFT_WIDTH) && (height == TFT_HEIGHT))
+    for (size_t i = 0; i < shown.size(); i += 3)
+      if (memcmp(&shown[i], &golden[i], 3) != 0)
+        pixelsDifferent++;
+
+  if (read && (width == TFT_WIDTH) && (height == TFT_HEIGHT) && (pixelsDifferent == 0))
+    return;
+
+  std::string shownFileName = std::string(outputFolder) + "/" + fileName;
+  WritePngImage(shownFileName.c_str(), TFT_WIDTH, TFT_HEIGHT, shown);
+
+  if (read)
+    printf("%s: %d pixels differ from %s, see %s\n", screen, pixelsDifferent, goldenFileName.c_str(), shownFileName.c_str());
+  else
+    printf("%s: %s could not be read, see %s\n", screen, goldenFileName.c_str(), shownFileName.c_str());
+
+  failures++;
+}
+
+static int TriangleWave(int sample, int period, int low, int high)
+{
+  int phase = sample % period;
+  int rising = (phase < period / 2) ? phase : period - phase;
+  return low + (high - low) * rising / (period / 2);
+}
+
+static void PublishChangingValues(int sample)
+{
+
+  // solar rising and falling over 40 minutes, a load switching between two levels and the grid making up the difference
+
+  char payload[32];
+
+  int solar = TriangleWave(sample, 480, 0, 3200);
+  int load = ((sample / 30) % 2 == 0) ? 650 : 2100;
+  int battery = (solar > load) ? solar - load : -TriangleWave(sample, 60, 200, 900);
+  int grid = load + battery - solar;
+
+  snprintf(payload, sizeof(payload), "{\"value\":%d}", solar);
+  PublishVenusValue("/system/0/Dc/Pv/Power", payload);
+  snprintf(payload, sizeof(payload), "{\"value\":%d}", load);
+  PublishVenusValue("/system/0/Ac/Consumption/L1/Power", payload);
+  snprintf(payload, sizeof(payload), "{\"value\":%d}", battery);
+  PublishVenusValue("/system/0/Dc/Battery/Power", payload);
+  snprintf(payload, sizeof(payload), "{\"value\":%d}", grid);
+  PublishVenusValue("/system/0/Ac/Grid/L1/Power", payload);
+}
+
+int main(int argc, char **argv)
+{
+
+  if (argc < 4)
+  {
+    printf("usage: rendering_test <golden folder> <sketch name> <output folder> [update]\n");
+    return 2;
+  };
+
+  goldenFolder = argv[1];
+  sketchName = argv[2];
+  outputFolder = argv[3];
+  updating = (argc > 4) && (strcmp(argv[4], "update") == 0);
+
+  // until Venus is found
+
+  setup();
+  HostRunSketch(5000);
+  CheckScreen("waiting");
+
+  // the main screen, with the battery charging
+
+  PublishVenusTopics(HostBroker());
+  HostRunSketch(20000);
+  CheckScreen("charging");
+
+  // and discharging, with nothing from the grid or the solar charger, so that the battery's time to go is shown
+
+  PublishVenusValue("/system/0/Ac/Grid/L1/Power", "{\"value\":0}");
+  PublishVenusValue("/system/0/Dc/Pv/Power", "{\"value\":0}");
+  PublishVenusValue("/system/0/Dc/Battery/Power", "{\"value\":-1642}");
+  PublishVenusValue("/system/0/Dc/Battery/TimeToGo", "{\"value\":37260}");
+  PublishVenusValue("/solarcharger/279/State", "{\"value\":0}");
+  HostRunSketch(20000);
+  CheckScreen("discharging");
+
+  // the power chart, shown by pressing both buttons together once there are 20 minutes of samples, and then left to scroll for a minute
+
+  for (int sample = 0; sample < 252; sample++)
+  {
+    if (sample == 240)
+    {
+      HostPressButton(PIN_BUTTON_1, 200);
+      HostPressButton(PIN_BUTTON_2, 200);
+    };
+    PublishChangingValues(sample);
+    HostRunSketch(5000);
+  };
+
+  CheckScreen("chart");
+
+  if (failures != 0)
+    return 1;
+
+  printf("%s rendering test %s\n", sketchName, updating ? "images written" : "passed");
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+// Telemetry log test
+//
+// checks that the telemetry log reads back the records written to it, across a change of month and a restart, finds a range of them,
+// and that a flush cut short by the power going off loses only the records of that flush
+//
+//   telemetry_log_test <output folder>
+
+#include "host_test.h"
+#include "telemetry_log.h"
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+static const uint32_t firstMinute = 29846160; // 12:00 on 30 September 2026 (UTC)
+
+static telemetryRecord Record(uint32_t minute)
+{
+
+  // values which change by varying amounts from one minute to the next, as the real ones do
+
+  telemetryRecord record;
+  record.minute = minute;
+  record.values[SolarTelemetry] = (int32_t)((minute * 37) % 4000);
+  record.values[GridTelemetry] = (int32_t)((minute * 13) % 900) - 450;
+  record.values[ACLoadTelemetry] = 300 + (int32_t)(minute % 97);
+  record.values[BatteryPowerTelemetry] = (int32_t)((minute * 7) % 2000) - 1000;
+  record.values[BatterySOCTelemetry] = 500 + (int32_t)(minute % 400);
+  record.values[BatteryTemperatureTelemetry] = (int32_t)(minute / 30 % 300) - 50;
+  return record;
+}
+
+static void KeepRecord(const telemetryRecord &record, void *context)
+{
+  ((std::vector<telemetryRecord> *)context)->push_back(record);
+}
+
+static std::vector<telemetryRecord> Read(uint32_t fromMinute, uint32_t toMinute)
+{
+  std::vector<telemetryRecord> records;
+  CHECK(ReadTelemetryLog(fromMinute, toMinute, KeepRecord, &records) == records.size());
+  return records;
+}
+
+static bool AreTheRecords(const std::vector<telemetryRecord> &records, uint32_t fromMinute, uint32_t toMinute)
+{
+
+  if (records.size() != toMinute - fromMinute + 1)
+    return false;
+
+  for (size_t r = 0; r < records.size(); r++)
+  {
+    telemetryRecord expected = Record(fromMinute + (uint32_t)r);
+    if ((records[r].minute != expected.minute) || (memcmp(records[r].values, expected.values, sizeof(expected.values)) != 0))
+      return false;
+  };
+
+  return true;
+}
+
+static long FileSize(const std::string &path)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+int main(int argc, char **argv)
+{
+
+  if (argc < 2)
+  {
+    printf("usage: telemetry_log_test <output folder>\n");
+    return 2;
+  };
+
+  std::string folder = std::string(argv[1]) + "/telemetry_log_test_files";
+  std::string september = folder + "/202609.log";
+  std::string october = folder + "/202610.log";
+
+  remove(september.c_str());
+  remove(october.c_str());
+
+  CHECK(BeginTelemetryLog(folder.c_str()));
+
+  // two days of records, flushed every ten minutes as the sketch does, which run into October
+
+  const uint32_t days = 2 * 24 * 60;
+
+  for (uint32_t minute = firstMinute; minute < firstMinute + days; minute++)
+  {
+    AppendTelemetryRecord(Record(minute));
+    if (minute % 10 == 9)
+      CHECK(FlushTelemetryLog());
+  };
+
+  // the records not yet flushed are read from memory
+
+  uint32_t lastMinute = firstMinute + days - 1;
+  CHECK(AreTheRecords(Read(0, 0xFFFFFFFFUL), firstMinute, lastMinute));
+
+  CHECK(FlushTelemetryLog());
+  CHECK(FileSize(september) > (long)telemetryLogBlockSize);
+  CHECK(FileSize(october) > (long)telemetryLogBlockSize);
+
+  // and after a restart, from the files, with a range found in the middle of them
+
+  CHECK(BeginTelemetryLog(folder.c_str()));
+  CHECK(AreTheRecords(Read(0, 0xFFFFFFFFUL), firstMinute, lastMinute));
+  CHECK(AreTheRecords(Read(firstMinute + 1000, firstMinute + 1500), firstMinute + 1000, firstMinute + 1500));
+  CHECK(Read(lastMinute + 1, 0xFFFFFFFFUL).empty());
+
+  // a record for a minute already logged is ignored
+
+  AppendTelemetryRecord(Record(lastMinute));
+  CHECK(AreTheRecords(Read(lastMinute - 10, 0xFFFFFFFFUL), lastMinute - 10, lastMinute));
+
+  // the power going off part way through a flush leaves the file with only part of its chunk: only that flush's records are lost, and
+  // the log carries on from before it
+
+  long sizeBefore = FileSize(october);
+  for (uint32_t minute = lastMinute + 1; minute <= lastMinute + 10; minute++)
+    AppendTelemetryRecord(Record(minute));
+  CHECK(FlushTelemetryLog());
+
+  long sizeAfter = FileSize(october);
+  CHECK(sizeAfter > sizeBefore);
+  CHECK(truncate(october.c_str(), sizeBefore + (sizeAfter - sizeBefore) / 2) == 0);
+
+  CHECK(BeginTelemetryLog(folder.c_str()));
+  CHECK(AreTheRecords(Read(0, 0xFFFFFFFFUL), firstMinute, lastMinute));
+
+  for (uint32_t minute = lastMinute + 1; minute <= lastMinute + 10; minute++)
+    AppendTelemetryRecord(Record(minute));
+  CHECK(FlushTelemetryLog());
+  CHECK(FileSize(october) == sizeAfter);
+
+  CHECK(BeginTelemetryLog(folder.c_str()));
+  CHECK(AreTheRecords(Read(0, 0xFFFFFFFFUL), firstMinute, lastMinute + 10));
+
+  // as does one which leaves rubbish where its chunk should have been
+
+  sizeBefore = FileSize(october);
+  for (uint32_t minute = lastMinute + 11; minute <= lastMinute + 20; minute++)
+    AppendTelemetryRecord(Record(minute));
+  CHECK(FlushTelemetryLog());
+
+  FILE *file = fopen(october.c_str(), "r+b");
+  CHECK(file != NULL);
+  if (file != NULL)
+  {
+    fseek(file, sizeBefore + 20, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, sizeBefore + 20, SEEK_SET);
+    fputc(byte ^ 0xFF, file);
+    fclose(file);
+  };
+
+  CHECK(BeginTelemetryLog(folder.c_str()));
+  CHECK(AreTheRecords(Read(0, 0xFFFFFFFFUL), firstMinute, lastMinute + 10));
+
+  if (failures != 0)
+    return 1;
+
+  printf("Telemetry log test passed\n");
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+// Traffic replay test
+//
+// checks that the traffic log reads back what was written to it, then records the traffic the sketch receives from the Venus emulator
+// with its 'record' serial monitor command, and replays the recording to the sketch, saved as a traffic log, ten times as fast
+//
+//   traffic_replay_test <output folder>
+
+#include "host_test.h"
+#include "traffic_log.h"
+#include "traffic_replay.h"
+#include "venus_emulator.h"
+#include <string.h>
+
+extern float batterySOC;
+
+static venusEmulator venus;
+
+static void CheckTheTrafficLog()
+{
+
+  const char *topics[] = {"N/c0619ab1d2e3/system/0/Dc/Battery/Soc", "N/c0619ab1d2e3/system/0/Dc/Pv/Power", "N/c0619ab1d2e3/system/0/Dc/Battery/Soc"};
+  const char *payloads[] = {"{\"value\":76.5}", "{\"value\":2380}", ""};
+  const uint32_t times[] = {0, 1500, 200000};
+
+  uint8_t buffer[256];
+  size_t length = 0;
+
+  trafficLogWriter writer;
+  BeginTrafficLogWriter(writer);
+
+  for (int i = 0; i < 3; i++)
+    CHECK(AppendTrafficLogMessage(writer, buffer, sizeof(buffer), length, times[i], topics[i], strlen(topics[i]), (const uint8_t *)payloads[i],
+                                  strlen(payloads[i])));
+
+  // the second message on a topic takes the time, the topic's number and the payload's length, a byte each (but for the time, which
+  // takes three)
+  CHECK(length == (1 + 1 + 1 + strlen(topics[0]) + 1 + strlen(payloads[0])) + (2 + 1 + 1 + strlen(topics[1]) + 1 + strlen(payloads[1])) + (3 + 1 + 1));
+
+  // one that does not fit is not added
+  size_t lengthBefore = length;
+  CHECK(!AppendTrafficLogMessage(writer, buffer, length + 4, length, 200001, topics[1], strlen(topics[1]), (const uint8_t *)payloads[1],
+                                 strlen(payloads[1])));
+  CHECK(length == lengthBefore);
+
+  trafficLogReader reader;
+  trafficLogMessage message;
+  BeginTrafficLogReader(reader, buffer, length);
+
+  for (int i = 0; i < 3; i++)
+  {
+    CHECK(ReadTrafficLogMessage(reader, message));
+    CHECK(message.time == times[i]);
+    CHECK((message.topicLength == strlen(topics[i])) && (memcmp(message.topic, topics[i], message.topicLength) == 0));
+    CHECK((message.payloadLength == strlen(payloads[i])) && (memcmp(message.payload, payloads[i], message.payloadLength) == 0));
+  };
+
+  CHECK(!ReadTrafficLogMessage(reader, message));
+
+  // nor is a message cut short read
+  BeginTrafficLogReader(reader, buffer, length - 1);
+  CHECK(ReadTrafficLogMessage(reader, message) && ReadTrafficLogMessage(reader, message) && !ReadTrafficLogMessage(reader, message));
+}
+
+static void Run(unsigned long milliSeconds)
+{
+  for (unsigned long ran = 0; ran < milliSeconds; ran += 10)
+  {
+    HostRunSketch(10);
+    venus.Step();
+  };
+}
+
+static void PublishStateOfCharge(int tenths)
+{
+  char payload[32];
+  snprintf(payload, sizeof(payload), "{\"value\":%d.%d}", tenths / 10, tenths % 10);
+  venus.SetValue("system/0/Dc/Battery/Soc", payload);
+}
+
+int main(int argc, char **argv)
+{
+
+  if (argc < 2)
+  {
+    printf("usage: traffic_replay_test <output folder>\n");
+    return 2;
+  };
+
+  CheckTheTrafficLog();
+
+  venus.Start(HostBroker(), installationID);
+  for (const auto &topic : venusTopics)
+    venus.SetValue(topic[0] + 1, topic[1]);
+
+  setup();
+  Run(20000);
+
+  // record the state of charge rising by 0.1 % a minute for ten minutes
+
+  HostTakeSerialOutput();
+  HostSerialInput("record\n");
+  Run(100);
+
+  for (int minute = 0; minute < 10; minute++)
+  {
+    PublishStateOfCharge(766 + minute);
+    Run(60000);
+  };
+
+  HostSerialInput("stop\nrecording\n");
+  Run(100);
+
+  std::string recordingFileName = std::string(argv[1]) + "/traffic_replay_test.txt";
+  std::string logFileName = std::string(argv[1]) + "/traffic_replay_test.log";
+
+  std::string output = HostTakeSerialOutput();
+  FILE *file = fopen(recordingFileName.c_str(), "wb");
+  CHECK(file != NULL);
+  if (file != NULL)
+  {
+    fwrite(output.data(), 1, output.size(), file);
+    fclose(file);
+  };
+
+  std::vector<trafficMessage> recorded;
+  CHECK(LoadTrafficRecording(recordingFileName.c_str(), recorded));
+
+  // every value published again on each keep alive, and each change to the state of charge
+  int stateOfChargeChanges = 0;
+  for (const auto &message : recorded)
+    if ((message.topic == std::string("N/") + installationID + "/system/0/Dc/Battery/Soc") && (message.payload != "{\"value\":76.5}"))
+      stateOfChargeChanges++;
+
+  CHECK(stateOfChargeChanges >= 10);
+  CHECK(recorded.size() > 200);
+  CHECK(TrafficInstallationID(recorded) == installationID);
+
+  // saved as a traffic log, the recording is read back the same, in less space
+
+  CHECK(SaveTrafficLog(logFileName.c_str(), recorded));
+
+  std::vector<trafficMessage> logged;
+  CHECK(LoadTrafficRecording(logFileName.c_str(), logged));
+  CHECK(logged.size() == recorded.size());
+  for (size_t i = 0; (i < logged.size()) && (i < recorded.size()); i++)
+    CHECK((logged[i].time == recorded[i].time) && (logged[i].topic == recorded[i].topic) && (logged[i].payload == recorded[i].payload));
+
+  // replayed ten times as fast, the ten minutes take one, and the sketch ends with the last state of charge recorded
+
+  PublishStateOfCharge(700);
+  Run(1000);
+  CHECK(batterySOC < 71.0F);
+
+  uint64_t replayStartedAt = HostMicroSeconds();
+  unsigned long handedOver = ReplayTraffic(venus, logged, 10);
+  uint64_t replayTook = HostMicroSeconds() - replayStartedAt;
+
+  CHECK(handedOver == logged.size());
+  CHECK((replayTook >= (uint64_t)logged.back().time * 100ULL) && (replayTook < (uint64_t)logged.back().time * 100ULL + 20000ULL));
+
+  Run(1000);
+  CHECK((batterySOC > 77.4F) && (batterySOC < 77.6F));
+
+  if (failures != 0)
+  {
+    printf("%s\n", HostTakeSerialOutput().c_str());
+    return 1;
+  };
+
+  printf("traffic replay test passed, %lu messages recorded\n", (unsigned long)recorded.size());
+
+  return 0;
+}
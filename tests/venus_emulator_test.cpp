@@ -0,0 +1,258 @@
+// Venus emulator test
+//
+// checks that the Venus emulator follows Venus's keep alive, read and write requests, and then runs the sketch against it to check
+// that the sketch finds the installation, receives every value, keeps Venus publishing and has a mode change echoed back; the times
+// the sketch reports for these (discovery, MassSubscribe readiness and the mode change's round trip) are written to standard output
+
+#include "host_test.h"
+#include "venus_emulator.h"
+#include "pins_config.h"
+#include <string.h>
+#include <vector>
+
+extern bool ESSIsBeingUsed;
+extern const char *chargingState;
+
+static venusEmulator venus;
+
+static std::string N(const char *path)
+{
+  return std::string("N/") + installationID + "/" + path;
+}
+
+static std::string R(const char *path)
+{
+  return std::string("R/") + installationID + "/" + path;
+}
+
+static std::string W(const char *path)
+{
+  return std::string("W/") + installationID + "/" + path;
+}
+
+static std::vector<hostMessage> Received(int connection)
+{
+
+  std::vector<hostMessage> messages;
+
+  hostMessage message;
+  while (HostBroker().Receive(connection, message))
+    messages.push_back(message);
+
+  return messages;
+}
+
+static bool WasReceived(const std::vector<hostMessage> &messages, const std::string &topic, const char *payload)
+{
+  for (const auto &message : messages)
+    if ((message.topic == topic) && (message.payload == payload))
+      return true;
+  return false;
+}
+
+static void CheckTheEmulator()
+{
+
+  hostBroker &broker = HostBroker();
+
+  int client = broker.Connect("client");
+
+  CHECK(venus.Start(broker, installationID));
+  for (const auto &topic : venusTopics)
+    venus.SetValue(topic[0] + 1, topic[1]);
+
+  // before a keep alive only the serial number is published, and it is retained
+
+  broker.Subscribe(client, "N/#");
+  std::vector<hostMessage> messages = Received(client);
+
+  CHECK(messages.size() == 1);
+  CHECK(WasReceived(messages, N("system/0/Serial"), "{\"value\":\"c0619ab1d2e3\"}"));
+  CHECK(venus.KeepAliveHasExpired());
+
+  // a keep alive publishes every value, and then full_publish_completed
+
+  broker.Publish(client, R("keepalive"), "");
+  venus.Step();
+  messages = Received(client);
+
+  CHECK(messages.size() == sizeof(venusTopics) / sizeof(venusTopics[0]) + 1);
+  CHECK(WasReceived(messages, N("system/0/Dc/Battery/Soc"), "{\"value\":76.5}"));
+  CHECK(!messages.empty() && (messages.back().topic == N("full_publish_completed")));
+  CHECK(!venus.KeepAliveHasExpired());
+
+  // and the values are published as they change, until the keep alive expires
+
+  venus.SetValue("system/0/Dc/Battery/Soc", "{\"value\":76.6}");
+  CHECK(WasReceived(Received(client), N("system/0/Dc/Battery/Soc"), "{\"value\":76.6}"));
+
+  // one suppressing the republish publishes nothing while the keep alive has not expired
+
+  broker.Publish(client, R("keepalive"), "{\"keepalive-options\": [\"suppress-republish\"]}");
+  venus.Step();
+  CHECK(Received(client).empty());
+
+  // one with a list of paths publishes only those
+
+  broker.Publish(client, R("keepalive"), "[\"system/0/Dc/Battery/#\", \"vebus/+/Mode\"]");
+  venus.Step();
+  messages = Received(client);
+
+  CHECK(messages.size() == 5);
+  CHECK(WasReceived(messages, N("vebus/276/Mode"), "{\"value\":3}"));
+
+  // the echo asked for is given with full_publish_completed
+
+  broker.Publish(client, R("keepalive"), "{\"keepalive-options\": [{\"full-publish-completed-echo\": \"42\"}]}");
+  venus.Step();
+  messages = Received(client);
+
+  CHECK(!messages.empty() && (messages.back().topic == N("full_publish_completed")) &&
+        (messages.back().payload.find("\"full-publish-completed-echo\":\"42\"") != std::string::npos));
+
+  // a read request publishes the value read, and a write request the value written, once the response time has passed
+
+  venus.SetResponseTime(200);
+
+  broker.Publish(client, R("system/0/Dc/Pv/Power"), "");
+  broker.Publish(client, W("vebus/276/Mode"), "{\"value\": 2}");
+  venus.Step();
+  CHECK(Received(client).empty());
+
+  HostAdvanceTime(200);
+  venus.Step();
+  messages = Received(client);
+
+  CHECK(messages.size() == 2);
+  CHECK(WasReceived(messages, N("system/0/Dc/Pv/Power"), "{\"value\":2380}"));
+  CHECK(WasReceived(messages, N("vebus/276/Mode"), "{\"value\":2}"));
+
+  venus.SetResponseTime(0);
+
+  // a write to a path that does not exist is ignored
+
+  broker.Publish(client, W("vebus/277/Mode"), "{\"value\": 2}");
+  venus.Step();
+  CHECK(Received(client).empty());
+
+  // with ESS, the solar charger's state is external control
+
+  venus.SetEssControlsSolarChargers(true);
+  CHECK(WasReceived(Received(client), N("solarcharger/279/State"), "{\"value\":252}"));
+  venus.SetEssControlsSolarChargers(false);
+  Received(client);
+
+  // once the keep alive has expired, changes are no longer published, and a keep alive suppressing the republish publishes them all
+
+  HostAdvanceTime(venusEmulator::keepAliveTime);
+  CHECK(venus.KeepAliveHasExpired());
+
+  venus.SetValue("system/0/Dc/Battery/Soc", "{\"value\":76.5}");
+  CHECK(Received(client).empty());
+
+  broker.Publish(client, R("keepalive"), "{\"keepalive-options\": [\"suppress-republish\"]}");
+  venus.Step();
+  CHECK(Received(client).size() == sizeof(venusTopics) / sizeof(venusTopics[0]) + 1);
+
+  // put back as it was for the sketch
+
+  venus.SetValue("vebus/276/Mode", "{\"value\":3}");
+  HostAdvanceTime(venusEmulator::keepAliveTime);
+
+  broker.Disconnect(client);
+}
+
+static void Run(unsigned long milliSeconds)
+{
+
+  // Venus takes its turn every 10 ms, between passes of the sketch's loop()
+
+  for (unsigned long ran = 0; ran < milliSeconds; ran += 10)
+  {
+    HostRunSketch(10);
+    venus.Step();
+  };
+}
+
+static void ReportTime(const std::string &output, const char *what, const char *line)
+{
+
+  size_t at = output.find(line);
+  CHECK(at != std::string::npos);
+  if (at == std::string::npos)
+    return;
+
+  size_t end = output.find('\n', at);
+  printf("%-40s %s\n", what, output.substr(at, end - at).c_str());
+}
+
+static void CheckTheSketch()
+{
+
+  // as Venus on a busy GX device, taking 50 ms to answer each request
+
+  venus.SetResponseTime(50);
+
+  setup();
+  Run(20000);
+
+  std::string output = HostTakeSerialOutput();
+
+  CHECK(output.find(std::string("*** Discovered Installation ID: ") + installationID) != std::string::npos);
+  CHECK(output.find("*** Discovered Multiplus three digit ID: 276") != std::string::npos);
+  CHECK(output.find("*** Discovered Solar Charger three digit ID: 279") != std::string::npos);
+
+  ReportTime(output, "discovery and subscription", "Subscribing (");
+  ReportTime(output, "MassSubscribe readiness", "All data received");
+
+  // the sketch's periodical keep alive requests keep Venus publishing
+
+  unsigned long keepAlivesReceived = venus.KeepAlivesReceived();
+  Run(3 * venusEmulator::keepAliveTime);
+
+  CHECK(!venus.KeepAliveHasExpired());
+  CHECK(venus.KeepAlivesReceived() >= keepAlivesReceived + 5);
+
+  // turning the charger off with the top button (and then the bottom one, for off) sets the Multiplus to inverter only, which Venus
+  // echoes back
+
+  HostTakeSerialOutput();
+
+  HostPressButton(PIN_BUTTON_1, 100);
+  HostPressButton(PIN_BUTTON_2, 100, 2000);
+  Run(5000);
+
+  output = HostTakeSerialOutput();
+
+  std::string mode;
+  CHECK(venus.Value("vebus/276/Mode", mode) && (mode == "{\"value\":2}"));
+  ReportTime(output, "mode change round trip", "Multiplus mode change confirmed");
+
+  // with ESS controlling the solar charger, the charging state is taken from the Multiplus's LEDs
+
+  venus.SetValue("vebus/276/Leds/Bulk", "{\"value\":0}");
+  venus.SetValue("vebus/276/Leds/Absorption", "{\"value\":1}");
+  venus.SetValue("vebus/276/Leds/Float", "{\"value\":0}");
+  venus.SetEssControlsSolarChargers(true);
+  Run(5000);
+
+  CHECK(ESSIsBeingUsed);
+  CHECK(strcmp(chargingState, "Absorption") == 0);
+}
+
+int main()
+{
+
+  CheckTheEmulator();
+  CheckTheSketch();
+
+  if (failures != 0)
+  {
+    printf("%s\n", HostTakeSerialOutput().c_str());
+    return 1;
+  };
+
+  printf("Venus emulator test passed\n");
+
+  return 0;
+}
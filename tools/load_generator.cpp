@@ -0,0 +1,201 @@
+// Load generator
+//
+// floods the sketch in the host build with messages on the topics it subscribes to under N/<installation id>/system/0/ (which depend
+// on its settings, such as the number of phases), at the rate and payload size given, published by the Venus emulator (see host/venus_emulator.h), and writes as one line of JSON how well the
+// sketch kept up:
+//
+//   topics, flooded           the topics flooded, and the messages published on them by the load generator
+//   published, delivered      the messages published during the flood (the flood's, and Venus's own republishes following each keep
+//                             alive request, some on topics the sketch has not subscribed to), and those the sketch's callbacks were
+//                             called for
+//   dropped_too_large         those dropped by the MQTT client as larger than its maximum packet size
+//   undelivered               those still waiting for the sketch when the flood ended, plus the drain time given to it
+//   late                      those delivered more than 100 ms after they were published
+//   peak_backlog              the most messages waiting for the sketch at any time
+//   callback_latency_ms       percentiles of the time from a message being published to the sketch's callbacks for it returning
+//   parsed_per_s              the payloads the sketch parsed (rather than found unchanged) a second of the flood
+//   host_messages_per_s       the messages delivered a second of this computer's time, for the speed of the parsing itself
+//   sketch                    the sketch's own ingestion statistics (its 'stats' serial monitor command) taken over the whole run
+//
+// as on the device, the MQTT client delivers one message each pass of loop(), and a pass takes at least a millisecond, so the rate the
+// sketch keeps up with is set by how long its passes take; the times are those of the virtual clock, which advances as the sketch reads
+// it (see host/host_board.h) rather than with the time the host takes, and the heap figures in the sketch's statistics are those of the
+// host build's stand-in for the ESP32, not a measurement; run the 'stats' command on the device for those
+//
+//   load_generator [messages a second] [payload bytes] [seconds]    by default 200 messages a second of 32 bytes for 60 seconds
+//
+// it is built with the host build (see CMakeLists.txt)
+
+#include "venus_emulator.h"
+#include "host_board.h"
+#include "host_broker.h"
+#include "EspMQTTClient.h"
+#include "ArduinoJson.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+void setup();
+
+extern EspMQTTClient client;
+
+static venusEmulator venus;
+
+static const char *installationID = "c0619ab1d2e3";
+
+static const char *floodedPaths[] = {"system/0/Ac/Grid/L1/Power", "system/0/Ac/Grid/L2/Power", "system/0/Ac/Grid/L3/Power",
+                                     "system/0/Dc/Pv/Power", "system/0/Dc/Battery/Soc", "system/0/Dc/Battery/Power",
+                                     "system/0/Dc/Battery/TimeToGo", "system/0/Dc/Battery/Temperature", "system/0/Ac/Consumption/L1/Power",
+                                     "system/0/Ac/Consumption/L2/Power", "system/0/Ac/Consumption/L3/Power"};
+
+static const int floodedTopics = sizeof(floodedPaths) / sizeof(floodedPaths[0]);
+
+static const uint64_t lateAfterMicroSeconds = 100000ULL;
+
+static void Run(unsigned long milliSeconds)
+{
+  for (unsigned long ran = 0; ran < milliSeconds; ran += 10)
+  {
+    HostRunSketch(10);
+    venus.Step();
+  };
+}
+
+static std::string Payload(unsigned long sequence, size_t payloadBytes)
+{
+
+  // a value which changes with each message, so that each is parsed, padded with spaces to the size given
+
+  char value[48];
+  snprintf(value, sizeof(value), "{\"value\":%lu.%lu", sequence % 10000UL / 10UL, sequence % 10UL);
+
+  std::string payload(value);
+  if (payload.size() + 1 < payloadBytes)
+    payload.append(payloadBytes - payload.size() - 1, ' ');
+  payload += "}";
+
+  return payload;
+}
+
+static std::string SketchStatistics()
+{
+
+  HostTakeSerialOutput();
+  HostSerialInput("stats\n");
+  HostRunSketch(1);
+
+  std::string output = HostTakeSerialOutput();
+  size_t start = output.find('{');
+  size_t end = output.find('\n', start);
+
+  return (start == std::string::npos) ? "{}" : output.substr(start, end - start);
+}
+
+static unsigned long PayloadsParsed(const std::string &statistics)
+{
+  JsonDocument doc;
+  deserializeJson(doc, statistics.c_str());
+  return doc["payloads_parsed"].as<unsigned long>();
+}
+
+static double Percentile(const std::vector<uint64_t> &sorted, double percentile)
+{
+  if (sorted.empty())
+    return 0.0;
+  size_t index = (size_t)(percentile / 100.0 * (double)(sorted.size() - 1) + 0.5);
+  return (double)sorted[index] / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+
+  unsigned long rate = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200UL;
+  size_t payloadBytes = (argc > 2) ? strtoul(argv[2], NULL, 10) : 32UL;
+  unsigned long seconds = (argc > 3) ? strtoul(argv[3], NULL, 10) : 60UL;
+
+  // an installation with one Multiplus and one solar charger, which the sketch finds and subscribes to before the flood starts
+
+  venus.Start(HostBroker(), installationID);
+  venus.SetValue("vebus/276/Mode", "{\"value\":3}");
+  venus.SetValue("solarcharger/279/Mode", "{\"value\":1}");
+  venus.SetValue("solarcharger/279/State", "{\"value\":3}");
+  for (int i = 0; i < floodedTopics; i++)
+    venus.SetValue(floodedPaths[i], "{\"value\":0}");
+
+  setup();
+  Run(20000);
+
+  std::vector<std::string> subscribedPaths;
+  for (int i = 0; i < floodedTopics; i++)
+    if (HostBroker().IsSubscribed(client.hostConnection(), std::string("N/") + installationID + "/" + floodedPaths[i]))
+      subscribedPaths.push_back(floodedPaths[i]);
+
+  if (subscribedPaths.empty())
+  {
+    printf("the sketch did not subscribe to the topics to be flooded\n");
+    return 1;
+  };
+
+  unsigned long parsedBefore = PayloadsParsed(SketchStatistics());
+  unsigned long droppedBefore = client.hostMessagesDropped();
+
+  client.hostTakeCallbackLatencies();
+  client.hostRecordCallbackLatencies(true);
+
+  // the flood, with the messages due in each millisecond published at its start
+
+  unsigned long flooded = 0;
+  unsigned long publishedBefore = venus.ValuesPublished();
+  size_t peakBacklog = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (unsigned long millisecond = 0; millisecond < seconds * 1000UL; millisecond++)
+  {
+
+    unsigned long due = (unsigned long)((unsigned long long)rate * (millisecond + 1) / 1000ULL);
+
+    for (; flooded < due; flooded++)
+      venus.SetValue(subscribedPaths[flooded % subscribedPaths.size()], Payload(flooded, payloadBytes));
+
+    HostRunSketch(1);
+    venus.Step();
+
+    peakBacklog = std::max(peakBacklog, HostBroker().MessagesWaiting(client.hostConnection()));
+  };
+
+  // a second to take in what is left
+
+  Run(1000);
+
+  double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  client.hostRecordCallbackLatencies(false);
+  std::vector<uint64_t> latencies = client.hostTakeCallbackLatencies();
+
+  std::string statistics = SketchStatistics();
+  unsigned long parsed = PayloadsParsed(statistics) - parsedBefore;
+
+  unsigned long published = venus.ValuesPublished() - publishedBefore;
+  unsigned long delivered = (unsigned long)latencies.size();
+  unsigned long droppedTooLarge = client.hostMessagesDropped() - droppedBefore;
+  unsigned long undelivered = (unsigned long)HostBroker().MessagesWaiting(client.hostConnection());
+
+  std::sort(latencies.begin(), latencies.end());
+  unsigned long late = (unsigned long)(latencies.end() - std::upper_bound(latencies.begin(), latencies.end(), lateAfterMicroSeconds));
+
+  printf("{\"rate_per_s\":%lu,\"payload_bytes\":%lu,\"seconds\":%lu,\"topics\":%lu,\"flooded\":%lu,\"published\":%lu,\"delivered\":%lu,\"dropped_too_large\":%lu,"
+         "\"undelivered\":%lu,\"late\":%lu,\"peak_backlog\":%lu,"
+         "\"callback_latency_ms\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+         "\"parsed_per_s\":%.1f,\"host_messages_per_s\":%.0f,\"sketch\":%s}\n",
+         rate, (unsigned long)payloadBytes, seconds, (unsigned long)subscribedPaths.size(), flooded, published, delivered, droppedTooLarge, undelivered, late, (unsigned long)peakBacklog,
+         Percentile(latencies, 50.0), Percentile(latencies, 90.0), Percentile(latencies, 99.0), Percentile(latencies, 100.0),
+         (double)parsed / (double)(seconds > 0 ? seconds : 1), hostSeconds > 0.0 ? (double)latencies.size() / hostSeconds : 0.0,
+         statistics.c_str());
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Telemetry log tool
+//
+// reads the telemetry log files written by the ESP32 Remote for Victron (the files in the telemetry folder of its FFat partition,
+// copied to a folder on this computer) using the same code as the sketch
+//
+//   telemetry_log_tool dump <folder> [from] [to]   the records, as comma separated values; from and to are times in seconds since 1 January 1970 (UTC)
+//   telemetry_log_tool benchmark <folder>          how well, and how quickly, the sample codec packs the records in the log
+//
+// it is built with the host build (see CMakeLists.txt), or on its own on Linux with:
+//
+//   g++ -O2 -I../ESP32RemoteForVictron telemetry_log_tool.cpp ../ESP32RemoteForVictron/telemetry_log.cpp ../ESP32RemoteForVictron/sample_codec.cpp -o telemetry_log_tool
+
+#include "telemetry_log.h"
+#include "sample_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+static void PrintRecord(const telemetryRecord &record, void *context)
+{
+  (void)context;
+  printf("%lu,%ld,%ld,%ld,%ld,%.1f,%.1f\n", (unsigned long)record.minute * 60UL, (long)record.values[SolarTelemetry], (long)record.values[GridTelemetry], (long)record.values[ACLoadTelemetry],
+         (long)record.values[BatteryPowerTelemetry], record.values[BatterySOCTelemetry] / 10.0, record.values[BatteryTemperatureTelemetry] / 10.0);
+}
+
+static void KeepRecord(const telemetryRecord &record, void *context)
+{
+  ((std::vector<telemetryRecord> *)context)->push_back(record);
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int Dump(uint32_t fromMinute, uint32_t toMinute)
+{
+  printf("time,solar W,grid W,AC load W,battery W,battery SOC %%,battery temperature C\n");
+  size_t records = ReadTelemetryLog(fromMinute, toMinute, PrintRecord, NULL);
+  fprintf(stderr, "%lu records\n", (unsigned long)records);
+  return 0;
+}
+
+static int Benchmark()
+{
+
+  std::vector<telemetryRecord> records;
+  ReadTelemetryLog(0, 0xFFFFFFFFUL, KeepRecord, &records);
+
+  if (records.empty())
+  {
+    fprintf(stderr, "the log has no records\n");
+    return 1;
+  };
+
+  // pack the records into blocks the size of the log's (in the log, each flush starts a new chunk within a block), repeating the whole log until enough time has passed to measure
+
+  const size_t blockSize = telemetryLogBlockSize;
+  std::vector<std::vector<uint8_t>> blocks;
+  std::vector<uint32_t> blockStartMinutes;
+
+  int passes = 0;
+  size_t encodedBytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  do
+  {
+
+    blocks.clear();
+    blockStartMinutes.clear();
+    encodedBytes = 0;
+
+    sampleEncoder encoder;
+    size_t length = 0;
+
+    for (size_t r = 0; r < records.size(); r++)
+    {
+      if (blocks.empty() || !EncodeSample(encoder, blocks.back().data(), blockSize, length, records[r].minute, records[r].values))
+      {
+        if (!blocks.empty())
+          blocks.back().resize(length);
+        encodedBytes += length;
+        blocks.push_back(std::vector<uint8_t>(blockSize));
+        blockStartMinutes.push_back(records[r].minute);
+        BeginSampleEncoder(encoder, telemetryValues, records[r].minute);
+        length = 0;
+        EncodeSample(encoder, blocks.back().data(), blockSize, length, records[r].minute, records[r].values);
+      };
+    };
+    blocks.back().resize(length);
+    encodedBytes += length;
+
+    passes++;
+  } while (SecondsSince(start) < 1.0);
+  double encodeSeconds = SecondsSince(start) / passes;
+
+  // then read them back, checking that they are the same
+
+  size_t decodedRecords = 0;
+  passes = 0;
+  start = std::chrono::steady_clock::now();
+  do
+  {
+
+    decodedRecords = 0;
+
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+      sampleDecoder decoder;
+      BeginSampleDecoder(decoder, telemetryValues, blockStartMinutes[b], blocks[b].data(), blocks[b].size());
+
+      telemetryRecord record;
+      while (DecodeSample(decoder, record.minute, record.values))
+      {
+        if ((decodedRecords >= records.size()) || (record.minute != records[decodedRecords].minute) || (memcmp(record.values, records[decodedRecords].values, sizeof(record.values)) != 0))
+        {
+          fprintf(stderr, "record %lu did not decode correctly\n", (unsigned long)decodedRecords);
+          return 1;
+        };
+        decodedRecords++;
+      };
+    };
+
+    passes++;
+  } while (SecondsSince(start) < 1.0);
+  double decodeSeconds = SecondsSince(start) / passes;
+
+  size_t rawBytes = records.size() * sizeof(telemetryRecord);
+
+  printf("records:          %lu\n", (unsigned long)records.size());
+  printf("unpacked bytes:   %lu (%lu a record)\n", (unsigned long)rawBytes, (unsigned long)sizeof(telemetryRecord));
+  printf("packed bytes:     %lu (%.2f a record)\n", (unsigned long)encodedBytes, (double)encodedBytes / records.size());
+  printf("compression:      %.1f to 1\n", (double)rawBytes / encodedBytes);
+  printf("encoding:         %.1f million records a second\n", records.size() / encodeSeconds / 1e6);
+  printf("decoding:         %.1f million records a second\n", decodedRecords / decodeSeconds / 1e6);
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+
+  if ((argc < 3) || ((strcmp(argv[1], "dump") != 0) && (strcmp(argv[1], "benchmark") != 0)))
+  {
+    fprintf(stderr, "usage: %s dump <folder> [from] [to]\n       %s benchmark <folder>\n", argv[0], argv[0]);
+    return 2;
+  };
+
+  if (!BeginTelemetryLog(argv[2]))
+  {
+    fprintf(stderr, "%s could not be read\n", argv[2]);
+    return 1;
+  };
+
+  if (strcmp(argv[1], "benchmark") == 0)
+    return Benchmark();
+
+  uint32_t fromMinute = (argc > 3) ? (uint32_t)(strtoul(argv[3], NULL, 10) / 60) : 0;
+  uint32_t toMinute = (argc > 4) ? (uint32_t)(strtoul(argv[4], NULL, 10) / 60) : 0xFFFFFFFFUL;
+
+  return Dump(fromMinute, toMinute);
+}
@@ -0,0 +1,97 @@
+// Traffic replay tool
+//
+// replays MQTT traffic recorded from Venus by the sketch (with its 'record', 'stop' and 'recording' serial monitor commands, whose
+// output is saved to a file) to the sketch in the host build, then sends the sketch's ingestion statistics and loop profile; see
+// host/traffic_replay.h
+//
+//   traffic_replay <recording> [speed]      replay the recording at the speed given (for example 1, 10 or 100), or as recorded
+//   traffic_replay <recording> save <log>   save the recording as a traffic log, which takes far less space than the text
+//
+// it is built with the host build (see CMakeLists.txt)
+
+#include "traffic_replay.h"
+#include "venus_emulator.h"
+#include "host_board.h"
+#include "host_broker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+void setup();
+
+static venusEmulator venus;
+
+static void Run(unsigned long milliSeconds)
+{
+  for (unsigned long ran = 0; ran < milliSeconds; ran += 10)
+  {
+    HostRunSketch(10);
+    venus.Step();
+  };
+}
+
+int main(int argc, char **argv)
+{
+
+  if (argc < 2)
+  {
+    printf("usage: traffic_replay <recording> [speed]\n       traffic_replay <recording> save <log>\n");
+    return 2;
+  };
+
+  std::vector<trafficMessage> messages;
+  if (!LoadTrafficRecording(argv[1], messages))
+  {
+    printf("%s is not a recording of MQTT traffic\n", argv[1]);
+    return 1;
+  };
+
+  if ((argc > 3) && (strcmp(argv[2], "save") == 0))
+  {
+    if (!SaveTrafficLog(argv[3], messages))
+    {
+      printf("%s could not be written\n", argv[3]);
+      return 1;
+    };
+    printf("%lu messages saved\n", (unsigned long)messages.size());
+    return 0;
+  };
+
+  unsigned long speed = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1UL;
+  if (speed == 0)
+    speed = 1;
+
+  std::string installationID = TrafficInstallationID(messages);
+  if (installationID.empty())
+  {
+    printf("%s holds no messages published by Venus\n", argv[1]);
+    return 1;
+  };
+
+  // the sketch finds the installation and subscribes, then the recording is replayed
+
+  venus.Start(HostBroker(), installationID);
+  SetInitialValues(venus, messages);
+
+  setup();
+  Run(20000);
+  HostTakeSerialOutput();
+
+  auto start = std::chrono::steady_clock::now();
+
+  unsigned long handedOver = ReplayTraffic(venus, messages, speed);
+  Run(1000);
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  HostTakeSerialOutput();
+  HostSerialInput("stats\nprofile\n");
+  HostRunSketch(10);
+
+  printf("%lu messages replayed at %lux, %.1f s of the recording in %.1f s\n", handedOver, speed,
+         messages.empty() ? 0.0 : messages.back().time / 1000.0, seconds);
+  printf("%s", HostTakeSerialOutput().c_str());
+
+  return 0;
+}